@@ -441,6 +441,16 @@ xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx*/
          default value.  This function never fails. All exceptions are cleared.
        */
 
+     PyAPI_FUNC(Py_ssize_t) _PyObject_LengthHintNoMask(PyObject *o);
+
+       /*
+         Like _PyObject_LengthHint(), but only the TypeError or
+         AttributeError saying that o has no length is cleared.  Return -1
+         with no exception set if o has no length hint, and -1 with one set
+         if len(o) or o.__length_hint__() fails in some other way.  For
+         __length_hint__() methods that pass on that of another object.
+       */
+
      PyAPI_FUNC(PyObject *) PyObject_GetItem(PyObject *o, PyObject *key);
 
        /*
@@ -7,6 +7,12 @@ extern "C" {
 PyAPI_FUNC(mod_ty) PyAST_FromNode(const node *, PyCompilerFlags *flags,
 				  const char *, PyArena *);
 
+/* Without a CST; NULL with no exception set means parse through one */
+PyAPI_FUNC(mod_ty) _PyAST_FromString(const char *, const char *, int,
+				     PyCompilerFlags *, PyArena *);
+PyAPI_FUNC(mod_ty) _PyAST_FromFile(FILE *, const char *, int,
+				   PyCompilerFlags *, PyArena *);
+
 #ifdef __cplusplus
 }
 #endif
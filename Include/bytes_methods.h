@@ -13,12 +13,11 @@ extern PyObject* _Py_bytes_islower(const char *cptr, Py_ssize_t len);
 extern PyObject* _Py_bytes_isupper(const char *cptr, Py_ssize_t len);
 extern PyObject* _Py_bytes_istitle(const char *cptr, Py_ssize_t len);
 
-/* These store their len sized answer in the given preallocated *result arg. */
-extern void _Py_bytes_lower(char *result, const char *cptr, Py_ssize_t len);
-extern void _Py_bytes_upper(char *result, const char *cptr, Py_ssize_t len);
+/* These store their len sized answer in the given preallocated *result arg.
+   _Py_bytes_lower(), _Py_bytes_upper() and _Py_bytes_swapcase() are declared
+   in stringobject.h, since str uses them too. */
 extern void _Py_bytes_title(char *result, char *s, Py_ssize_t len);
 extern void _Py_bytes_capitalize(char *result, char *s, Py_ssize_t len);
-extern void _Py_bytes_swapcase(char *result, char *s, Py_ssize_t len);
 
 /* Shared __doc__ strings. */
 extern const char _Py_isspace__doc__[];
@@ -25,6 +25,7 @@ typedef struct {
     int co_firstlineno;		/* first source line number */
     PyObject *co_lnotab;	/* string (encoding addr<->lineno mapping) */
     void *co_zombieframe;     /* for optimization only (see frameobject.c) */
+    int co_lazyconsts;		/* co_consts has lazily loaded code objects */
 } PyCodeObject;
 
 /* Masks for co_flags above */
@@ -40,6 +41,11 @@ typedef struct {
    call frame it setup.
 */
 #define CO_NOFREE       0x0040
+/* The CO_GENEXP_MAP flag is set on generator expressions with one for
+   clause and no if clause.  Like imap(), they yield once for each item of
+   the iterator they're passed, so their length hint is that iterator's.
+*/
+#define CO_GENEXP_MAP   0x0080
 
 #if 0
 /* This is no longer used.  Stopped defining in 2.5, do not re-use. */
@@ -65,6 +71,22 @@ PyAPI_DATA(PyTypeObject) PyCode_Type;
 #define PyCode_Check(op) (Py_TYPE(op) == &PyCode_Type)
 #define PyCode_GetNumFree(op) (PyTuple_GET_SIZE((op)->co_freevars))
 
+/* Stands in for a code object among the constants of another code object
+   until it is needed; see Python/marshal.c.  _PyLazyCode_Load() returns a
+   borrowed reference to the code object.  _PyCode_LoadConsts() gives co a
+   new co_consts with all of them replaced; PyFrame_New() calls it, so
+   that a code object being run never has any, and C code that reads the
+   co_consts of a code object it didn't get from a frame must call it
+   first.  Only code objects read by marshal can be part of a cycle: the
+   lazy code objects refer back to what was read before them, which can
+   include code objects that hold them, however deep down.  marshal has
+   the garbage collector track those code objects, and only those. */
+PyAPI_DATA(PyTypeObject) _PyLazyCode_Type;
+#define _PyLazyCode_Check(op) (Py_TYPE(op) == &_PyLazyCode_Type)
+PyAPI_FUNC(PyObject *) _PyLazyCode_Load(PyObject *);
+PyAPI_FUNC(int) _PyCode_LoadConsts(PyCodeObject *);
+#define _PyCode_HAS_LAZY_CONSTS(co) ((co)->co_lazyconsts)
+
 /* Public interface */
 PyAPI_FUNC(PyCodeObject *) PyCode_New(
 	int, int, int, int, PyObject *, PyObject *, PyObject *, PyObject *,
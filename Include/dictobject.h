@@ -65,7 +65,22 @@ ma_used is the number of non-NULL, non-dummy keys (== the number of non-NULL
 values == the number of Active items).
 To avoid slowing down lookups on a near-full table, we resize the table when
 it's two-thirds full.
+
+ma_version is a version tag.  It is given a fresh value, never before seen
+by any dict, whenever the dict is created or its contents change (insert,
+replace, delete, clear or resize), so a cache can remember the tag and
+compare it later instead of repeating a lookup.  The low PyDict_MAX_WATCHERS
+bits record which watchers observe this dict; use PyDict_GET_VERSION() to
+read the tag itself.
 */
+#ifdef HAVE_LONG_LONG
+typedef unsigned PY_LONG_LONG Py_dictversion_t;
+#else
+typedef size_t Py_dictversion_t;
+#endif
+
+#define PyDict_MAX_WATCHERS 8
+
 typedef struct _dictobject PyDictObject;
 struct _dictobject {
 	PyObject_HEAD
@@ -85,6 +100,7 @@ struct _dictobject {
 	 */
 	PyDictEntry *ma_table;
 	PyDictEntry *(*ma_lookup)(PyDictObject *mp, PyObject *key, long hash);
+	Py_dictversion_t ma_version;
 	PyDictEntry ma_smalltable[PyDict_MINSIZE];
 };
 
@@ -139,6 +155,34 @@ PyAPI_FUNC(PyObject *) PyDict_GetItemString(PyObject *dp, const char *key);
 PyAPI_FUNC(int) PyDict_SetItemString(PyObject *dp, const char *key, PyObject *item);
 PyAPI_FUNC(int) PyDict_DelItemString(PyObject *dp, const char *key);
 
+/* Dict watchers.  A watcher callback is registered once with
+   PyDict_AddWatcher(), which returns its id (or -1 with an exception set),
+   and is then enabled per dict with PyDict_Watch().  The callback runs
+   before the dict is changed; for PyDict_EVENT_MODIFIED, new_value is the
+   value about to be stored.  Callbacks must not modify the dict.  For
+   PyDict_EVENT_DEALLOCATED the dict is kept alive during the callback, and
+   is not freed if the callback took a reference to it.  A callback
+   returning -1 has its exception reported with PyErr_WriteUnraisable(). */
+typedef enum {
+	PyDict_EVENT_ADDED,
+	PyDict_EVENT_MODIFIED,
+	PyDict_EVENT_DELETED,
+	PyDict_EVENT_CLEARED,
+	PyDict_EVENT_DEALLOCATED
+} PyDict_WatchEvent;
+
+typedef int (*PyDict_WatchCallback)(PyDict_WatchEvent event, PyObject *dict,
+				    PyObject *key, PyObject *new_value);
+
+PyAPI_FUNC(int) PyDict_AddWatcher(PyDict_WatchCallback callback);
+PyAPI_FUNC(int) PyDict_ClearWatcher(int watcher_id);
+PyAPI_FUNC(int) PyDict_Watch(int watcher_id, PyObject *dict);
+PyAPI_FUNC(int) PyDict_Unwatch(int watcher_id, PyObject *dict);
+
+#define PyDict_GET_VERSION(op) \
+	(((PyDictObject *)(op))->ma_version & \
+	 ~(Py_dictversion_t)((1 << PyDict_MAX_WATCHERS) - 1))
+
 PyAPI_FUNC(void) PyDict_SetStrictLookup(PyObject *dp);
 PyAPI_FUNC(long) PyDict_GetHashFromKey(PyObject *key);
 PyAPI_FUNC(PyObject *) PyDict_GetItemWithHash(PyObject *mp, PyObject *key, long hash);
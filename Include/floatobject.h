@@ -114,6 +114,7 @@ PyAPI_FUNC(double) _PyFloat_Unpack8(const unsigned char *p, int le);
 
 /* free list api */
 PyAPI_FUNC(int) PyFloat_ClearFreeList(void);
+PyAPI_FUNC(void) _PyFloat_FreeListStats(Py_ssize_t *count, Py_ssize_t *nbytes);
 
 /* Format the object based on the format_spec, as defined in PEP 3101
    (Advanced String Formatting). */
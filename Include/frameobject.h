@@ -76,6 +76,7 @@ PyAPI_FUNC(void) PyFrame_LocalsToFast(PyFrameObject *, int);
 PyAPI_FUNC(void) PyFrame_FastToLocals(PyFrameObject *);
 
 PyAPI_FUNC(int) PyFrame_ClearFreeList(void);
+PyAPI_FUNC(void) _PyFrame_FreeListStats(Py_ssize_t *count, Py_ssize_t *nbytes);
 
 #ifdef __cplusplus
 }
@@ -57,6 +57,10 @@ struct _frozen {
 
 PyAPI_DATA(struct _frozen *) PyImport_FrozenModules;
 
+/* Standard library modules built into the interpreter, sorted by name: */
+
+PyAPI_DATA(struct _frozen) _PyImport_FrozenStdlib[];
+
 #ifdef __cplusplus
 }
 #endif
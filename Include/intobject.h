@@ -61,6 +61,7 @@ PyAPI_FUNC(long) PyOS_strtol(char *, char **, int);
 
 /* free list api */
 PyAPI_FUNC(int) PyInt_ClearFreeList(void);
+PyAPI_FUNC(void) _PyInt_FreeListStats(Py_ssize_t *count, Py_ssize_t *nbytes);
 
 /* Convert an integer to the given base.  Returns a string.
    If base is 2, 8 or 16, add the proper prefix '0b', '0o' or '0x'.
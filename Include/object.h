@@ -84,6 +84,33 @@ whose size is determined when the object is allocated.
 	_PyObject_EXTRA_INIT		\
 	1, type,
 
+/* Immortal objects.  Objects that live as long as the interpreter -- None,
+ * True and False, the small ints, the one-character strings -- can be given
+ * a reference count with _Py_IMMORTAL_BIT set.  Py_INCREF and Py_DECREF
+ * then leave them alone, so their header cache lines stay shared between
+ * CPUs and their pages stay shared between processes after fork().  The
+ * count starts half way between the bit and the next one up, so code that
+ * still adjusts ob_refcnt directly (or was compiled without immortal object
+ * support) can't move it in or out of the immortal range.  Without
+ * WITH_IMMORTAL_OBJECTS, these objects are simply created with a count of 1
+ * and owned by whatever caches them, as before.
+ */
+#ifdef WITH_IMMORTAL_OBJECTS
+#define _Py_IMMORTAL_BIT	((PY_SSIZE_T_MAX >> 1) + 1)
+#define _Py_IMMORTAL_REFCNT	(_Py_IMMORTAL_BIT | (_Py_IMMORTAL_BIT >> 1))
+#define _Py_IsImmortal(op) \
+	((((PyObject*)(op))->ob_refcnt & _Py_IMMORTAL_BIT) != 0)
+#define _Py_SetImmortal(op) (Py_REFCNT(op) = _Py_IMMORTAL_REFCNT)
+#else
+#define _Py_IMMORTAL_REFCNT	1
+#define _Py_IsImmortal(op)	0
+#define _Py_SetImmortal(op)	((void)0)
+#endif
+
+#define PyObject_HEAD_INIT_IMMORTAL(type)	\
+	_PyObject_EXTRA_INIT			\
+	_Py_IMMORTAL_REFCNT, type,
+
 #define PyVarObject_HEAD_INIT(type, size)	\
 	PyObject_HEAD_INIT(type) size,
 
@@ -746,6 +773,21 @@ PyAPI_FUNC(void) _Py_AddToAllObjects(PyObject *, int force);
 	(*Py_TYPE(op)->tp_dealloc)((PyObject *)(op)))
 #endif /* !Py_TRACE_REFS */
 
+#ifdef WITH_IMMORTAL_OBJECTS
+#define Py_INCREF(op) (					\
+	_Py_IsImmortal(op) ? (void)0 :			\
+	(void)(_Py_INC_REFTOTAL  _Py_REF_DEBUG_COMMA	\
+	       ((PyObject*)(op))->ob_refcnt++))
+
+#define Py_DECREF(op)					\
+	if (_Py_IsImmortal(op))				\
+		{ }					\
+	else if (_Py_DEC_REFTOTAL  _Py_REF_DEBUG_COMMA	\
+	    --((PyObject*)(op))->ob_refcnt != 0)		\
+		_Py_CHECK_REFCNT(op)			\
+	else						\
+		_Py_Dealloc((PyObject *)(op))
+#else
 #define Py_INCREF(op) (				\
 	_Py_INC_REFTOTAL  _Py_REF_DEBUG_COMMA	\
 	((PyObject*)(op))->ob_refcnt++)
@@ -756,6 +798,7 @@ PyAPI_FUNC(void) _Py_AddToAllObjects(PyObject *, int force);
 		_Py_CHECK_REFCNT(op)			\
 	else						\
 		_Py_Dealloc((PyObject *)(op))
+#endif /* WITH_IMMORTAL_OBJECTS */
 
 /* Safely decref `op` and set `op` to NULL, especially useful in tp_clear
  * and tp_dealloc implementatons.
@@ -101,6 +101,40 @@ PyAPI_FUNC(void) PyObject_Free(void *);
 
 /* Macros */
 #ifdef WITH_PYMALLOC
+/* pymalloc statistics, available in release builds too.  Only size classes
+   owning at least one pool are reported in sizeclasses. */
+#define PyMalloc_MAX_SIZE_CLASSES 64
+
+typedef struct {
+	size_t block_size;
+	size_t pools;
+	size_t blocks_in_use;
+	size_t blocks_available;
+} PyMallocSizeClassStats;
+
+typedef struct {
+	size_t small_request_threshold;
+	size_t pool_size;
+	size_t arena_size;
+	size_t arenas_allocated_total;
+	size_t arenas_reclaimed;
+	size_t arenas_highwater;
+	size_t arenas_allocated_current;
+	size_t parked_arenas;	/* empty arenas kept mapped for reuse */
+	size_t free_pools;
+	size_t released_pools;	/* free pools given back to the system */
+	size_t allocated_bytes;
+	size_t available_bytes;
+	size_t pool_header_bytes;
+	size_t quantization_bytes;
+	size_t arena_alignment_bytes;
+	unsigned int nsizeclasses;
+	PyMallocSizeClassStats sizeclasses[PyMalloc_MAX_SIZE_CLASSES];
+} PyMallocStats;
+
+PyAPI_FUNC(void) _PyObject_GetMallocStats(PyMallocStats *);
+PyAPI_FUNC(size_t) _PyObject_ReleaseFreePools(void);
+
 #ifdef PYMALLOC_DEBUG	/* WITH_PYMALLOC && PYMALLOC_DEBUG */
 PyAPI_FUNC(void *) _PyObject_DebugMalloc(size_t nbytes);
 PyAPI_FUNC(void *) _PyObject_DebugRealloc(void *p, size_t nbytes);
@@ -17,7 +17,8 @@ extern "C" {
      arena will ensure that the PyObjects stay alive at least until
      PyArena_Free() is called.  When an arena is freed, all the memory it
      allocated is freed, the arena releases internal references to registered
-     PyObject*, and none of its pointers are valid.
+     PyObject*, and none of its pointers are valid.  A few freed arenas are
+     kept, with their memory, for PyArena_New() to hand out again.
      XXX (tim) What does "none of its pointers are valid" mean?  Does it
      XXX mean that pointers previously obtained via PyArena_Malloc() are
      XXX no longer valid?  (That's clearly true, but not sure that's what
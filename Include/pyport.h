@@ -230,6 +230,23 @@ typedef Py_intptr_t	Py_ssize_t;
 #define Py_MEMCPY memcpy
 #endif
 
+/* Py_HAVE_SSE2 is defined when the SSE2 intrinsics from <emmintrin.h> can
+ * be used unconditionally; SSE2 is part of the x86-64 baseline.
+ *
+ * Py_HAVE_AVX2_TARGET is defined when a single function can be compiled for
+ * AVX2 by marking it Py_TARGET_AVX2.  Such a function must only be called
+ * once Py_CPU_HAS_AVX2() has returned true at runtime.
+ */
+#if defined(__GNUC__) && defined(__SSE2__)
+#define Py_HAVE_SSE2 1
+#if defined(__x86_64__) && (defined(__clang__) || __GNUC__ > 4 || \
+			    (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define Py_HAVE_AVX2_TARGET 1
+#define Py_TARGET_AVX2 __attribute__((target("avx2")))
+#define Py_CPU_HAS_AVX2() __builtin_cpu_supports("avx2")
+#endif
+#endif
+
 #include <stdlib.h>
 
 #include <math.h> /* Moved here from the math section, before extern "C" */
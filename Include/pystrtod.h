@@ -9,6 +9,7 @@ extern "C" {
 PyAPI_FUNC(double) PyOS_ascii_strtod(const char *str, char **ptr);
 PyAPI_FUNC(double) PyOS_ascii_atof(const char *str);
 PyAPI_FUNC(char *) PyOS_ascii_formatd(char *buffer, size_t buf_len,  const char *format, double d);
+PyAPI_FUNC(char *) _PyOS_ascii_formatd_shortest(char *buffer, size_t buf_len, double d, int precision);
 
 
 #ifdef __cplusplus
@@ -67,6 +67,10 @@ PyAPI_FUNC(PyObject *) Py_CompileStringFlags(const char *, const char *, int,
 					     PyCompilerFlags *);
 PyAPI_FUNC(struct symtable *) Py_SymtableString(const char *, const char *, int);
 
+/* Kilobytes of code the compile() cache may keep; 0 turns it off */
+PyAPI_DATA(Py_ssize_t) Py_CompileCacheSize;
+PyAPI_FUNC(PyObject *) _PyCompileCache_GetStats(void);
+
 PyAPI_FUNC(void) PyErr_Print(void);
 PyAPI_FUNC(void) PyErr_PrintEx(int);
 PyAPI_FUNC(void) PyErr_Display(PyObject *, PyObject *, PyObject *);
@@ -104,6 +108,7 @@ PyAPI_FUNC(char *) Py_GetProgramFullPath(void);
 PyAPI_FUNC(char *) Py_GetPrefix(void);
 PyAPI_FUNC(char *) Py_GetExecPrefix(void);
 PyAPI_FUNC(char *) Py_GetPath(void);
+PyAPI_FUNC(char *) _Py_GetStdlibDir(void);
 
 /* In their own files */
 PyAPI_FUNC(const char *) Py_GetVersion(void);
@@ -129,6 +134,8 @@ PyAPI_FUNC(int) PyByteArray_Init(void);
 /* Various internal finalizers */
 PyAPI_FUNC(void) _PyExc_Fini(void);
 PyAPI_FUNC(void) _PyImport_Fini(void);
+PyAPI_FUNC(void) _PyCompileCache_Fini(void);
+PyAPI_FUNC(void) PyArena_Fini(void);
 PyAPI_FUNC(void) PyMethod_Fini(void);
 PyAPI_FUNC(void) PyFrame_Fini(void);
 PyAPI_FUNC(void) PyCFunction_Fini(void);
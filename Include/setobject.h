@@ -17,9 +17,14 @@ There are three kinds of slots in the table:
 Note: .pop() abuses the hash field of an Unused or Dummy slot to
 hold a search finger.  The hash field of Unused or Dummy slots has
 no meaning otherwise.
+
+Each slot also has a control byte, which says which kind it is and, for an
+Active slot, holds 7 bits of the key's hash.  Lookups compare the control
+bytes of a group of PySet_GROUPSIZE slots at once.
 */
 
 #define PySet_MINSIZE 8
+#define PySet_GROUPSIZE 16
 
 typedef struct {
 	long hash;      /* cached hash code for the entry key */
@@ -52,6 +57,13 @@ struct _setobject {
 	setentry *(*lookup)(PySetObject *so, PyObject *key, long hash);
 	setentry smalltable[PySet_MINSIZE];
 
+	/* ctrl points to smallctrl for small tables, whose bytes past
+	 * PySet_MINSIZE always say Unused, else to the mask + 1 bytes just
+	 * past the end of table, which are malloc'ed along with it.
+	 */
+	unsigned char *ctrl;
+	unsigned char smallctrl[PySet_GROUPSIZE];
+
 	long hash;		/* only used by frozenset objects */
 	PyObject *weakreflist;	/* List of weak references */
 };
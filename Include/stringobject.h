@@ -95,6 +95,26 @@ PyAPI_FUNC(void) _Py_ReleaseInternedStrings(void);
    x must be an iterable object. */
 PyAPI_FUNC(PyObject *) _PyString_Join(PyObject *sep, PyObject *x);
 
+/* Byte kernels shared by str and bytearray, in Objects/bytes_methods.c.
+   They store their len sized answer in the preallocated result.  The case
+   conversions only touch the ASCII letters, whatever the locale;
+   _Py_bytes_translate() maps every byte through a 256 byte table and
+   returns nonzero if that changed any of them. */
+PyAPI_FUNC(void) _Py_bytes_lower(char *result, const char *cptr,
+				 Py_ssize_t len);
+PyAPI_FUNC(void) _Py_bytes_upper(char *result, const char *cptr,
+				 Py_ssize_t len);
+PyAPI_FUNC(void) _Py_bytes_swapcase(char *result, const char *cptr,
+				    Py_ssize_t len);
+PyAPI_FUNC(int) _Py_bytes_translate(char *result, const char *cptr,
+				    Py_ssize_t len, const char *table);
+
+/* str.lower(), str.upper() and str.swapcase() follow the C library's
+   ctype functions, and can only use the kernels above while those agree
+   with ASCII.  _PyString_CheckCtype() finds out whether they do; call it
+   after changing LC_CTYPE. */
+PyAPI_FUNC(void) _PyString_CheckCtype(void);
+
 /* --- Generic Codecs ----------------------------------------------------- */
 
 /* Create an object by decoding the encoded string s of the
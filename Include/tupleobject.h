@@ -53,7 +53,24 @@ PyAPI_FUNC(PyObject *) PyTuple_DeepCopy(PyObject *);
 /* Macro, *only* to be used to fill in brand new tuples */
 #define PyTuple_SET_ITEM(op, i, v) (((PyTupleObject *)(op))->ob_item[i] = v)
 
+/* Exact tuples of two or more items cache their hash in an extra slot after
+   the last item; it's -1 until the hash has been computed.  Code that puts
+   new items into a tuple it has already handed out (reusing it because it
+   holds the only reference) must call _PyTuple_RESET_HASH() as well.  For
+   extensions that predate the cache and only check that they hold the only
+   reference, the slot is neither read nor written while that is the case,
+   see _PyTuple_HASH_CACHED(). */
+#define _PyTuple_CACHES_HASH(op) \
+    (Py_SIZE(op) >= 2 && PyTuple_CheckExact(op))
+#define _PyTuple_HASH_CACHED(op) \
+    (_PyTuple_CACHES_HASH(op) && Py_REFCNT(op) > 1)
+#define _PyTuple_HASH_SLOT(op) \
+    (*(long *)&((PyTupleObject *)(op))->ob_item[Py_SIZE(op)])
+#define _PyTuple_RESET_HASH(op) \
+    do { if (_PyTuple_CACHES_HASH(op)) _PyTuple_HASH_SLOT(op) = -1; } while (0)
+
 PyAPI_FUNC(int) PyTuple_ClearFreeList(void);
+PyAPI_FUNC(void) _PyTuple_FreeListStats(Py_ssize_t *count, Py_ssize_t *nbytes);
 
 #ifdef __cplusplus
 }
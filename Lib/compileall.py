@@ -16,10 +16,10 @@ import os
 import sys
 import py_compile
 
-__all__ = ["compile_dir","compile_path"]
+__all__ = ["compile_dir","compile_file","compile_path"]
 
 def compile_dir(dir, maxlevels=10, ddir=None,
-                force=0, rx=None, quiet=0):
+                force=0, rx=None, quiet=0, workers=1):
     """Byte-compile all modules in the given directory tree.
 
     Arguments (only dir is required):
@@ -30,8 +30,50 @@ def compile_dir(dir, maxlevels=10, ddir=None,
                directory name that will show up in error messages)
     force:     if 1, force compilation, even if timestamps are up-to-date
     quiet:     if 1, be quiet during compilation
+    workers:   number of processes to compile in (default 1); 0 means
+               one per CPU
 
     """
+    pool = _make_pool(workers)
+    try:
+        return _compile_files(_walk_dir(dir, maxlevels, ddir, rx, quiet),
+                              force, quiet, pool)
+    finally:
+        _close_pool(pool)
+
+def _make_pool(workers):
+    """Return a process pool of workers processes (0: one per CPU), or None
+    to compile in this process."""
+    if workers == 1:
+        return None
+    try:
+        from multiprocessing import Pool
+        return Pool(workers or None)
+    except (ImportError, OSError, NotImplementedError):
+        # No working process pool here: compile in this process
+        return None
+
+def _close_pool(pool):
+    if pool is not None:
+        pool.terminate()
+        pool.join()
+
+def _compile_files(files, force, quiet, pool):
+    """Compile the (fullname, ddir) pairs of files, in pool if not None."""
+    if pool is not None:
+        results = pool.map(_compile_file,
+                           [(fullname, dname, force, None, quiet)
+                            for fullname, dname in files])
+        return min([1] + results)
+    success = 1
+    for fullname, dname in files:
+        if not compile_file(fullname, dname, force, None, quiet):
+            success = 0
+    return success
+
+def _walk_dir(dir, maxlevels, ddir, rx, quiet):
+    """Generate the (fullname, ddir) of the modules compile_dir() compiles,
+    in order."""
     if not quiet:
         print 'Listing', dir, '...'
     try:
@@ -40,7 +82,6 @@ def compile_dir(dir, maxlevels=10, ddir=None,
         print "Can't list", dir
         names = []
     names.sort()
-    success = 1
     for name in names:
         fullname = os.path.join(dir, name)
         if ddir is not None:
@@ -52,39 +93,79 @@ def compile_dir(dir, maxlevels=10, ddir=None,
             if mo:
                 continue
         if os.path.isfile(fullname):
-            head, tail = name[:-3], name[-3:]
-            if tail == '.py':
-                cfile = fullname + (__debug__ and 'c' or 'o')
-                ftime = os.stat(fullname).st_mtime
-                try: ctime = os.stat(cfile).st_mtime
-                except os.error: ctime = 0
-                if (ctime > ftime) and not force: continue
-                if not quiet:
-                    print 'Compiling', fullname, '...'
-                try:
-                    ok = py_compile.compile(fullname, None, dfile, True)
-                except KeyboardInterrupt:
-                    raise KeyboardInterrupt
-                except py_compile.PyCompileError,err:
-                    if quiet:
-                        print 'Compiling', fullname, '...'
-                    print err.msg
-                    success = 0
-                except IOError, e:
-                    print "Sorry", e
-                    success = 0
-                else:
-                    if ok == 0:
-                        success = 0
+            if name[-3:] == '.py':
+                yield fullname, ddir
         elif maxlevels > 0 and \
              name != os.curdir and name != os.pardir and \
              os.path.isdir(fullname) and \
              not os.path.islink(fullname):
-            if not compile_dir(fullname, maxlevels - 1, dfile, force, rx, quiet):
+            for item in _walk_dir(fullname, maxlevels - 1, dfile, rx, quiet):
+                yield item
+
+def _compile_file(args):
+    """compile_file() for Pool.map()"""
+    return compile_file(*args)
+
+def compile_file(fullname, ddir=None, force=0, rx=None, quiet=0):
+    """Byte-compile one file.
+
+    Arguments (only fullname is required):
+
+    fullname:  the file to byte-compile
+    ddir:      if given, purported directory name (this is the
+               directory name that will show up in error messages)
+    force:     if 1, force compilation, even if the file is up-to-date
+    rx:        if given, a regexp; files whose full path it matches
+               are skipped
+    quiet:     if 1, be quiet during compilation
+
+    The file is up-to-date if its .pyc (or .pyo) file is newer, or was
+    compiled from the same contents (see py_compile.source_matches()).
+    Return 1 unless compiling failed.
+
+    """
+    success = 1
+    name = os.path.basename(fullname)
+    if ddir is not None:
+        dfile = os.path.join(ddir, name)
+    else:
+        dfile = None
+    if rx is not None:
+        mo = rx.search(fullname)
+        if mo:
+            return success
+    if os.path.isfile(fullname):
+        head, tail = name[:-3], name[-3:]
+        if tail == '.py':
+            cfile = fullname + (__debug__ and 'c' or 'o')
+            if not force:
+                ftime = os.stat(fullname).st_mtime
+                try: ctime = os.stat(cfile).st_mtime
+                except os.error: ctime = 0
+                if ctime > ftime:
+                    return success
+                if ctime and py_compile.source_matches(fullname, cfile):
+                    return success
+            if not quiet:
+                print 'Compiling', fullname, '...'
+            try:
+                ok = py_compile.compile(fullname, None, dfile, True)
+            except KeyboardInterrupt:
+                raise KeyboardInterrupt
+            except py_compile.PyCompileError,err:
+                if quiet:
+                    print 'Compiling', fullname, '...'
+                print err.msg
+                success = 0
+            except IOError, e:
+                print "Sorry", e
                 success = 0
+            else:
+                if ok == 0:
+                    success = 0
     return success
 
-def compile_path(skip_curdir=1, maxlevels=0, force=0, quiet=0):
+def compile_path(skip_curdir=1, maxlevels=0, force=0, quiet=0, workers=1):
     """Byte-compile all module on sys.path.
 
     Arguments (all optional):
@@ -93,33 +174,55 @@ def compile_path(skip_curdir=1, maxlevels=0, force=0, quiet=0):
     maxlevels:   max recursion level (default 0)
     force: as for compile_dir() (default 0)
     quiet: as for compile_dir() (default 0)
+    workers: as for compile_dir() (default 1)
 
     """
+    pool = _make_pool(workers)
+    try:
+        return _compile_path(skip_curdir, maxlevels, force, quiet, pool)
+    finally:
+        _close_pool(pool)
+
+def _compile_path(skip_curdir, maxlevels, force, quiet, pool):
+    """compile_path() with the files compiled in pool if not None, which
+    all the entries of sys.path share."""
     success = 1
     for dir in sys.path:
         if (not dir or dir == os.curdir) and skip_curdir:
             print 'Skipping current directory'
         else:
-            success = success and compile_dir(dir, maxlevels, None,
-                                              force, quiet=quiet)
+            success = success and \
+                      _compile_files(_walk_dir(dir, maxlevels, None, None,
+                                               quiet),
+                                     force, quiet, pool)
     return success
 
 def main():
     """Script main program."""
     import getopt
     try:
-        opts, args = getopt.getopt(sys.argv[1:], 'lfqd:x:')
+        opts, args = getopt.getopt(sys.argv[1:], 'lfqd:x:j:')
+        workers = 1
+        for o, a in opts:
+            if o == '-j':
+                try:
+                    workers = int(a)
+                except ValueError:
+                    workers = -1
+                if workers < 0:
+                    raise getopt.error("-j needs a number of processes")
     except getopt.error, msg:
         print msg
         print "usage: python compileall.py [-l] [-f] [-q] [-d destdir] " \
-              "[-x regexp] [directory ...]"
+              "[-x regexp] [-j N] [directory ...]"
         print "-l: don't recurse down"
-        print "-f: force rebuild even if timestamps are up-to-date"
+        print "-f: force rebuild even if the files are up-to-date"
         print "-q: quiet operation"
         print "-d destdir: purported directory name for error messages"
         print "   if no directory arguments, -l sys.path is assumed"
         print "-x regexp: skip files matching the regular expression regexp"
         print "   the regexp is searched for in the full path of the file"
+        print "-j N: compile in N processes (0: one per CPU)"
         sys.exit(2)
     maxlevels = 10
     ddir = None
@@ -139,14 +242,19 @@ def main():
             print "-d destdir require exactly one directory argument"
             sys.exit(2)
     success = 1
+    pool = _make_pool(workers)
     try:
-        if args:
-            for dir in args:
-                if not compile_dir(dir, maxlevels, ddir,
-                                   force, rx, quiet):
-                    success = 0
-        else:
-            success = compile_path()
+        try:
+            if args:
+                for dir in args:
+                    if not _compile_files(_walk_dir(dir, maxlevels, ddir,
+                                                    rx, quiet),
+                                          force, quiet, pool):
+                        success = 0
+            else:
+                success = _compile_path(1, 0, 0, 0, pool)
+        finally:
+            _close_pool(pool)
     except KeyboardInterrupt:
         print "\n[interrupt]"
         success = 0
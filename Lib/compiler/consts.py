@@ -15,6 +15,7 @@ CO_VARARGS = 0x0004
 CO_VARKEYWORDS = 0x0008
 CO_NESTED = 0x0010
 CO_GENERATOR = 0x0020
+CO_GENEXP_MAP = 0x0080
 CO_GENERATOR_ALLOWED = 0
 CO_FUTURE_DIVISION = 0x2000
 CO_FUTURE_ABSIMPORT = 0x4000
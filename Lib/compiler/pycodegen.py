@@ -9,7 +9,7 @@ from compiler import ast, parse, walk, syntax
 from compiler import pyassem, misc, future, symbols
 from compiler.consts import SC_LOCAL, SC_GLOBAL, SC_FREE, SC_CELL
 from compiler.consts import (CO_VARARGS, CO_VARKEYWORDS, CO_NEWLOCALS,
-     CO_NESTED, CO_GENERATOR, CO_FUTURE_DIVISION,
+     CO_NESTED, CO_GENERATOR, CO_GENEXP_MAP, CO_FUTURE_DIVISION,
      CO_FUTURE_ABSIMPORT, CO_FUTURE_WITH_STATEMENT, CO_FUTURE_PRINT_FUNCTION)
 from compiler.pyassem import TupleArg
 
@@ -1391,6 +1391,9 @@ class GenExprCodeGenerator(NestedScopeMixin, AbstractFunctionCode,
         self.graph.setFreeVars(self.scope.get_free_vars())
         self.graph.setCellVars(self.scope.get_cell_vars())
         self.graph.setFlag(CO_GENERATOR)
+        quals = gexp.code.quals
+        if len(quals) == 1 and not quals[0].ifs:
+            self.graph.setFlag(CO_GENEXP_MAP)
 
 class AbstractClassCode:
 
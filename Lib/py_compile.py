@@ -10,9 +10,27 @@ import os
 import sys
 import traceback
 
+try:
+    from hashlib import sha1
+except ImportError:
+    sha1 = None
+
 MAGIC = imp.get_magic()
 
-__all__ = ["compile", "main", "PyCompileError"]
+# compile() ends the files it writes with this mark, a version byte and the
+# SHA-1 digest of the source as read in universal newline mode, so that
+# source_matches() can tell whether a source whose time stamp changed was
+# edited at all.  Loading the code doesn't read that far.  The trailer is
+# only looked at in files with the current MAGIC; SOURCE_HASH_VERSION goes
+# up if its contents ever change.
+SOURCE_HASH_MARK = '\0SRC'
+SOURCE_HASH_VERSION = 1
+
+def _source_trailer(source):
+    """Internal; the trailer compile() writes after the code of source."""
+    return SOURCE_HASH_MARK + chr(SOURCE_HASH_VERSION) + sha1(source).digest()
+
+__all__ = ["compile", "main", "PyCompileError", "source_matches"]
 
 
 class PyCompileError(Exception):
@@ -117,7 +135,7 @@ def compile(file, cfile=None, dfile=None, doraise=False):
         timestamp = long(os.fstat(f.fileno()).st_mtime)
     except AttributeError:
         timestamp = long(os.stat(file).st_mtime)
-    codestring = f.read()
+    codestring = source = f.read()
     f.close()
     if codestring and codestring[-1] != '\n':
         codestring = codestring + '\n'
@@ -136,12 +154,74 @@ def compile(file, cfile=None, dfile=None, doraise=False):
     fc.write('\0\0\0\0')
     wr_long(fc, timestamp)
     marshal.dump(codeobject, fc)
+    if sha1 is not None:
+        fc.write(_source_trailer(source))
     fc.flush()
     fc.seek(0, 0)
     fc.write(MAGIC)
     fc.close()
     set_creator_type(cfile)
 
+def source_matches(file, cfile=None):
+    """Tell whether cfile holds the code for the current contents of file.
+
+    This goes by the digest of the source that compile() stores, whatever
+    the time stamps say.  When the contents match but the time stamp
+    recorded in cfile isn't the one file has now, cfile is replaced by a
+    copy with the new one, so that importing the module takes it too.
+    The copy is written next to cfile and renamed over it, so that no
+    import ever sees a partly written file; where that rename fails,
+    False is returned and the caller compiles file again.  cfile
+    defaults as for compile().
+    """
+    if sha1 is None:
+        return False
+    if cfile is None:
+        cfile = file + (__debug__ and 'c' or 'o')
+    try:
+        f = open(file, 'U')
+        try:
+            try:
+                timestamp = long(os.fstat(f.fileno()).st_mtime)
+            except AttributeError:
+                timestamp = long(os.stat(file).st_mtime)
+            trailer = _source_trailer(f.read())
+        finally:
+            f.close()
+        fc = open(cfile, 'rb')
+        try:
+            data = fc.read()
+        finally:
+            fc.close()
+    except IOError:
+        return False
+    if len(data) < 8 + len(trailer) or data[:4] != MAGIC or \
+       not data.endswith(trailer):
+        return False
+    mtime = ''.join([chr((timestamp >> i) & 0xff) for i in (0, 8, 16, 24)])
+    if data[4:8] != mtime:
+        tmp = '%s.%d.tmp' % (cfile, os.getpid())
+        try:
+            fd = os.open(tmp, os.O_WRONLY | os.O_CREAT | os.O_EXCL |
+                         getattr(os, 'O_BINARY', 0), 0666)
+        except OSError:
+            return False
+        try:
+            fc = os.fdopen(fd, 'wb')
+            try:
+                fc.write(data[:4] + mtime + data[8:])
+            finally:
+                fc.close()
+            os.rename(tmp, cfile)
+        except (IOError, OSError):
+            try:
+                os.unlink(tmp)
+            except OSError:
+                pass
+            return False
+        set_creator_type(cfile)
+    return True
+
 def main(args=None):
     """Compile several source files.
 
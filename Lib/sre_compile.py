@@ -503,6 +503,14 @@ def compile(p, flags=0):
 
     if isstring(p):
         pattern = p
+        key = (type(p), p, flags)
+        args = _snapshot.get(key)
+        if args is not None:
+            try:
+                return _compile_snapshot(pattern, args)
+            except (RuntimeError, TypeError, ValueError):
+                # invalid entry, from a damaged file
+                del _snapshot[key]
         p = sre_parse.parse(p, flags)
     else:
         pattern = None
@@ -523,8 +531,98 @@ def compile(p, flags=0):
     for k, i in groupindex.items():
         indexgroup[i] = k
 
+    # with LOCALE, the code depends on the locale it was compiled in
+    if (pattern is not None and _snapshot_path is not None and
+        not (flags | p.pattern.flags) & SRE_FLAG_LOCALE and
+        len(_snapshot) < _SNAPSHOT_MAX):
+        global _snapshot_new
+        _snapshot[key] = (flags | p.pattern.flags, code, p.pattern.groups-1,
+                          groupindex.copy(), indexgroup[:])
+        _snapshot_new += 1
+
     return _sre.compile(
         pattern, flags | p.pattern.flags, code,
         p.pattern.groups-1,
         groupindex, indexgroup
         )
+
+# Startup snapshot.  Most of the time it takes to import many modules goes
+# into compiling the regular expressions they define.  When the
+# PYTHONRESNAPSHOT environment variable names a file, the programs of the
+# patterns compiled in earlier runs are read from it, and those patterns
+# are built from their programs instead of being parsed and compiled again.
+# At exit, the file is replaced by one that also has the patterns compiled
+# in this run, if there are any.  Only the Python version and engine that
+# wrote the file use it (see _snapshot_header()).
+
+_snapshot = {} # (type, pattern, flags) -> the rest of _sre.compile's args
+_snapshot_path = None
+_snapshot_new = 0 # patterns added since the file was read
+_SNAPSHOT_MAX = 2000
+
+def _snapshot_header():
+    return ("sre snapshot", 1, sys.hexversion, MAGIC, _sre.CODESIZE,
+            sys.maxunicode)
+
+def _compile_snapshot(pattern, args):
+    flags, code, groups, groupindex, indexgroup = args
+    # the pattern object keeps these, and they can be changed through it
+    return _sre.compile(pattern, flags, code, groups,
+                        groupindex.copy(), indexgroup[:])
+
+def _load_snapshot(path):
+    # internal: use the patterns in the snapshot file path, and save
+    # those compiled from now on to it at exit
+    global _snapshot_path
+    import marshal, atexit
+    _snapshot_path = path
+    try:
+        f = open(path, "rb")
+        try:
+            header, entries = marshal.load(f)
+        finally:
+            f.close()
+    except (IOError, EOFError, ValueError, TypeError):
+        header = entries = None
+    if header == _snapshot_header():
+        try:
+            for entry in entries[:_SNAPSHOT_MAX]:
+                pattern, flags, args = entry[0], entry[1], entry[2:]
+                if len(args) == 5:
+                    _snapshot[(type(pattern), pattern, flags)] = args
+        except (TypeError, IndexError):
+            pass
+    atexit.register(_save_snapshot)
+
+def _save_snapshot():
+    # internal: write the snapshot file again if patterns were added.
+    # It is written next to the old one and renamed over it, so that
+    # processes starting meanwhile read either of them whole.
+    if not _snapshot_new:
+        return
+    import marshal, os
+    entries = [(key[1], key[2]) + args for key, args in _snapshot.items()]
+    tmp = "%s.%d.tmp" % (_snapshot_path, os.getpid())
+    try:
+        f = open(tmp, "wb")
+        try:
+            marshal.dump((_snapshot_header(), entries), f)
+        finally:
+            f.close()
+        try:
+            os.rename(tmp, _snapshot_path)
+        except OSError:
+            # Windows doesn't rename over an existing file
+            os.remove(_snapshot_path)
+            os.rename(tmp, _snapshot_path)
+    except (IOError, OSError):
+        try:
+            os.remove(tmp)
+        except OSError:
+            pass
+
+if not sys.flags.ignore_environment:
+    import os
+    if os.environ.get("PYTHONRESNAPSHOT"):
+        _load_snapshot(os.environ["PYTHONRESNAPSHOT"])
+    del os
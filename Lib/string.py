@@ -528,6 +528,14 @@ try:
 except ImportError:
     pass                                          # Use the original versions
 
+# String builders, for putting a string together from many pieces in
+# linear time.  The module is missing only while Python is being built.
+
+try:
+    from _stringbuilder import StringBuilder, UnicodeBuilder
+except ImportError:
+    pass
+
 ########################################################################
 # the Formatter class
 # see PEP 3101 for details and purpose of this class
@@ -18,6 +18,12 @@ class BadSeq2(Sequence):
     def __init__(self): self.seq = ['a', 'b', 'c']
     def __len__(self): return 8
 
+class Hinted:
+    def __init__(self, seq, hint): self.it = iter(seq); self.hint = hint
+    def __iter__(self): return self
+    def next(self): return self.it.next()
+    def __length_hint__(self): return self.hint
+
 class CommonTest(unittest.TestCase):
     # This testcase contains test that can be used in all
     # stringlike classes. Currently this is str, unicode
@@ -230,6 +236,35 @@ class CommonTest(unittest.TestCase):
         self.checkraises(TypeError, 'hello', 'rfind')
         self.checkraises(TypeError, 'hello', 'rfind', 42)
 
+    def test_find_count_long(self):
+        # find(), count() and whitespace split() scan long strings a block
+        # at a time; check matches at and across every position of a few
+        # blocks, and near the end of the string.
+        for n in (15, 16, 17, 31, 32, 33, 63, 64, 65, 100):
+            for pos in range(n):
+                s = 'x' * pos + 'y' + 'x' * (n - pos - 1)
+                self.checkequal(pos, s, 'find', 'y')
+                self.checkequal(1, s, 'count', 'y')
+                self.checkequal(n - 1, s, 'count', 'x')
+                s = 'x' * pos + 'yz' + 'x' * (n - pos - 1)
+                self.checkequal(pos, s, 'find', 'yz')
+                if pos < n - 1:
+                    self.checkequal(pos, s, 'find', 'yzx')
+                else:
+                    self.checkequal(-1, s, 'find', 'yzx')
+                self.checkequal(pos - 1, s, 'find', 'xyz')
+                self.checkequal(-1, s, 'find', 'yy')
+                s = 'x' * pos + ' ' + 'x' * (n - pos - 1)
+                self.checkequal([x for x in ['x' * pos, 'x' * (n - pos - 1)]
+                                 if x], s, 'split')
+        self.checkequal(500, 'ab' * 500, 'count', 'ab')
+        self.checkequal(250, 'ab' * 500, 'count', 'aba')
+        self.checkequal(500, 'ab' * 500, 'count', 'a')
+        self.checkequal(-1, 'ab' * 500, 'find', 'abb')
+        self.checkequal(500, 'a' * 1000, 'count', 'aa')
+        self.checkequal(1000, 'a' * 1000, 'count', 'a')
+        self.checkequal(['\x7f\x00', 'a', 'b~'], '\x7f\x00 a\tb~\n', 'split')
+
     def test_index(self):
         self.checkequal(0, 'abcdefghiabc', 'index', '')
         self.checkequal(3, 'abcdefghiabc', 'index', 'def')
@@ -1026,6 +1061,29 @@ class MixinStrUnicodeUserStringTest:
         self.checkraises(TypeError, ' ', 'join', BadSeq1())
         self.checkequal('a b c', ' ', 'join', BadSeq2())
 
+        # iterators other than lists and tuples are joined as they go
+        self.checkequal('', ' ', 'join', iter([]))
+        self.checkequal('a', ' ', 'join', iter(['a']))
+        self.checkequal('a b c', ' ', 'join', iter(['a', 'b', 'c']))
+        self.checkequal('0-1-2-3-4', '-', 'join', (str(i) for i in range(5)))
+        for i in [5, 25, 125, 625]:
+            self.checkequal(((('a' * i) + '-') * i)[:-1], '-', 'join',
+                 iter(['a' * i] * i))
+        if test_support.have_unicode:
+            self.checkequal(unicode('a.b.c'), '.', 'join',
+                            iter([unicode('a'), 'b', 'c']))
+            self.checkequal(unicode('a.b.c.d'), '.', 'join',
+                            iter(['a', 'b', unicode('c'), 'd']))
+            self.checkequal(unicode('a'), '.', 'join', iter([unicode('a')]))
+            self.checkraises(TypeError, '.', 'join',
+                             iter(['a', unicode('b'), 3]))
+        self.checkraises(TypeError, ' ', 'join', iter(['a', 'b', 3]))
+
+        # the length hint only sizes the result, whether it's right or not
+        for hint in [0, 1, 3, 100, 10000]:
+            self.checkequal('-'.join(['a' * 100] * 100), '-', 'join',
+                            Hinted(['a' * 100] * 100, hint))
+
         self.checkraises(TypeError, ' ', 'join')
         self.checkraises(TypeError, ' ', 'join', 7)
         self.checkraises(TypeError, ' ', 'join', Sequence([7, 'hello', 123L]))
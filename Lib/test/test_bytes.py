@@ -846,6 +846,18 @@ class AssortedBytesTest(unittest.TestCase):
         self.assertEqual(b, b'hello')
         self.assertEqual(c, b'hee')
 
+    def test_long_translate_and_case(self):
+        # Long enough for the vectorised loops, at every alignment
+        s = ''.join(map(chr, range(256))) * 2
+        table = ''.join(chr((i * 151 + 7) & 255) for i in range(256))
+        for i in range(33):
+            t = s[i:i+300]
+            b = bytearray(t)
+            self.assertEqual(b.translate(table), t.translate(table))
+            self.assertEqual(b.lower(), t.lower())
+            self.assertEqual(b.upper(), t.upper())
+            self.assertEqual(b.swapcase(), t.swapcase())
+
     def test_split_bytearray(self):
         self.assertEqual(b'a b'.split(memoryview(b' ')), [b'a', b'b'])
 
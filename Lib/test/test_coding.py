@@ -21,6 +21,42 @@ class CodingTest(unittest.TestCase):
         fp.close()
         self.assertRaises(SyntaxError, compile, text, filename, 'exec')
 
+    def exec_file(self, data):
+        fp = open(test.test_support.TESTFN, 'wb')
+        try:
+            fp.write(data)
+        finally:
+            fp.close()
+        ns = {}
+        try:
+            execfile(test.test_support.TESTFN, ns)
+        finally:
+            os.unlink(test.test_support.TESTFN)
+        return ns
+
+    def test_file_lines(self):
+        # Past the first two lines, files are read in blocks rather
+        # than line by line; the lines must come out the same.
+        # A NUL byte drops the rest of its line and joins it to the next.
+        ns = self.exec_file('a = 1\r\nb = 2\r\nc = 3\r\r\n'
+                            'd = 4\0junk\n + 5\ndef f():\n  pass')
+        self.assertEqual([ns[x] for x in 'abcd'], [1, 2, 3, 9])
+        self.assertEqual(ns['f'].func_code.co_firstlineno, 6)
+        lines = ['x%d = %d' % (i, i) for i in range(20000)]
+        ns = self.exec_file('\n'.join(lines) + '\ns = """a\r\nb"""\n')
+        self.assertEqual(ns['x19999'], 19999)
+        self.assertEqual(ns['s'], 'a\nb')
+
+    def test_non_ascii_past_encoding_lines(self):
+        try:
+            self.exec_file('a = 1\nb = 2\nc = 3\nd = "\xe9"\n')
+        except SyntaxError, e:
+            self.assert_("'\\xe9'" in e.msg and "line 4" in e.msg, e.msg)
+        else:
+            self.fail("non-ASCII byte without an encoding declared")
+        ns = self.exec_file('# -*- coding: latin-1 -*-\n\n\nd = u"\xe9"\n')
+        self.assertEqual(ns['d'], u'\xe9')
+
 def test_main():
     test.test_support.run_unittest(CodingTest)
 
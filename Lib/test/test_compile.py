@@ -460,6 +460,71 @@ if 1:
         ast.body = [_ast.BoolOp()]
         self.assertRaises(TypeError, compile, ast, '<ast>', 'exec')
 
+    def test_same_code_as_concrete_syntax_tree(self):
+        # compile() builds the AST straight from the tokens, the parser
+        # module goes through a concrete syntax tree: they must agree
+        import marshal, parser, os
+        sources = [
+            'x = 1; y = -2 ** -1; z = not a < b <= c is not d',
+            'print >>f, 1, "a" "b",\nprint',
+            'def f(a, (b, c)=(1, 2), *d, **e):\n    return lambda x=a: x\n',
+            '@d\n@e(1)\nclass C(A, B.c):\n    def f(self): yield [x for x in ()]\n',
+            'try:\n    pass\nexcept (E, F), e:\n    pass\nelse:\n    pass\n'
+            'finally:\n    del x[1:2, ...], y.z\n',
+            'for i, in x, y:\n    continue\nelse:\n    while 0: break\n',
+            'with a as (b, c): exec "x" in d\n',
+            'from __future__ import print_function\nprint(1, sep="")\n',
+            'from __future__ import unicode_literals\nx = "a" r"\\n"\n',
+            'import a.b as c, d\nfrom ..e import (f as g, h,)\nglobal i\n',
+            'f(a, *b, c=d, **e)(x for x in y if z)[::]\nx = `1`, {1: 2}\n',
+            'if a:\n    b\nelif c: d\nelse:\n    assert e, f\n',
+        ]
+        for name in ('decimal.py', 'inspect.py'):
+            f = open(os.path.join(os.path.dirname(os.__file__), name), 'U')
+            try:
+                sources.append(f.read())
+            finally:
+                f.close()
+        for source in sources:
+            # version 2 has no references, which depend on refcounts
+            self.assertEqual(
+                marshal.dumps(compile(source, '<source>', 'exec'), 2),
+                marshal.dumps(parser.suite(source).compile('<source>'), 2))
+
+    def test_token_parser_grammar(self):
+        # The token parser in Python/ast.c follows Grammar/Grammar by
+        # hand, and records the digest of the rules it was written for
+        import hashlib, os, re
+        srcdir = os.path.dirname(os.path.dirname(os.path.abspath(os.__file__)))
+        grammar = os.path.join(srcdir, 'Grammar', 'Grammar')
+        ast_c = os.path.join(srcdir, 'Python', 'ast.c')
+        if not (os.path.exists(grammar) and os.path.exists(ast_c)):
+            return # not run from a source tree
+        rules = []
+        for line in open(grammar):
+            line = line.split('#', 1)[0].rstrip()
+            if line.strip():
+                rules.append(line)
+        digest = re.search(r'#define GRAMMAR_MD5 "(\w+)"',
+                           open(ast_c).read()).group(1)
+        self.assertEqual(hashlib.md5('\n'.join(rules)).hexdigest(), digest,
+                         'Grammar/Grammar changed: update the token parser '
+                         'in Python/ast.c, then GRAMMAR_MD5')
+
+    def test_token_parser_errors(self):
+        # Errors other than those in the source are not retried through
+        # the CST; those in the source are reported as pgen finds them
+        self.assertRaises(SyntaxError, compile, 'None = 1\n)\n', '?', 'exec')
+        try:
+            compile('None = 1\nx = (\n', '?', 'exec')
+        except SyntaxError, e:
+            self.assertEqual(e.lineno, 2)
+        else:
+            self.fail('no SyntaxError')
+        self.assertRaises(SyntaxError, compile, 'u"\\N{nonesuch}"', '?', 'exec')
+        self.assertRaises(SyntaxError, compile, '# coding: nonesuch\n', '?',
+                          'exec')
+
 
 def test_main():
     test_support.run_unittest(TestSpecifics)
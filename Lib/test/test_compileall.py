@@ -0,0 +1,209 @@
+import compileall
+import imp
+import marshal
+import os
+import py_compile
+import shutil
+import struct
+import sys
+import tempfile
+import time
+import unittest
+from test import test_support
+
+class CompileallTests(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+        self.source_path = os.path.join(self.directory, '_test.py')
+        self.bc_path = self.source_path + (__debug__ and 'c' or 'o')
+        self.write_source('x = 123\n')
+        self.subdirectory = os.path.join(self.directory, 'sub')
+        os.mkdir(self.subdirectory)
+        self.sub_paths = []
+        for i in range(5):
+            path = os.path.join(self.subdirectory, '_test%d.py' % i)
+            f = open(path, 'w')
+            f.write('y = %d\n' % i)
+            f.close()
+            self.sub_paths.append(path)
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def write_source(self, text, mtime=None):
+        f = open(self.source_path, 'w')
+        f.write(text)
+        f.close()
+        if mtime is not None:
+            os.utime(self.source_path, (mtime, mtime))
+
+    def read_bc(self):
+        f = open(self.bc_path, 'rb')
+        try:
+            return f.read()
+        finally:
+            f.close()
+
+    def recorded_mtime(self):
+        return struct.unpack('<i', self.read_bc()[4:8])[0]
+
+    def test_pyc_still_loads(self):
+        # The source digest at the end of the file doesn't get in the way
+        # of the code before it
+        py_compile.compile(self.source_path)
+        data = self.read_bc()
+        self.assertEqual(data[:4], imp.get_magic())
+        ns = {}
+        exec marshal.loads(data[8:]) in ns
+        self.assertEqual(ns['x'], 123)
+
+    def test_compile_file(self):
+        self.assert_(compileall.compile_file(self.source_path, quiet=1))
+        self.assert_(os.path.exists(self.bc_path))
+        self.assertEqual(self.recorded_mtime(),
+                         int(os.stat(self.source_path).st_mtime))
+
+    def test_unchanged_source_is_not_recompiled(self):
+        if py_compile.sha1 is None:
+            return
+        now = int(time.time())
+        self.write_source('x = 123\n', now - 100)
+        compileall.compile_file(self.source_path, quiet=1)
+        os.utime(self.bc_path, (now - 200, now - 200))
+        # Touching the source only brings the recorded time stamp up to
+        # date, so that imports accept the file
+        self.write_source('x = 123\n', now - 50)
+        compile = py_compile.compile
+        py_compile.compile = None
+        try:
+            compileall.compile_file(self.source_path, quiet=1)
+        finally:
+            py_compile.compile = compile
+        self.assertEqual(self.recorded_mtime(), now - 50)
+        # ... while a changed source is compiled again
+        data = self.read_bc()
+        self.write_source('x = 456\n', now - 50)
+        os.utime(self.bc_path, (now - 200, now - 200))
+        compileall.compile_file(self.source_path, quiet=1)
+        self.assertNotEqual(self.read_bc(), data)
+        ns = {}
+        exec marshal.loads(self.read_bc()[8:]) in ns
+        self.assertEqual(ns['x'], 456)
+
+    def test_source_matches(self):
+        if py_compile.sha1 is None:
+            return
+        self.assertFalse(py_compile.source_matches(self.source_path))
+        py_compile.compile(self.source_path)
+        self.assert_(py_compile.source_matches(self.source_path))
+        self.write_source('x = 124\n')
+        self.assertFalse(py_compile.source_matches(self.source_path))
+        # Files written without a digest never match
+        f = open(self.bc_path, 'wb')
+        f.write(imp.get_magic() + '\0' * 4)
+        f.close()
+        self.assertFalse(py_compile.source_matches(self.source_path))
+
+    def test_source_matches_replaces_file(self):
+        if py_compile.sha1 is None:
+            return
+        now = int(time.time())
+        self.write_source('x = 123\n', now - 100)
+        py_compile.compile(self.source_path)
+        data = self.read_bc()
+        self.assert_(data.endswith(py_compile.SOURCE_HASH_MARK +
+                                   chr(py_compile.SOURCE_HASH_VERSION) +
+                                   py_compile.sha1('x = 123\n').digest()))
+        # The updated file is a new one, renamed over the old one, so that
+        # a reader that has the old one open keeps seeing all of it
+        f = open(self.bc_path, 'rb')
+        try:
+            self.write_source('x = 123\n', now - 50)
+            self.assert_(py_compile.source_matches(self.source_path))
+            self.assertEqual(f.read(), data)
+        finally:
+            f.close()
+        self.assertEqual(self.recorded_mtime(), now - 50)
+        self.assertEqual(self.read_bc()[8:], data[8:])
+        self.assertEqual(sorted(os.listdir(self.directory)),
+                         ['_test.py', '_test.py' + self.bc_path[-1], 'sub'])
+
+    def test_universal_newlines(self):
+        # Sources are read in universal newline mode, lone '\r' included
+        f = open(self.source_path, 'wb')
+        f.write('x = 1\ry = 2\r\nz = 3')
+        f.close()
+        py_compile.compile(self.source_path, doraise=True)
+        ns = {}
+        exec marshal.loads(self.read_bc()[8:]) in ns
+        self.assertEqual((ns['x'], ns['y'], ns['z']), (1, 2, 3))
+        if py_compile.sha1 is not None:
+            self.assert_(py_compile.source_matches(self.source_path))
+
+    def test_compile_dir_workers(self):
+        for workers in (1, 2):
+            self.assert_(compileall.compile_dir(self.directory, quiet=1,
+                                                workers=workers))
+            for path in [self.source_path] + self.sub_paths:
+                bc_path = path + (__debug__ and 'c' or 'o')
+                self.assert_(os.path.exists(bc_path), bc_path)
+                os.unlink(bc_path)
+
+    def test_compile_dir_failure(self):
+        f = open(os.path.join(self.subdirectory, '_bad.py'), 'w')
+        f.write('x = (\n')
+        f.close()
+        for workers in (1, 2):
+            stdout = sys.stdout
+            sys.stdout = open(os.devnull, 'w')
+            try:
+                ok = compileall.compile_dir(self.directory, quiet=1,
+                                            workers=workers)
+            finally:
+                sys.stdout.close()
+                sys.stdout = stdout
+            self.assertFalse(ok)
+
+    def test_compile_path_one_pool(self):
+        pools = []
+        make_pool = compileall._make_pool
+        def counting_make_pool(workers):
+            pools.append(workers)
+            return make_pool(workers)
+        path = sys.path[:]
+        compileall._make_pool = counting_make_pool
+        sys.path[:] = [self.directory, self.subdirectory]
+        try:
+            self.assert_(compileall.compile_path(quiet=1, workers=2))
+        finally:
+            sys.path[:] = path
+            compileall._make_pool = make_pool
+        self.assertEqual(pools, [2])
+        for path in [self.source_path] + self.sub_paths:
+            self.assert_(os.path.exists(path + (__debug__ and 'c' or 'o')))
+
+    def test_workers_option(self):
+        argv = sys.argv
+        stdout = sys.stdout
+        sys.stdout = open(os.devnull, 'w')
+        try:
+            for option, ok in (('2', True), (' 2', True), ('0', True),
+                               ('-1', False), ('x', False), ('', False)):
+                sys.argv = ['compileall', '-q', '-j', option, self.directory]
+                if ok:
+                    self.assert_(compileall.main())
+                else:
+                    self.assertRaises(SystemExit, compileall.main)
+        finally:
+            sys.stdout.close()
+            sys.stdout = stdout
+            sys.argv = argv
+
+
+def test_main():
+    test_support.run_unittest(CompileallTests)
+
+
+if __name__ == "__main__":
+    test_main()
@@ -339,6 +339,14 @@ class ComplexTest(unittest.TestCase):
         self.assertEqual(-6j,complex(repr(-6j)))
         self.assertEqual(6j,complex(repr(6j)))
 
+        self.assertEqual(repr(1.1+2.2j), '(1.1+2.2j)')
+        self.assertEqual(repr(0.1-0.3j), '(0.1-0.3j)')
+        self.assertEqual(repr(-0.1j), '-0.1j')
+        self.assertEqual(repr(complex(1e300, -1e-300)), '(1e+300-1e-300j)')
+        z = complex(1.0/3, 2.0/3)
+        self.assertEqual(z, complex(repr(z)))
+        self.assertEqual(str(z), '(0.333333333333+0.666666666667j)')
+
         self.assertEqual(repr(complex(1., INF)), "(1+inf*j)")
         self.assertEqual(repr(complex(1., -INF)), "(1-inf*j)")
         self.assertEqual(repr(complex(INF, 1)), "(inf+1j)")
@@ -253,6 +253,67 @@ class ReprTestCase(unittest.TestCase):
             self.assertEqual(v, eval(repr(v)))
         floats_file.close()
 
+    def test_short_repr(self):
+        # repr() uses as few digits as read back as the same float.
+        test_strings = [
+            '0.0', '-0.0', '0.1', '0.3', '1.1', '2.5', '-1.25', '100.0',
+            '1e+22', '1e-05', '0.0001', '123456789.0', '1.7976931348623157e+308',
+            '2.2250738585072014e-308', '5e-324', '1e+17',
+            '10000000000000000.0', '0.30000000000000004',
+            '0.9999999999999999', '0.14285714285714285',
+            ]
+        for s in test_strings:
+            self.assertEqual(repr(float(s)), s)
+
+    def test_repr_roundtrip(self):
+        rng = random.Random(12345)
+        for i in xrange(20000):
+            x = struct.unpack('<d', struct.pack('<Q',
+                                                rng.getrandbits(64)))[0]
+            if isnan(x) or isinf(x):
+                continue
+            r = repr(x)
+            self.assertEqual(float(r), x)
+            # Fewer digits never read back as x: rounding to one less
+            # significant digit gives a different float.
+            digits = len(r.split('e')[0].replace('-', '').replace('.', '')
+                         .lstrip('0').rstrip('0'))
+            if digits > 1:
+                self.assertNotEqual(float('%.*e' % (digits - 2, x)), x, r)
+            # and str() is still %.12g
+            s = '%.12g' % x
+            if '.' not in s and 'e' not in s:
+                s += '.0'
+            self.assertEqual(str(x), s)
+
+    def test_short_decimal_repr(self):
+        # A number written with 15 significant digits or fewer comes back
+        # with the same digits.
+        rng = random.Random(54321)
+        for i in xrange(20000):
+            s = '%.*e' % (rng.randint(1, 14), rng.uniform(-1e6, 1e6))
+            self.assertEqual(float(repr(float(s))), float(s))
+            self.assertEqual(repr(float(s)),
+                             repr(float(s.replace('e', '0e'))))
+            self.assertEqual(
+                repr(float(s)).split('e')[0].replace('.', '').strip('-0'),
+                s.split('e')[0].replace('.', '').strip('-0'))
+
+    def test_fast_strtod(self):
+        # Short decimal strings take a shortcut; padding them out with
+        # zeros makes strtod() do the work, and that has to agree.
+        rng = random.Random(2468)
+        for i in xrange(20000):
+            digits = str(rng.randrange(10**rng.randint(1, 15)))
+            point = rng.randint(0, len(digits))
+            s = digits[:point] + '.' + digits[point:]
+            for e in '', 'e%d' % rng.randint(-30, 30):
+                self.assertEqual(float(s + e), float(s + '0' * 20 + e))
+        self.assertEqual(float('1e22'), 10.0**22)
+        self.assertEqual(float('1e23'), 1e23)
+        self.assertEqual(float('-0.0e5'), -0.0)
+        self.assertEqual(copysign(1.0, float('-0.0e5')), -1.0)
+
 # Beginning with Python 2.6 float has cross platform compatible
 # ways to create and represent inf and nan
 class InfNanTest(unittest.TestCase):
@@ -38,6 +38,26 @@ class FrozenTests(unittest.TestCase):
         del sys.modules['__phello__']
         del sys.modules['__phello__.spam']
 
+    def test_frozen_stdlib(self):
+        # Modules built in by "make frozenstdlib" stand for their sources
+        import imp
+        import encodings.utf_8
+        for name, module in sys.modules.items():
+            if (module is None or name.startswith('__') or
+                not imp.is_frozen(name)):
+                continue
+            filename = module.__file__
+            if hasattr(module, '__path__'):
+                self.assertEqual(module.__path__,
+                                 [os.path.dirname(filename)])
+            f = open(filename, 'U')
+            try:
+                source = f.read()
+            finally:
+                f.close()
+            self.assertEqual(imp.get_frozen_object(name),
+                             compile(source + '\n', filename, 'exec'))
+
 
 def test_main():
     run_unittest(FrozenTests)
@@ -1,4 +1,9 @@
 import imp
+import os
+import shutil
+import sys
+import tempfile
+import time
 import unittest
 from test import test_support
 
@@ -55,9 +60,85 @@ class ReloadTests(unittest.TestCase):
         imp.reload(marshal)
 
 
+class InvalidateCachesTests(unittest.TestCase):
+
+    """Imports see modules added to a directory that was already searched."""
+
+    def setUp(self):
+        self.dir = tempfile.mkdtemp()
+        sys.path.insert(0, self.dir)
+        # Old enough that the listing of the directory can be cached.
+        self.mtime = time.time() - 100
+        os.utime(self.dir, (self.mtime, self.mtime))
+
+    def tearDown(self):
+        sys.path.remove(self.dir)
+        shutil.rmtree(self.dir)
+        for name in ('imp_cachemod1', 'imp_cachemod2', 'imp_cachemod3',
+                     'imp_cachepkg'):
+            sys.modules.pop(name, None)
+        imp.invalidate_caches()
+
+    def search(self, name):
+        # Often enough for the directory to be listed
+        for i in range(50):
+            self.assertRaises(ImportError, __import__, name)
+
+    def add_file(self, name, source, mtime):
+        f = open(os.path.join(self.dir, name), 'w')
+        f.write(source)
+        f.close()
+        os.utime(self.dir, (mtime, mtime))
+
+    def test_new_module(self):
+        self.search('imp_cachemod1')
+        self.add_file('imp_cachemod1.py', 'x = 1\n', self.mtime + 10)
+        import imp_cachemod1
+        self.assertEqual(imp_cachemod1.x, 1)
+
+    def test_new_package(self):
+        self.search('imp_cachepkg')
+        os.mkdir(os.path.join(self.dir, 'imp_cachepkg'))
+        self.add_file(os.path.join('imp_cachepkg', '__init__.py'), 'y = 2\n',
+                      self.mtime + 10)
+        import imp_cachepkg
+        self.assertEqual(imp_cachepkg.y, 2)
+
+    def test_invalidate_caches(self):
+        self.search('imp_cachemod2')
+        # The directory looks unchanged, so the old listing may still be
+        # used until the caches are invalidated.
+        self.add_file('imp_cachemod2.py', 'z = 3\n', self.mtime)
+        imp.invalidate_caches()
+        import imp_cachemod2
+        self.assertEqual(imp_cachemod2.z, 3)
+
+    def test_chdir(self):
+        # The '' entry of sys.path is the current directory, whichever
+        # it is, even if it has the same mtime as the one before
+        other = tempfile.mkdtemp()
+        cwd = os.getcwd()
+        sys.path.insert(0, '')
+        try:
+            f = open(os.path.join(other, 'imp_cachemod3.py'), 'w')
+            f.write('w = 4\n')
+            f.close()
+            os.utime(other, (self.mtime, self.mtime))
+            os.chdir(self.dir)
+            self.search('imp_cachemod3')
+            os.chdir(other)
+            import imp_cachemod3
+            self.assertEqual(imp_cachemod3.w, 4)
+        finally:
+            os.chdir(cwd)
+            sys.path.remove('')
+            shutil.rmtree(other)
+
+
 def test_main():
     tests = [
         ReloadTests,
+        InvalidateCachesTests,
     ]
     try:
         import thread
@@ -33,17 +33,21 @@ Reversed objects can also be wrapped around mutable objects; however, any
 appends after the current position are ignored.  Any other approach leads
 to confusion and possibly returning the same item more than once.
 
-The iterators not listed above, such as enumerate and the other itertools,
-are not length transparent because they have no way to distinguish between
-iterables that report static length and iterators whose length changes with
-each call (i.e. the difference between enumerate('abc') and
-enumerate(iter('abc')).
+Iterators over other iterators, such as enumerate, imap(), izip() and
+islice(), and generator expressions with a single for clause and no if
+clause, report a length worked out from that of the iterators they take
+items from.  Those are made when they are, so they track the remaining
+length even when given an iterable, as in enumerate('abc').  They have no
+length if one of their iterators has none.
+
+Other generators, and the remaining itertools, are not length transparent.
 
 """
 
 import unittest
 from test import test_support
-from itertools import repeat
+from itertools import repeat, count, imap, izip, izip_longest, islice
+from itertools import starmap
 from collections import deque
 from __builtin__ import len as _len
 
@@ -195,6 +199,119 @@ class TestListReversed(TestInvariantWithoutMutations):
         d.extend(xrange(20))
         self.assertEqual(len(it), 0)
 
+## ------- Iterators over other iterators -------
+
+class TestEnumerate(TestInvariantWithoutMutations):
+
+    def setUp(self):
+        self.it = enumerate(xrange(n))
+
+    def test_no_len_for_unsized(self):
+        self.assertRaises(TypeError, len, enumerate(count()))
+
+class TestGenexp(TestInvariantWithoutMutations):
+
+    def setUp(self):
+        self.it = (x * 2 for x in range(n))
+
+    def test_no_len_for_other_generators(self):
+        def gen():
+            yield 1
+        self.assertRaises(TypeError, len, gen())
+        self.assertRaises(TypeError, len, (x for x in range(n) if x))
+        self.assertRaises(TypeError, len,
+                          (x for x in range(n) for y in range(2)))
+        self.assertRaises(TypeError, len, (x for x in count()))
+
+    def test_len_while_running(self):
+        def inner():
+            for x in xrange(n):
+                yield lens.append(len(g))
+        lens = []
+        g = (x for x in inner())
+        self.assertRaises(TypeError, list, g)
+
+    def test_finished(self):
+        def gen():
+            yield 1
+        g = gen()
+        list(g)
+        self.assertEqual(len(g), 0)
+
+class TestImap(TestInvariantWithoutMutations):
+
+    def setUp(self):
+        self.it = imap(pow, range(n), range(n + 5))
+
+class TestIzip(TestInvariantWithoutMutations):
+
+    def setUp(self):
+        self.it = izip(range(n + 5), xrange(n + 1), range(n))
+
+    def test_empty(self):
+        self.assertEqual(len(izip()), 0)
+
+    def test_no_len_for_unsized(self):
+        # Like zip(), refuse to guess when an input won't say
+        self.assertRaises(TypeError, len, izip(range(n), count()))
+
+class TestIzipLongest(TestInvariantWithoutMutations):
+
+    def setUp(self):
+        self.it = izip_longest(range(n - 5), range(n), range(3))
+
+    def test_no_len_for_unsized(self):
+        self.assertRaises(TypeError, len, izip_longest(range(n), count()))
+
+class TestIslice(TestInvariantWithoutMutations):
+
+    def setUp(self):
+        self.it = islice(count(), 3, 3 + 3 * n, 3)
+
+    def test_lengths(self):
+        for stop in range(25):
+            for args in [(stop,), (2, stop), (2, stop, 3), (0, stop, 7)]:
+                self.assertEqual(len(islice(range(20), *args)),
+                                 _len(list(islice(range(20), *args))))
+        self.assertEqual(len(islice(range(n), 2, None, 2)), 4)
+        self.assertRaises(TypeError, len, islice(count(), 2, None))
+
+class TestStarmap(TestInvariantWithoutMutations):
+
+    def setUp(self):
+        self.it = starmap(pow, zip(range(n), range(n)))
+
+class BadHint(object):
+    # An iterator whose length hint fails with the given exception
+    def __init__(self, exc):
+        self.exc = exc
+    def __iter__(self):
+        return self
+    def next(self):
+        raise StopIteration
+    def __length_hint__(self):
+        raise self.exc
+
+class TestHintErrors(unittest.TestCase):
+
+    def wrappers(self, it):
+        return [enumerate(it), (x for x in it), imap(abs, it), izip(it),
+                izip_longest(it), islice(it, 1, None), starmap(pow, it)]
+
+    def test_errors_passed_on(self):
+        # Errors other than the one saying there's no hint aren't lost
+        for exc in ValueError, ZeroDivisionError, KeyboardInterrupt:
+            for wrapper in self.wrappers(BadHint(exc)):
+                self.assertRaises(exc, wrapper.__length_hint__)
+                self.assertEqual(list(wrapper), [])
+            # even where the wrapper could have done without it
+            self.assertRaises(exc, islice(BadHint(exc), 5).__length_hint__)
+
+    def test_no_hint(self):
+        for exc in TypeError, AttributeError:
+            for wrapper in self.wrappers(BadHint(exc)):
+                self.assertRaises(TypeError, len, wrapper)
+
 def test_main():
     unittests = [
         TestRepeat,
@@ -209,6 +326,14 @@ def test_main():
         TestSet,
         TestList,
         TestListReversed,
+        TestEnumerate,
+        TestGenexp,
+        TestImap,
+        TestIzip,
+        TestIzipLongest,
+        TestIslice,
+        TestStarmap,
+        TestHintErrors,
     ]
     test_support.run_unittest(*unittests)
 
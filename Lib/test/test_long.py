@@ -18,6 +18,8 @@ SHIFT = 15
 BASE = 2 ** SHIFT
 MASK = BASE - 1
 KARATSUBA_CUTOFF = 70   # from longobject.c
+TOOM3_CUTOFF = 400      # ditto
+NTT_CUTOFF = 1500       # ditto
 
 # Max number of base BASE digits to use in test cases.  Doubling
 # this will more than double the runtime.
@@ -164,6 +166,41 @@ class LongTest(unittest.TestCase):
                 self.assertEqual(x, y,
                     Frm("bad result for a*b: a=%r, b=%r, x=%r, y=%r", a, b, x, y))
 
+    def test_huge_multiplication(self):
+        # Toom-Cook and number-theoretic transform products, checked
+        # against the sum of the products of a with short pieces of b,
+        # which stay below those cutoffs.
+        def chunked_mul(a, b):
+            chunk = KARATSUBA_CUTOFF * SHIFT
+            mask = (1L << chunk) - 1
+            result, shift = 0L, 0
+            while b:
+                result += (a * (b & mask)) << shift
+                b >>= chunk
+                shift += chunk
+            return result
+
+        for lena, lenb in [(TOOM3_CUTOFF + 1, TOOM3_CUTOFF + 1),
+                           (TOOM3_CUTOFF * 2, TOOM3_CUTOFF + 7),
+                           (NTT_CUTOFF + 1, NTT_CUTOFF + 1),
+                           (NTT_CUTOFF * 3, NTT_CUTOFF * 2 + 5)]:
+            a = abs(self.getran(lena))
+            b = abs(self.getran(lenb))
+            for x, y in (a, b), (-a, b), (a, a):
+                self.assertEqual(x * y, chunked_mul(x, y))
+        ones = (1L << (NTT_CUTOFF * 2 * SHIFT)) - 1
+        self.assertEqual(ones * ones, chunked_mul(ones, ones))
+
+        # Modular powers with a big modulus reduce by Barrett's method.
+        m = abs(self.getran(TOOM3_CUTOFF)) | 1
+        a = self.getran(TOOM3_CUTOFF * 2)
+        x = 1
+        for i in range(5):
+            x = x * a % m
+            self.assertEqual(pow(a, i + 1, m), x)
+        self.assertEqual(pow(-a, 3, m), -a * a * a % m)
+        self.assertEqual(pow(a, 3, -m), a * a * a % -m)
+
     def check_bitop_identities_1(self, x):
         eq = self.assertEqual
         eq(x & 0, 0, Frm("x & 0 != 0 for x=%r", x))
@@ -275,6 +312,31 @@ class LongTest(unittest.TestCase):
                 x = self.getran(lenx)
                 self.check_format_1(x)
 
+    def test_format_huge(self):
+        # Long decimal conversions split the number at powers of 10;
+        # check numbers around those powers, and ones with long runs of 0
+        # and 1 bits, against a format built from 50-digit pieces.
+        def chunked_str(x):
+            pieces = []
+            while x >= 10L**50:
+                x, r = divmod(x, 10L**50)
+                pieces.append('%050d' % r)
+            pieces.append(str(int(x)))
+            pieces.reverse()
+            return ''.join(pieces)
+        values = []
+        for e in (255, 256, 257, 512, 1024, 2048, 3000):
+            values += [10L**e - 1, 10L**e, 10L**e + 1, 7 * 10L**e + 3]
+        for ndigits in (100, 300, 700, 2000):
+            values.append(abs(self.getran(ndigits)))
+        for x in values:
+            s = chunked_str(x)
+            self.assertEqual(str(x), s)
+            self.assertEqual(str(-x), '-' + s)
+            self.assertEqual(long(s), x)
+            self.assertEqual(long('-' + s), -x)
+            self.assertEqual(long('0' * 300 + s), x)
+
     def test_long(self):
         self.assertEqual(long(314), 314L)
         self.assertEqual(long(3.14), 3L)
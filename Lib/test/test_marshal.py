@@ -4,6 +4,7 @@
 from test import test_support
 import marshal
 import sys
+import gc
 import unittest
 import os
 
@@ -148,6 +149,97 @@ class CodeTestCase(unittest.TestCase):
         new = marshal.loads(marshal.dumps(co))
         self.assertEqual(co, new)
 
+    nested_source = """
+def outer(x, y=2):
+    def inner(z=x * 10):
+        return z + y
+    return inner
+class C:
+    def method(self, a=1):
+        return a * 3
+    prop = lambda self: 'prop'
+"""
+
+    def check_nested(self, new):
+        ns = {}
+        exec new in ns
+        self.assertEqual(ns['outer'](1)(), 12)
+        self.assertEqual(ns['C']().method(), 3)
+        self.assertEqual(ns['C']().prop(), 'prop')
+
+    def test_nested_code(self):
+        # Version 3 loads the nested code objects lazily
+        co = compile(self.nested_source, 'nested', 'exec')
+        for version in range(marshal.version + 1):
+            new = marshal.loads(marshal.dumps(co, version))
+            self.check_nested(new)
+            new = marshal.loads(marshal.dumps(co, version))
+            self.assertEqual(co, new)
+            self.assertEqual(hash(co), hash(new))
+            for c in new.co_consts:
+                self.assert_(not type(c).__name__.startswith('lazy'))
+            self.assertEqual(co.co_consts, new.co_consts)
+            self.assertEqual(marshal.loads(marshal.dumps(new, version)), co)
+
+    def test_nested_code_collected(self):
+        # The code objects still to be loaded refer back to the objects
+        # read before them, including the code object holding them; it's
+        # written as one that can be referred to when co has other
+        # references.  The cycles have to be freed all the same.
+        co = compile(self.nested_source, 'nested', 'exec')
+        data = marshal.dumps(co)
+        gc.collect()
+        before = len(gc.get_objects())
+        for i in range(10):
+            marshal.loads(data)
+        gc.collect()
+        self.assert_(len(gc.get_objects()) - before < 10)
+
+    def test_nested_code_file(self):
+        co = compile(self.nested_source, 'nested', 'exec')
+        f = open(test_support.TESTFN, 'wb')
+        try:
+            marshal.dump(co, f)
+            f.close()
+            f = open(test_support.TESTFN, 'rb')
+            new = marshal.load(f)
+        finally:
+            f.close()
+            os.unlink(test_support.TESTFN)
+        self.check_nested(new)
+
+    def test_nested_code_data(self):
+        # Code objects still to be loaded keep a copy of their own part of
+        # the data, not the whole string they were read from
+        data = marshal.dumps(compile(self.nested_source, 'nested', 'exec'))
+        before = sys.getrefcount(data)
+        new = marshal.loads(data)
+        self.assertEqual(sys.getrefcount(data), before)
+        self.check_nested(new)
+
+    def test_shared_names(self):
+        # Version 4 writes equal tuples of names once
+        co = compile("def f(a, b):\n    return a.a + b.b\n", 'names', 'exec')
+        self.assert_(len(marshal.dumps(co, 4)) < len(marshal.dumps(co, 3)))
+        ns = {}
+        exec marshal.loads(marshal.dumps(co, 4)) in ns
+        f = ns['f'].func_code
+        self.assertEqual(f.co_varnames, ('a', 'b'))
+        self.assert_(f.co_names is f.co_varnames)
+
+    def test_long_interned_string(self):
+        # The references after a long interned string number it too
+        source = "def f(a):\n    a.a\ndef g(b):\n    b = %r\n" % ('b' * 256)
+        co = compile(source, 'long', 'exec')
+        for version in range(marshal.version + 1):
+            self.assertEqual(marshal.loads(marshal.dumps(co, version)), co)
+
+    def test_truncated_nested_code(self):
+        data = marshal.dumps(compile(self.nested_source, 'nested', 'exec'))
+        for i in range(len(data)):
+            self.assertRaises((EOFError, ValueError, TypeError),
+                              marshal.loads, data[:i])
+
 class ContainerTestCase(unittest.TestCase):
     d = {'astring': 'foo@bar.baz.spam',
          'afloat': 7283.43,
@@ -184,6 +276,37 @@ class ContainerTestCase(unittest.TestCase):
         self.assertEqual(t, new)
         os.unlink(test_support.TESTFN)
 
+    def test_shared_objects(self):
+        item = [1.5, 'spam' * 100, (2L, u'eggs')]
+        value = [item, item, tuple(item)]
+        for version in range(marshal.version + 1):
+            new = marshal.loads(marshal.dumps(value, version))
+            self.assertEqual(new, value)
+            # Version 4 keeps objects shared
+            self.assertEqual(new[0] is new[1], version >= 4)
+            self.assertEqual(new[0][1] is new[2][1], version >= 4)
+
+    def test_recursive_containers(self):
+        l = []
+        l.append(l)
+        new = marshal.loads(marshal.dumps(l))
+        self.assert_(new[0] is new)
+        d = {}
+        d[1] = d
+        new = marshal.loads(marshal.dumps(d))
+        self.assert_(new[1] is new)
+        # Through a tuple, which refers back to it while being read too
+        l = []
+        t = (l, 1)
+        l.append(t)
+        new = marshal.loads(marshal.dumps(t))
+        self.assert_(new[0][0] is new)
+        new = marshal.loads(marshal.dumps(l))
+        self.assert_(new[0][0] is new)
+        # Versions without references can't write them
+        for version in range(4):
+            self.assertRaises(ValueError, marshal.dumps, l, version)
+
     def test_sets(self):
         for constructor in (set, frozenset):
             t = constructor(self.d.keys())
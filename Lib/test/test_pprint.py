@@ -277,7 +277,10 @@ class QueryTestCase(unittest.TestCase):
                                                             frozenset([frozenset([1]),
                                                                        frozenset([0,
                                                                                   1])])]),
- frozenset([frozenset([1, 2]), frozenset([2])]): frozenset([frozenset([frozenset([1,
+ frozenset([frozenset([1, 2]), frozenset([2])]): frozenset([frozenset([frozenset([2]),
+                                                                       frozenset([0,
+                                                                                  2])]),
+                                                            frozenset([frozenset([1,
                                                                                   2]),
                                                                        frozenset([0,
                                                                                   1,
@@ -285,9 +288,6 @@ class QueryTestCase(unittest.TestCase):
                                                             frozenset([frozenset([1]),
                                                                        frozenset([1,
                                                                                   2])]),
-                                                            frozenset([frozenset([2]),
-                                                                       frozenset([0,
-                                                                                  2])]),
                                                             frozenset([frozenset(),
                                                                        frozenset([2])])]),
  frozenset([frozenset([]), frozenset([0])]): frozenset([frozenset([frozenset([0]),
@@ -301,12 +301,12 @@ class QueryTestCase(unittest.TestCase):
                                                         frozenset([frozenset(),
                                                                    frozenset([2])])]),
  frozenset([frozenset([]), frozenset([1])]): frozenset([frozenset([frozenset(),
+                                                                   frozenset([2])]),
+                                                        frozenset([frozenset(),
                                                                    frozenset([0])]),
                                                         frozenset([frozenset([1]),
                                                                    frozenset([1,
                                                                               2])]),
-                                                        frozenset([frozenset(),
-                                                                   frozenset([2])]),
                                                         frozenset([frozenset([1]),
                                                                    frozenset([0,
                                                                               1])])]),
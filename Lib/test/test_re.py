@@ -2,9 +2,10 @@ import sys
 sys.path = ['.'] + sys.path
 
 from test.test_support import verbose, run_unittest
+from test import test_support
 import re
 from re import Scanner
-import sys, os, traceback
+import sys, os, traceback, marshal
 from weakref import proxy
 
 # Misc tests from Tim Peters' re.doc
@@ -685,6 +686,70 @@ class ReTests(unittest.TestCase):
         self.assertEqual(pattern.sub('#', 'a\nb\nc'), 'a#\nb#\nc#')
         self.assertEqual(pattern.sub('#', '\n'), '#\n#')
 
+    def run_with_snapshot(self, code):
+        import subprocess
+        env = os.environ.copy()
+        env['PYTHONRESNAPSHOT'] = test_support.TESTFN
+        p = subprocess.Popen([sys.executable, '-c', code], env=env,
+                             stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        out, err = p.communicate()
+        self.assertEqual(p.returncode, 0, err)
+        return out.strip()
+
+    def test_snapshot(self):
+        compile_it = ("import re; p = re.compile(r'(?P<x>a)b+', re.I); "
+                      "print p.match('ABB').group('x'), p.groupindex")
+        # no sre_parse.parse() call for what the snapshot has
+        from_snapshot = ("import sre_parse; sre_parse.parse = None; "
+                         + compile_it)
+        try:
+            self.assertEqual(self.run_with_snapshot(compile_it),
+                             "A {'x': 1}")
+            self.assert_(os.path.exists(test_support.TESTFN))
+            self.assertEqual(self.run_with_snapshot(from_snapshot),
+                             "A {'x': 1}")
+            # changes to a pattern's groupindex don't reach the snapshot
+            self.assertEqual(self.run_with_snapshot(
+                "import re; re.compile(r'(?P<x>a)b+', re.I)"
+                ".groupindex['y'] = 2; re.purge(); " + compile_it),
+                             "A {'x': 1}")
+        finally:
+            test_support.unlink(test_support.TESTFN)
+
+    def test_snapshot_damaged(self):
+        compile_it = "import re; print re.compile('a(b)').match('ab').group(1)"
+        try:
+            for data in ['', 'garbage', marshal.dumps(("sre snapshot", 0)),
+                         marshal.dumps((("sre snapshot", 0), [])),
+                         marshal.dumps((re.sre_compile._snapshot_header(),
+                                        [("a(b)", 0, 1, 2)]))]:
+                f = open(test_support.TESTFN, "wb")
+                f.write(data)
+                f.close()
+                self.assertEqual(self.run_with_snapshot(compile_it), "b")
+                # the file was written again, with the pattern
+                f = open(test_support.TESTFN, "rb")
+                header, entries = marshal.load(f)
+                f.close()
+                self.assertEqual(header, re.sre_compile._snapshot_header())
+                self.assert_(("a(b)", 0) in [e[:2] for e in entries])
+        finally:
+            test_support.unlink(test_support.TESTFN)
+
+    def test_snapshot_locale(self):
+        # with LOCALE, the code depends on the locale it was compiled in
+        try:
+            self.assertEqual(self.run_with_snapshot(
+                "import re; print re.compile('a', re.L).match('a').group()"),
+                             "a")
+            if os.path.exists(test_support.TESTFN):
+                f = open(test_support.TESTFN, "rb")
+                header, entries = marshal.load(f)
+                f.close()
+                self.failIf("a" in [e[0] for e in entries])
+        finally:
+            test_support.unlink(test_support.TESTFN)
+
 
 def run_re_tests():
     from test.re_tests import benchmarks, tests, SUCCEED, FAIL, SYNTAX_ERROR
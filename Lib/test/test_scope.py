@@ -632,6 +632,32 @@ self.assert_(X.passed)
 
         f() # used to crash the interpreter...
 
+    def testManyFreeVars(self):
+        names = ['v%d' % i for i in range(200)]
+        src = "def f():\n"
+        for i, name in enumerate(names):
+            src += "    %s = %d\n" % (name, i)
+        src += "    def g():\n        return %s\n    return g\n" % (
+            " + ".join(names))
+        ns = {}
+        exec src in ns
+        g = ns['f']()
+        self.assertEqual(g(), sum(range(200)))
+        self.assertEqual(sorted(g.func_code.co_freevars), sorted(names))
+
+    def testMangledFreeVars(self):
+        # Each use of a private name is mangled into a new string, yet
+        # they all refer to the same variable
+        class C:
+            def m(self):
+                __x = 1
+                def g():
+                    return __x
+                return g
+        g = C().m()
+        self.assertEqual(g(), 1)
+        self.assertEqual(g.func_code.co_freevars, ('_C__x',))
+
 
 
 def test_main():
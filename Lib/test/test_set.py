@@ -1113,6 +1113,104 @@ class TestMutate(unittest.TestCase):
 
 #==============================================================================
 
+class SameHash(object):
+    'Unequal objects with one hash, so all land in the same probe group'
+    def __init__(self, value):
+        self.value = value
+    def __hash__(self):
+        return 42
+    def __eq__(self, other):
+        return isinstance(other, SameHash) and self.value == other.value
+
+class TestProbing(unittest.TestCase):
+    # The table is searched a group of slots at a time
+
+    def check(self, s, present, absent):
+        self.assertEqual(len(s), len(present))
+        for x in present:
+            self.assert_(x in s)
+        for x in absent:
+            self.assert_(x not in s)
+
+    def test_ints(self):
+        # Multiples of a power of two share their low hash bits
+        for step in (1, 16, 1024, 1 << 20):
+            present = range(0, 2000 * step, 2 * step)
+            absent = range(step, 2000 * step, 2 * step)
+            self.check(set(present), present, absent)
+
+    def test_strings(self):
+        present = ['x%d' % i for i in xrange(2000)]
+        absent = ['y%d' % i for i in xrange(2000)]
+        self.check(set(present), present, absent)
+        self.check(set(present + [u'z']), present + [u'z'], absent)
+
+    def test_same_hash(self):
+        present = map(SameHash, range(0, 200, 2))
+        absent = map(SameHash, range(1, 200, 2))
+        s = set(present)
+        self.check(s, present, absent)
+        for x in present[::3]:
+            s.remove(x)
+        self.check(s, [x for i, x in enumerate(present) if i % 3],
+                   present[::3] + absent)
+
+    def test_remove_and_readd(self):
+        s = set(range(100))
+        for i in xrange(1000):
+            s.remove(i)
+            self.assert_(i not in s)
+            s.add(i + 100)
+        self.check(s, range(1000, 1100), range(1000))
+        while s:
+            x = s.pop()
+            self.assert_(x not in s)
+        self.assertEqual(s, set())
+
+    def test_pop_then_lookup(self):
+        s = set(range(40))
+        popped = [s.pop() for i in range(35)]
+        self.check(s, sorted(set(range(40)) - set(popped)), popped)
+
+    def test_str_equal_unicode(self):
+        # 'd' == u'd' and they hash alike; whichever went in first stays
+        for other in (set([u'd']), [u'd'], (u'd',), {u'd': 1}):
+            s = set('abc')
+            s.update(other)
+            s.update('d')
+            self.assertEqual(len(s), 4)
+            s = set(other)
+            s.update('d')
+            self.assertEqual(len(s), 1)
+
+    def test_dict_operand(self):
+        s = set(range(0, 100, 2))
+        d = dict.fromkeys(range(0, 100, 3))
+        self.assertEqual(s.intersection(d), set(range(0, 100, 6)))
+        self.assertEqual(s.isdisjoint(d), False)
+        self.assertEqual(s.isdisjoint(dict.fromkeys([1, 3])), True)
+        self.assertEqual(s.difference(d), s - set(d))
+        self.assertEqual(set(d), set(range(0, 100, 3)))
+        t = set(s)
+        t.difference_update(d)
+        self.assertEqual(t, s - set(d))
+        t = set(s)
+        t.symmetric_difference_update(d)
+        self.assertEqual(t, s ^ set(d))
+
+    def test_update_from_list_mutated(self):
+        # Hashing may shrink the list being read
+        class Shrinker(int):
+            def __hash__(self):
+                del data[:]
+                return int.__hash__(self)
+        data = [1, Shrinker(2), 3, 4]
+        s = set()
+        s.update(data)
+        self.assertEqual(s, set([1, 2]))
+
+#==============================================================================
+
 class TestSubsets(unittest.TestCase):
 
     case2method = {"<=": "issubset",
@@ -1693,6 +1791,7 @@ def test_main(verbose=None):
         TestBinaryOps,
         TestUpdateOps,
         TestMutate,
+        TestProbing,
         TestSubsetEqualEmpty,
         TestSubsetEqualNonEmpty,
         TestSubsetEmptyNonEmpty,
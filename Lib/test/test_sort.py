@@ -267,11 +267,65 @@ class TestDecorateSortUndecorate(unittest.TestCase):
 
 #==============================================================================
 
+class TestSpecialisedCompares(unittest.TestCase):
+    # Lists whose keys are all str, int or float are sorted with
+    # type-specific comparisons, and long enough lists of ints or floats
+    # by radix sort.  Check them against the generic path, which keys of
+    # another type with the same "<" force.
+
+    def check_sort(self, data):
+        class Key(object):
+            def __init__(self, x):
+                self.x = x
+            def __lt__(self, other):
+                return self.x < other.x
+        for reverse in False, True:
+            expected = sorted(data, key=Key, reverse=reverse)
+            got = sorted(data, reverse=reverse)
+            self.assertEqual(map(id, got), map(id, expected))
+            got = sorted(data, key=lambda x: x, reverse=reverse)
+            self.assertEqual(map(id, got), map(id, expected))
+
+    def test_ints(self):
+        for n in 10, 1000:
+            self.check_sort([random.randrange(-50, 50) for i in xrange(n)])
+            self.check_sort([random.randint(-sys.maxint-1, sys.maxint)
+                             for i in xrange(n)])
+            self.check_sort(range(n))
+
+    def test_floats(self):
+        special = [0.0, -0.0, 1e308, -1e308, 5e-324, -5e-324,
+                   float('inf'), float('-inf')]
+        for n in 10, 1000:
+            data = [float(random.randrange(-50, 50)) for i in xrange(n)]
+            self.check_sort(data + special * 3)
+            data = [random.gauss(0, 1e6) for i in xrange(n)]
+            self.check_sort(data + special)
+            # A NaN defeats the radix sort, but not the comparisons.
+            self.check_sort(data + [float('nan')] + special)
+
+    def test_strings(self):
+        for n in 10, 1000:
+            self.check_sort([''.join(chr(random.randrange(256))
+                                     for j in xrange(random.randrange(4)))
+                             for i in xrange(n)])
+
+    def test_mixed_types(self):
+        class MyInt(int):
+            pass
+        for data in ([1, 2.0] * 300, [1, MyInt(2)] * 300,
+                     ['a', u'b'] * 300, [3, 1, 2, 3L] * 300):
+            random.shuffle(data)
+            self.check_sort(data)
+
+#==============================================================================
+
 def test_main(verbose=None):
     test_classes = (
         TestBase,
         TestDecorateSortUndecorate,
         TestBugs,
+        TestSpecialisedCompares,
     )
 
     test_support.run_unittest(*test_classes)
@@ -31,6 +31,39 @@ class StrTest(
         a[0] = a
         self.assertEqual(str(a), '{0: {...}}')
 
+    def test_join_huge_hint(self):
+        # Too big to size the result for, so it is grown as usual
+        self.assertEqual('-'.join(string_tests.Hinted(['a' * 100] * 100,
+                                                      sys.maxint)),
+                         '-'.join(['a' * 100] * 100))
+
+    def test_long_case_conversion(self):
+        # Long enough for the vectorised loops, at every alignment
+        lower = lambda c: chr(ord(c) + 32) if 'A' <= c <= 'Z' else c
+        upper = lambda c: chr(ord(c) - 32) if 'a' <= c <= 'z' else c
+        s = ''.join(map(chr, range(256))) * 2
+        for i in range(33):
+            t = s[i:i+300]
+            self.assertEqual(t.lower(), ''.join(map(lower, t)))
+            self.assertEqual(t.upper(), ''.join(map(upper, t)))
+            self.assertEqual(t.swapcase(),
+                             ''.join(lower(c) if c.isupper() else upper(c)
+                                     for c in t))
+
+    def test_long_translate(self):
+        identity = ''.join(map(chr, range(256)))
+        table = ''.join(chr((i * 151 + 7) & 255) for i in range(256))
+        s = identity * 2
+        for i in range(33):
+            t = s[i:i+300]
+            self.assertEqual(t.translate(table),
+                             ''.join(table[ord(c)] for c in t))
+            self.assertTrue(t.translate(identity) is t)
+            # A change only at the very end still makes a new string
+            u = t.replace('\0', 'x')[:-1] + '\0'
+            self.assertEqual(u.translate('\1' + identity[1:]),
+                             u[:-1] + '\1')
+
     def test_formatting(self):
         string_tests.MixinStrUnicodeUserStringTest.test_formatting(self)
         self.assertRaises(OverflowError, '%c'.__mod__, 0x1234)
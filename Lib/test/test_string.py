@@ -196,6 +196,83 @@ class ModuleTest(unittest.TestCase):
         self.assertRaises(ValueError, format, '', '#')
         self.assertRaises(ValueError, format, '', '#20')
 
+class BuilderTest(unittest.TestCase):
+
+    def test_string_builder(self):
+        b = string.StringBuilder()
+        self.assertEqual(len(b), 0)
+        self.assertEqual(b.getvalue(), '')
+        b.append('abc')
+        b += 'def'
+        b.append('')
+        self.assertEqual(len(b), 6)
+        self.assertEqual(b.getvalue(), 'abcdef')
+        self.assertRaises(TypeError, b.append, u'x')
+        self.assertRaises(TypeError, b.append, 1)
+        self.assertEqual(b.getvalue(), 'abcdef')
+
+    def test_unicode_builder(self):
+        b = string.UnicodeBuilder()
+        self.assertEqual(b.getvalue(), u'')
+        b.append(u'abc')
+        b += 'def'
+        self.assertEqual(b.getvalue(), u'abcdef')
+        self.assertEqual(type(b.getvalue()), unicode)
+        self.assertRaises(TypeError, b.append, 1)
+        self.assertRaises(UnicodeError, b.append, '\xff')
+        self.assertEqual(b.getvalue(), u'abcdef')
+
+    def test_getvalue_then_append(self):
+        # The value handed out must not change when the builder does.
+        for cls, s in ((string.StringBuilder, 'xy'),
+                       (string.UnicodeBuilder, u'xy')):
+            b = cls(size=1000)
+            values = []
+            for i in range(200):
+                b.append(s)
+                values.append(b.getvalue())
+            for i, v in enumerate(values):
+                self.assertEqual(v, s * (i + 1))
+
+    def test_getvalue_dropped(self):
+        # A value that was handed out and dropped again is grown in place.
+        for cls, s in ((string.StringBuilder, 'xy'),
+                       (string.UnicodeBuilder, u'xy')):
+            b = cls()
+            for i in range(200):
+                b.append(s)
+                v = b.getvalue()
+                self.assertEqual(v, s * (i + 1))
+                self.assertEqual(hash(v), hash(s * (i + 1)))
+                del v
+            self.assertEqual(b.getvalue(), s * 200)
+
+    def test_getvalue_interned(self):
+        # The builder fills up nearly enough to hand its buffer out.
+        b = string.StringBuilder()
+        b.append('abc' * 100)
+        b.append('d' * 100)
+        v = intern(b.getvalue())
+        del v
+        b.append('e')
+        self.assertEqual(intern('abc' * 100 + 'd' * 100),
+                         'abc' * 100 + 'd' * 100)
+        self.assertEqual(b.getvalue(), 'abc' * 100 + 'd' * 100 + 'e')
+
+    def test_many_pieces(self):
+        for cls in string.StringBuilder, string.UnicodeBuilder:
+            b = cls()
+            pieces = [str(i) for i in range(10000)]
+            for p in pieces:
+                b += p
+            self.assertEqual(b.getvalue(), ''.join(pieces))
+            self.assertEqual(len(b), len(''.join(pieces)))
+
+    def test_size(self):
+        self.assertEqual(string.StringBuilder(100).getvalue(), '')
+        self.assertEqual(string.StringBuilder(size=0).getvalue(), '')
+        self.assertRaises(TypeError, string.StringBuilder, 'x')
+
 class BytesAliasTest(unittest.TestCase):
 
     def test_builtin(self):
@@ -208,7 +285,8 @@ class BytesAliasTest(unittest.TestCase):
         self.assert_(type(br""), str)
 
 def test_main():
-    test_support.run_unittest(StringTest, ModuleTest, BytesAliasTest)
+    test_support.run_unittest(StringTest, ModuleTest, BuilderTest,
+                              BytesAliasTest)
 
 if __name__ == "__main__":
     test_main()
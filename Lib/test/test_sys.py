@@ -222,14 +222,32 @@ class SysModuleTest(unittest.TestCase):
 
     def test_refcount(self):
         self.assertRaises(TypeError, sys.getrefcount)
-        c = sys.getrefcount(None)
-        n = None
-        self.assertEqual(sys.getrefcount(None), c+1)
+        o = object()
+        c = sys.getrefcount(o)
+        n = o
+        self.assertEqual(sys.getrefcount(o), c+1)
         del n
-        self.assertEqual(sys.getrefcount(None), c)
+        self.assertEqual(sys.getrefcount(o), c)
         if hasattr(sys, "gettotalrefcount"):
             self.assert_(isinstance(sys.gettotalrefcount(), int))
 
+    def test_immortal_objects(self):
+        # Built without immortal objects, None's count is an ordinary one.
+        if sys.getrefcount(None) < sys.maxint // 2:
+            return
+        for obj in (None, True, False, NotImplemented, Ellipsis,
+                    0, 1, -5, 256, '', 'a', chr(255)):
+            c = sys.getrefcount(obj)
+            refs = [obj] * 100
+            self.assertEqual(sys.getrefcount(obj), c, repr(obj))
+            del refs
+            self.assertEqual(sys.getrefcount(obj), c, repr(obj))
+        # Other ints and strings are still counted.
+        for obj in (257, 'ab'):
+            c = sys.getrefcount(obj)
+            refs = [obj] * 100
+            self.assertEqual(sys.getrefcount(obj), c + 100)
+
     def test_getframe(self):
         self.assertRaises(TypeError, sys._getframe, 42, 42)
         self.assertRaises(ValueError, sys._getframe, 2000000000)
@@ -367,6 +385,130 @@ class SysModuleTest(unittest.TestCase):
     def test_clear_type_cache(self):
         sys._clear_type_cache()
 
+    def test_malloc_stats(self):
+        stats = sys._malloc_stats()
+        freelists = stats["freelists"]
+        for name in ("int", "float", "frame", "tuple"):
+            count, nbytes = freelists[name]
+            self.assert_(count >= 0 and nbytes >= 0, name)
+        # ints released to the free list show up there
+        x = [int(i) for i in xrange(1000, 2000)]
+        before = sys._malloc_stats()["freelists"]["int"][0]
+        del x
+        self.assert_(sys._malloc_stats()["freelists"]["int"][0] >=
+                     before + 900)
+        if "arenas_allocated_current" not in stats:
+            return  # built without pymalloc
+        self.assert_(stats["arenas_allocated_current"] > 0)
+        self.assert_(stats["arenas_highwater"] >=
+                     stats["arenas_allocated_current"])
+        self.assert_(0.0 <= stats["fragmentation"] <= 1.0)
+        used = sum(size * inuse
+                   for size, pools, inuse, avail in stats["size_classes"])
+        self.assertEqual(used, stats["allocated_bytes"])
+        self.assert_(stats["allocated_bytes"] <= stats["arena_bytes"])
+        self.assert_(0 <= stats["released_pools"] <= stats["free_pools"])
+
+    def test_malloc_release_pools(self):
+        import gc
+        # Free pools may be given back to the system by full collections;
+        # the memory must come back intact when it is needed again.
+        x = [(i,) for i in xrange(100000)]
+        keep = x[::300]
+        del x
+        gc.collect()
+        gc.collect()
+        stats = sys._malloc_stats()
+        if "released_pools" in stats:
+            self.assert_(stats["released_pools"] <= stats["free_pools"])
+        y = [(i,) for i in xrange(100000)]
+        for i, t in enumerate(y):
+            self.assertEqual(t, (i,))
+        for i, t in enumerate(keep):
+            self.assertEqual(t, (i * 300,))
+
+    def test_malloc_release_spike(self):
+        import gc
+        if "released_pools" not in sys._malloc_stats():
+            return  # built without pymalloc
+        def held():
+            stats = sys._malloc_stats()
+            return (stats["arenas_allocated_current"] + stats["parked_arenas"],
+                    stats["released_pools"])
+        gc.collect()
+        arenas, released = held()
+        x = [(i,) for i in xrange(200000)]
+        self.assert_(held()[0] > arenas)
+        peak = held()[0]
+        del x
+        gc.collect()
+        gc.collect()
+        # Either whole arenas went back to the system, or their free pools
+        # were released.
+        now, now_released = held()
+        self.assert_(now < peak or now_released > released)
+        self.assert_(sys._malloc_stats()["parked_arenas"] <= 4)
+
+    def test_compile_cache_stats(self):
+        stats = sys._compile_cache_stats()
+        for name in ("size", "bytes", "entries", "hits", "misses",
+                     "evictions"):
+            self.assert_(stats[name] >= 0, name)
+        self.assert_(stats["bytes"] <= stats["size"] * 1024)
+
+    def test_compile_cache(self):
+        import subprocess
+        code = r"""if 1:
+            import sys
+            a = compile('x + 1', 'f', 'eval')
+            assert compile('x + 1', 'f', 'eval') is a
+            assert compile('x + 1', 'g', 'eval') is not a
+            assert compile('x + 1', 'f', 'exec') is not a
+            assert compile('x + 1', 'f', 'eval', 0x2000) is not a
+            for i in range(3):
+                exec 'y = 2'
+                assert eval('y * 3') == 6
+            # Future imports still reach the caller's flags
+            ns = {}
+            for i in range(2):
+                exec compile('from __future__ import division\n'
+                             'q = 1 / 2', 'f', 'exec') in ns
+                assert ns['q'] == 0.5
+            stats = sys._compile_cache_stats()
+            assert stats['size'] == 2, stats
+            assert stats['hits'] >= 6, stats
+            # Filling the cache evicts the least recently used entries
+            for i in range(500):
+                compile('x + %d' % i, 'f', 'eval')
+            stats = sys._compile_cache_stats()
+            assert stats['evictions'] > 0, stats
+            assert stats['bytes'] <= 2048, stats
+            assert compile('x + 499', 'f', 'eval') is \
+                   compile('x + 499', 'f', 'eval')
+            print 'ok'
+            """
+        p = subprocess.Popen([sys.executable, "-X", "compile_cache=2",
+                              "-c", code], stdout=subprocess.PIPE)
+        self.assertEqual(p.communicate()[0].strip(), 'ok')
+        self.assertEqual(p.returncode, 0)
+        for size in ("x", "-1", str(sys.maxsize // 1024 + 1), "9" * 30):
+            rc = subprocess.call([sys.executable, "-X", "compile_cache=" + size,
+                                  "-c", "pass"], stderr=subprocess.PIPE)
+            self.assertEqual(rc, 2)
+        # The largest size is as good as no limit
+        code = r"""if 1:
+            import sys
+            for i in range(500):
+                compile('x + %d' % i, 'f', 'eval')
+            assert compile('x + 0', 'f', 'eval') is \
+                   compile('x + 0', 'f', 'eval')
+            assert sys._compile_cache_stats()['evictions'] == 0
+            """
+        rc = subprocess.call([sys.executable, "-X",
+                              "compile_cache=%d" % (sys.maxsize // 1024),
+                              "-c", code])
+        self.assertEqual(rc, 0)
+
     def test_ioencoding(self):
         import subprocess,os
         env = dict(os.environ)
@@ -484,7 +626,7 @@ class SizeofTest(unittest.TestCase):
         # complex
         check(complex(0,1), size(h + '2d'))
         # code
-        check(get_cell().func_code, size(h + '4i8Pi2P'))
+        check(get_cell().func_code, size(h + '4i8Pi2Pi'))
         # BaseException
         check(BaseException(), size(h + '3P'))
         # UnicodeEncodeError
@@ -511,9 +653,9 @@ class SizeofTest(unittest.TestCase):
         # method-wrapper (descriptor object)
         check({}.__iter__, size(h + '2P'))
         # dict
-        check({}, size(h + '3P2P' + 8*'P2P'))
+        check({}, size(h + '3P2PQ' + 8*'P2P'))
         x = {1:1, 2:2, 3:3, 4:4, 5:5, 6:6, 7:7, 8:8}
-        check(x, size(h + '3P2P' + 8*'P2P') + 16*size('P2P'))
+        check(x, size(h + '3P2PQ' + 8*'P2P') + 16*size('P2P'))
         # dictionary-keyiterator
         check({}.iterkeys(), size(h + 'P2PPP'))
         # dictionary-valueiterator
@@ -609,8 +751,10 @@ class SizeofTest(unittest.TestCase):
         # set
         # frozenset
         PySet_MINSIZE = 8
+        PySet_GROUPSIZE = 16
         samples = [[], range(10), range(50)]
-        s = size(h + '3P2P' + PySet_MINSIZE*'lP' + 'lP')
+        s = size(h + '3P2P' + PySet_MINSIZE*'lP' + 'P%ds' % PySet_GROUPSIZE +
+                 'lP')
         for sample in samples:
             minused = len(sample)
             if minused == 0: tmp = 1
@@ -624,8 +768,10 @@ class SizeofTest(unittest.TestCase):
                 check(set(sample), s)
                 check(frozenset(sample), s)
             else:
-                check(set(sample), s + newsize*struct.calcsize('lP'))
-                check(frozenset(sample), s + newsize*struct.calcsize('lP'))
+                # each slot has a control byte after the table
+                entrysize = struct.calcsize('lP') + 1
+                check(set(sample), s + newsize*entrysize)
+                check(frozenset(sample), s + newsize*entrysize)
         # setiterator
         check(iter(set()), size(h + 'P3P'))
         # slice
@@ -637,7 +783,9 @@ class SizeofTest(unittest.TestCase):
         check(super(int), size(h + '3P'))
         # tuple
         check((), size(vh))
-        check((1,2,3), size(vh) + 3*self.P)
+        check((1,), size(vh) + self.P)
+        # (one more slot holds the cached hash)
+        check((1,2,3), size(vh) + 4*self.P)
         # tupleiterator
         check(iter(()), size(h + 'lP'))
         # type
@@ -71,6 +71,37 @@ class TupleTest(seq_tests.CommonTest):
         collisions = len(inps) - len(set(map(hash, inps)))
         self.assert_(collisions <= 15)
 
+    def test_hash_items(self):
+        # The hash is worked out from the item hashes, whatever their type
+        self.assertEqual(hash((1, 2)), hash((1L, 2.0)))
+        self.assertEqual(hash((-1, 'a')), hash((-1L, u'a')))
+        self.assertRaises(TypeError, hash, (1, []))
+
+    def test_hash_cache(self):
+        t = (1, 'a', (2, 3))
+        h = hash(t)
+        self.assertEqual(hash(t), h)
+        self.assertEqual(hash((1, 'a', (2, 3))), h)
+        class T(tuple):
+            pass
+        self.assertEqual(hash(T(t)), h)
+        self.assertEqual(hash(T(t)), h)
+
+    def test_hash_reused_tuples(self):
+        # Some iterators reuse their result tuple when nobody else holds
+        # it; they mustn't keep the hash of the previous items.
+        from itertools import izip, izip_longest, product, combinations, \
+                              permutations
+        d = dict.fromkeys(range(5), 'x')
+        for it in (lambda: enumerate('abcd'),
+                   lambda: d.iteritems(),
+                   lambda: izip('abc', 'def'),
+                   lambda: izip_longest('abc', 'd'),
+                   lambda: product('ab', repeat=3),
+                   lambda: combinations('abcd', 2),
+                   lambda: permutations('abc', 2)):
+            self.assertEqual(map(hash, it()), map(hash, list(it())))
+
     def test_repr(self):
         l0 = tuple()
         l2 = (0, 1, 2)
@@ -1113,6 +1113,53 @@ class UnicodeTest(
         #  will fail
         self.assertRaises(UnicodeEncodeError, "foo{0}".format, u'\u1000bar')
 
+    def test_find_ascii_pattern(self):
+        # Long ASCII patterns are searched with a shift table on which
+        # non-ASCII characters move the window past themselves.
+        pat = u'ab' * 20 + u'c'
+        for filler in (u'\xe9', u'\u20ac', u'b', u'c'):
+            s = filler * 100 + pat + filler * 3 + pat
+            self.assertEqual(s.find(pat), 100)
+            self.assertEqual(s.rfind(pat), 100 + len(pat) + 3)
+            self.assertEqual(s.count(pat), 2)
+            self.assertEqual(s.find(pat, 101), 100 + len(pat) + 3)
+            self.assertEqual((filler * 200).find(pat), -1)
+        s = u'x' * 300 + u'y'
+        self.assertEqual((u'x' * 1000 + s).find(s), 1000)
+        self.assertEqual((u'x' * 1000 + s).count(s), 1)
+
+    def test_character_ranges(self):
+        # The ASCII and Latin-1 fast paths must give the same results as
+        # the general code.
+        samples = [u'abc', u'ab\xe9', u'ab\u20ac', u'', u'\xe9\xe9\xe9']
+        for a in samples:
+            for b in samples:
+                a2 = u''.join(list(a))   # fresh copies
+                b2 = u''.join(list(b))
+                hash(a)
+                hash(b)
+                expected = list(a) == list(b)
+                for x, y in ((a, b), (a2, b), (a, b2), (a2, b2)):
+                    self.assertEqual(x == y, expected)
+                    self.assertEqual(x != y, not expected)
+                    self.assertEqual(y in x, y.encode('utf-8') in
+                                             x.encode('utf-8'))
+        for s in (u'abc', u'ab\xe9', u'ab\u20ac'):
+            t = s.encode('utf-8').decode('utf-8')
+            self.assertEqual(t, s)
+            self.assertEqual(t.encode('utf-8'), s.encode('utf-8'))
+            self.assertEqual(s.encode('latin-1', 'replace'),
+                             t.encode('latin-1', 'replace'))
+            self.assertEqual(s.encode('ascii', 'replace'),
+                             t.encode('ascii', 'replace'))
+        self.assertEqual(u'abc'.encode('ascii'), 'abc')
+        self.assertEqual(u'ab\xe9'.encode('latin-1'), 'ab\xe9')
+        self.assertRaises(UnicodeEncodeError, u'ab\xe9'.encode, 'ascii')
+        self.assertRaises(UnicodeEncodeError, u'ab\u20ac'.encode, 'latin-1')
+        self.assertEqual('ab\xe9'.decode('latin-1').encode('latin-1'),
+                         'ab\xe9')
+        self.assertEqual('ab\xe9'.decode('ascii', 'replace'), u'ab\ufffd')
+
     def test_raiseMemError(self):
         # Ensure that the freelist contains a consistent object, even
         # when a string allocation fails with a MemoryError.
@@ -179,8 +179,10 @@ PyLocale_setlocale(PyObject* self, PyObject* args)
         if (!result_object)
             return NULL;
         /* record changes to LC_CTYPE */
-        if (category == LC_CTYPE || category == LC_ALL)
+        if (category == LC_CTYPE || category == LC_ALL) {
+            _PyString_CheckCtype();
             fixup_ulcase();
+        }
         /* things that got wrong up to here are ignored */
         PyErr_Clear();
     } else {
@@ -0,0 +1,382 @@
+/* String builders.
+
+   StringBuilder and UnicodeBuilder put a string together from pieces in
+   amortised linear time, wherever the builder is kept.  (s += piece is
+   only that fast when s is a local variable that nothing else refers to;
+   in an attribute, a container or a unicode object it copies s every
+   time.)  The pieces are written straight into an overallocated str or
+   unicode object, which getvalue() trims and returns without copying.
+   Once that string has been dropped again, the buffer is grown in place,
+   so getvalue() and append() can alternate in linear time too.
+*/
+
+#include "Python.h"
+
+typedef struct {
+	PyObject_HEAD
+	PyObject *buf;		/* str or unicode being filled, or NULL */
+	Py_ssize_t len;		/* number of characters of buf in use */
+} builderobject;
+
+static PyTypeObject StringBuilder_Type;
+static PyTypeObject UnicodeBuilder_Type;
+
+#define UnicodeBuilder_Check(op) (Py_TYPE(op) == &UnicodeBuilder_Type)
+
+/* Size of the smallest buffer allocated, in characters. */
+#define MIN_BUF_SIZE 64
+
+/* Number of characters buf has room for. */
+static Py_ssize_t
+builder_bufsize(builderobject *self)
+{
+	if (self->buf == NULL)
+		return 0;
+	if (UnicodeBuilder_Check(self))
+		return PyUnicode_GET_SIZE(self->buf);
+	return PyString_GET_SIZE(self->buf);
+}
+
+/* Make room for n more characters.  Return -1 on error, 0 otherwise.
+ *
+ * Characters are only ever written into a buffer nobody else has seen:
+ * once getvalue() has handed the buffer out it's exactly full, so the next
+ * append gets a new one, unless the string handed out has since been
+ * dropped and the buffer can be grown in place.
+ */
+static int
+builder_reserve(builderobject *self, Py_ssize_t n)
+{
+	PyObject *newbuf;
+	Py_ssize_t need, size;
+
+	if (n == 0)
+		return 0;
+	if (n > PY_SSIZE_T_MAX - self->len) {
+		PyErr_SetString(PyExc_OverflowError,
+				"string is too large to build");
+		return -1;
+	}
+	need = self->len + n;
+	if (need <= builder_bufsize(self)) {
+		assert(Py_REFCNT(self->buf) == 1);
+		return 0;
+	}
+
+	/* Grow by half again, so that appending n characters one piece at
+	 * a time copies each character a bounded number of times.
+	 */
+	if (need < MIN_BUF_SIZE)
+		size = MIN_BUF_SIZE;
+	else if (need <= PY_SSIZE_T_MAX - (need >> 1))
+		size = need + (need >> 1);
+	else
+		size = need;
+	if (self->buf != NULL && Py_REFCNT(self->buf) == 1 &&
+	    !(PyString_CheckExact(self->buf) &&
+	      PyString_CHECK_INTERNED(self->buf))) {
+		/* Nothing else refers to it any more:  grow it in place. */
+		if ((UnicodeBuilder_Check(self) ?
+		     PyUnicode_Resize(&self->buf, size) :
+		     _PyString_Resize(&self->buf, size)) < 0) {
+			/* _PyString_Resize() drops buf on error. */
+			if (self->buf == NULL)
+				self->len = 0;
+			return -1;
+		}
+		return 0;
+	}
+	if (UnicodeBuilder_Check(self)) {
+		newbuf = PyUnicode_FromUnicode(NULL, size);
+		if (newbuf == NULL)
+			return -1;
+		if (self->len > 0)
+			Py_UNICODE_COPY(PyUnicode_AS_UNICODE(newbuf),
+					PyUnicode_AS_UNICODE(self->buf),
+					self->len);
+	}
+	else {
+		newbuf = PyString_FromStringAndSize(NULL, size);
+		if (newbuf == NULL)
+			return -1;
+		if (self->len > 0)
+			Py_MEMCPY(PyString_AS_STRING(newbuf),
+				  PyString_AS_STRING(self->buf), self->len);
+	}
+	Py_XDECREF(self->buf);
+	self->buf = newbuf;
+	return 0;
+}
+
+static PyObject *
+builder_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+	builderobject *self;
+	Py_ssize_t size = 0;
+	static char *kwlist[] = {"size", 0};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n", kwlist, &size))
+		return NULL;
+	self = PyObject_New(builderobject, type);
+	if (self == NULL)
+		return NULL;
+	self->buf = NULL;
+	self->len = 0;
+	if (size > 0 && builder_reserve(self, size) < 0) {
+		Py_DECREF(self);
+		return NULL;
+	}
+	return (PyObject *)self;
+}
+
+static void
+builder_dealloc(builderobject *self)
+{
+	Py_XDECREF(self->buf);
+	PyObject_Del(self);
+}
+
+/* Append the str or unicode s; return -1 on error, 0 otherwise. */
+static int
+builder_append_internal(builderobject *self, PyObject *s)
+{
+	Py_ssize_t n;
+
+	if (UnicodeBuilder_Check(self)) {
+		PyObject *u = PyUnicode_FromObject(s);
+
+		if (u == NULL)
+			return -1;
+		n = PyUnicode_GET_SIZE(u);
+		if (builder_reserve(self, n) < 0) {
+			Py_DECREF(u);
+			return -1;
+		}
+		Py_UNICODE_COPY(PyUnicode_AS_UNICODE(self->buf) + self->len,
+				PyUnicode_AS_UNICODE(u), n);
+		Py_DECREF(u);
+	}
+	else {
+		if (!PyString_Check(s)) {
+			PyErr_Format(PyExc_TypeError,
+				     "expected string, %.80s found",
+				     Py_TYPE(s)->tp_name);
+			return -1;
+		}
+		n = PyString_GET_SIZE(s);
+		if (builder_reserve(self, n) < 0)
+			return -1;
+		Py_MEMCPY(PyString_AS_STRING(self->buf) + self->len,
+			  PyString_AS_STRING(s), n);
+	}
+	self->len += n;
+	return 0;
+}
+
+PyDoc_STRVAR(append_doc,
+"append(s)\n\
+\n\
+Add s to the end of the string being built.");
+
+static PyObject *
+builder_append(builderobject *self, PyObject *s)
+{
+	if (builder_append_internal(self, s) < 0)
+		return NULL;
+	Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(getvalue_doc,
+"getvalue() -> string\n\
+\n\
+Return the string built so far.  The builder can still be appended to.");
+
+static PyObject *
+builder_getvalue(builderobject *self)
+{
+	int unicode = UnicodeBuilder_Check(self);
+
+	if (self->len == 0) {
+		if (unicode)
+			return PyUnicode_FromUnicode(NULL, 0);
+		return PyString_FromStringAndSize(NULL, 0);
+	}
+	if (builder_bufsize(self) != self->len) {
+		/* Only the builder has seen buf, so it can be trimmed in
+		 * place.  That rarely moves it.
+		 */
+		assert(Py_REFCNT(self->buf) == 1);
+		if ((unicode ? PyUnicode_Resize(&self->buf, self->len) :
+			       _PyString_Resize(&self->buf, self->len)) < 0) {
+			/* _PyString_Resize() drops buf on error. */
+			if (self->buf == NULL)
+				self->len = 0;
+			return NULL;
+		}
+	}
+	Py_INCREF(self->buf);
+	return self->buf;
+}
+
+static Py_ssize_t
+builder_length(builderobject *self)
+{
+	return self->len;
+}
+
+static PyObject *
+builder_inplace_concat(builderobject *self, PyObject *s)
+{
+	if (builder_append_internal(self, s) < 0)
+		return NULL;
+	Py_INCREF(self);
+	return (PyObject *)self;
+}
+
+static PySequenceMethods builder_as_sequence = {
+	(lenfunc)builder_length,		/* sq_length */
+	0,					/* sq_concat */
+	0,					/* sq_repeat */
+	0,					/* sq_item */
+	0,					/* sq_slice */
+	0,					/* sq_ass_item */
+	0,					/* sq_ass_slice */
+	0,					/* sq_contains */
+	(binaryfunc)builder_inplace_concat,	/* sq_inplace_concat */
+	0,					/* sq_inplace_repeat */
+};
+
+static PyMethodDef builder_methods[] = {
+	{"append", (PyCFunction)builder_append, METH_O, append_doc},
+	{"getvalue", (PyCFunction)builder_getvalue, METH_NOARGS,
+	 getvalue_doc},
+	{NULL, NULL}	/* sentinel */
+};
+
+PyDoc_STRVAR(StringBuilder_doc,
+"StringBuilder([size]) -> new string builder\n\
+\n\
+Build a str from pieces with append() or +=, and get it with getvalue().\n\
+size is a guess at the length of the result.");
+
+static PyTypeObject StringBuilder_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"_stringbuilder.StringBuilder",		/* tp_name */
+	sizeof(builderobject),			/* tp_basicsize */
+	0,					/* tp_itemsize */
+	/* methods */
+	(destructor)builder_dealloc,		/* tp_dealloc */
+	0,					/* tp_print */
+	0,					/* tp_getattr */
+	0,					/* tp_setattr */
+	0,					/* tp_compare */
+	0,					/* tp_repr */
+	0,					/* tp_as_number */
+	&builder_as_sequence,			/* tp_as_sequence */
+	0,					/* tp_as_mapping */
+	0,					/* tp_hash */
+	0,					/* tp_call */
+	0,					/* tp_str */
+	PyObject_GenericGetAttr,		/* tp_getattro */
+	0,					/* tp_setattro */
+	0,					/* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT,			/* tp_flags */
+	StringBuilder_doc,			/* tp_doc */
+	0,					/* tp_traverse */
+	0,					/* tp_clear */
+	0,					/* tp_richcompare */
+	0,					/* tp_weaklistoffset */
+	0,					/* tp_iter */
+	0,					/* tp_iternext */
+	builder_methods,			/* tp_methods */
+	0,					/* tp_members */
+	0,					/* tp_getset */
+	0,					/* tp_base */
+	0,					/* tp_dict */
+	0,					/* tp_descr_get */
+	0,					/* tp_descr_set */
+	0,					/* tp_dictoffset */
+	0,					/* tp_init */
+	0,					/* tp_alloc */
+	builder_new,				/* tp_new */
+};
+
+PyDoc_STRVAR(UnicodeBuilder_doc,
+"UnicodeBuilder([size]) -> new unicode builder\n\
+\n\
+Build a unicode string from pieces with append() or +=, and get it with\n\
+getvalue().  str pieces are decoded with the default encoding.  size is a\n\
+guess at the length of the result.");
+
+static PyTypeObject UnicodeBuilder_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"_stringbuilder.UnicodeBuilder",	/* tp_name */
+	sizeof(builderobject),			/* tp_basicsize */
+	0,					/* tp_itemsize */
+	/* methods */
+	(destructor)builder_dealloc,		/* tp_dealloc */
+	0,					/* tp_print */
+	0,					/* tp_getattr */
+	0,					/* tp_setattr */
+	0,					/* tp_compare */
+	0,					/* tp_repr */
+	0,					/* tp_as_number */
+	&builder_as_sequence,			/* tp_as_sequence */
+	0,					/* tp_as_mapping */
+	0,					/* tp_hash */
+	0,					/* tp_call */
+	0,					/* tp_str */
+	PyObject_GenericGetAttr,		/* tp_getattro */
+	0,					/* tp_setattro */
+	0,					/* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT,			/* tp_flags */
+	UnicodeBuilder_doc,			/* tp_doc */
+	0,					/* tp_traverse */
+	0,					/* tp_clear */
+	0,					/* tp_richcompare */
+	0,					/* tp_weaklistoffset */
+	0,					/* tp_iter */
+	0,					/* tp_iternext */
+	builder_methods,			/* tp_methods */
+	0,					/* tp_members */
+	0,					/* tp_getset */
+	0,					/* tp_base */
+	0,					/* tp_dict */
+	0,					/* tp_descr_get */
+	0,					/* tp_descr_set */
+	0,					/* tp_dictoffset */
+	0,					/* tp_init */
+	0,					/* tp_alloc */
+	builder_new,				/* tp_new */
+};
+
+PyDoc_STRVAR(module_doc,
+"String builders:  build a string from pieces in linear time.\n\
+\n\
+Use the classes through the string module.");
+
+PyMODINIT_FUNC
+init_stringbuilder(void)
+{
+	int i;
+	PyObject *m;
+	char *name;
+	PyTypeObject *typelist[] = {
+		&StringBuilder_Type,
+		&UnicodeBuilder_Type,
+		NULL
+	};
+
+	m = Py_InitModule3("_stringbuilder", NULL, module_doc);
+	if (m == NULL)
+		return;
+
+	for (i=0 ; typelist[i] != NULL ; i++) {
+		if (PyType_Ready(typelist[i]) < 0)
+			return;
+		name = strchr(typelist[i]->tp_name, '.');
+		assert (name != NULL);
+		Py_INCREF(typelist[i]);
+		PyModule_AddObject(m, name+1, (PyObject *)typelist[i]);
+	}
+}
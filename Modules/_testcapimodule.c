@@ -173,6 +173,162 @@ test_dict_iteration(PyObject* self)
 }
 
 
+/* Test dict version tags and the dict watcher API. */
+
+static int watcher_events[PyDict_EVENT_DEALLOCATED + 1];
+static PyObject *watched_dict;
+static int resurrect_watched_dict;
+static PyObject *resurrected_dict;
+
+static int
+dict_watch_callback(PyDict_WatchEvent event, PyObject *dict,
+		    PyObject *key, PyObject *new_value)
+{
+	if (dict != watched_dict)
+		return 0;
+	watcher_events[event]++;
+	if (event == PyDict_EVENT_DEALLOCATED && resurrect_watched_dict) {
+		resurrect_watched_dict = 0;
+		Py_INCREF(dict);
+		resurrected_dict = dict;
+	}
+	return 0;
+}
+
+static PyObject *
+test_dict_watchers(PyObject *self)
+{
+	PyObject *dict, *key, *value, *res;
+	Py_dictversion_t v1, v2;
+	int wid, i, ok;
+
+	dict = PyDict_New();
+	if (dict == NULL)
+		return NULL;
+	key = PyString_FromString("key");
+	value = PyInt_FromLong(42);
+	wid = PyDict_AddWatcher(dict_watch_callback);
+	if (key == NULL || value == NULL || wid < 0)
+		goto error;
+	memset(watcher_events, 0, sizeof(watcher_events));
+	watched_dict = dict;
+
+	/* Versions change on every mutation, and only then. */
+	v1 = PyDict_GET_VERSION(dict);
+	if (PyDict_SetItem(dict, key, value) < 0)
+		goto error;
+	v2 = PyDict_GET_VERSION(dict);
+	if (v2 == v1) {
+		raiseTestError("test_dict_watchers",
+			       "version not bumped by insertion");
+		goto error;
+	}
+	if (PyDict_GetItem(dict, key) != value ||
+	    PyDict_GET_VERSION(dict) != v2) {
+		raiseTestError("test_dict_watchers",
+			       "version bumped by a lookup");
+		goto error;
+	}
+
+	/* Events are only delivered to watched dicts. */
+	if (PyDict_SetItem(dict, key, key) < 0)
+		goto error;
+	if (watcher_events[PyDict_EVENT_MODIFIED] != 0) {
+		raiseTestError("test_dict_watchers",
+			       "event sent for an unwatched dict");
+		goto error;
+	}
+	if (PyDict_Watch(wid, dict) < 0)
+		goto error;
+	if (PyDict_SetItem(dict, value, value) < 0 ||
+	    PyDict_SetItem(dict, value, key) < 0 ||
+	    PyDict_DelItem(dict, value) < 0)
+		goto error;
+	PyDict_Clear(dict);
+	if (PyDict_Unwatch(wid, dict) < 0)
+		goto error;
+	if (PyDict_SetItem(dict, key, value) < 0)
+		goto error;
+	if (PyDict_Watch(wid, dict) < 0)
+		goto error;
+	Py_CLEAR(dict);
+	ok = watcher_events[PyDict_EVENT_ADDED] == 1 &&
+	     watcher_events[PyDict_EVENT_MODIFIED] == 1 &&
+	     watcher_events[PyDict_EVENT_DELETED] == 1 &&
+	     watcher_events[PyDict_EVENT_CLEARED] == 1 &&
+	     watcher_events[PyDict_EVENT_DEALLOCATED] == 1;
+	if (!ok) {
+		raiseTestError("test_dict_watchers",
+			       "unexpected watcher events");
+		goto error;
+	}
+
+	/* A callback may keep a dict being freed alive. */
+	dict = PyDict_New();
+	if (dict == NULL || PyDict_SetItem(dict, key, value) < 0 ||
+	    PyDict_Watch(wid, dict) < 0)
+		goto error;
+	watched_dict = dict;
+	resurrect_watched_dict = 1;
+	Py_CLEAR(dict);
+	dict = resurrected_dict;
+	resurrected_dict = NULL;
+	if (dict == NULL || PyDict_GetItem(dict, key) != value) {
+		raiseTestError("test_dict_watchers",
+			       "dict not kept alive by its watcher");
+		goto error;
+	}
+	Py_CLEAR(dict);
+	if (watcher_events[PyDict_EVENT_DEALLOCATED] != 3) {
+		raiseTestError("test_dict_watchers",
+			       "unexpected deallocation events");
+		goto error;
+	}
+
+	/* Watcher IDs are validated. */
+	if (PyDict_ClearWatcher(wid) < 0)
+		goto error;
+	if (PyDict_ClearWatcher(wid) == 0 ||
+	    PyDict_Watch(PyDict_MAX_WATCHERS, value) == 0) {
+		raiseTestError("test_dict_watchers",
+			       "invalid watcher ID accepted");
+		goto error;
+	}
+	PyErr_Clear();
+	wid = -1;
+
+	/* All watcher slots can be used, and no more. */
+	for (i = 0; i < PyDict_MAX_WATCHERS; i++) {
+		if (PyDict_AddWatcher(dict_watch_callback) < 0)
+			break;
+	}
+	res = NULL;
+	if (i == PyDict_MAX_WATCHERS &&
+	    PyDict_AddWatcher(dict_watch_callback) < 0) {
+		PyErr_Clear();
+		Py_INCREF(Py_None);
+		res = Py_None;
+	}
+	else
+		raiseTestError("test_dict_watchers",
+			       "wrong number of watcher slots");
+	while (--i >= 0)
+		PyDict_ClearWatcher(i);
+	watched_dict = NULL;
+	Py_DECREF(key);
+	Py_DECREF(value);
+	return res;
+
+  error:
+	if (wid >= 0)
+		PyDict_ClearWatcher(wid);
+	watched_dict = NULL;
+	Py_XDECREF(dict);
+	Py_XDECREF(key);
+	Py_XDECREF(value);
+	return NULL;
+}
+
 /* Tests of PyLong_{As, From}{Unsigned,}Long(), and (#ifdef HAVE_LONG_LONG)
    PyLong_{As, From}{Unsigned,}LongLong().
 
@@ -777,6 +933,7 @@ static PyMethodDef TestMethods[] = {
 	{"test_config",		(PyCFunction)test_config,	 METH_NOARGS},
 	{"test_list_api",	(PyCFunction)test_list_api,	 METH_NOARGS},
 	{"test_dict_iteration",	(PyCFunction)test_dict_iteration,METH_NOARGS},
+	{"test_dict_watchers",	(PyCFunction)test_dict_watchers, METH_NOARGS},
 	{"test_long_api",	(PyCFunction)test_long_api,	 METH_NOARGS},
 	{"test_long_numbits",	(PyCFunction)test_long_numbits,	 METH_NOARGS},
 	{"test_k_code",		(PyCFunction)test_k_code,	 METH_NOARGS},
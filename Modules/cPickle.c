@@ -2068,6 +2068,7 @@ save_global(Picklerobject *self, PyObject *args, PyObject *name)
 
 		PyTuple_SET_ITEM(two_tuple, 0, module);
 		PyTuple_SET_ITEM(two_tuple, 1, global_name);
+		_PyTuple_RESET_HASH(two_tuple);
 		py_code = PyDict_GetItem(extension_registry, two_tuple);
 		if (py_code == NULL)
 			goto gen_global;	/* not registered */
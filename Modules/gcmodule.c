@@ -738,6 +738,10 @@ clear_freelists(void)
 	(void)PyUnicode_ClearFreeList();
 	(void)PyInt_ClearFreeList();
 	(void)PyFloat_ClearFreeList();
+#ifdef WITH_PYMALLOC
+	/* And some of the memory that clearing them freed up. */
+	(void)_PyObject_ReleaseFreePools();
+#endif
 }
 
 /* This is the main function.  Read this to understand how the
@@ -127,6 +127,7 @@
 
 static char prefix[MAXPATHLEN+1];
 static char exec_prefix[MAXPATHLEN+1];
+static char stdlib_dir[MAXPATHLEN+1];
 static char progpath[MAXPATHLEN+1];
 static char *module_search_path = NULL;
 static char lib_python[] = "lib/python" VERSION;
@@ -513,8 +514,10 @@ calculate_path(void)
         strncpy(prefix, PREFIX, MAXPATHLEN);
         joinpath(prefix, lib_python);
     }
-    else
+    else {
         reduce(prefix);
+        strcpy(stdlib_dir, prefix);
+    }
 
     strncpy(zip_path, prefix, MAXPATHLEN);
     zip_path[MAXPATHLEN] = '\0';
@@ -687,6 +690,16 @@ Py_GetProgramFullPath(void)
     return progpath;
 }
 
+/* The directory holding the standard library modules, or NULL if it
+   wasn't found */
+char *
+_Py_GetStdlibDir(void)
+{
+    if (!module_search_path)
+        calculate_path();
+    return stdlib_dir[0] ? stdlib_dir : NULL;
+}
+
 
 #ifdef __cplusplus
 }
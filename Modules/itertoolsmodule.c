@@ -8,6 +8,45 @@
    All rights reserved.
 */
 
+PyDoc_STRVAR(length_hint_doc, "Private method returning an estimate of len(list(it)).");
+
+/* Helpers for the __length_hint__ methods of iterators over other
+   iterators.  iters_length_hint() returns the smallest (or, if longest is
+   true, the largest) length hint of the iterators in the tuple iters,
+   skipping NULL entries, or -1 if any of them has none or there are none.
+   Errors from the iterators' own hints are passed on as -1 with the
+   exception set, and length_hint_result() reports those as they are.
+*/
+
+static Py_ssize_t
+iters_length_hint(PyObject *iters, int longest)
+{
+	Py_ssize_t i, n, hint = -1;
+
+	for (i = 0; i < PyTuple_GET_SIZE(iters); i++) {
+		if (PyTuple_GET_ITEM(iters, i) == NULL)
+			continue;
+		n = _PyObject_LengthHintNoMask(PyTuple_GET_ITEM(iters, i));
+		if (n < 0)
+			return -1;
+		if (hint < 0 || (longest ? n > hint : n < hint))
+			hint = n;
+	}
+	return hint;
+}
+
+static PyObject *
+length_hint_result(Py_ssize_t hint)
+{
+	if (hint < 0) {
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_TypeError,
+					"len() of unsized object");
+		return NULL;
+	}
+	return PyInt_FromSsize_t(hint);
+}
+
 
 /* groupby object ***********************************************************/
 
@@ -1241,6 +1280,33 @@ islice_next(isliceobject *lz)
 	return item;
 }
 
+static PyObject *
+islice_len(isliceobject *lz)
+{
+	Py_ssize_t n, end;
+
+	/* Items cnt, cnt + 1, ... are still to be read from the iterator,
+	 * and those numbered next, next + step, ... below end are returned.
+	 */
+	n = _PyObject_LengthHintNoMask(lz->it);
+	if (n < 0 && (lz->stop == -1 || PyErr_Occurred()))
+		return length_hint_result(-1);
+	if (n < 0 || n > PY_SSIZE_T_MAX - lz->cnt)
+		end = PY_SSIZE_T_MAX;
+	else
+		end = lz->cnt + n;
+	if (lz->stop != -1 && lz->stop < end)
+		end = lz->stop;
+	if (lz->next >= end)
+		return length_hint_result(0);
+	return length_hint_result((end - lz->next - 1) / lz->step + 1);
+}
+
+static PyMethodDef islice_methods[] = {
+	{"__length_hint__", (PyCFunction)islice_len, METH_NOARGS, length_hint_doc},
+ 	{NULL,		NULL}		/* sentinel */
+};
+
 PyDoc_STRVAR(islice_doc,
 "islice(iterable, [start,] stop [, step]) --> islice object\n\
 \n\
@@ -1281,7 +1347,7 @@ static PyTypeObject islice_type = {
 	0,				/* tp_weaklistoffset */
 	PyObject_SelfIter,		/* tp_iter */
 	(iternextfunc)islice_next,	/* tp_iternext */
-	0,				/* tp_methods */
+	islice_methods,			/* tp_methods */
 	0,				/* tp_members */
 	0,				/* tp_getset */
 	0,				/* tp_base */
@@ -1377,6 +1443,17 @@ starmap_next(starmapobject *lz)
 	return result;
 }
 
+static PyObject *
+starmap_len(starmapobject *lz)
+{
+	return length_hint_result(_PyObject_LengthHintNoMask(lz->it));
+}
+
+static PyMethodDef starmap_methods[] = {
+	{"__length_hint__", (PyCFunction)starmap_len, METH_NOARGS, length_hint_doc},
+ 	{NULL,		NULL}		/* sentinel */
+};
+
 PyDoc_STRVAR(starmap_doc,
 "starmap(function, sequence) --> starmap object\n\
 \n\
@@ -1413,7 +1490,7 @@ static PyTypeObject starmap_type = {
 	0,				/* tp_weaklistoffset */
 	PyObject_SelfIter,		/* tp_iter */
 	(iternextfunc)starmap_next,	/* tp_iternext */
-	0,				/* tp_methods */
+	starmap_methods,		/* tp_methods */
 	0,				/* tp_members */
 	0,				/* tp_getset */
 	0,				/* tp_base */
@@ -1553,6 +1630,17 @@ imap_next(imapobject *lz)
 	return result;
 }
 
+static PyObject *
+imap_len(imapobject *lz)
+{
+	return length_hint_result(iters_length_hint(lz->iters, 0));
+}
+
+static PyMethodDef imap_methods[] = {
+	{"__length_hint__", (PyCFunction)imap_len, METH_NOARGS, length_hint_doc},
+ 	{NULL,		NULL}		/* sentinel */
+};
+
 PyDoc_STRVAR(imap_doc,
 "imap(func, *iterables) --> imap object\n\
 \n\
@@ -1592,7 +1680,7 @@ static PyTypeObject imap_type = {
 	0,				/* tp_weaklistoffset */
 	PyObject_SelfIter,		/* tp_iter */
 	(iternextfunc)imap_next,	/* tp_iternext */
-	0,				/* tp_methods */
+	imap_methods,			/* tp_methods */
 	0,				/* tp_members */
 	0,				/* tp_getset */
 	0,				/* tp_base */
@@ -1927,6 +2015,7 @@ product_next(productobject *lz)
 		}
 		/* Now, we've got the only copy so we can update it in-place */
 		assert (npools==0 || Py_REFCNT(result) == 1);
+		_PyTuple_RESET_HASH(result);
 
                 /* Update the pool indices right-to-left.  Only advance to the
                    next pool when the previous one rolls-over */
@@ -2158,6 +2247,7 @@ combinations_next(combinationsobject *co)
 		 * PyTuple's freelist. 
 		 */
 		assert(r == 0 || Py_REFCNT(result) == 1);
+		_PyTuple_RESET_HASH(result);
 
                 /* Scan indices right-to-left until finding one that is not
                    at its maximum (i + n - r). */
@@ -2425,6 +2515,7 @@ permutations_next(permutationsobject *po)
 		}
 		/* Now, we've got the only copy so we can update it in-place */
 		assert(r == 0 || Py_REFCNT(result) == 1);
+		_PyTuple_RESET_HASH(result);
 
                 /* Decrement rightmost cycle, moving leftward upon zero rollover */
 		for (i=r-1 ; i>=0 ; i--) {
@@ -3065,6 +3156,7 @@ izip_next(izipobject *lz)
 		return NULL;
 	if (Py_REFCNT(result) == 1) {
 		Py_INCREF(result);
+		_PyTuple_RESET_HASH(result);
 		for (i=0 ; i < tuplesize ; i++) {
 			it = PyTuple_GET_ITEM(lz->ittuple, i);
 			assert(PyIter_Check(it));
@@ -3095,6 +3187,19 @@ izip_next(izipobject *lz)
 	return result;
 }
 
+static PyObject *
+izip_len(izipobject *lz)
+{
+	if (lz->tuplesize == 0)
+		return length_hint_result(0);
+	return length_hint_result(iters_length_hint(lz->ittuple, 0));
+}
+
+static PyMethodDef izip_methods[] = {
+	{"__length_hint__", (PyCFunction)izip_len, METH_NOARGS, length_hint_doc},
+ 	{NULL,		NULL}		/* sentinel */
+};
+
 PyDoc_STRVAR(izip_doc,
 "izip(iter1 [,iter2 [...]]) --> izip object\n\
 \n\
@@ -3135,7 +3240,7 @@ static PyTypeObject izip_type = {
 	0,				/* tp_weaklistoffset */
 	PyObject_SelfIter,		/* tp_iter */
 	(iternextfunc)izip_next,	/* tp_iternext */
-	0,				/* tp_methods */
+	izip_methods,			/* tp_methods */
 	0,				/* tp_members */
 	0,				/* tp_getset */
 	0,				/* tp_base */
@@ -3240,8 +3345,6 @@ repeat_len(repeatobject *ro)
         return PyInt_FromSize_t(ro->cnt);
 }
 
-PyDoc_STRVAR(length_hint_doc, "Private method returning an estimate of len(list(it)).");
-
 static PyMethodDef repeat_methods[] = {
 	{"__length_hint__", (PyCFunction)repeat_len, METH_NOARGS, length_hint_doc},
  	{NULL,		NULL}		/* sentinel */
@@ -3413,6 +3516,7 @@ izip_longest_next(iziplongestobject *lz)
                 return NULL;
 	if (Py_REFCNT(result) == 1) {
 		Py_INCREF(result);
+		_PyTuple_RESET_HASH(result);
 		for (i=0 ; i < tuplesize ; i++) {
 			it = PyTuple_GET_ITEM(lz->ittuple, i);
                         if (it == NULL) {
@@ -3469,6 +3573,20 @@ izip_longest_next(iziplongestobject *lz)
 	return result;
 }
 
+static PyObject *
+izip_longest_len(iziplongestobject *lz)
+{
+	if (lz->tuplesize == 0 || lz->numactive == 0)
+		return length_hint_result(0);
+	return length_hint_result(iters_length_hint(lz->ittuple, 1));
+}
+
+static PyMethodDef izip_longest_methods[] = {
+	{"__length_hint__", (PyCFunction)izip_longest_len, METH_NOARGS,
+	 length_hint_doc},
+ 	{NULL,		NULL}		/* sentinel */
+};
+
 PyDoc_STRVAR(izip_longest_doc,
 "izip_longest(iter1 [,iter2 [...]], [fillvalue=None]) --> izip_longest object\n\
 \n\
@@ -3510,7 +3628,7 @@ static PyTypeObject iziplongest_type = {
 	0,				/* tp_weaklistoffset */
 	PyObject_SelfIter,		/* tp_iter */
 	(iternextfunc)izip_longest_next,	/* tp_iternext */
-	0,				/* tp_methods */
+	izip_longest_methods,		/* tp_methods */
 	0,				/* tp_members */
 	0,				/* tp_getset */
 	0,				/* tp_base */
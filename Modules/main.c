@@ -40,7 +40,7 @@ static char **orig_argv;
 static int  orig_argc;
 
 /* command line options */
-#define BASE_OPTS "3bBc:dEhiJm:OQ:sStuUvVW:xX?"
+#define BASE_OPTS "3bBc:dEhiJm:OQ:sStuUvVW:xX:?"
 
 #ifndef RISCOS
 #define PROGRAM_OPTS BASE_OPTS
@@ -86,6 +86,7 @@ static char *usage_3 = "\
 -x     : skip first line of source, allowing use of non-Unix forms of #!cmd\n\
 ";
 static char *usage_4 = "\
+-X compile_cache=N : keep up to N kilobytes of code compiled from strings\n\
 -3     : warn about Python 3.x incompatibilities\n\
 file   : program read from script file\n\
 -      : program read from stdin (default; interactive mode if a tty)\n\
@@ -396,7 +397,29 @@ Py_Main(int argc, char **argv)
 			skipfirstline = 1;
 			break;
 
-		/* case 'X': reserved for implementation-specific arguments */
+		case 'X':
+			/* Implementation-specific options */
+			if (strncmp(_PyOS_optarg, "compile_cache=", 14) == 0) {
+				char *end;
+				long size;
+				errno = 0;
+				size = strtol(_PyOS_optarg + 14, &end, 10);
+				if (end != _PyOS_optarg + 14 && *end == '\0' &&
+				    errno == 0 && size >= 0 &&
+				    size <= PY_SSIZE_T_MAX / 1024) {
+					Py_CompileCacheSize = size;
+					break;
+				}
+				fprintf(stderr,
+					"-X compile_cache=N takes a number of "
+					"kilobytes from 0 to %" PY_FORMAT_SIZE_T
+					"d\n", PY_SSIZE_T_MAX / 1024);
+				return usage(2, argv[0]);
+			}
+			fprintf(stderr, "Unknown -X option: %s\n",
+				_PyOS_optarg);
+			return usage(2, argv[0]);
+			/* NOTREACHED */
 
 		case 'U':
 			Py_UnicodeFlag++;
@@ -83,14 +83,27 @@ PyObject_Length(PyObject *o)
 #define PyObject_Length PyObject_Size
 
 
+/* Clear the exception set when o has no __len__() or __length_hint__(),
+   and return 0; return -1 if a different one is set. */
+
+static int
+no_length_error(void)
+{
+	if (!PyErr_ExceptionMatches(PyExc_TypeError) &&
+	    !PyErr_ExceptionMatches(PyExc_AttributeError))
+		return -1;
+	PyErr_Clear();
+	return 0;
+}
+
 /* The length hint function returns a non-negative value from o.__len__()
    or o.__length_hint__().  If those methods aren't found or return a negative
-   value, then the defaultvalue is returned.  This function never fails. 
-   Accordingly, it will mask exceptions raised in either method.
+   value, -1 is returned with no exception set.  Other errors raised by them
+   are passed on, as -1 with the exception set.
 */
 
 Py_ssize_t
-_PyObject_LengthHint(PyObject *o, Py_ssize_t defaultvalue)
+_PyObject_LengthHintNoMask(PyObject *o)
 {
 	static PyObject *hintstrobj = NULL;
 	PyObject *ro;
@@ -100,26 +113,40 @@ _PyObject_LengthHint(PyObject *o, Py_ssize_t defaultvalue)
 	rv = PyObject_Size(o);
 	if (rv >= 0)
 		return rv;
-	if (PyErr_Occurred())
-		PyErr_Clear();
+	if (PyErr_Occurred() && no_length_error() < 0)
+		return -1;
 
 	/* cache a hashed version of the attribute string */
 	if (hintstrobj == NULL) {
 		hintstrobj = PyString_InternFromString("__length_hint__");
 		if (hintstrobj == NULL)
-			goto defaultcase;
+			return -1;
 	}
 
 	/* try o.__length_hint__() */
 	ro = PyObject_CallMethodObjArgs(o, hintstrobj, NULL);
-	if (ro == NULL)
-		goto defaultcase;
+	if (ro == NULL) {
+		no_length_error();
+		return -1;
+	}
 	rv = PyInt_AsLong(ro);
 	Py_DECREF(ro);
+	if (rv == -1 && PyErr_Occurred())
+		return -1;
+	return rv < 0 ? -1 : rv;
+}
+
+/* _PyObject_LengthHint() never fails, and returns defaultvalue instead of
+   passing on any error.
+*/
+
+Py_ssize_t
+_PyObject_LengthHint(PyObject *o, Py_ssize_t defaultvalue)
+{
+	Py_ssize_t rv = _PyObject_LengthHintNoMask(o);
+
 	if (rv >= 0)
 		return rv;
-
-defaultcase:
 	if (PyErr_Occurred())
 		PyErr_Clear();
 	return defaultvalue;
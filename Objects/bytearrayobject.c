@@ -1467,10 +1467,7 @@ bytes_translate(PyByteArrayObject *self, PyObject *args)
 
     if (vdel.len == 0) {
         /* If no deletions are required, use faster code */
-        for (i = inlen; --i >= 0; ) {
-            c = Py_CHARMASK(*input++);
-            *output++ = table[c];
-        }
+        _Py_bytes_translate(output, input, inlen, table);
         goto done;
     }
 
@@ -2218,7 +2215,7 @@ split_whitespace(const char *s, Py_ssize_t len, Py_ssize_t maxcount)
         while (i < len && ISSPACE(s[i]))
             i++;
         j = i;
-        while (i < len && !ISSPACE(s[i]))
+        while ((i = skip_ascii_graph(s, i, len)) < len && !ISSPACE(s[i]))
             i++;
         if (j < i) {
             if (maxcount-- <= 0)
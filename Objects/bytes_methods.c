@@ -1,6 +1,13 @@
 #include "Python.h"
 #include "bytes_methods.h"
 
+#ifdef Py_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef Py_HAVE_AVX2_TARGET
+#include <immintrin.h>
+#endif
+
 /* Our own locale-independent ctype.h-like macros */
 
 const unsigned int _Py_ctype_table[256] = {
@@ -451,6 +458,73 @@ _Py_bytes_istitle(const char *cptr, Py_ssize_t len)
 }
 
 
+/* ASCII case conversion flips the 0x20 bit of the letters of one case.
+   Those are the bytes c for which (c | fold) lies between lo and hi:
+   lower() looks for 'A'-'Z' and upper() for 'a'-'z' with a fold of 0, and
+   swapcase() for 'a'-'z' with a fold of 0x20, which takes in both cases.
+   The vector kernels make the range checks with signed byte compares, so
+   the bytes from 0x80 up never match. */
+
+#ifdef Py_HAVE_AVX2_TARGET
+Py_TARGET_AVX2 static Py_ssize_t
+flip_case_avx2(char *result, const char *s, Py_ssize_t len,
+	       char lo, char hi, char fold)
+{
+	const __m256i vlo = _mm256_set1_epi8(lo - 1);
+	const __m256i vhi = _mm256_set1_epi8(hi + 1);
+	const __m256i vfold = _mm256_set1_epi8(fold);
+	const __m256i bit = _mm256_set1_epi8(0x20);
+	Py_ssize_t i;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i c = _mm256_loadu_si256((const __m256i *)(s + i));
+		__m256i t = _mm256_or_si256(c, vfold);
+		__m256i m = _mm256_and_si256(_mm256_cmpgt_epi8(t, vlo),
+					     _mm256_cmpgt_epi8(vhi, t));
+		_mm256_storeu_si256((__m256i *)(result + i),
+			_mm256_xor_si256(c, _mm256_and_si256(m, bit)));
+	}
+	return i;
+}
+#endif
+
+static void
+flip_case(char *result, const char *s, Py_ssize_t len,
+	  char lo, char hi, char fold)
+{
+	Py_ssize_t i = 0;
+
+#ifdef Py_HAVE_AVX2_TARGET
+	if (len >= 64 && Py_CPU_HAS_AVX2())
+		i = flip_case_avx2(result, s, len, lo, hi, fold);
+#endif
+#ifdef Py_HAVE_SSE2
+	if (i + 16 <= len) {
+		const __m128i vlo = _mm_set1_epi8(lo - 1);
+		const __m128i vhi = _mm_set1_epi8(hi + 1);
+		const __m128i vfold = _mm_set1_epi8(fold);
+		const __m128i bit = _mm_set1_epi8(0x20);
+
+		for (; i + 16 <= len; i += 16) {
+			__m128i c = _mm_loadu_si128((const __m128i *)(s + i));
+			__m128i t = _mm_or_si128(c, vfold);
+			__m128i m = _mm_and_si128(_mm_cmpgt_epi8(t, vlo),
+						  _mm_cmplt_epi8(t, vhi));
+			_mm_storeu_si128((__m128i *)(result + i),
+				_mm_xor_si128(c, _mm_and_si128(m, bit)));
+		}
+	}
+#endif
+	for (; i < len; i++) {
+		int c = Py_CHARMASK(s[i]);
+		int t = c | fold;
+		if (t >= lo && t <= hi)
+			c ^= 0x20;
+		result[i] = c;
+	}
+}
+
+
 PyDoc_STRVAR_shared(_Py_lower__doc__,
 "B.lower() -> copy of B\n\
 \n\
@@ -459,23 +533,7 @@ Return a copy of B with all ASCII characters converted to lowercase.");
 void
 _Py_bytes_lower(char *result, const char *cptr, Py_ssize_t len)
 {
-	Py_ssize_t i;
-
-        /*
-	newobj = PyString_FromStringAndSize(NULL, len);
-	if (!newobj)
-		return NULL;
-
-	s = PyString_AS_STRING(newobj);
-        */
-
-	Py_MEMCPY(result, cptr, len);
-
-	for (i = 0; i < len; i++) {
-		int c = Py_CHARMASK(result[i]);
-		if (ISUPPER(c))
-			result[i] = TOLOWER(c);
-	}
+	flip_case(result, cptr, len, 'A', 'Z', 0);
 }
 
 
@@ -487,23 +545,7 @@ Return a copy of B with all ASCII characters converted to uppercase.");
 void
 _Py_bytes_upper(char *result, const char *cptr, Py_ssize_t len)
 {
-	Py_ssize_t i;
-
-        /*
-	newobj = PyString_FromStringAndSize(NULL, len);
-	if (!newobj)
-		return NULL;
-
-	s = PyString_AS_STRING(newobj);
-        */
-
-	Py_MEMCPY(result, cptr, len);
-
-	for (i = 0; i < len; i++) {
-		int c = Py_CHARMASK(result[i]);
-		if (ISLOWER(c))
-			result[i] = TOUPPER(c);
-	}
+	flip_case(result, cptr, len, 'a', 'z', 0);
 }
 
 
@@ -584,27 +626,72 @@ Return a copy of B with uppercase ASCII characters converted\n\
 to lowercase ASCII and vice versa.");
 
 void
-_Py_bytes_swapcase(char *result, char *s, Py_ssize_t len)
+_Py_bytes_swapcase(char *result, const char *cptr, Py_ssize_t len)
 {
-	Py_ssize_t i;
+	flip_case(result, cptr, len, 'a', 'z', 0x20);
+}
 
-        /*
-	newobj = PyString_FromStringAndSize(NULL, len);
-	if (newobj == NULL)
-		return NULL;
-	s_new = PyString_AsString(newobj);
-        */
-	for (i = 0; i < len; i++) {
-		int c = Py_CHARMASK(*s++);
-		if (ISLOWER(c)) {
-			*result = TOUPPER(c);
-		}
-		else if (ISUPPER(c)) {
-			*result = TOLOWER(c);
+
+#ifdef Py_HAVE_AVX2_TARGET
+/* Look 32 bytes up at a time in the sixteen 16 byte rows of the table.
+   Row h is looked up with c - 16*h, saturated up by 0x70: that keeps the
+   low four bits for the bytes of row h and sets the top bit, which makes
+   the shuffle give 0, for all the others. */
+Py_TARGET_AVX2 static Py_ssize_t
+translate_avx2(char *result, const char *s, Py_ssize_t len,
+	       const char *table, int *changed)
+{
+	__m256i rows[16], diff = _mm256_setzero_si256();
+	const __m256i step = _mm256_set1_epi8(16);
+	const __m256i bias = _mm256_set1_epi8(0x70);
+	Py_ssize_t i;
+	int h;
+
+	for (h = 0; h < 16; h++)
+		rows[h] = _mm256_broadcastsi128_si256(
+			_mm_loadu_si128((const __m128i *)(table + 16*h)));
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i c = _mm256_loadu_si256((const __m256i *)(s + i));
+		__m256i x = c, r = _mm256_setzero_si256();
+		for (h = 0; h < 16; h++) {
+			r = _mm256_or_si256(r, _mm256_shuffle_epi8(rows[h],
+				_mm256_adds_epu8(x, bias)));
+			x = _mm256_sub_epi8(x, step);
 		}
-		else
-			*result = c;
-		result++;
+		diff = _mm256_or_si256(diff, _mm256_xor_si256(r, c));
+		_mm256_storeu_si256((__m256i *)(result + i), r);
 	}
+	*changed = !_mm256_testz_si256(diff, diff);
+	return i;
 }
+#endif
 
+int
+_Py_bytes_translate(char *result, const char *cptr, Py_ssize_t len,
+		    const char *table)
+{
+	const unsigned char *s = (const unsigned char *)cptr;
+	const unsigned char *t = (const unsigned char *)table;
+	unsigned char *r = (unsigned char *)result;
+	Py_ssize_t i = 0;
+	int changed = 0, diff = 0;
+
+#ifdef Py_HAVE_AVX2_TARGET
+	if (len >= 64 && Py_CPU_HAS_AVX2())
+		i = translate_avx2(result, cptr, len, table, &changed);
+#endif
+	/* Four at a time, to keep the loads of the table independent */
+	for (; i + 4 <= len; i += 4) {
+		r[i] = t[s[i]];
+		r[i+1] = t[s[i+1]];
+		r[i+2] = t[s[i+2]];
+		r[i+3] = t[s[i+3]];
+		diff |= (r[i] ^ s[i]) | (r[i+1] ^ s[i+1]) |
+			(r[i+2] ^ s[i+2]) | (r[i+3] ^ s[i+3]);
+	}
+	for (; i < len; i++) {
+		r[i] = t[s[i]];
+		diff |= r[i] ^ s[i];
+	}
+	return changed || diff != 0;
+}
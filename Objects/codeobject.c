@@ -49,6 +49,7 @@ PyCode_New(int argcount, int nlocals, int stacksize, int flags,
 {
 	PyCodeObject *co;
 	Py_ssize_t i;
+	int lazy = 0;	/* some of consts are still to be loaded */
 	/* Check argument types */
 	if (argcount < 0 || nlocals < 0 ||
 	    code == NULL ||
@@ -71,13 +72,15 @@ PyCode_New(int argcount, int nlocals, int stacksize, int flags,
 	/* Intern selected string constants */
 	for (i = PyTuple_Size(consts); --i >= 0; ) {
 		PyObject *v = PyTuple_GetItem(consts, i);
+		if (_PyLazyCode_Check(v))
+			lazy = 1;
 		if (!PyString_Check(v))
 			continue;
 		if (!all_name_chars((unsigned char *)PyString_AS_STRING(v)))
 			continue;
 		PyString_InternInPlace(&PyTuple_GET_ITEM(consts, i));
 	}
-	co = PyObject_NEW(PyCodeObject, &PyCode_Type);
+	co = PyObject_GC_New(PyCodeObject, &PyCode_Type);
 	if (co != NULL) {
 		co->co_argcount = argcount;
 		co->co_nlocals = nlocals;
@@ -103,6 +106,7 @@ PyCode_New(int argcount, int nlocals, int stacksize, int flags,
 		Py_INCREF(lnotab);
 		co->co_lnotab = lnotab;
                 co->co_zombieframe = NULL;
+		co->co_lazyconsts = lazy;
 	}
 	return co;
 }
@@ -116,7 +120,6 @@ static PyMemberDef code_memberlist[] = {
 	{"co_stacksize",T_INT,		OFF(co_stacksize),	READONLY},
 	{"co_flags",	T_INT,		OFF(co_flags),		READONLY},
 	{"co_code",	T_OBJECT,	OFF(co_code),		READONLY},
-	{"co_consts",	T_OBJECT,	OFF(co_consts),		READONLY},
 	{"co_names",	T_OBJECT,	OFF(co_names),		READONLY},
 	{"co_varnames",	T_OBJECT,	OFF(co_varnames),	READONLY},
 	{"co_freevars",	T_OBJECT,	OFF(co_freevars),	READONLY},
@@ -128,6 +131,63 @@ static PyMemberDef code_memberlist[] = {
 	{NULL}	/* Sentinel */
 };
 
+int
+_PyCode_LoadConsts(PyCodeObject *co)
+{
+	PyObject *old, *consts;
+	Py_ssize_t i, n;
+
+	if (!_PyCode_HAS_LAZY_CONSTS(co))
+		return 0;
+	/* co_consts may have been handed out already, so it is replaced
+	   rather than changed.  Loading can run destructors, which could
+	   load co's constants meanwhile; hold on to the old tuple. */
+	old = co->co_consts;
+	Py_INCREF(old);
+	n = PyTuple_GET_SIZE(old);
+	consts = PyTuple_New(n);
+	if (consts == NULL)
+		goto error;
+	for (i = 0; i < n; i++) {
+		PyObject *v = PyTuple_GET_ITEM(old, i);
+		if (_PyLazyCode_Check(v)) {
+			v = _PyLazyCode_Load(v);
+			if (v == NULL)
+				goto error;
+		}
+		Py_INCREF(v);
+		PyTuple_SET_ITEM(consts, i, v);
+	}
+	if (_PyCode_HAS_LAZY_CONSTS(co)) {
+		co->co_lazyconsts = 0;
+		co->co_consts = consts;
+		Py_DECREF(old);		/* co's reference */
+	}
+	else
+		Py_DECREF(consts);
+	Py_DECREF(old);
+	return 0;
+
+  error:
+	Py_XDECREF(consts);
+	Py_DECREF(old);
+	return -1;
+}
+
+static PyObject *
+code_getconsts(PyCodeObject *co, void *closure)
+{
+	if (_PyCode_LoadConsts(co) < 0)
+		return NULL;
+	Py_INCREF(co->co_consts);
+	return co->co_consts;
+}
+
+static PyGetSetDef code_getsetlist[] = {
+	{"co_consts",	(getter)code_getconsts,	NULL,	NULL},
+	{NULL}	/* Sentinel */
+};
+
 /* Helper for code_new: return a shallow copy of a tuple that is
    guaranteed to contain exact strings, by converting string subclasses
    to exact strings and complaining if a non-string is found. */
@@ -257,6 +317,7 @@ code_new(PyTypeObject *type, PyObject *args, PyObject *kw)
 static void
 code_dealloc(PyCodeObject *co)
 {
+	PyObject_GC_UnTrack(co);
 	Py_XDECREF(co->co_code);
 	Py_XDECREF(co->co_consts);
 	Py_XDECREF(co->co_names);
@@ -268,7 +329,19 @@ code_dealloc(PyCodeObject *co)
 	Py_XDECREF(co->co_lnotab);
         if (co->co_zombieframe != NULL)
                 PyObject_GC_Del(co->co_zombieframe);
-	PyObject_DEL(co);
+	PyObject_GC_Del(co);
+}
+
+/* Code objects read by marshal can be part of a cycle: the lazily loaded
+   code objects among their constants, or those of code objects further
+   down, refer back to the objects read before them (see Python/marshal.c),
+   which can include the code objects holding them.  marshal has only those
+   code objects tracked. */
+static int
+code_traverse(PyCodeObject *co, visitproc visit, void *arg)
+{
+	Py_VISIT(co->co_consts);
+	return 0;
 }
 
 static PyObject *
@@ -307,6 +380,8 @@ code_compare(PyCodeObject *co, PyCodeObject *cp)
 	if (cmp) goto normalize;
 	cmp = PyObject_Compare(co->co_code, cp->co_code);
 	if (cmp) return cmp;
+	if (_PyCode_LoadConsts(co) < 0 || _PyCode_LoadConsts(cp) < 0)
+		return -1;
 	cmp = PyObject_Compare(co->co_consts, cp->co_consts);
 	if (cmp) return cmp;
 	cmp = PyObject_Compare(co->co_names, cp->co_names);
@@ -364,6 +439,8 @@ code_richcompare(PyObject *self, PyObject *other, int op)
 	if (!eq) goto unequal;
 	eq = PyObject_RichCompareBool(co->co_code, cp->co_code, Py_EQ);
 	if (eq <= 0) goto unequal;
+	if (_PyCode_LoadConsts(co) < 0 || _PyCode_LoadConsts(cp) < 0)
+		return NULL;
 	eq = PyObject_RichCompareBool(co->co_consts, cp->co_consts, Py_EQ);
 	if (eq <= 0) goto unequal;
 	eq = PyObject_RichCompareBool(co->co_names, cp->co_names, Py_EQ);
@@ -402,6 +479,7 @@ code_hash(PyCodeObject *co)
 	if (h0 == -1) return -1;
 	h1 = PyObject_Hash(co->co_code);
 	if (h1 == -1) return -1;
+	if (_PyCode_LoadConsts(co) < 0) return -1;
 	h2 = PyObject_Hash(co->co_consts);
 	if (h2 == -1) return -1;
 	h3 = PyObject_Hash(co->co_names);
@@ -489,9 +567,9 @@ PyTypeObject PyCode_Type = {
 	PyObject_GenericGetAttr,	/* tp_getattro */
 	0,				/* tp_setattro */
 	0,				/* tp_as_buffer */
-	Py_TPFLAGS_DEFAULT,		/* tp_flags */
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,	/* tp_flags */
 	code_doc,			/* tp_doc */
-	0,				/* tp_traverse */
+	(traverseproc)code_traverse,	/* tp_traverse */
 	0,				/* tp_clear */
 	code_richcompare,				/* tp_richcompare */
 	0,				/* tp_weaklistoffset */
@@ -499,7 +577,7 @@ PyTypeObject PyCode_Type = {
 	0,				/* tp_iternext */
 	0,				/* tp_methods */
 	code_memberlist,		/* tp_members */
-	0,				/* tp_getset */
+	code_getsetlist,		/* tp_getset */
 	0,				/* tp_base */
 	0,				/* tp_dict */
 	0,				/* tp_descr_get */
@@ -25,6 +25,9 @@
    The str() precision is chosen so that in most cases, the rounding noise
    created by various operations is suppressed, while giving plenty of
    precision for practical use.
+
+   Both parts are written with no more digits than they need to read back,
+   as float's repr() and str() are.
 */
 
 #define PREC_REPR	17
@@ -367,12 +370,17 @@ complex_to_buf(char *buf, int bufsz, PyComplexObject *v, int precision)
 				strncpy(buf, "-inf*j", 7);
 		}
 		else {
-			PyOS_snprintf(format, sizeof(format), "%%.%ig", precision);
-			PyOS_ascii_formatd(buf, bufsz - 1, format, v->cval.imag);
+			if (_PyOS_ascii_formatd_shortest(buf, bufsz - 1,
+					v->cval.imag, precision) == NULL) {
+				PyOS_snprintf(format, sizeof(format),
+					      "%%.%ig", precision);
+				PyOS_ascii_formatd(buf, bufsz - 1, format,
+						   v->cval.imag);
+			}
 			strncat(buf, "j", 1);
 		}
 	} else {
-		char re[64], im[64];
+		char re[64], im[64], *imp = im;
 		/* Format imaginary part with sign, real part without */
 		if (!Py_IS_FINITE(v->cval.real)) {
 			if (Py_IS_NAN(v->cval.real))
@@ -383,7 +391,8 @@ complex_to_buf(char *buf, int bufsz, PyComplexObject *v, int precision)
 			else
 				strncpy(re, "-inf", 5);
 		}
-		else {
+		else if (_PyOS_ascii_formatd_shortest(re, sizeof(re),
+				v->cval.real, precision) == NULL) {
 			PyOS_snprintf(format, sizeof(format), "%%.%ig", precision);
 			PyOS_ascii_formatd(re, sizeof(re), format, v->cval.real);
 		}
@@ -396,11 +405,19 @@ complex_to_buf(char *buf, int bufsz, PyComplexObject *v, int precision)
 			else
 				strncpy(im, "-inf*", 6);
 		}
+		else if (_PyOS_ascii_formatd_shortest(im + 1, sizeof(im) - 1,
+				v->cval.imag, precision) != NULL) {
+			/* Supply the sign %+g would have. */
+			if (im[1] == '-')
+				imp = im + 1;
+			else
+				im[0] = '+';
+		}
 		else {
 			PyOS_snprintf(format, sizeof(format), "%%+.%ig", precision);
 			PyOS_ascii_formatd(im, sizeof(im), format, v->cval.imag);
 		}
-		PyOS_snprintf(buf, bufsz, "(%s%sj)", re, im);
+		PyOS_snprintf(buf, bufsz, "(%s%sj)", re, imp);
 	}
 }
 
@@ -200,6 +200,125 @@ show_alloc(void)
 	INIT_NONZERO_DICT_SLOTS(mp);					\
     } while(0)
 
+/* Version tags and watchers.  Every change to a dict's contents gives it a
+   new tag from dict_global_version; the tag's low PyDict_MAX_WATCHERS bits
+   are a mask of the watchers observing the dict, so an unwatched dict pays
+   only a single test per mutation.  Tags are 64 bits wide where available,
+   leaving plenty of room before the counter could wrap.
+*/
+static Py_dictversion_t dict_global_version = 0;
+static PyDict_WatchCallback dict_watchers[PyDict_MAX_WATCHERS];
+
+#define DICT_VERSION_INCREMENT ((Py_dictversion_t)1 << PyDict_MAX_WATCHERS)
+#define DICT_WATCHER_MASK (DICT_VERSION_INCREMENT - 1)
+
+#define DICT_NEW_VERSION(mp) \
+	((mp)->ma_version = (dict_global_version += DICT_VERSION_INCREMENT))
+
+#define DICT_BUMP_VERSION(mp) \
+	((mp)->ma_version = (dict_global_version += DICT_VERSION_INCREMENT) | \
+			    ((mp)->ma_version & DICT_WATCHER_MASK))
+
+#define DICT_NOTIFY(event, mp, key, value) do {				\
+	if ((mp)->ma_version & DICT_WATCHER_MASK)			\
+		dict_notify_watchers(event, mp, key, value);		\
+    } while(0)
+
+static void
+dict_notify_watchers(PyDict_WatchEvent event, PyDictObject *mp,
+		     PyObject *key, PyObject *value)
+{
+	static PyObject *context = NULL;
+	PyObject *t, *v, *tb;
+	int i;
+
+	/* A dict may be changed or freed while an exception is being
+	   propagated; the callbacks must not see or clobber it. */
+	PyErr_Fetch(&t, &v, &tb);
+	for (i = 0; i < PyDict_MAX_WATCHERS; i++) {
+		PyDict_WatchCallback cb = dict_watchers[i];
+		if (cb == NULL || !(mp->ma_version & ((Py_dictversion_t)1 << i)))
+			continue;
+		if (cb(event, (PyObject *)mp, key, value) < 0) {
+			if (context == NULL)
+				context = PyString_InternFromString(
+					"dict watcher callback");
+			PyErr_WriteUnraisable(context);
+		}
+	}
+	PyErr_Restore(t, v, tb);
+}
+
+static int
+check_watcher_id(int watcher_id)
+{
+	if (watcher_id < 0 || watcher_id >= PyDict_MAX_WATCHERS) {
+		PyErr_Format(PyExc_ValueError,
+			     "invalid dict watcher ID %d", watcher_id);
+		return -1;
+	}
+	if (dict_watchers[watcher_id] == NULL) {
+		PyErr_Format(PyExc_ValueError,
+			     "no dict watcher set for ID %d", watcher_id);
+		return -1;
+	}
+	return 0;
+}
+
+int
+PyDict_AddWatcher(PyDict_WatchCallback callback)
+{
+	int i;
+
+	for (i = 0; i < PyDict_MAX_WATCHERS; i++) {
+		if (dict_watchers[i] == NULL) {
+			dict_watchers[i] = callback;
+			return i;
+		}
+	}
+	PyErr_SetString(PyExc_RuntimeError,
+			"no more dict watcher IDs available");
+	return -1;
+}
+
+int
+PyDict_ClearWatcher(int watcher_id)
+{
+	if (check_watcher_id(watcher_id) < 0)
+		return -1;
+	dict_watchers[watcher_id] = NULL;
+	return 0;
+}
+
+int
+PyDict_Watch(int watcher_id, PyObject *dict)
+{
+	if (!PyDict_Check(dict)) {
+		PyErr_SetString(PyExc_ValueError,
+				"cannot watch non-dictionary");
+		return -1;
+	}
+	if (check_watcher_id(watcher_id) < 0)
+		return -1;
+	((PyDictObject *)dict)->ma_version |= (Py_dictversion_t)1 << watcher_id;
+	return 0;
+}
+
+int
+PyDict_Unwatch(int watcher_id, PyObject *dict)
+{
+	if (!PyDict_Check(dict)) {
+		PyErr_SetString(PyExc_ValueError,
+				"cannot unwatch non-dictionary");
+		return -1;
+	}
+	if (check_watcher_id(watcher_id) < 0)
+		return -1;
+	((PyDictObject *)dict)->ma_version &=
+		~((Py_dictversion_t)1 << watcher_id);
+	return 0;
+}
+
 /* Dictionary reuse scheme to save calls to malloc, free, and memset */
 #ifndef PyDict_MAXFREELIST
 #define PyDict_MAXFREELIST 80
@@ -262,6 +381,7 @@ PyDict_New(void)
 #endif
 	}
 	mp->ma_lookup = lookdict_string;
+	DICT_NEW_VERSION(mp);
 #ifdef SHOW_CONVERSION_COUNTS
 	++created;
 #endif
@@ -454,12 +574,16 @@ insertdict(register PyDictObject *mp, PyObject *key, long hash, PyObject *value)
 		return -1;
 	}
 	if (ep->me_value != NULL) {
+		DICT_NOTIFY(PyDict_EVENT_MODIFIED, mp, key, value);
 		old_value = ep->me_value;
 		ep->me_value = value;
+		DICT_BUMP_VERSION(mp);
 		Py_DECREF(old_value); /* which **CAN** re-enter */
 		Py_DECREF(key);
 	}
 	else {
+		DICT_NOTIFY(PyDict_EVENT_ADDED, mp, key, value);
+		DICT_BUMP_VERSION(mp);
 		if (ep->me_key == NULL)
 			mp->ma_fill++;
 		else {
@@ -572,6 +696,7 @@ dictresize(PyDictObject *mp, Py_ssize_t minused)
 	mp->ma_used = 0;
 	i = mp->ma_fill;
 	mp->ma_fill = 0;
+	DICT_BUMP_VERSION(mp);
 
 	/* Copy the data over; this is refcount-neutral for active entries;
 	   dummy entries aren't copied over, of course */
@@ -611,6 +736,14 @@ _PyDict_NewPresized(Py_ssize_t minused)
 	return op;
 }
 
+/* The hash a str or tuple key has already cached, or -1 if there isn't one
+   (yet).  Looking it up here saves a call through tp_hash on every lookup of
+   the usual key types.
+ */
+#define CACHED_HASH(key) \
+	(PyString_CheckExact(key) ? ((PyStringObject *)(key))->ob_shash : \
+	 _PyTuple_HASH_CACHED(key) ? _PyTuple_HASH_SLOT(key) : -1)
+
 /* Note that, for historical reasons, PyDict_GetItem() suppresses all errors
  * that may occur (originally dicts supported only string keys, and exceptions
  * weren't possible).  So, while the original intent was that a NULL return
@@ -630,8 +763,7 @@ PyDict_GetItem(PyObject *op, PyObject *key)
 	PyThreadState *tstate;
 	if (!PyDict_Check(op))
 		return NULL;
-	if (!PyString_CheckExact(key) ||
-	    (hash = ((PyStringObject *) key)->ob_shash) == -1)
+	if ((hash = CACHED_HASH(key)) == -1)
 	{
 		hash = PyObject_Hash(key);
 		if (hash == -1) {
@@ -684,12 +816,7 @@ PyDict_SetItem(register PyObject *op, PyObject *key, PyObject *value)
 	assert(key);
 	assert(value);
 	mp = (PyDictObject *)op;
-	if (PyString_CheckExact(key)) {
-		hash = ((PyStringObject *)key)->ob_shash;
-		if (hash == -1)
-			hash = PyObject_Hash(key);
-	}
-	else {
+	if ((hash = CACHED_HASH(key)) == -1) {
 		hash = PyObject_Hash(key);
 		if (hash == -1)
 			return -1;
@@ -732,8 +859,7 @@ PyDict_DelItem(PyObject *op, PyObject *key)
 		return -1;
 	}
 	assert(key);
-	if (!PyString_CheckExact(key) ||
-	    (hash = ((PyStringObject *) key)->ob_shash) == -1) {
+	if ((hash = CACHED_HASH(key)) == -1) {
 		hash = PyObject_Hash(key);
 		if (hash == -1)
 			return -1;
@@ -746,12 +872,14 @@ PyDict_DelItem(PyObject *op, PyObject *key)
 		set_key_error(key);
 		return -1;
 	}
+	DICT_NOTIFY(PyDict_EVENT_DELETED, mp, key, NULL);
 	old_key = ep->me_key;
 	Py_INCREF(dummy);
 	ep->me_key = dummy;
 	old_value = ep->me_value;
 	ep->me_value = NULL;
 	mp->ma_used--;
+	DICT_BUMP_VERSION(mp);
 	Py_DECREF(old_value);
 	Py_DECREF(old_key);
 	return 0;
@@ -788,6 +916,10 @@ PyDict_Clear(PyObject *op)
 	 * clearing.
 	 */
 	fill = mp->ma_fill;
+	if (table_is_malloced || fill > 0) {
+		DICT_NOTIFY(PyDict_EVENT_CLEARED, mp, NULL, NULL);
+		DICT_BUMP_VERSION(mp);
+	}
 	if (table_is_malloced)
 		EMPTY_TO_MINSIZE(mp);
 
@@ -897,11 +1029,63 @@ _PyDict_Next(PyObject *op, Py_ssize_t *ppos, PyObject **pkey, PyObject **pvalue,
 
 /* Methods */
 
+/* Tell the watchers of mp that it is about to be freed.  It is brought
+   back to life for the callbacks, which may keep a reference to it;
+   return 1 if one did, and mp must not be freed after all. */
+static int
+dict_notify_dealloc(PyDictObject *mp)
+{
+	PyObject *self = (PyObject *)mp;
+
+	/* Temporarily resurrect the object. */
+	assert(self->ob_refcnt == 0);
+	self->ob_refcnt = 1;
+
+	dict_notify_watchers(PyDict_EVENT_DEALLOCATED, mp, NULL, NULL);
+
+	/* Undo the temporary resurrection; can't use DECREF here, it would
+	 * cause a recursive call.
+	 */
+	assert(self->ob_refcnt > 0);
+	if (--self->ob_refcnt == 0) {
+		/* Don't tell them again if the trashcan puts off freeing it */
+		mp->ma_version &= ~DICT_WATCHER_MASK;
+		return 0;
+	}
+
+	/* A callback resurrected it!  Make it look like the original
+	 * Py_DECREF never happened.
+	 */
+	{
+		Py_ssize_t refcnt = self->ob_refcnt;
+		_Py_NewReference(self);
+		self->ob_refcnt = refcnt;
+	}
+	assert(_Py_AS_GC(self)->gc.gc_refs != _PyGC_REFS_UNTRACKED);
+
+	/* If Py_REF_DEBUG, _Py_NewReference bumped _Py_RefTotal, so
+	 * we need to undo that. */
+	_Py_DEC_REFTOTAL;
+	/* If Py_TRACE_REFS, _Py_NewReference re-added self to the object
+	 * chain, so no more to do there.
+	 * If COUNT_ALLOCS, the original decref bumped tp_frees, and
+	 * _Py_NewReference bumped tp_allocs:  both of those need to be
+	 * undone.
+	 */
+#ifdef COUNT_ALLOCS
+	--self->ob_type->tp_frees;
+	--self->ob_type->tp_allocs;
+#endif
+	return 1;
+}
+
 static void
 dict_dealloc(register PyDictObject *mp)
 {
 	register PyDictEntry *ep;
 	Py_ssize_t fill = mp->ma_fill;
+	if ((mp->ma_version & DICT_WATCHER_MASK) && dict_notify_dealloc(mp))
+		return;
  	PyObject_GC_UnTrack(mp);
 	Py_TRASHCAN_SAFE_BEGIN(mp)
 	for (ep = mp->ma_table; fill > 0; ep++) {
@@ -1068,8 +1252,7 @@ dict_subscript(PyDictObject *mp, register PyObject *key)
 	long hash;
 	PyDictEntry *ep;
 	assert(mp->ma_table != NULL);
-	if (!PyString_CheckExact(key) ||
-	    (hash = ((PyStringObject *) key)->ob_shash) == -1) {
+	if ((hash = CACHED_HASH(key)) == -1) {
 		hash = PyObject_Hash(key);
 		if (hash == -1)
 			return NULL;
@@ -1852,8 +2035,7 @@ dict_contains(register PyDictObject *mp, PyObject *key)
 	long hash;
 	PyDictEntry *ep;
 
-	if (!PyString_CheckExact(key) ||
-	    (hash = ((PyStringObject *) key)->ob_shash) == -1) {
+	if ((hash = CACHED_HASH(key)) == -1) {
 		hash = PyObject_Hash(key);
 		if (hash == -1)
 			return NULL;
@@ -1885,8 +2067,7 @@ dict_get(register PyDictObject *mp, PyObject *args)
 	if (!PyArg_UnpackTuple(args, "get", 1, 2, &key, &failobj))
 		return NULL;
 
-	if (!PyString_CheckExact(key) ||
-	    (hash = ((PyStringObject *) key)->ob_shash) == -1) {
+	if ((hash = CACHED_HASH(key)) == -1) {
 		hash = PyObject_Hash(key);
 		if (hash == -1)
 			return NULL;
@@ -1914,8 +2095,7 @@ dict_setdefault(register PyDictObject *mp, PyObject *args)
 	if (!PyArg_UnpackTuple(args, "setdefault", 1, 2, &key, &failobj))
 		return NULL;
 
-	if (!PyString_CheckExact(key) ||
-	    (hash = ((PyStringObject *) key)->ob_shash) == -1) {
+	if ((hash = CACHED_HASH(key)) == -1) {
 		hash = PyObject_Hash(key);
 		if (hash == -1)
 			return NULL;
@@ -1960,8 +2140,7 @@ dict_pop(PyDictObject *mp, PyObject *args)
 				"pop(): dictionary is empty");
 		return NULL;
 	}
-	if (!PyString_CheckExact(key) ||
-	    (hash = ((PyStringObject *) key)->ob_shash) == -1) {
+	if ((hash = CACHED_HASH(key)) == -1) {
 		hash = PyObject_Hash(key);
 		if (hash == -1)
 			return NULL;
@@ -1977,12 +2156,14 @@ dict_pop(PyDictObject *mp, PyObject *args)
 		set_key_error(key);
 		return NULL;
 	}
+	DICT_NOTIFY(PyDict_EVENT_DELETED, mp, key, NULL);
 	old_key = ep->me_key;
 	Py_INCREF(dummy);
 	ep->me_key = dummy;
 	old_value = ep->me_value;
 	ep->me_value = NULL;
 	mp->ma_used--;
+	DICT_BUMP_VERSION(mp);
 	Py_DECREF(old_key);
 	return old_value;
 }
@@ -2034,12 +2215,14 @@ dict_popitem(PyDictObject *mp)
 				i = 1;
 		}
 	}
+	DICT_NOTIFY(PyDict_EVENT_DELETED, mp, ep->me_key, NULL);
 	PyTuple_SET_ITEM(res, 0, ep->me_key);
 	PyTuple_SET_ITEM(res, 1, ep->me_value);
 	Py_INCREF(dummy);
 	ep->me_key = dummy;
 	ep->me_value = NULL;
 	mp->ma_used--;
+	DICT_BUMP_VERSION(mp);
 	assert(mp->ma_table[0].me_value == NULL);
 	mp->ma_table[0].me_hash = i + 1;  /* next place to start */
 	return res;
@@ -2208,8 +2391,7 @@ PyDict_Contains(PyObject *op, PyObject *key)
 	PyDictObject *mp = (PyDictObject *)op;
 	PyDictEntry *ep;
 
-	if (!PyString_CheckExact(key) ||
-	    (hash = ((PyStringObject *) key)->ob_shash) == -1) {
+	if ((hash = CACHED_HASH(key)) == -1) {
 		hash = PyObject_Hash(key);
 		if (hash == -1)
 			return -1;
@@ -2256,6 +2438,7 @@ dict_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 		assert(d->ma_table == NULL && d->ma_fill == 0 && d->ma_used == 0);
 		INIT_NONZERO_DICT_SLOTS(d);
 		d->ma_lookup = lookdict_string;
+		DICT_NEW_VERSION(d);
 #ifdef SHOW_CONVERSION_COUNTS
 		++created;
 #endif
@@ -2904,6 +3087,7 @@ static PyObject *dictiter_iternextitem(dictiterobject *di)
 		Py_INCREF(result);
 		Py_DECREF(PyTuple_GET_ITEM(result, 0));
 		Py_DECREF(PyTuple_GET_ITEM(result, 1));
+		_PyTuple_RESET_HASH(result);
 	} else {
 		result = PyTuple_New(2);
 		if (result == NULL)
@@ -106,6 +106,7 @@ enum_next_long(enumobject *en, PyObject* next_item)
 		Py_INCREF(result);
 		Py_DECREF(PyTuple_GET_ITEM(result, 0));
 		Py_DECREF(PyTuple_GET_ITEM(result, 1));
+		_PyTuple_RESET_HASH(result);
 	} else {
 		result = PyTuple_New(2);
 		if (result == NULL) {
@@ -145,6 +146,7 @@ enum_next(enumobject *en)
 		Py_INCREF(result);
 		Py_DECREF(PyTuple_GET_ITEM(result, 0));
 		Py_DECREF(PyTuple_GET_ITEM(result, 1));
+		_PyTuple_RESET_HASH(result);
 	} else {
 		result = PyTuple_New(2);
 		if (result == NULL) {
@@ -158,6 +160,27 @@ enum_next(enumobject *en)
 	return result;
 }
 
+static PyObject *
+enum_len(enumobject *en)
+{
+	Py_ssize_t n = _PyObject_LengthHintNoMask(en->en_sit);
+
+	if (n < 0) {
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_TypeError,
+					"len() of unsized object");
+		return NULL;
+	}
+	return PyInt_FromSsize_t(n);
+}
+
+PyDoc_STRVAR(length_hint_doc, "Private method returning an estimate of len(list(it)).");
+
+static PyMethodDef enum_methods[] = {
+	{"__length_hint__", (PyCFunction)enum_len, METH_NOARGS, length_hint_doc},
+ 	{NULL,		NULL}		/* sentinel */
+};
+
 PyDoc_STRVAR(enum_doc,
 "enumerate(iterable) -> iterator for index, value of iterable\n"
 "\n"
@@ -196,7 +219,7 @@ PyTypeObject PyEnum_Type = {
 	0,                              /* tp_weaklistoffset */
 	PyObject_SelfIter,		/* tp_iter */
 	(iternextfunc)enum_next,        /* tp_iternext */
-	0,                              /* tp_methods */
+	enum_methods,                   /* tp_methods */
 	0,                              /* tp_members */
 	0,                              /* tp_getset */
 	0,                              /* tp_base */
@@ -309,8 +332,6 @@ reversed_len(reversedobject *ro)
 	return PyInt_FromSsize_t((seqsize < position)  ?  0  :  position);
 }
 
-PyDoc_STRVAR(length_hint_doc, "Private method returning an estimate of len(list(it)).");
-
 static PyMethodDef reversediter_methods[] = {
 	{"__length_hint__", (PyCFunction)reversed_len, METH_NOARGS, length_hint_doc},
  	{NULL,		NULL}		/* sentinel */
@@ -338,6 +338,24 @@ PyFloat_AsDouble(PyObject *op)
 
 /* Methods */
 
+/* Precisions used by repr() and str(), respectively.
+
+   The repr() precision (17 significant decimal digits) is the minimal number
+   that is guaranteed to have enough precision so that if the number is read
+   back in the exact same binary value is recreated.  This is true for IEEE
+   floating point by design, and also happens to work for all other modern
+   hardware.  repr() only uses as many of them as that takes, though, so
+   repr(0.1) is '0.1' rather than '0.10000000000000001'.
+
+   The str() precision is chosen so that in most cases, the rounding noise
+   created by various operations is suppressed, while giving plenty of
+   precision for practical use.
+
+*/
+
+#define PREC_REPR	17
+#define PREC_STR	12
+
 static void
 format_float(char *buf, size_t buflen, PyFloatObject *v, int precision)
 {
@@ -349,11 +367,19 @@ format_float(char *buf, size_t buflen, PyFloatObject *v, int precision)
 	   We want float numbers to be recognizable as such,
 	   i.e., they should contain a decimal point or an exponent.
 	   However, %g may print the number as an integer;
-	   in such cases, we append ".0" to the string. */
+	   in such cases, we append ".0" to the string.
+	   The digits come from _PyOS_ascii_formatd_shortest() when it can
+	   do the job: for repr() it drops the noise from the end of the
+	   17 digits, and for str() it's what %g gives, only faster.  (With
+	   16 digits it would be neither.) */
 
 	assert(PyFloat_Check(v));
-	PyOS_snprintf(format, 32, "%%.%ig", precision);
-	PyOS_ascii_formatd(buf, buflen, format, v->ob_fval);
+	if ((precision > 15 && precision < PREC_REPR) ||
+	    _PyOS_ascii_formatd_shortest(buf, buflen, v->ob_fval,
+					 precision) == NULL) {
+		PyOS_snprintf(format, 32, "%%.%ig", precision);
+		PyOS_ascii_formatd(buf, buflen, format, v->ob_fval);
+	}
 	cp = buf;
 	if (*cp == '-')
 		cp++;
@@ -442,23 +468,6 @@ convert_to_double(PyObject **v, double *dbl)
 	return 0;
 }
 
-/* Precisions used by repr() and str(), respectively.
-
-   The repr() precision (17 significant decimal digits) is the minimal number
-   that is guaranteed to have enough precision so that if the number is read
-   back in the exact same binary value is recreated.  This is true for IEEE
-   floating point by design, and also happens to work for all other modern
-   hardware.
-
-   The str() precision is chosen so that in most cases, the rounding noise
-   created by various operations is suppressed, while giving plenty of
-   precision for practical use.
-
-*/
-
-#define PREC_REPR	17
-#define PREC_STR	12
-
 /* XXX PyFloat_AsString and PyFloat_AsReprString should be deprecated:
    XXX they pass a char buffer without passing a length.
 */
@@ -2071,6 +2080,20 @@ _PyFloat_Init(void)
 		PyStructSequence_InitType(&FloatInfoType, &floatinfo_desc);
 }
 
+/* Report how many float objects are parked on the free list, and the memory
+   they tie up.  The free list is walked, so this is for statistics only. */
+void
+_PyFloat_FreeListStats(Py_ssize_t *count, Py_ssize_t *nbytes)
+{
+	PyFloatObject *p;
+	Py_ssize_t n = 0;
+
+	for (p = free_list; p != NULL; p = (PyFloatObject *)Py_TYPE(p))
+		n++;
+	*count = n;
+	*nbytes = n * sizeof(PyFloatObject);
+}
+
 int
 PyFloat_ClearFreeList(void)
 {
@@ -620,6 +620,8 @@ PyFrame_New(PyThreadState *tstate, PyCodeObject *code, PyObject *globals,
 		return NULL;
 	}
 #endif
+	if (_PyCode_HAS_LAZY_CONSTS(code) && _PyCode_LoadConsts(code) < 0)
+		return NULL;
 	if (back == NULL || back->f_globals != globals) {
 		builtins = PyDict_GetItem(globals, builtin_object);
 		if (builtins) {
@@ -943,6 +945,22 @@ PyFrame_LocalsToFast(PyFrameObject *f, int clear)
 	PyErr_Restore(error_type, error_value, error_traceback);
 }
 
+/* Report the size of the free list.  Zombie frames kept by code objects
+   are not counted: they belong to their code object, not to the list. */
+void
+_PyFrame_FreeListStats(Py_ssize_t *count, Py_ssize_t *nbytes)
+{
+	PyFrameObject *f;
+	Py_ssize_t n = 0;
+
+	for (f = free_list; f != NULL; f = f->f_back)
+		/* subtract one as it is already included in PyFrameObject */
+		n += sizeof(PyGC_Head) + sizeof(PyFrameObject) +
+		     (Py_SIZE(f)-1) * sizeof(PyObject *);
+	*count = numfree;
+	*nbytes = n;
+}
+
 /* Clear out the free list */
 int
 PyFrame_ClearFreeList(void)
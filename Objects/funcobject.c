@@ -9,9 +9,14 @@
 PyObject *
 PyFunction_New(PyObject *code, PyObject *globals)
 {
-	PyFunctionObject *op = PyObject_GC_New(PyFunctionObject,
-					    &PyFunction_Type);
+	PyFunctionObject *op;
 	static PyObject *__name__ = 0;
+	if (_PyLazyCode_Check(code)) {
+		code = _PyLazyCode_Load(code);
+		if (code == NULL)
+			return NULL;
+	}
+	op = PyObject_GC_New(PyFunctionObject, &PyFunction_Type);
 	if (op != NULL) {
 		PyObject *doc;
 		PyObject *consts;
@@ -281,6 +281,34 @@ gen_iternext(PyGenObject *gen)
 }
 
 
+static PyObject *
+gen_length_hint(PyGenObject *gen)
+{
+	PyFrameObject *f = gen->gi_frame;
+	Py_ssize_t n = -1;
+
+	/* A running generator's f_stacktop is NULL too. */
+	if (gen->gi_running)
+		n = -1;
+	else if (f == NULL || f->f_stacktop == NULL)
+		n = 0;
+	else if ((((PyCodeObject *)gen->gi_code)->co_flags & CO_GENEXP_MAP) &&
+		 f->f_localsplus[0] != NULL)
+		/* The iterator it's passed is its first local. */
+		n = _PyObject_LengthHintNoMask(f->f_localsplus[0]);
+	if (n < 0) {
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_TypeError,
+					"len() of unsized object");
+		return NULL;
+	}
+	return PyInt_FromSsize_t(n);
+}
+
+PyDoc_STRVAR(length_hint_doc,
+"Private method returning an estimate of len(list(it)).");
+
+
 static PyObject *
 gen_repr(PyGenObject *gen)
 {
@@ -322,6 +350,8 @@ static PyMethodDef gen_methods[] = {
 	{"send",(PyCFunction)gen_send, METH_O, send_doc},
 	{"throw",(PyCFunction)gen_throw, METH_VARARGS, throw_doc},
 	{"close",(PyCFunction)gen_close, METH_NOARGS, close_doc},
+	{"__length_hint__",(PyCFunction)gen_length_hint, METH_NOARGS,
+	 length_hint_doc},
 	{NULL, NULL}	/* Sentinel */
 };
 
@@ -1301,6 +1301,8 @@ _PyInt_Init(void)
 	int ival;
 #if NSMALLNEGINTS + NSMALLPOSINTS > 0
 	for (ival = -NSMALLNEGINTS; ival < NSMALLPOSINTS; ival++) {
+		if (small_ints[ival + NSMALLNEGINTS] != NULL)
+			continue;	/* kept by PyInt_Fini() */
               if (!free_list && (free_list = fill_free_list()) == NULL)
 			return 0;
 		/* PyObject_New is inlined */
@@ -1308,12 +1310,27 @@ _PyInt_Init(void)
 		free_list = (PyIntObject *)Py_TYPE(v);
 		PyObject_INIT(v, &PyInt_Type);
 		v->ob_ival = ival;
+		_Py_SetImmortal(v);
 		small_ints[ival + NSMALLNEGINTS] = v;
 	}
 #endif
 	return 1;
 }
 
+/* Report how many int objects are parked on the free list, and the memory
+   they tie up.  The free list is walked, so this is for statistics only. */
+void
+_PyInt_FreeListStats(Py_ssize_t *count, Py_ssize_t *nbytes)
+{
+	PyIntObject *p;
+	Py_ssize_t n = 0;
+
+	for (p = free_list; p != NULL; p = (PyIntObject *)Py_TYPE(p))
+		n++;
+	*count = n;
+	*nbytes = n * sizeof(PyIntObject);
+}
+
 int
 PyInt_ClearFreeList(void)
 {
@@ -1383,6 +1400,14 @@ PyInt_Fini(void)
 	i = NSMALLNEGINTS + NSMALLPOSINTS;
 	q = small_ints;
 	while (--i >= 0) {
+		/* Immortal small ints can't be freed:  static types hold on
+		   to some of them in their dicts from one Py_Initialize() to
+		   the next.  They are kept here instead, for _PyInt_Init()
+		   to reuse. */
+		if (*q != NULL && _Py_IsImmortal(*q)) {
+			q++;
+			continue;
+		}
 		Py_XDECREF(*q);
 		*q++ = NULL;
 	}
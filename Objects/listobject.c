@@ -972,20 +972,95 @@ reverse_slice(PyObject **lo, PyObject **hi)
  * pieces to this algorithm; read listsort.txt for overviews and details.
  */
 
-/* Comparison function.  Takes care of calling a user-supplied
- * comparison function (any callable Python object), which must not be
- * NULL (use the ISLT macro if you don't know, or call PyObject_RichCompareBool
- * with Py_LT if you know it's NULL).
- * Returns -1 on error, 1 if x < y, 0 if x >= y.
+/* The maximum number of entries in a MergeState's pending-runs stack.
+ * This is enough to sort arrays of size up to about
+ *     32 * phi ** MAX_MERGE_PENDING
+ * where phi ~= 1.618.  85 is ridiculouslylarge enough, good for an array
+ * with 2**64 elements.
  */
+#define MAX_MERGE_PENDING 85
+
+/* When we get into galloping mode, we stay there until both runs win less
+ * often than MIN_GALLOP consecutive times.  See listsort.txt for more info.
+ */
+#define MIN_GALLOP 7
+
+/* Avoid malloc for small temp arrays. */
+#define MERGESTATE_TEMP_SIZE 256
+
+/* One MergeState exists on the stack per invocation of mergesort.  It's just
+ * a convenient way to pass state around among the helper functions.
+ */
+struct s_slice {
+	PyObject **base;
+	Py_ssize_t len;
+};
+
+typedef struct s_MergeState MergeState;
+
+struct s_MergeState {
+	/* The user-supplied comparison function. or NULL if none given. */
+	PyObject *compare;
+
+	/* The function the sort calls to compare two entries:  see ISLT.
+	 * When all the entries are of one type, it can be a specialised
+	 * function that skips the generic rich comparison machinery.  When
+	 * the entries are wrapped by a key function, key_compare unwraps
+	 * them and calls unwrapped_compare on the keys.
+	 */
+	int (*key_compare)(PyObject *, PyObject *, MergeState *);
+	int (*unwrapped_compare)(PyObject *, PyObject *, MergeState *);
+
+	/* This controls when we get *into* galloping mode.  It's initialized
+	 * to MIN_GALLOP.  merge_lo and merge_hi tend to nudge it higher for
+	 * random data, and lower for highly structured data.
+	 */
+	Py_ssize_t min_gallop;
+
+	/* 'a' is temp storage to help with merges.  It contains room for
+	 * alloced entries.
+	 */
+	PyObject **a;	/* may point to temparray below */
+	Py_ssize_t alloced;
+
+	/* A stack of n pending runs yet to be merged.  Run #i starts at
+	 * address base[i] and extends for len[i] elements.  It's always
+	 * true (so long as the indices are in bounds) that
+	 *
+	 *     pending[i].base + pending[i].len == pending[i+1].base
+	 *
+	 * so we could cut the storage for this, but it's a minor amount,
+	 * and keeping all the info explicit simplifies the code.
+	 */
+	int n;
+	struct s_slice pending[MAX_MERGE_PENDING];
+
+	/* 'a' points to this when possible, rather than muck with malloc. */
+	PyObject *temparray[MERGESTATE_TEMP_SIZE];
+};
+
+/* Comparison functions, for MergeState.key_compare.  They all return -1 on
+ * error, 1 if x < y, 0 if x >= y.
+ */
+
+/* The default:  compare with "<". */
 static int
-islt(PyObject *x, PyObject *y, PyObject *compare)
+safe_object_compare(PyObject *x, PyObject *y, MergeState *ms)
+{
+	return PyObject_RichCompareBool(x, y, Py_LT);
+}
+
+/* Takes care of calling a user-supplied comparison function (any callable
+ * Python object), ms->compare, which must not be NULL.
+ */
+static int
+islt(PyObject *x, PyObject *y, MergeState *ms)
 {
 	PyObject *res;
 	PyObject *args;
 	Py_ssize_t i;
 
-	assert(compare != NULL);
+	assert(ms->compare != NULL);
 	/* Call the user's comparison function and translate the 3-way
 	 * result into true or false (or error).
 	 */
@@ -996,7 +1071,7 @@ islt(PyObject *x, PyObject *y, PyObject *compare)
 	Py_INCREF(y);
 	PyTuple_SET_ITEM(args, 0, x);
 	PyTuple_SET_ITEM(args, 1, y);
-	res = PyObject_Call(compare, args, NULL);
+	res = PyObject_Call(ms->compare, args, NULL);
 	Py_DECREF(args);
 	if (res == NULL)
 		return -1;
@@ -1012,20 +1087,17 @@ islt(PyObject *x, PyObject *y, PyObject *compare)
 	return i < 0;
 }
 
-/* If COMPARE is NULL, calls PyObject_RichCompareBool with Py_LT, else calls
- * islt.  This avoids a layer of function call in the usual case, and
- * sorting does many comparisons.
+/* Compares X and Y with the MergeState's comparison function; there must
+ * be a MergeState *ms in scope.
  * Returns -1 on error, 1 if x < y, 0 if x >= y.
  */
-#define ISLT(X, Y, COMPARE) ((COMPARE) == NULL ?			\
-			     PyObject_RichCompareBool(X, Y, Py_LT) :	\
-			     islt(X, Y, COMPARE))
+#define ISLT(X, Y) (*(ms->key_compare))(X, Y, ms)
 
 /* Compare X to Y via "<".  Goto "fail" if the comparison raises an
    error.  Else "k" is set to true iff X<Y, and an "if (k)" block is
    started.  It makes more sense in context <wink>.  X and Y are PyObject*s.
 */
-#define IFLT(X, Y) if ((k = ISLT(X, Y, compare)) < 0) goto fail;  \
+#define IFLT(X, Y) if ((k = ISLT(X, Y)) < 0) goto fail;  \
 		   if (k)
 
 /* binarysort is the best method for sorting small arrays: it does
@@ -1040,8 +1112,7 @@ islt(PyObject *x, PyObject *y, PyObject *compare)
    the input (nothing is lost or duplicated).
 */
 static int
-binarysort(PyObject **lo, PyObject **hi, PyObject **start, PyObject *compare)
-     /* compare -- comparison function object, or NULL for default */
+binarysort(MergeState *ms, PyObject **lo, PyObject **hi, PyObject **start)
 {
 	register Py_ssize_t k;
 	register PyObject **l, **p, **r;
@@ -1106,7 +1177,7 @@ elements to get out of order).
 Returns -1 in case of error.
 */
 static Py_ssize_t
-count_run(PyObject **lo, PyObject **hi, PyObject *compare, int *descending)
+count_run(MergeState *ms, PyObject **lo, PyObject **hi, int *descending)
 {
 	Py_ssize_t k;
 	Py_ssize_t n;
@@ -1161,7 +1232,8 @@ key, and the last n-k should follow key.
 Returns -1 on error.  See listsort.txt for info on the method.
 */
 static Py_ssize_t
-gallop_left(PyObject *key, PyObject **a, Py_ssize_t n, Py_ssize_t hint, PyObject *compare)
+gallop_left(MergeState *ms, PyObject *key, PyObject **a, Py_ssize_t n,
+	    Py_ssize_t hint)
 {
 	Py_ssize_t ofs;
 	Py_ssize_t lastofs;
@@ -1252,7 +1324,8 @@ we're sticking to "<" comparisons that it's much harder to follow if
 written as one routine with yet another "left or right?" flag.
 */
 static Py_ssize_t
-gallop_right(PyObject *key, PyObject **a, Py_ssize_t n, Py_ssize_t hint, PyObject *compare)
+gallop_right(MergeState *ms, PyObject *key, PyObject **a, Py_ssize_t n,
+	     Py_ssize_t hint)
 {
 	Py_ssize_t ofs;
 	Py_ssize_t lastofs;
@@ -1328,68 +1401,14 @@ fail:
 	return -1;
 }
 
-/* The maximum number of entries in a MergeState's pending-runs stack.
- * This is enough to sort arrays of size up to about
- *     32 * phi ** MAX_MERGE_PENDING
- * where phi ~= 1.618.  85 is ridiculouslylarge enough, good for an array
- * with 2**64 elements.
- */
-#define MAX_MERGE_PENDING 85
-
-/* When we get into galloping mode, we stay there until both runs win less
- * often than MIN_GALLOP consecutive times.  See listsort.txt for more info.
- */
-#define MIN_GALLOP 7
-
-/* Avoid malloc for small temp arrays. */
-#define MERGESTATE_TEMP_SIZE 256
-
-/* One MergeState exists on the stack per invocation of mergesort.  It's just
- * a convenient way to pass state around among the helper functions.
- */
-struct s_slice {
-	PyObject **base;
-	Py_ssize_t len;
-};
-
-typedef struct s_MergeState {
-	/* The user-supplied comparison function. or NULL if none given. */
-	PyObject *compare;
-
-	/* This controls when we get *into* galloping mode.  It's initialized
-	 * to MIN_GALLOP.  merge_lo and merge_hi tend to nudge it higher for
-	 * random data, and lower for highly structured data.
-	 */
-	Py_ssize_t min_gallop;
-
-	/* 'a' is temp storage to help with merges.  It contains room for
-	 * alloced entries.
-	 */
-	PyObject **a;	/* may point to temparray below */
-	Py_ssize_t alloced;
-
-	/* A stack of n pending runs yet to be merged.  Run #i starts at
-	 * address base[i] and extends for len[i] elements.  It's always
-	 * true (so long as the indices are in bounds) that
-	 *
-	 *     pending[i].base + pending[i].len == pending[i+1].base
-	 *
-	 * so we could cut the storage for this, but it's a minor amount,
-	 * and keeping all the info explicit simplifies the code.
-	 */
-	int n;
-	struct s_slice pending[MAX_MERGE_PENDING];
-
-	/* 'a' points to this when possible, rather than muck with malloc. */
-	PyObject *temparray[MERGESTATE_TEMP_SIZE];
-} MergeState;
-
 /* Conceptually a MergeState's constructor. */
 static void
 merge_init(MergeState *ms, PyObject *compare)
 {
 	assert(ms != NULL);
 	ms->compare = compare;
+	ms->key_compare = compare == NULL ? safe_object_compare : islt;
+	ms->unwrapped_compare = NULL;
 	ms->a = ms->temparray;
 	ms->alloced = MERGESTATE_TEMP_SIZE;
 	ms->n = 0;
@@ -1450,7 +1469,6 @@ merge_lo(MergeState *ms, PyObject **pa, Py_ssize_t na,
                          PyObject **pb, Py_ssize_t nb)
 {
 	Py_ssize_t k;
-	PyObject *compare;
 	PyObject **dest;
 	int result = -1;	/* guilty until proved innocent */
 	Py_ssize_t min_gallop;
@@ -1470,7 +1488,6 @@ merge_lo(MergeState *ms, PyObject **pa, Py_ssize_t na,
 		goto CopyB;
 
 	min_gallop = ms->min_gallop;
-	compare = ms->compare;
 	for (;;) {
 		Py_ssize_t acount = 0;	/* # of times A won in a row */
 		Py_ssize_t bcount = 0;	/* # of times B won in a row */
@@ -1480,7 +1497,7 @@ merge_lo(MergeState *ms, PyObject **pa, Py_ssize_t na,
 		 */
  		for (;;) {
  			assert(na > 1 && nb > 0);
-	 		k = ISLT(*pb, *pa, compare);
+	 		k = ISLT(*pb, *pa);
 			if (k) {
 				if (k < 0)
 					goto Fail;
@@ -1515,7 +1532,7 @@ merge_lo(MergeState *ms, PyObject **pa, Py_ssize_t na,
  			assert(na > 1 && nb > 0);
 			min_gallop -= min_gallop > 1;
 	 		ms->min_gallop = min_gallop;
-			k = gallop_right(*pb, pa, na, 0, compare);
+			k = gallop_right(ms, *pb, pa, na, 0);
 			acount = k;
 			if (k) {
 				if (k < 0)
@@ -1538,7 +1555,7 @@ merge_lo(MergeState *ms, PyObject **pa, Py_ssize_t na,
 			if (nb == 0)
 				goto Succeed;
 
- 			k = gallop_left(*pa, pb, nb, 0, compare);
+ 			k = gallop_left(ms, *pa, pb, nb, 0);
  			bcount = k;
 			if (k) {
 				if (k < 0)
@@ -1582,7 +1599,6 @@ static Py_ssize_t
 merge_hi(MergeState *ms, PyObject **pa, Py_ssize_t na, PyObject **pb, Py_ssize_t nb)
 {
 	Py_ssize_t k;
-	PyObject *compare;
 	PyObject **dest;
 	int result = -1;	/* guilty until proved innocent */
 	PyObject **basea;
@@ -1607,7 +1623,6 @@ merge_hi(MergeState *ms, PyObject **pa, Py_ssize_t na, PyObject **pb, Py_ssize_t
 		goto CopyA;
 
 	min_gallop = ms->min_gallop;
-	compare = ms->compare;
 	for (;;) {
 		Py_ssize_t acount = 0;	/* # of times A won in a row */
 		Py_ssize_t bcount = 0;	/* # of times B won in a row */
@@ -1617,7 +1632,7 @@ merge_hi(MergeState *ms, PyObject **pa, Py_ssize_t na, PyObject **pb, Py_ssize_t
 		 */
  		for (;;) {
  			assert(na > 0 && nb > 1);
-	 		k = ISLT(*pb, *pa, compare);
+	 		k = ISLT(*pb, *pa);
 			if (k) {
 				if (k < 0)
 					goto Fail;
@@ -1652,7 +1667,7 @@ merge_hi(MergeState *ms, PyObject **pa, Py_ssize_t na, PyObject **pb, Py_ssize_t
  			assert(na > 0 && nb > 1);
 			min_gallop -= min_gallop > 1;
 	 		ms->min_gallop = min_gallop;
-			k = gallop_right(*pb, basea, na, na-1, compare);
+			k = gallop_right(ms, *pb, basea, na, na-1);
 			if (k < 0)
 				goto Fail;
 			k = na - k;
@@ -1670,7 +1685,7 @@ merge_hi(MergeState *ms, PyObject **pa, Py_ssize_t na, PyObject **pb, Py_ssize_t
 			if (nb == 1)
 				goto CopyA;
 
- 			k = gallop_left(*pa, baseb, nb, nb-1, compare);
+ 			k = gallop_left(ms, *pa, baseb, nb, nb-1);
 			if (k < 0)
 				goto Fail;
 			k = nb - k;
@@ -1722,7 +1737,6 @@ merge_at(MergeState *ms, Py_ssize_t i)
 	PyObject **pa, **pb;
 	Py_ssize_t na, nb;
 	Py_ssize_t k;
-	PyObject *compare;
 
 	assert(ms != NULL);
 	assert(ms->n >= 2);
@@ -1748,8 +1762,7 @@ merge_at(MergeState *ms, Py_ssize_t i)
 	/* Where does b start in a?  Elements in a before that can be
 	 * ignored (already in place).
 	 */
-	compare = ms->compare;
-	k = gallop_right(*pb, pa, na, 0, compare);
+	k = gallop_right(ms, *pb, pa, na, 0);
 	if (k < 0)
 		return -1;
 	pa += k;
@@ -1760,7 +1773,7 @@ merge_at(MergeState *ms, Py_ssize_t i)
 	/* Where does a end in b?  Elements in b after that can be
 	 * ignored (already in place).
 	 */
-	nb = gallop_left(pa[na-1], pb, nb, nb-1, compare);
+	nb = gallop_left(ms, pa[na-1], pb, nb, nb-1);
 	if (nb <= 0)
 		return nb;
 
@@ -2025,6 +2038,188 @@ build_cmpwrapper(PyObject *cmpfunc)
 	return (PyObject *)co;
 }
 
+/* Specialised comparisons.  Before sorting, a pass over the keys checks
+ * whether they all have the same type; if that's str, int or float, the
+ * sort compares them directly instead of through PyObject_RichCompareBool,
+ * which has to find and call the type's comparison for every pair.  These
+ * functions assume the types without checking them, and can't fail.
+ */
+
+static int
+unsafe_string_compare(PyObject *x, PyObject *y, MergeState *ms)
+{
+	Py_ssize_t len_x = Py_SIZE(x), len_y = Py_SIZE(y);
+	int c;
+
+	/* Like string_richcompare(); the first characters usually decide. */
+	c = Py_CHARMASK(*PyString_AS_STRING(x)) -
+	    Py_CHARMASK(*PyString_AS_STRING(y));
+	if (c == 0)
+		c = memcmp(PyString_AS_STRING(x), PyString_AS_STRING(y),
+			   len_x < len_y ? len_x : len_y);
+	return c != 0 ? c < 0 : len_x < len_y;
+}
+
+static int
+unsafe_int_compare(PyObject *x, PyObject *y, MergeState *ms)
+{
+	return PyInt_AS_LONG(x) < PyInt_AS_LONG(y);
+}
+
+static int
+unsafe_float_compare(PyObject *x, PyObject *y, MergeState *ms)
+{
+	return PyFloat_AS_DOUBLE(x) < PyFloat_AS_DOUBLE(y);
+}
+
+/* Compares the keys of two sortwrappers. */
+static int
+unwrapping_compare(PyObject *x, PyObject *y, MergeState *ms)
+{
+	return (*(ms->unwrapped_compare))(((sortwrapperobject *)x)->key,
+					  ((sortwrapperobject *)y)->key, ms);
+}
+
+#define SORT_KEY(ITEM, WRAPPED) \
+	((WRAPPED) ? ((sortwrapperobject *)(ITEM))->key : (ITEM))
+
+/* If the keys of items[0:n] all have the same type, and it's one with a
+ * specialised comparison, point ms at it and return the type.  Otherwise
+ * return NULL and leave ms alone.  wrapped is true if the items are
+ * sortwrappers.  ms mustn't have a user-supplied comparison function.
+ */
+static PyTypeObject *
+specialise_compare(MergeState *ms, PyObject **items, Py_ssize_t n,
+		   int wrapped)
+{
+	PyTypeObject *type;
+	Py_ssize_t i;
+
+	assert(ms->compare == NULL && n > 0);
+	type = Py_TYPE(SORT_KEY(items[0], wrapped));
+	if (type == &PyString_Type)
+		ms->unwrapped_compare = unsafe_string_compare;
+	else if (type == &PyInt_Type)
+		ms->unwrapped_compare = unsafe_int_compare;
+	else if (type == &PyFloat_Type)
+		ms->unwrapped_compare = unsafe_float_compare;
+	else
+		return NULL;
+	for (i = 1; i < n; i++) {
+		if (Py_TYPE(SORT_KEY(items[i], wrapped)) != type) {
+			ms->unwrapped_compare = NULL;
+			return NULL;
+		}
+	}
+	ms->key_compare = wrapped ? unwrapping_compare : ms->unwrapped_compare;
+	return type;
+}
+
+#if defined(HAVE_LONG_LONG) && SIZEOF_LONG_LONG == 8 && \
+    SIZEOF_LONG <= 8 && SIZEOF_DOUBLE == 8
+#define USE_RADIX_SORT
+
+/* Lists of at least this many ints or floats are sorted by radix sort
+ * rather than by merging.
+ */
+#define RADIX_SORT_CUTOFF 256
+
+typedef unsigned PY_LONG_LONG radix_key;
+
+#define RADIX_SIGN_BIT ((radix_key)1 << 63)
+
+typedef struct {
+	radix_key key;
+	PyObject *item;
+} radix_entry;
+
+/* Sort items[0:n], whose keys are all ints or all floats (type says which),
+ * by an LSD radix sort on an unsigned integer mapping of the keys that
+ * orders them the same way "<" does.  Equal keys map to the same integer,
+ * and the radix sort is stable, so the result is just what the merge sort
+ * would give.  Return 1 if the items were sorted, or 0 (with no exception
+ * set) if the radix sort doesn't apply:  if there's a NaN, which "<"
+ * doesn't order, if doubles aren't IEEE 754, or if memory is short.
+ */
+static int
+radix_sort(PyObject **items, Py_ssize_t n, PyTypeObject *type, int wrapped)
+{
+	Py_ssize_t count[sizeof(radix_key)][256];
+	radix_entry *a, *b, *t;
+	radix_key key, prev = 0;
+	Py_ssize_t i, sum;
+	int byte, c, sorted = 1, result = 0;
+
+	if (type == &PyFloat_Type) {
+		double d = -2.0;
+		memcpy(&key, &d, sizeof(key));
+		if (key != (radix_key)0xc0000000 << 32)
+			return 0;
+	}
+	a = PyMem_New(radix_entry, n);
+	b = PyMem_New(radix_entry, n);
+	if (a == NULL || b == NULL)
+		goto done;
+
+	/* Find the keys, count the occurrences of each value of each of their
+	 * bytes, and check whether the items are already in order. */
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < n; i++) {
+		PyObject *o = SORT_KEY(items[i], wrapped);
+		if (type == &PyInt_Type)
+			key = (radix_key)(PY_LONG_LONG)PyInt_AS_LONG(o) ^
+			      RADIX_SIGN_BIT;
+		else {
+			double d = PyFloat_AS_DOUBLE(o);
+			if (d != d)
+				goto done;
+			/* -0.0 == 0.0, so they must get the same key */
+			if (d == 0.0)
+				d = 0.0;
+			memcpy(&key, &d, sizeof(key));
+			key = key & RADIX_SIGN_BIT ? ~key : key | RADIX_SIGN_BIT;
+		}
+		if (key < prev)
+			sorted = 0;
+		prev = key;
+		a[i].key = key;
+		a[i].item = items[i];
+		for (byte = 0; byte < (int)sizeof(radix_key); byte++)
+			count[byte][(key >> (8 * byte)) & 0xff]++;
+	}
+	result = 1;
+	if (sorted)
+		goto done;
+
+	/* One stable counting-sort pass per byte, least significant first,
+	 * skipping the bytes that are the same in every key. */
+	for (byte = 0; byte < (int)sizeof(radix_key); byte++) {
+		Py_ssize_t *cnt = count[byte];
+		const int shift = 8 * byte;
+
+		if (cnt[(a[0].key >> shift) & 0xff] == n)
+			continue;
+		for (c = 0, sum = 0; c < 256; c++) {
+			Py_ssize_t k = cnt[c];
+			cnt[c] = sum;
+			sum += k;
+		}
+		for (i = 0; i < n; i++)
+			b[cnt[(a[i].key >> shift) & 0xff]++] = a[i];
+		t = a;
+		a = b;
+		b = t;
+	}
+	for (i = 0; i < n; i++)
+		items[i] = a[i].item;
+
+done:
+	PyMem_Free(a);
+	PyMem_Free(b);
+	return result;
+}
+#endif /* HAVE_LONG_LONG etc */
+
 /* An adaptive, stable, natural mergesort.  See listsort.txt.
  * Returns Py_None on success, NULL on error.  Even in case of error, the
  * list will be some permutation of its input state (nothing is lost or
@@ -2113,6 +2308,24 @@ listsort(PyListObject *self, PyObject *args, PyObject *kwds)
 	if (nremaining < 2)
 		goto succeed;
 
+	/* Compare keys of a single type directly, and sort enough ints or
+	 * floats without comparing them at all.
+	 */
+	if (compare == NULL) {
+		PyTypeObject *type = specialise_compare(&ms, saved_ob_item,
+							saved_ob_size,
+							keyfunc != NULL);
+#ifdef USE_RADIX_SORT
+		if ((type == &PyInt_Type || type == &PyFloat_Type) &&
+		    saved_ob_size >= RADIX_SORT_CUTOFF &&
+		    radix_sort(saved_ob_item, saved_ob_size, type,
+			       keyfunc != NULL))
+			goto succeed;
+#else
+		(void)type;
+#endif
+	}
+
 	/* March over the array once, left to right, finding natural runs,
 	 * and extending short natural runs to minrun elements.
 	 */
@@ -2124,7 +2337,7 @@ listsort(PyListObject *self, PyObject *args, PyObject *kwds)
 		Py_ssize_t n;
 
 		/* Identify next run. */
-		n = count_run(lo, hi, compare, &descending);
+		n = count_run(&ms, lo, hi, &descending);
 		if (n < 0)
 			goto fail;
 		if (descending)
@@ -2133,7 +2346,7 @@ listsort(PyListObject *self, PyObject *args, PyObject *kwds)
 		if (n < minrun) {
 			const Py_ssize_t force = nremaining <= minrun ?
 	 			  	  nremaining : minrun;
-			if (binarysort(lo, lo + force, lo + n, compare) < 0)
+			if (binarysort(&ms, lo, lo + force, lo + n) < 0)
 				goto fail;
 			n = force;
 		}
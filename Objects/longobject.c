@@ -16,6 +16,17 @@
 #define KARATSUBA_CUTOFF 70
 #define KARATSUBA_SQUARE_CUTOFF (2 * KARATSUBA_CUTOFF)
 
+/* Above TOOM3_CUTOFF digits, k_mul() uses Toom-Cook 3-way multiplication
+ * instead, and above NTT_CUTOFF digits a number-theoretic transform.
+ */
+#define TOOM3_CUTOFF 400
+#define NTT_CUTOFF 1500
+
+/* pow() with a modulus of more than BARRETT_CUTOFF digits reduces by
+ * Barrett's method, with two multiplications, instead of by long division.
+ */
+#define BARRETT_CUTOFF 250
+
 /* For exponentiation, use the binary left-to-right algorithm
  * unless the exponent contains more than FIVEARY_CUTOFF digits.
  * In that case, do 5 bits at a time.  The potential drawback is that
@@ -23,6 +34,16 @@
  */
 #define FIVEARY_CUTOFF 8
 
+/* Conversion between longs and decimal strings of more than
+ * DECIMAL_DC_WIDTH digits is done by divide and conquer: the number is
+ * split at a power of 10 and the two halves are converted recursively, so
+ * that it runs about as fast as multiplication instead of in quadratic
+ * time.  The powers used are 10**(DECIMAL_DC_WIDTH << k); they are cached,
+ * together with the reciprocals that dividing by them needs.
+ */
+#define DECIMAL_DC_WIDTH 256
+#define DECIMAL_DC_LEVELS (8 * SIZEOF_SIZE_T)
+
 #define ABS(x) ((x) < 0 ? -(x) : (x))
 
 #undef MIN
@@ -35,6 +56,13 @@ static PyLongObject *long_normalize(PyLongObject *);
 static PyLongObject *mul1(PyLongObject *, wdigit);
 static PyLongObject *muladd1(PyLongObject *, wdigit, wdigit);
 static PyLongObject *divrem1(PyLongObject *, digit, digit *);
+static PyLongObject *x_add(PyLongObject *, PyLongObject *);
+static PyLongObject *x_sub(PyLongObject *, PyLongObject *);
+static PyLongObject *k_mul(PyLongObject *, PyLongObject *);
+static int long_compare(PyLongObject *, PyLongObject *);
+static int long_divrem(PyLongObject *, PyLongObject *,
+	PyLongObject **, PyLongObject **);
+static PyLongObject *long_from_non_binary_base(char *, char *, int);
 
 #define SIGCHECK(PyTryBlock) \
 	if (--_Py_Ticker < 0) { \
@@ -1194,6 +1222,415 @@ divrem1(PyLongObject *a, digit n, digit *prem)
 	return long_normalize(z);
 }
 
+/* Return 2**n. */
+
+static PyLongObject *
+long_pow2(Py_ssize_t n)
+{
+	Py_ssize_t size = n / PyLong_SHIFT + 1;
+	PyLongObject *z = _PyLong_New(size);
+
+	if (z == NULL)
+		return NULL;
+	memset(z->ob_digit, 0, (size - 1) * sizeof(digit));
+	z->ob_digit[size - 1] = (digit)1 << (n % PyLong_SHIFT);
+	return z;
+}
+
+/* Return a >> n for a non-negative long a. */
+
+static PyLongObject *
+long_rshift_bits(PyLongObject *a, Py_ssize_t n)
+{
+	Py_ssize_t wordshift = n / PyLong_SHIFT;
+	Py_ssize_t newsize = Py_SIZE(a) - wordshift;
+	int loshift = n % PyLong_SHIFT;
+	int hishift = PyLong_SHIFT - loshift;
+	PyLongObject *z;
+	Py_ssize_t i;
+
+	assert(Py_SIZE(a) >= 0 && n >= 0);
+	if (newsize <= 0)
+		return _PyLong_New(0);
+	z = _PyLong_New(newsize);
+	if (z == NULL)
+		return NULL;
+	for (i = 0; i < newsize; i++) {
+		twodigits t = a->ob_digit[wordshift + i] >> loshift;
+		if (i + 1 < newsize)
+			t |= (twodigits)a->ob_digit[wordshift + i + 1]
+				<< hishift;
+		z->ob_digit[i] = (digit)(t & PyLong_MASK);
+	}
+	return long_normalize(z);
+}
+
+/* Replace *pa with *pa + b (if sign > 0) or *pa - b (if sign < 0), for
+   non-negative b.  Return -1 on error, 0 otherwise. */
+
+static int
+long_iadd(PyLongObject **pa, PyLongObject *b, int sign)
+{
+	PyLongObject *a = *pa, *z;
+
+	if (Py_SIZE(a) < 0) {
+		/* -|a| + b == -(|a| - b), -|a| - b == -(|a| + b) */
+		z = sign > 0 ? x_sub(a, b) : x_add(a, b);
+		if (z != NULL)
+			Py_SIZE(z) = -Py_SIZE(z);
+	}
+	else
+		z = sign > 0 ? x_add(a, b) : x_sub(a, b);
+	Py_DECREF(a);
+	*pa = z;
+	return z == NULL ? -1 : 0;
+}
+
+/* The cache of 10**(DECIMAL_DC_WIDTH << k), and of the reciprocals
+   2**(2*bits) // 10**(DECIMAL_DC_WIDTH << k), where bits is the bit length
+   of the power. */
+static PyLongObject *decimal_powers[DECIMAL_DC_LEVELS];
+static PyLongObject *decimal_inverses[DECIMAL_DC_LEVELS];
+static Py_ssize_t decimal_bits[DECIMAL_DC_LEVELS];
+
+/* Return a borrowed reference to 10**(DECIMAL_DC_WIDTH << k). */
+
+static PyLongObject *
+decimal_power(int k)
+{
+	PyLongObject *p, *z;
+	int i;
+
+	assert(k >= 0 && k < DECIMAL_DC_LEVELS);
+	if (decimal_powers[k] != NULL)
+		return decimal_powers[k];
+	if (k == 0) {
+		z = (PyLongObject *)PyLong_FromLong(1L);
+		for (i = 0; z != NULL && i < DECIMAL_DC_WIDTH; i += 4) {
+			p = mul1(z, 10000);
+			Py_DECREF(z);
+			z = p;
+		}
+	}
+	else {
+		p = decimal_power(k - 1);
+		if (p == NULL)
+			return NULL;
+		z = k_mul(p, p);
+	}
+	if (z == NULL)
+		return NULL;
+	decimal_bits[k] = _PyLong_NumBits((PyObject *)z);
+	decimal_powers[k] = z;
+	return z;
+}
+
+/* Return a borrowed reference to the reciprocal of decimal_power(k), as
+   described above.  The first one is found by long division; after that,
+   the square of the previous one is a good enough first guess for one
+   Newton step, and the result is then corrected to be exact. */
+
+static PyLongObject *
+decimal_inverse(int k)
+{
+	PyLongObject *p, *e, *r = NULL, *t = NULL, *u = NULL;
+	Py_ssize_t bits;
+
+	if (decimal_inverses[k] != NULL)
+		return decimal_inverses[k];
+	p = decimal_power(k);
+	if (p == NULL)
+		return NULL;
+	bits = decimal_bits[k];
+	e = long_pow2(2 * bits);
+	if (e == NULL)
+		return NULL;
+	if (k == 0) {
+		if (long_divrem(e, p, &r, &t) < 0)
+			goto Error;
+		Py_CLEAR(t);
+	}
+	else {
+		PyLongObject *g, *prev = decimal_inverse(k - 1);
+		if (prev == NULL)
+			goto Error;
+		/* g = prev**2 scaled to 2**(2*bits) / p */
+		t = k_mul(prev, prev);
+		if (t == NULL)
+			goto Error;
+		g = long_rshift_bits(t, 4 * decimal_bits[k - 1] - 2 * bits);
+		Py_CLEAR(t);
+		if (g == NULL)
+			goto Error;
+		/* r = 2*g - (p*g*g >> 2*bits) */
+		r = x_add(g, g);
+		t = k_mul(g, g);
+		Py_DECREF(g);
+		if (r == NULL || t == NULL)
+			goto Error;
+		u = k_mul(t, p);
+		Py_CLEAR(t);
+		if (u == NULL)
+			goto Error;
+		t = long_rshift_bits(u, 2 * bits);
+		Py_CLEAR(u);
+		if (t == NULL || long_iadd(&r, t, -1) < 0)
+			goto Error;
+		Py_CLEAR(t);
+		/* make r exact, keeping t = 2**(2*bits) - p*r */
+		u = k_mul(r, p);
+		if (u == NULL)
+			goto Error;
+		t = x_sub(e, u);
+		Py_CLEAR(u);
+		if (t == NULL)
+			goto Error;
+		u = (PyLongObject *)PyLong_FromLong(1L);
+		if (u == NULL)
+			goto Error;
+		while (Py_SIZE(t) < 0) {
+			if (long_iadd(&r, u, -1) < 0 ||
+			    long_iadd(&t, p, 1) < 0)
+				goto Error;
+		}
+		while (long_compare(t, p) >= 0) {
+			if (long_iadd(&r, u, 1) < 0 ||
+			    long_iadd(&t, p, -1) < 0)
+				goto Error;
+		}
+		Py_CLEAR(u);
+		Py_CLEAR(t);
+	}
+	Py_DECREF(e);
+	decimal_inverses[k] = r;
+	return r;
+
+  Error:
+	Py_DECREF(e);
+	Py_XDECREF(r);
+	Py_XDECREF(t);
+	Py_XDECREF(u);
+	return NULL;
+}
+
+/* Divide the non-negative long a by p, using Barrett reduction so that the
+   cost is that of two multiplications.  a must be less than p**2, p must
+   have bits bits, and inv must be 2**(2*bits) // p.  pdiv may be NULL.
+   Return -1 on error, 0 otherwise. */
+
+static int
+barrett_divmod(PyLongObject *a, PyLongObject *p, PyLongObject *inv,
+	       Py_ssize_t bits, PyLongObject **pdiv, PyLongObject **prem)
+{
+	PyLongObject *q, *r, *t, *one;
+
+	/* q = ((a >> (bits-1)) * inv) >> (bits+1) is at most 2 too small */
+	t = long_rshift_bits(a, bits - 1);
+	if (t == NULL)
+		return -1;
+	r = k_mul(t, inv);
+	Py_DECREF(t);
+	if (r == NULL)
+		return -1;
+	q = long_rshift_bits(r, bits + 1);
+	Py_DECREF(r);
+	if (q == NULL)
+		return -1;
+	t = k_mul(q, p);
+	if (t == NULL) {
+		Py_DECREF(q);
+		return -1;
+	}
+	r = x_sub(a, t);
+	Py_DECREF(t);
+	if (r == NULL) {
+		Py_DECREF(q);
+		return -1;
+	}
+	assert(Py_SIZE(r) >= 0);
+	if (long_compare(r, p) >= 0) {
+		one = (PyLongObject *)PyLong_FromLong(1L);
+		if (one == NULL)
+			goto Error;
+		do {
+			if (long_iadd(&q, one, 1) < 0 ||
+			    long_iadd(&r, p, -1) < 0) {
+				Py_DECREF(one);
+				goto Error;
+			}
+		} while (long_compare(r, p) >= 0);
+		Py_DECREF(one);
+	}
+	if (pdiv != NULL)
+		*pdiv = q;
+	else
+		Py_DECREF(q);
+	*prem = r;
+	return 0;
+
+  Error:
+	Py_XDECREF(q);
+	Py_XDECREF(r);
+	return -1;
+}
+
+/* Divide the non-negative long a, which must be less than the square of
+   decimal_power(k), by decimal_power(k).  Return -1 on error, 0
+   otherwise. */
+
+static int
+decimal_divmod(PyLongObject *a, int k, PyLongObject **pdiv, PyLongObject **prem)
+{
+	PyLongObject *inv = decimal_inverse(k);
+
+	if (inv == NULL)
+		return -1;
+	return barrett_divmod(a, decimal_powers[k], inv, decimal_bits[k],
+			      pdiv, prem);
+}
+
+/* Write the decimal digits of the non-negative long a, zero-padded on the
+   left to width characters, to p[0:width].  This takes quadratic time. */
+
+static int
+long_to_decimal_basecase(PyLongObject *a, char *p, Py_ssize_t width)
+{
+	Py_ssize_t size = Py_SIZE(a);
+	digit *pin = a->ob_digit;
+	PyLongObject *scratch;
+	char *q = p + width;
+
+	if (size > 0) {
+		scratch = _PyLong_New(size);
+		if (scratch == NULL)
+			return -1;
+		do {
+			int i;
+			digit rem = inplace_divrem1(scratch->ob_digit,
+						    pin, size, 10000);
+			pin = scratch->ob_digit;
+			if (pin[size - 1] == 0)
+				--size;
+			for (i = 0; i < 4 && (size || rem); i++) {
+				assert(q > p);
+				*--q = '0' + rem % 10;
+				rem /= 10;
+			}
+		} while (size != 0);
+		Py_DECREF(scratch);
+	}
+	memset(p, '0', q - p);
+	return 0;
+}
+
+/* Write the decimal digits of the non-negative long a, which must be less
+   than 10**(DECIMAL_DC_WIDTH << k), zero-padded on the left to
+   DECIMAL_DC_WIDTH << k characters, to p. */
+
+static int
+long_to_decimal_dc(PyLongObject *a, int k, char *p)
+{
+	PyLongObject *q, *r;
+	int status;
+
+	/* a PyLong digit is worth more than 4 decimal ones */
+	if (k == 0 || Py_SIZE(a) <= DECIMAL_DC_WIDTH / 4)
+		return long_to_decimal_basecase(a, p,
+						(Py_ssize_t)DECIMAL_DC_WIDTH << k);
+	if (decimal_divmod(a, k - 1, &q, &r) < 0)
+		return -1;
+	status = long_to_decimal_dc(q, k - 1, p);
+	if (status == 0)
+		status = long_to_decimal_dc(r, k - 1,
+				p + ((Py_ssize_t)DECIMAL_DC_WIDTH << (k - 1)));
+	Py_DECREF(q);
+	Py_DECREF(r);
+	return status;
+}
+
+/* Write the decimal digits of the long a, which has more than
+   DECIMAL_DC_WIDTH of them, to the end of the buffer p[0:size], and
+   return the number written, or -1 on error. */
+
+static Py_ssize_t
+long_to_decimal(PyLongObject *a, char *p, Py_ssize_t size)
+{
+	PyLongObject *abs_a;
+	Py_ssize_t width = DECIMAL_DC_WIDTH, n;
+	char *buf, *q;
+	int k = 0;
+
+	while (width < size) {
+		width <<= 1;
+		k++;
+	}
+	if (k >= DECIMAL_DC_LEVELS) {
+		PyErr_NoMemory();
+		return -1;
+	}
+	buf = PyMem_MALLOC(width);
+	if (buf == NULL) {
+		PyErr_NoMemory();
+		return -1;
+	}
+	abs_a = (PyLongObject *)_PyLong_Copy(a);
+	if (abs_a != NULL)
+		Py_SIZE(abs_a) = ABS(Py_SIZE(abs_a));
+	if (abs_a == NULL || long_to_decimal_dc(abs_a, k, buf) < 0) {
+		Py_XDECREF(abs_a);
+		PyMem_FREE(buf);
+		return -1;
+	}
+	Py_DECREF(abs_a);
+	for (q = buf; *q == '0' && q < buf + width - 1; q++)
+		;
+	n = buf + width - q;
+	assert(n <= size);
+	memcpy(p + size - n, q, n);
+	PyMem_FREE(buf);
+	return n;
+}
+
+/* Convert the string of n decimal digits at str to a long.  Strings of
+   more than DECIMAL_DC_WIDTH digits are split in two, with a power of 10
+   digits in the lower part. */
+
+static PyLongObject *
+long_from_decimal(char *str, Py_ssize_t n)
+{
+	PyLongObject *hi, *lo, *t, *z;
+	Py_ssize_t width = DECIMAL_DC_WIDTH;
+	int k = 0;
+
+	if (n <= DECIMAL_DC_WIDTH)
+		return long_from_non_binary_base(str, str + n, 10);
+	while (width < n - width) {
+		width <<= 1;
+		k++;
+	}
+	/* width is the largest DECIMAL_DC_WIDTH << k less than n */
+	if (decimal_power(k) == NULL)
+		return NULL;
+	hi = long_from_decimal(str, n - width);
+	if (hi == NULL)
+		return NULL;
+	lo = long_from_decimal(str + n - width, width);
+	if (lo == NULL) {
+		Py_DECREF(hi);
+		return NULL;
+	}
+	t = k_mul(hi, decimal_powers[k]);
+	Py_DECREF(hi);
+	if (t == NULL) {
+		Py_DECREF(lo);
+		return NULL;
+	}
+	z = x_add(t, lo);
+	Py_DECREF(t);
+	Py_DECREF(lo);
+	return z;
+}
+
 /* Convert the long to a string object with given base,
    appending a base prefix of 0[box] if base is 2, 8 or 16.
    Add a trailing "L" if addL is non-zero.
@@ -1245,6 +1682,15 @@ _PyLong_Format(PyObject *aa, int base, int addL, int newstyle)
 	if (a->ob_size == 0) {
 		*--p = '0';
 	}
+	else if (base == 10 && size_a > DECIMAL_DC_WIDTH / 4) {
+		Py_ssize_t n = long_to_decimal(a, PyString_AS_STRING(str),
+					p - PyString_AS_STRING(str));
+		if (n < 0) {
+			Py_DECREF(str);
+			return NULL;
+		}
+		p -= n;
+	}
 	else if ((base & (base - 1)) == 0) {
 		/* JRH: special case for power-of-2 bases */
 		twodigits accum = 0;
@@ -1456,62 +1902,12 @@ long_from_binary_base(char **str, int base)
 	return long_normalize(z);
 }
 
-PyObject *
-PyLong_FromString(char *str, char **pend, int base)
-{
-	int sign = 1;
-	char *start, *orig_str = str;
-	PyLongObject *z;
-	PyObject *strobj, *strrepr;
-	Py_ssize_t slen;
-
-	if ((base != 0 && base < 2) || base > 36) {
-		PyErr_SetString(PyExc_ValueError,
-				"long() arg 2 must be >= 2 and <= 36");
-		return NULL;
-	}
-	while (*str != '\0' && isspace(Py_CHARMASK(*str)))
-		str++;
-	if (*str == '+')
-		++str;
-	else if (*str == '-') {
-		++str;
-		sign = -1;
-	}
-	while (*str != '\0' && isspace(Py_CHARMASK(*str)))
-		str++;
-	if (base == 0) {
-		/* No base given.  Deduce the base from the contents
-		   of the string */
-		if (str[0] != '0')
-			base = 10;
-		else if (str[1] == 'x' || str[1] == 'X')
-			base = 16;
-		else if (str[1] == 'o' || str[1] == 'O')
-			base = 8;
-		else if (str[1] == 'b' || str[1] == 'B')
-			base = 2;
-		else
-			/* "old" (C-style) octal literal, still valid in
-			   2.x, although illegal in 3.x */
-			base = 8;
-	}
-	/* Whether or not we were deducing the base, skip leading chars
-	   as needed */
-	if (str[0] == '0' &&
-	    ((base == 16 && (str[1] == 'x' || str[1] == 'X')) ||
-	     (base == 8  && (str[1] == 'o' || str[1] == 'O')) ||
-	     (base == 2  && (str[1] == 'b' || str[1] == 'B'))))
-		str += 2;
-
-	start = str;
-	if ((base & (base - 1)) == 0)
-		z = long_from_binary_base(&str, base);
-	else {
 /***
 Binary bases can be converted in time linear in the number of digits, because
 Python's representation base is binary.  Other bases (including decimal!) use
 the simple quadratic-time algorithm below, complicated by some speed tricks.
+(Long decimal strings are first split up by long_from_decimal(), so that
+this only sees pieces of at most DECIMAL_DC_WIDTH digits.)
 
 First some math:  the largest integer that can be expressed in N base-B digits
 is B**N-1.  Consequently, if we have an N-digit input in base B, the worst-
@@ -1593,116 +1989,183 @@ that triggers it(!).  Instead the code was tested by artificially allocating
 just 1 digit at the start, so that the copying code was exercised for every
 digit beyond the first.
 ***/
-		register twodigits c;	/* current input character */
-		Py_ssize_t size_z;
-		int i;
-		int convwidth;
-		twodigits convmultmax, convmult;
-		digit *pz, *pzstop;
-		char* scan;
-
-		static double log_base_PyLong_BASE[37] = {0.0e0,};
-		static int convwidth_base[37] = {0,};
-		static twodigits convmultmax_base[37] = {0,};
-
-		if (log_base_PyLong_BASE[base] == 0.0) {
-			twodigits convmax = base;
-			int i = 1;
-
-			log_base_PyLong_BASE[base] = log((double)base) /
-						log((double)PyLong_BASE);
-			for (;;) {
-				twodigits next = convmax * base;
-				if (next > PyLong_BASE)
-					break;
-				convmax = next;
-				++i;
-			}
-			convmultmax_base[base] = convmax;
-			assert(i > 0);
-			convwidth_base[base] = i;
+
+/* Convert the base `base` digits in str[0:scan-str] to a normalized long.
+ * base is not a power of 2.
+ */
+static PyLongObject *
+long_from_non_binary_base(char *str, char *scan, int base)
+{
+	PyLongObject *z;
+	register twodigits c;	/* current input character */
+	Py_ssize_t size_z;
+	int i;
+	int convwidth;
+	twodigits convmultmax, convmult;
+	digit *pz, *pzstop;
+
+	static double log_base_PyLong_BASE[37] = {0.0e0,};
+	static int convwidth_base[37] = {0,};
+	static twodigits convmultmax_base[37] = {0,};
+
+	if (log_base_PyLong_BASE[base] == 0.0) {
+		twodigits convmax = base;
+		int i = 1;
+
+		log_base_PyLong_BASE[base] = log((double)base) /
+					log((double)PyLong_BASE);
+		for (;;) {
+			twodigits next = convmax * base;
+			if (next > PyLong_BASE)
+				break;
+			convmax = next;
+			++i;
 		}
+		convmultmax_base[base] = convmax;
+		assert(i > 0);
+		convwidth_base[base] = i;
+	}
 
-		/* Find length of the string of numeric characters. */
-		scan = str;
-		while (_PyLong_DigitValue[Py_CHARMASK(*scan)] < base)
-			++scan;
+	/* Create a long object that can contain the largest possible
+	 * integer with this base and length.  Note that there's no
+	 * need to initialize z->ob_digit -- no slot is read up before
+	 * being stored into.
+	 */
+	size_z = (Py_ssize_t)((scan - str) * log_base_PyLong_BASE[base]) + 1;
+	/* Uncomment next line to test exceedingly rare copy code */
+	/* size_z = 1; */
+	assert(size_z > 0);
+	z = _PyLong_New(size_z);
+	if (z == NULL)
+		return NULL;
+	Py_SIZE(z) = 0;
 
-		/* Create a long object that can contain the largest possible
-		 * integer with this base and length.  Note that there's no
-		 * need to initialize z->ob_digit -- no slot is read up before
-		 * being stored into.
-		 */
-		size_z = (Py_ssize_t)((scan - str) * log_base_PyLong_BASE[base]) + 1;
-		/* Uncomment next line to test exceedingly rare copy code */
-		/* size_z = 1; */
-		assert(size_z > 0);
-		z = _PyLong_New(size_z);
-		if (z == NULL)
-			return NULL;
-		Py_SIZE(z) = 0;
+	/* `convwidth` consecutive input digits are treated as a single
+	 * digit in base `convmultmax`.
+	 */
+	convwidth = convwidth_base[base];
+	convmultmax = convmultmax_base[base];
+
+	/* Work ;-) */
+	while (str < scan) {
+		/* grab up to convwidth digits from the input string */
+		c = (digit)_PyLong_DigitValue[Py_CHARMASK(*str++)];
+		for (i = 1; i < convwidth && str != scan; ++i, ++str) {
+			c = (twodigits)(c *  base +
+				_PyLong_DigitValue[Py_CHARMASK(*str)]);
+			assert(c < PyLong_BASE);
+		}
 
-		/* `convwidth` consecutive input digits are treated as a single
-		 * digit in base `convmultmax`.
+		convmult = convmultmax;
+		/* Calculate the shift only if we couldn't get
+		 * convwidth digits.
 		 */
-		convwidth = convwidth_base[base];
-		convmultmax = convmultmax_base[base];
-
-		/* Work ;-) */
-		while (str < scan) {
-			/* grab up to convwidth digits from the input string */
-			c = (digit)_PyLong_DigitValue[Py_CHARMASK(*str++)];
-			for (i = 1; i < convwidth && str != scan; ++i, ++str) {
-				c = (twodigits)(c *  base +
-					_PyLong_DigitValue[Py_CHARMASK(*str)]);
-				assert(c < PyLong_BASE);
-			}
-
-			convmult = convmultmax;
-			/* Calculate the shift only if we couldn't get
-			 * convwidth digits.
-			 */
-			if (i != convwidth) {
-				convmult = base;
-				for ( ; i > 1; --i)
-					convmult *= base;
-			}
+		if (i != convwidth) {
+			convmult = base;
+			for ( ; i > 1; --i)
+				convmult *= base;
+		}
 
-			/* Multiply z by convmult, and add c. */
-			pz = z->ob_digit;
-			pzstop = pz + Py_SIZE(z);
-			for (; pz < pzstop; ++pz) {
-				c += (twodigits)*pz * convmult;
-				*pz = (digit)(c & PyLong_MASK);
-				c >>= PyLong_SHIFT;
+		/* Multiply z by convmult, and add c. */
+		pz = z->ob_digit;
+		pzstop = pz + Py_SIZE(z);
+		for (; pz < pzstop; ++pz) {
+			c += (twodigits)*pz * convmult;
+			*pz = (digit)(c & PyLong_MASK);
+			c >>= PyLong_SHIFT;
+		}
+		/* carry off the current end? */
+		if (c) {
+			assert(c < PyLong_BASE);
+			if (Py_SIZE(z) < size_z) {
+				*pz = (digit)c;
+				++Py_SIZE(z);
 			}
-			/* carry off the current end? */
-			if (c) {
-				assert(c < PyLong_BASE);
-				if (Py_SIZE(z) < size_z) {
-					*pz = (digit)c;
-					++Py_SIZE(z);
-				}
-				else {
-					PyLongObject *tmp;
-					/* Extremely rare.  Get more space. */
-					assert(Py_SIZE(z) == size_z);
-					tmp = _PyLong_New(size_z + 1);
-					if (tmp == NULL) {
-						Py_DECREF(z);
-						return NULL;
-					}
-					memcpy(tmp->ob_digit,
-					       z->ob_digit,
-					       sizeof(digit) * size_z);
+			else {
+				PyLongObject *tmp;
+				/* Extremely rare.  Get more space. */
+				assert(Py_SIZE(z) == size_z);
+				tmp = _PyLong_New(size_z + 1);
+				if (tmp == NULL) {
 					Py_DECREF(z);
-					z = tmp;
-					z->ob_digit[size_z] = (digit)c;
-					++size_z;
+					return NULL;
 				}
+				memcpy(tmp->ob_digit,
+				       z->ob_digit,
+				       sizeof(digit) * size_z);
+				Py_DECREF(z);
+				z = tmp;
+				z->ob_digit[size_z] = (digit)c;
+				++size_z;
 			}
 		}
 	}
+	return z;
+}
+
+PyObject *
+PyLong_FromString(char *str, char **pend, int base)
+{
+	int sign = 1;
+	char *start, *orig_str = str;
+	PyLongObject *z;
+	PyObject *strobj, *strrepr;
+	Py_ssize_t slen;
+
+	if ((base != 0 && base < 2) || base > 36) {
+		PyErr_SetString(PyExc_ValueError,
+				"long() arg 2 must be >= 2 and <= 36");
+		return NULL;
+	}
+	while (*str != '\0' && isspace(Py_CHARMASK(*str)))
+		str++;
+	if (*str == '+')
+		++str;
+	else if (*str == '-') {
+		++str;
+		sign = -1;
+	}
+	while (*str != '\0' && isspace(Py_CHARMASK(*str)))
+		str++;
+	if (base == 0) {
+		/* No base given.  Deduce the base from the contents
+		   of the string */
+		if (str[0] != '0')
+			base = 10;
+		else if (str[1] == 'x' || str[1] == 'X')
+			base = 16;
+		else if (str[1] == 'o' || str[1] == 'O')
+			base = 8;
+		else if (str[1] == 'b' || str[1] == 'B')
+			base = 2;
+		else
+			/* "old" (C-style) octal literal, still valid in
+			   2.x, although illegal in 3.x */
+			base = 8;
+	}
+	/* Whether or not we were deducing the base, skip leading chars
+	   as needed */
+	if (str[0] == '0' &&
+	    ((base == 16 && (str[1] == 'x' || str[1] == 'X')) ||
+	     (base == 8  && (str[1] == 'o' || str[1] == 'O')) ||
+	     (base == 2  && (str[1] == 'b' || str[1] == 'B'))))
+		str += 2;
+
+	start = str;
+	if ((base & (base - 1)) == 0)
+		z = long_from_binary_base(&str, base);
+	else {
+		char *scan = str;
+
+		/* Find length of the string of numeric characters. */
+		while (_PyLong_DigitValue[Py_CHARMASK(*scan)] < base)
+			++scan;
+		if (base == 10)
+			z = long_from_decimal(str, scan - str);
+		else
+			z = long_from_non_binary_base(str, scan, base);
+		str = scan;
+	}
 	if (z == NULL)
 		return NULL;
 	if (str == start)
@@ -1760,8 +2223,6 @@ PyLong_FromUnicode(Py_UNICODE *u, Py_ssize_t length, int base)
 static PyLongObject *x_divrem
 	(PyLongObject *, PyLongObject *, PyLongObject **);
 static PyObject *long_long(PyObject *v);
-static int long_divrem(PyLongObject *, PyLongObject *,
-	PyLongObject **, PyLongObject **);
 
 /* Long division with remainder, top-level routine */
 
@@ -2263,6 +2724,465 @@ kmul_split(PyLongObject *n, Py_ssize_t size, PyLongObject **high, PyLongObject *
 }
 
 static PyLongObject *k_lopsided_mul(PyLongObject *a, PyLongObject *b);
+static PyLongObject *toom3_mul(PyLongObject *a, PyLongObject *b);
+#ifdef HAVE_LONG_LONG
+static PyLongObject *ntt_mul(PyLongObject *a, PyLongObject *b);
+#endif
+
+/* Return a / n for a digit n that is known to divide a exactly. */
+
+static PyLongObject *
+divexact1(PyLongObject *a, digit n)
+{
+	digit rem;
+	PyLongObject *z = divrem1(a, n, &rem);
+
+	assert(rem == 0);
+	if (z != NULL && Py_SIZE(a) < 0)
+		Py_SIZE(z) = -Py_SIZE(z);
+	return z;
+}
+
+/* Evaluate x2*t**2 + x1*t + x0 at t = 1, -1 and -2, for non-negative
+ * x0, x1 and x2.  Return -1 on error, 0 otherwise.
+ */
+static int
+toom3_eval(PyLongObject *x0, PyLongObject *x1, PyLongObject *x2,
+	   PyLongObject **v1, PyLongObject **vm1, PyLongObject **vm2)
+{
+	PyLongObject *p, *t, *u;
+
+	*v1 = *vm1 = *vm2 = NULL;
+	p = x_add(x0, x2);
+	if (p == NULL)
+		return -1;
+	*v1 = x_add(p, x1);
+	*vm1 = x_sub(p, x1);
+	Py_DECREF(p);
+	if (*v1 == NULL || *vm1 == NULL)
+		goto fail;
+	/* (x(-1) + x2) * 2 - x0 */
+	t = (PyLongObject *)long_add(*vm1, x2);
+	if (t == NULL)
+		goto fail;
+	u = (PyLongObject *)long_add(t, t);
+	Py_DECREF(t);
+	if (u == NULL)
+		goto fail;
+	*vm2 = (PyLongObject *)long_sub(u, x0);
+	Py_DECREF(u);
+	if (*vm2 == NULL)
+		goto fail;
+	return 0;
+
+ fail:
+	Py_CLEAR(*v1);
+	Py_CLEAR(*vm1);
+	return -1;
+}
+
+/* k_mul() of the signed values a and b, with the sign of the product. */
+
+static PyLongObject *
+toom3_signed_mul(PyLongObject *a, PyLongObject *b)
+{
+	PyLongObject *z = k_mul(a, b);
+
+	if (z != NULL && (Py_SIZE(a) < 0) != (Py_SIZE(b) < 0))
+		Py_SIZE(z) = -Py_SIZE(z);
+	return z;
+}
+
+/* Toom-Cook 3-way multiplication.  Ignores the input signs, and returns
+ * the absolute value of the product (or NULL if error).  Each operand is
+ * split into three pieces, as the coefficients of a quadratic; the two
+ * quadratics are evaluated at 0, 1, -1, -2 and infinity, the five values
+ * multiplied pairwise by recursive calls to k_mul(), and the coefficients
+ * of the product recovered by interpolation (using Bodrato's sequence of
+ * steps).  That's 5 multiplications of a third of the size, against
+ * Karatsuba's 3 of half the size.
+ */
+static PyLongObject *
+toom3_mul(PyLongObject *a, PyLongObject *b)
+{
+	const Py_ssize_t asize = ABS(Py_SIZE(a));
+	const Py_ssize_t bsize = ABS(Py_SIZE(b));
+	const Py_ssize_t shift = (MAX(asize, bsize) + 2) / 3;
+	PyLongObject *a0 = NULL, *a1 = NULL, *a2 = NULL;
+	PyLongObject *b0 = NULL, *b1 = NULL, *b2 = NULL;
+	PyLongObject *av1 = NULL, *avm1 = NULL, *avm2 = NULL;
+	PyLongObject *bv1 = NULL, *bvm1 = NULL, *bvm2 = NULL;
+	PyLongObject *r0 = NULL, *r1 = NULL, *r2 = NULL, *r3 = NULL;
+	PyLongObject *r4 = NULL, *rm1 = NULL, *rm2 = NULL;
+	PyLongObject *t, *u, *ret = NULL;
+	PyLongObject **coeff[5];
+	Py_ssize_t i;
+
+	/* Split and evaluate. */
+	if (kmul_split(a, shift, &t, &a0) < 0)
+		goto fail;
+	i = kmul_split(t, shift, &a2, &a1);
+	Py_DECREF(t);
+	if (i < 0 || toom3_eval(a0, a1, a2, &av1, &avm1, &avm2) < 0)
+		goto fail;
+	if (a == b) {
+		b0 = a0; Py_INCREF(b0);
+		b1 = a1; Py_INCREF(b1);
+		b2 = a2; Py_INCREF(b2);
+		bv1 = av1; Py_INCREF(bv1);
+		bvm1 = avm1; Py_INCREF(bvm1);
+		bvm2 = avm2; Py_INCREF(bvm2);
+	}
+	else {
+		if (kmul_split(b, shift, &t, &b0) < 0)
+			goto fail;
+		i = kmul_split(t, shift, &b2, &b1);
+		Py_DECREF(t);
+		if (i < 0 ||
+		    toom3_eval(b0, b1, b2, &bv1, &bvm1, &bvm2) < 0)
+			goto fail;
+	}
+
+	/* Multiply pointwise. */
+	if ((r0 = k_mul(a0, b0)) == NULL ||
+	    (r1 = k_mul(av1, bv1)) == NULL ||
+	    (rm1 = toom3_signed_mul(avm1, bvm1)) == NULL ||
+	    (rm2 = toom3_signed_mul(avm2, bvm2)) == NULL ||
+	    (r4 = k_mul(a2, b2)) == NULL)
+		goto fail;
+
+	/* Interpolate:
+	 * r3 = (r(-2) - r(1)) / 3
+	 * r1 = (r(1) - r(-1)) / 2
+	 * r2 = r(-1) - r(0)
+	 * r3 = (r2 - r3) / 2 + 2 * r(inf)
+	 * r2 = r2 + r1 - r(inf)
+	 * r1 = r1 - r3
+	 */
+	if ((t = (PyLongObject *)long_sub(rm2, r1)) == NULL)
+		goto fail;
+	r3 = divexact1(t, 3);
+	Py_DECREF(t);
+	if (r3 == NULL || (t = (PyLongObject *)long_sub(r1, rm1)) == NULL)
+		goto fail;
+	Py_DECREF(r1);
+	r1 = divexact1(t, 2);
+	Py_DECREF(t);
+	if (r1 == NULL ||
+	    (r2 = (PyLongObject *)long_sub(rm1, r0)) == NULL ||
+	    (t = (PyLongObject *)long_sub(r2, r3)) == NULL)
+		goto fail;
+	Py_DECREF(r3);
+	r3 = NULL;
+	u = divexact1(t, 2);
+	Py_DECREF(t);
+	if (u == NULL)
+		goto fail;
+	t = x_add(r4, r4);
+	if (t == NULL) {
+		Py_DECREF(u);
+		goto fail;
+	}
+	r3 = (PyLongObject *)long_add(u, t);
+	Py_DECREF(u);
+	Py_DECREF(t);
+	if (r3 == NULL || (t = (PyLongObject *)long_add(r2, r1)) == NULL)
+		goto fail;
+	Py_DECREF(r2);
+	r2 = (PyLongObject *)long_sub(t, r4);
+	Py_DECREF(t);
+	if (r2 == NULL || (t = (PyLongObject *)long_sub(r1, r3)) == NULL)
+		goto fail;
+	Py_DECREF(r1);
+	r1 = t;
+
+	/* Add the coefficients into place.  They are all non-negative, and
+	 * none can stick out past the end of the product.
+	 */
+	ret = _PyLong_New(asize + bsize);
+	if (ret == NULL)
+		goto fail;
+	memset(ret->ob_digit, 0, Py_SIZE(ret) * sizeof(digit));
+	coeff[0] = &r0;
+	coeff[1] = &r1;
+	coeff[2] = &r2;
+	coeff[3] = &r3;
+	coeff[4] = &r4;
+	for (i = 0; i < 5; i++) {
+		PyLongObject *r = *coeff[i];
+		assert(Py_SIZE(r) >= 0);
+		if (Py_SIZE(r) == 0)
+			continue;
+		assert(Py_SIZE(r) <= Py_SIZE(ret) - i * shift);
+		(void)v_iadd(ret->ob_digit + i * shift,
+			     Py_SIZE(ret) - i * shift,
+			     r->ob_digit, Py_SIZE(r));
+	}
+	ret = long_normalize(ret);
+
+ fail:
+	Py_XDECREF(a0);
+	Py_XDECREF(a1);
+	Py_XDECREF(a2);
+	Py_XDECREF(b0);
+	Py_XDECREF(b1);
+	Py_XDECREF(b2);
+	Py_XDECREF(av1);
+	Py_XDECREF(avm1);
+	Py_XDECREF(avm2);
+	Py_XDECREF(bv1);
+	Py_XDECREF(bvm1);
+	Py_XDECREF(bvm2);
+	Py_XDECREF(r0);
+	Py_XDECREF(r1);
+	Py_XDECREF(r2);
+	Py_XDECREF(r3);
+	Py_XDECREF(r4);
+	Py_XDECREF(rm1);
+	Py_XDECREF(rm2);
+	return ret;
+}
+
+#ifdef HAVE_LONG_LONG
+
+/* Number-theoretic transform multiplication.  The digit sequences of a
+ * and b are convolved modulo two primes of the form c*2**k + 1, by
+ * transforming both, multiplying pointwise and transforming back, and the
+ * two results are combined with the Chinese remainder theorem.  Each
+ * coefficient of the convolution is less than
+ * min(asize, bsize) * PyLong_BASE**2, which is below the product of the
+ * primes for any transform length up to 2**23; the carries are then
+ * propagated to give the digits of the product.
+ */
+#define NTT_P1 998244353UL	/* 119 * 2**23 + 1 */
+#define NTT_P2 469762049UL	/* 7 * 2**26 + 1 */
+#define NTT_ROOT 3UL		/* a primitive root of both */
+#define NTT_MAX_SIZE ((Py_ssize_t)1 << 23)
+
+typedef unsigned PY_LONG_LONG ntt_wide;
+
+/* A prime modulus, with what Barrett reduction by it needs. */
+typedef struct {
+	unsigned long p;
+	int bits;		/* bit length of p */
+	ntt_wide inv;		/* 2**(2*bits) // p */
+} ntt_modulus;
+
+static void
+ntt_modulus_init(ntt_modulus *mod, unsigned long p)
+{
+	mod->p = p;
+	for (mod->bits = 0; (p >> mod->bits) != 0; mod->bits++)
+		;
+	mod->inv = ((ntt_wide)1 << (2 * mod->bits)) / p;
+}
+
+/* a * b % p, for a, b < p. */
+static unsigned long
+ntt_mulmod(unsigned long a, unsigned long b, const ntt_modulus *mod)
+{
+	ntt_wide x = (ntt_wide)a * b;
+	ntt_wide q = ((x >> (mod->bits - 1)) * mod->inv) >> (mod->bits + 1);
+	unsigned long r = (unsigned long)(x - q * mod->p);
+
+	while (r >= mod->p)
+		r -= mod->p;
+	return r;
+}
+
+/* Return x + p if x, taken as signed, is negative, else x.  The values
+ * are all below 2**31, so this adds p back after a subtraction went below
+ * zero; it's done without a branch because the branch is unpredictable.
+ */
+#define NTT_FOLD(x, p) \
+	((x) + ((p) & (0UL - ((x) >> (8 * SIZEOF_LONG - 1)))))
+
+/* a * w % p, for a < 2**32, given wq = w * 2**32 // p (Shoup's trick). */
+static unsigned long
+ntt_mulmod_shoup(unsigned long a, unsigned long w, unsigned long wq,
+		 unsigned long p)
+{
+	ntt_wide q = ((ntt_wide)a * wq) >> 32;
+	unsigned long r = (unsigned long)((ntt_wide)a * w - q * p) - p;
+
+	return NTT_FOLD(r, p);
+}
+
+static unsigned long
+ntt_powmod(unsigned long b, unsigned long e, const ntt_modulus *mod)
+{
+	unsigned long r = 1;
+
+	while (e) {
+		if (e & 1)
+			r = ntt_mulmod(r, b, mod);
+		b = ntt_mulmod(b, b, mod);
+		e >>= 1;
+	}
+	return r;
+}
+
+/* Transform x[0:n] in place; n is a power of 2.  The roots of unity used
+ * by the stage that combines halves of length half are
+ * roots[half:2*half], and rootq[j] is roots[j] * 2**32 // p.
+ */
+static void
+ntt_transform(unsigned long *x, Py_ssize_t n, unsigned long p,
+	      unsigned long *roots, unsigned long *rootq)
+{
+	Py_ssize_t i, j, len, half;
+
+	/* bit-reversal permutation */
+	for (i = 1, j = 0; i < n; i++) {
+		Py_ssize_t bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j) {
+			unsigned long t = x[i];
+			x[i] = x[j];
+			x[j] = t;
+		}
+	}
+
+	for (len = 2; len <= n; len <<= 1) {
+		unsigned long *w = roots + (len >> 1);
+		unsigned long *wq = rootq + (len >> 1);
+		half = len >> 1;
+		for (i = 0; i < n; i += len) {
+			unsigned long *lo = x + i, *hi = x + i + half;
+			for (j = 0; j < half; j++) {
+				unsigned long u = lo[j];
+				unsigned long v = ntt_mulmod_shoup(hi[j],
+							w[j], wq[j], p);
+				unsigned long sum = u + v - p;
+				unsigned long diff = u - v;
+				lo[j] = NTT_FOLD(sum, p);
+				hi[j] = NTT_FOLD(diff, p);
+			}
+		}
+	}
+}
+
+/* Convolve the digits of a and b modulo p into c[0:n].  tmp must have
+ * room for n values, and roots for 2*n. */
+
+static void
+ntt_convolve(PyLongObject *a, PyLongObject *b, unsigned long *c,
+	     unsigned long *tmp, unsigned long *roots, Py_ssize_t n,
+	     const ntt_modulus *mod)
+{
+	const Py_ssize_t asize = ABS(Py_SIZE(a));
+	const Py_ssize_t bsize = ABS(Py_SIZE(b));
+	const unsigned long p = mod->p;
+	unsigned long *rootq = roots + n;
+	unsigned long w, ninv, t;
+	Py_ssize_t i, h;
+
+	/* The last stage uses the powers of a primitive n-th root of unity;
+	 * each stage before it uses every other power of the next one's. */
+	w = ntt_powmod(NTT_ROOT, (p - 1) / n, mod);
+	roots[n / 2] = 1;
+	for (i = n / 2 + 1; i < n; i++)
+		roots[i] = ntt_mulmod(roots[i - 1], w, mod);
+	for (h = n / 4; h >= 1; h >>= 1)
+		for (i = 0; i < h; i++)
+			roots[h + i] = roots[2 * h + 2 * i];
+	for (i = 1; i < n; i++)
+		rootq[i] = (unsigned long)(((ntt_wide)roots[i] << 32) / p);
+
+	for (i = 0; i < asize; i++)
+		c[i] = a->ob_digit[i];
+	for (; i < n; i++)
+		c[i] = 0;
+	ntt_transform(c, n, p, roots, rootq);
+	if (a == b) {
+		for (i = 0; i < n; i++)
+			c[i] = ntt_mulmod(c[i], c[i], mod);
+	}
+	else {
+		for (i = 0; i < bsize; i++)
+			tmp[i] = b->ob_digit[i];
+		for (; i < n; i++)
+			tmp[i] = 0;
+		ntt_transform(tmp, n, p, roots, rootq);
+		for (i = 0; i < n; i++)
+			c[i] = ntt_mulmod(c[i], tmp[i], mod);
+	}
+
+	/* The inverse transform is the forward one with the output in
+	 * reverse order (except for c[0]), divided by n. */
+	ntt_transform(c, n, p, roots, rootq);
+	for (i = 1; i < n - i; i++) {
+		t = c[i];
+		c[i] = c[n - i];
+		c[n - i] = t;
+	}
+	ninv = ntt_powmod((unsigned long)n, p - 2, mod);
+	t = (unsigned long)(((ntt_wide)ninv << 32) / p);
+	for (i = 0; i < n; i++)
+		c[i] = ntt_mulmod_shoup(c[i], ninv, t, p);
+}
+
+/* Multiply a and b with the NTT.  Ignores the input signs, and returns the
+ * absolute value of the product (or NULL if error).  asize + bsize must
+ * not exceed NTT_MAX_SIZE.
+ */
+static PyLongObject *
+ntt_mul(PyLongObject *a, PyLongObject *b)
+{
+	const Py_ssize_t asize = ABS(Py_SIZE(a));
+	const Py_ssize_t bsize = ABS(Py_SIZE(b));
+	Py_ssize_t n, i;
+	unsigned long *c1, *c2, *tmp, *roots, inv;
+	ntt_modulus mod1, mod2;
+	ntt_wide carry;
+	PyLongObject *ret;
+
+	assert(asize + bsize <= NTT_MAX_SIZE);
+	for (n = 1; n < asize + bsize; n <<= 1)
+		;
+	ret = _PyLong_New(asize + bsize);
+	if (ret == NULL)
+		return NULL;
+	c1 = PyMem_New(unsigned long, n);
+	c2 = PyMem_New(unsigned long, n);
+	tmp = PyMem_New(unsigned long, n);
+	roots = PyMem_New(unsigned long, 2 * n);
+	if (c1 == NULL || c2 == NULL || tmp == NULL || roots == NULL) {
+		PyMem_Free(c1);
+		PyMem_Free(c2);
+		PyMem_Free(tmp);
+		PyMem_Free(roots);
+		Py_DECREF(ret);
+		return (PyLongObject *)PyErr_NoMemory();
+	}
+
+	ntt_modulus_init(&mod1, NTT_P1);
+	ntt_modulus_init(&mod2, NTT_P2);
+	ntt_convolve(a, b, c1, tmp, roots, n, &mod1);
+	ntt_convolve(a, b, c2, tmp, roots, n, &mod2);
+
+	/* Combine: x = c1 + P1 * ((c2 - c1) / P1 mod P2), and carry. */
+	inv = ntt_powmod(NTT_P1 % NTT_P2, NTT_P2 - 2, &mod2);
+	carry = 0;
+	for (i = 0; i < asize + bsize; i++) {
+		unsigned long d = c1[i] % NTT_P2;
+		d = c2[i] >= d ? c2[i] - d : c2[i] + NTT_P2 - d;
+		carry += c1[i] + (ntt_wide)NTT_P1 * ntt_mulmod(d, inv, &mod2);
+		ret->ob_digit[i] = (digit)(carry & PyLong_MASK);
+		carry >>= PyLong_SHIFT;
+	}
+	assert(carry == 0);
+
+	PyMem_Free(c1);
+	PyMem_Free(c2);
+	PyMem_Free(tmp);
+	PyMem_Free(roots);
+	return long_normalize(ret);
+}
+
+#endif /* HAVE_LONG_LONG */
 
 /* Karatsuba multiplication.  Ignores the input signs, and returns the
  * absolute value of the product (or NULL if error).
@@ -2318,9 +3238,20 @@ k_mul(PyLongObject *a, PyLongObject *b)
 	 * b as a string of "big digits", each of width a->ob_size.  That
 	 * leads to a sequence of balanced calls to k_mul.
 	 */
+#ifdef HAVE_LONG_LONG
+	/* The transform doesn't care how lopsided the operands are, as
+	 * long as the product isn't too long for it.
+	 */
+	if (asize > NTT_CUTOFF && asize + bsize <= NTT_MAX_SIZE)
+		return ntt_mul(a, b);
+#endif
+
 	if (2 * asize <= bsize)
 		return k_lopsided_mul(a, b);
 
+	if (asize > TOOM3_CUTOFF)
+		return toom3_mul(a, b);
+
 	/* Split a & b into hi & lo pieces. */
 	shift = bsize >> 1;
 	if (kmul_split(a, shift, &ah, &al) < 0) goto fail;
@@ -2753,6 +3684,8 @@ long_pow(PyObject *v, PyObject *w, PyObject *x)
 	PyLongObject *z = NULL;  /* accumulated result */
 	Py_ssize_t i, j, k;             /* counters */
 	PyLongObject *temp = NULL;
+	PyLongObject *cinv = NULL;	/* for Barrett reduction mod c */
+	Py_ssize_t cbits = 0;
 
 	/* 5-ary values.  If the exponent is large enough, table is
 	 * precomputed so that table[i] == a**i % c for i in range(32).
@@ -2836,6 +3769,28 @@ long_pow(PyObject *v, PyObject *w, PyObject *x)
 			a = temp;
 			temp = NULL;
 		}
+
+		/* For a big modulus, one long division to find the reciprocal
+		   of c saves one per multiplication.  The base must be reduced
+		   too, so that every product is less than c**2. */
+		if (Py_SIZE(c) > BARRETT_CUTOFF && Py_SIZE(b) > 0) {
+			if (long_compare(a, c) >= 0) {
+				if (l_divmod(a, c, NULL, &temp) < 0)
+					goto Error;
+				Py_DECREF(a);
+				a = temp;
+				temp = NULL;
+			}
+			cbits = _PyLong_NumBits((PyObject *)c);
+			temp = long_pow2(2 * cbits);
+			if (temp == NULL)
+				goto Error;
+			i = long_divrem(temp, c, &cinv, &z);
+			Py_CLEAR(temp);
+			if (i < 0)
+				goto Error;
+			Py_CLEAR(z);
+		}
 	}
 
 	/* At this point a, b, and c are guaranteed non-negative UNLESS
@@ -2849,7 +3804,15 @@ long_pow(PyObject *v, PyObject *w, PyObject *x)
 	 * is NULL.
 	 */
 #define REDUCE(X)					\
-	if (c != NULL) {				\
+	if (cinv != NULL) {				\
+		if (barrett_divmod(X, c, cinv, cbits,	\
+				   NULL, &temp) < 0)	\
+			goto Error;			\
+		Py_XDECREF(X);				\
+		X = temp;				\
+		temp = NULL;				\
+	}						\
+	else if (c != NULL) {				\
 		if (l_divmod(X, c, NULL, &temp) < 0)	\
 			goto Error;			\
 		Py_XDECREF(X);				\
@@ -2927,6 +3890,7 @@ long_pow(PyObject *v, PyObject *w, PyObject *x)
 	Py_DECREF(a);
 	Py_DECREF(b);
 	Py_XDECREF(c);
+	Py_XDECREF(cinv);
 	Py_XDECREF(temp);
 	return (PyObject *)z;
 }
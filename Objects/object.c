@@ -2033,8 +2033,7 @@ static PyTypeObject PyNone_Type = {
 };
 
 PyObject _Py_NoneStruct = {
-  _PyObject_EXTRA_INIT
-  1, &PyNone_Type
+  PyObject_HEAD_INIT_IMMORTAL(&PyNone_Type)
 };
 
 /* NotImplemented is an object that can be used to signal that an
@@ -2064,8 +2063,7 @@ static PyTypeObject PyNotImplemented_Type = {
 };
 
 PyObject _Py_NotImplementedStruct = {
-	_PyObject_EXTRA_INIT
-	1, &PyNotImplemented_Type
+	PyObject_HEAD_INIT_IMMORTAL(&PyNotImplemented_Type)
 };
 
 void
@@ -2,6 +2,13 @@
 
 #ifdef WITH_PYMALLOC
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
 /* An object allocator for Python.
 
    Here is an introduction to the layers of the Python memory architecture,
@@ -167,9 +174,19 @@
  *
  * Therefore, allocating arenas with malloc is not optimal, because there is
  * some address space wastage, but this is the most portable way to request
- * memory from the system across various platforms.
+ * memory from the system across various platforms.  Where anonymous mmap()
+ * is available it is used instead (see ARENAS_USE_MMAP below):  arenas come
+ * back page aligned, and are really given back to the system when freed.
+ *
+ * Define PYMALLOC_ARENA_SIZE to change the arena size; it must be a
+ * multiple of POOL_SIZE.  Bigger arenas mean fewer trips to the system and
+ * make huge pages possible, at the price of arenas being harder to free.
  */
+#ifdef PYMALLOC_ARENA_SIZE
+#define ARENA_SIZE		PYMALLOC_ARENA_SIZE
+#else
 #define ARENA_SIZE		(256 << 10)	/* 256KB */
+#endif
 
 #ifdef WITH_MEMORY_LIMITS
 #define MAX_ARENAS		(SMALL_MEMORY_LIMIT / ARENA_SIZE)
@@ -182,6 +199,38 @@
 #define POOL_SIZE		SYSTEM_PAGE_SIZE	/* must be 2^N */
 #define POOL_SIZE_MASK		SYSTEM_PAGE_SIZE_MASK
 
+#if ARENA_SIZE % POOL_SIZE != 0
+#error "ARENA_SIZE must be a multiple of POOL_SIZE"
+#endif
+
+/* Upper bound on the number of pools in an arena. */
+#define MAX_POOLS_IN_ARENA	(ARENA_SIZE / POOL_SIZE)
+
+/*
+ * Arena backend.  With anonymous mmap() arenas can be released to the
+ * system piecemeal:  pools which stay free for a while are handed back with
+ * madvise(MADV_DONTNEED), see _PyObject_ReleaseFreePools().  That can't be
+ * done with malloc()'ed memory, which may share pages with other data.
+ *
+ * If the arenas are a multiple of the huge page size, they can also be
+ * aligned for, and backed by, transparent huge pages, which cuts TLB misses
+ * on big heaps.  That's off unless the PYTHONMALLOCHUGEPAGES environment
+ * variable is set, since it makes the memory of a mostly idle arena as
+ * expensive as that of a full one.
+ */
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_ANONYMOUS)
+#define ARENAS_USE_MMAP
+#ifdef MADV_DONTNEED
+#define PYMALLOC_RELEASE_POOLS
+#endif
+#ifndef HUGE_PAGE_SIZE
+#define HUGE_PAGE_SIZE		(2 * 1024 * 1024)
+#endif
+#if defined(MADV_HUGEPAGE) && ARENA_SIZE % HUGE_PAGE_SIZE == 0
+#define ARENAS_USE_HUGE_PAGES
+#endif
+#endif
+
 /*
  * -- End of tunable settings section --
  */
@@ -269,6 +318,16 @@ struct arena_object {
 	/* Singly-linked list of available pools. */
 	struct pool_header* freepools;
 
+#ifdef PYMALLOC_RELEASE_POOLS
+	/* Free pools whose memory was given back to the system.  They are
+	 * not on the freepools list, as their headers are gone; a bit is set
+	 * in `released` for each of them, indexed by its position in the
+	 * arena.  They still count in nfreepools.
+	 */
+	uint nreleased;
+	uchar released[(MAX_POOLS_IN_ARENA + 7) / 8];
+#endif
+
 	/* Whenever this arena_object is not associated with an allocated
 	 * arena, the nextarena member is used to link all unassociated
 	 * arena_objects in the singly-linked `unused_arena_objects` list.
@@ -292,6 +351,8 @@ struct arena_object {
 #define POOL_OVERHEAD		ROUNDUP(sizeof(struct pool_header))
 
 #define DUMMY_SIZE_IDX		0xffff	/* size class of newly cached pools */
+#define AGED_SIZE_IDX		0xfffe	/* size class of pools found free by
+					   the last _PyObject_ReleaseFreePools */
 
 /* Round pointer P down to the closest pool-aligned address <= P, as a poolp */
 #define POOL_ADDR(P) ((poolp)((uptr)(P) & ~(uptr)POOL_SIZE_MASK))
@@ -493,12 +554,146 @@ static struct arena_object* usable_arenas = NULL;
 /* Number of arenas allocated that haven't been free()'d. */
 static size_t narenas_currently_allocated = 0;
 
-#ifdef PYMALLOC_DEBUG
 /* Total number of times malloc() called to allocate an arena. */
 static size_t ntimes_arena_allocated = 0;
 /* High water mark (max value ever seen) for narenas_currently_allocated. */
 static size_t narenas_highwater = 0;
+
+#ifdef ARENAS_USE_HUGE_PAGES
+/* -1 until the first arena is allocated, then whether to use huge pages. */
+static int use_huge_pages = -1;
+#endif
+
+#ifdef ARENAS_USE_MMAP
+/* Arenas that fall empty are parked rather than unmapped at once, so that
+ * a program which keeps building and dropping a big structure doesn't take
+ * a page fault on every page of every arena each time round.  The list of
+ * them is threaded through the arenas themselves, most recently parked
+ * first.  At most MAX_PARKED_ARENAS are kept; an arena that falls empty
+ * while the list is full is unmapped right away.  Whenever an arena is
+ * taken or parked, those parked more than PARKED_ARENA_SECONDS ago are
+ * unmapped, so a program that stops allocating doesn't hang on to them
+ * for good.  _PyObject_ReleaseFreePools() also unmaps the ones which were
+ * already parked at its previous call.
+ */
+#define MAX_PARKED_ARENAS	4
+#define PARKED_ARENA_SECONDS	2
+
+struct parked_arena {
+	struct parked_arena *next;
+	time_t parked_at;
+	int aged;	/* parked at the last _PyObject_ReleaseFreePools() */
+};
+static struct parked_arena *parked_arenas = NULL;
+static size_t nparked_arenas = 0;
+
+/* Unmap the parked arenas which have been parked since before `now`
+ * - PARKED_ARENA_SECONDS, or (if `aged_too` is set) that are marked aged.
+ * Return the number of bytes given back.
+ */
+static size_t
+unmap_parked_arenas(time_t now, int aged_too)
+{
+	struct parked_arena **plink = &parked_arenas;
+	size_t released = 0;
+
+	while (*plink != NULL) {
+		struct parked_arena *parked = *plink;
+
+		if (now - parked->parked_at <= PARKED_ARENA_SECONDS &&
+		    !(aged_too && parked->aged)) {
+			plink = &parked->next;
+			continue;
+		}
+		*plink = parked->next;
+		munmap((void *)parked, ARENA_SIZE);
+		--nparked_arenas;
+		released += ARENA_SIZE;
+	}
+	return released;
+}
+#endif
+
+/* Get the memory for an arena from the system; return 0 on failure. */
+static uptr
+arena_map(void)
+{
+#ifdef ARENAS_USE_MMAP
+	void *address;
+
+	if (parked_arenas != NULL) {
+		struct parked_arena *parked;
+
+		(void)unmap_parked_arenas(time(NULL), 0);
+		parked = parked_arenas;
+		if (parked != NULL) {
+			parked_arenas = parked->next;
+			--nparked_arenas;
+			return (uptr)parked;
+		}
+	}
+#ifdef ARENAS_USE_HUGE_PAGES
+	if (use_huge_pages < 0) {
+		char *opt = Py_GETENV("PYTHONMALLOCHUGEPAGES");
+		use_huge_pages = opt != NULL && *opt != '\0';
+	}
+	if (use_huge_pages) {
+		/* Map a huge page more than needed, and trim the ends so
+		 * that the arena starts on a huge page boundary.
+		 */
+		uptr start, aligned;
+		const size_t slack = HUGE_PAGE_SIZE;
+
+		address = mmap(NULL, ARENA_SIZE + slack,
+			       PROT_READ | PROT_WRITE,
+			       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (address == MAP_FAILED)
+			return 0;
+		start = (uptr)address;
+		aligned = (start + slack - 1) & ~(uptr)(slack - 1);
+		if (aligned > start)
+			munmap(address, aligned - start);
+		if (start + slack > aligned)
+			munmap((void *)(aligned + ARENA_SIZE),
+			       start + slack - aligned);
+		(void)madvise((void *)aligned, ARENA_SIZE, MADV_HUGEPAGE);
+		return aligned;
+	}
+#endif
+	address = mmap(NULL, ARENA_SIZE, PROT_READ | PROT_WRITE,
+		       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (address == MAP_FAILED)
+		return 0;
+	return (uptr)address;
+#else
+	return (uptr)malloc(ARENA_SIZE);
+#endif
+}
+
+/* Park an empty arena for reuse, or give its memory back to the system
+ * if there's no room for it among the parked arenas.
+ */
+static void
+arena_park(uptr address)
+{
+#ifdef ARENAS_USE_MMAP
+	struct parked_arena *parked = (struct parked_arena *)address;
+	time_t now = time(NULL);
+
+	(void)unmap_parked_arenas(now, 0);
+	if (nparked_arenas >= MAX_PARKED_ARENAS) {
+		munmap((void *)address, ARENA_SIZE);
+		return;
+	}
+	parked->next = parked_arenas;
+	parked->parked_at = now;
+	parked->aged = 0;
+	parked_arenas = parked;
+	++nparked_arenas;
+#else
+	free((void *)address);
 #endif
+}
 
 /* Allocate a new arena.  If we run out of memory, return NULL.  Else
  * allocate a new arena, and return the address of an arena_object
@@ -562,7 +757,7 @@ new_arena(void)
 	arenaobj = unused_arena_objects;
 	unused_arena_objects = arenaobj->nextarena;
 	assert(arenaobj->address == 0);
-	arenaobj->address = (uptr)malloc(ARENA_SIZE);
+	arenaobj->address = arena_map();
 	if (arenaobj->address == 0) {
 		/* The allocation failed: return NULL after putting the
 		 * arenaobj back.
@@ -573,12 +768,14 @@ new_arena(void)
 	}
 
 	++narenas_currently_allocated;
-#ifdef PYMALLOC_DEBUG
 	++ntimes_arena_allocated;
 	if (narenas_currently_allocated > narenas_highwater)
 		narenas_highwater = narenas_currently_allocated;
-#endif
 	arenaobj->freepools = NULL;
+#ifdef PYMALLOC_RELEASE_POOLS
+	arenaobj->nreleased = 0;
+	memset(arenaobj->released, 0, sizeof(arenaobj->released));
+#endif
 	/* pool_address <- first pool-aligned address in the arena
 	   nfreepools <- number of whole pools that fit after alignment */
 	arenaobj->pool_address = (block*)arenaobj->address;
@@ -594,6 +791,129 @@ new_arena(void)
 	return arenaobj;
 }
 
+#ifdef PYMALLOC_RELEASE_POOLS
+#define ARENA_NRELEASED(AO)	((AO)->nreleased)
+
+/* Index of pool P within the arena described by AO. */
+#define POOL_INDEX(AO, P) \
+	((uint)(((uptr)(P) - (((AO)->address + POOL_SIZE_MASK) & \
+			      ~(uptr)POOL_SIZE_MASK)) / POOL_SIZE))
+
+/* Take back one of the arena's released pools, and return it with a header
+ * fit for the freepools list.  Writing the header faults a fresh, zeroed
+ * page in.
+ */
+static poolp
+reuse_released_pool(struct arena_object *ao)
+{
+	uint i = 0, bit = 0;
+	poolp pool;
+
+	assert(ao->nreleased > 0);
+	while (ao->released[i] == 0)
+		++i;
+	while (!(ao->released[i] & (1 << bit)))
+		++bit;
+	ao->released[i] &= ~(1 << bit);
+	--ao->nreleased;
+
+	pool = (poolp)(((ao->address + POOL_SIZE_MASK) &
+			~(uptr)POOL_SIZE_MASK) + (i * 8 + bit) * POOL_SIZE);
+	assert(POOL_INDEX(ao, pool) == i * 8 + bit);
+	pool->arenaindex = ao - arenas;
+	pool->szidx = DUMMY_SIZE_IDX;
+	pool->nextpool = NULL;
+	return pool;
+}
+
+/* -1 until checked, then whether pools are made of whole system pages. */
+static int pools_are_pages = -1;
+#else
+#define ARENA_NRELEASED(AO)	0
+#endif
+
+/* Give the memory of long-empty pools back to the system, and return the
+ * number of bytes released.  A pool is released when it was already free
+ * at the previous call, so calling this periodically only trims pools
+ * that aren't needed any more; gc calls it after each full collection.
+ * Parked empty arenas are unmapped the same way.  This is a no-op unless
+ * arenas are mmap()'ed.
+ */
+size_t
+_PyObject_ReleaseFreePools(void)
+{
+	size_t released = 0;
+#ifdef PYMALLOC_RELEASE_POOLS
+	uint i;
+#endif
+
+#ifdef ARENAS_USE_MMAP
+	struct parked_arena *parked;
+
+	LOCK();
+	released += unmap_parked_arenas(time(NULL), 1);
+	/* Give the newly parked ones until the next call. */
+	for (parked = parked_arenas; parked != NULL; parked = parked->next)
+		parked->aged = 1;
+	UNLOCK();
+#endif
+#ifdef PYMALLOC_RELEASE_POOLS
+
+	if (pools_are_pages < 0) {
+#if defined(HAVE_SYSCONF) && defined(_SC_PAGESIZE)
+		pools_are_pages = sysconf(_SC_PAGESIZE) == POOL_SIZE;
+#else
+		pools_are_pages = 0;
+#endif
+	}
+	/* Releasing a pool would split the huge page holding it. */
+	if (!pools_are_pages
+#ifdef ARENAS_USE_HUGE_PAGES
+	    || use_huge_pages > 0
+#endif
+	    )
+		return 0;
+
+	LOCK();
+	for (i = 0; i < maxarenas; ++i) {
+		struct arena_object *ao = &arenas[i];
+		poolp *link;
+
+		if (ao->address == 0)
+			continue;
+		link = &ao->freepools;
+		while (*link != NULL) {
+			poolp pool = *link;
+			uint index;
+
+			if (pool->szidx != AGED_SIZE_IDX) {
+				/* Newly free:  give it until the next call. */
+				pool->szidx = AGED_SIZE_IDX;
+				link = &pool->nextpool;
+				continue;
+			}
+			*link = pool->nextpool;
+			if (madvise((void *)pool, POOL_SIZE, MADV_DONTNEED)) {
+				/* Leave it alone, and stop trying. */
+				pool->nextpool = *link;
+				*link = pool;
+				UNLOCK();
+				return released;
+			}
+			index = POOL_INDEX(ao, pool);
+			assert(index < ao->ntotalpools);
+			assert(!(ao->released[index >> 3] &
+				 (1 << (index & 7))));
+			ao->released[index >> 3] |= 1 << (index & 7);
+			++ao->nreleased;
+			released += POOL_SIZE;
+		}
+	}
+	UNLOCK();
+#endif
+	return released;
+}
+
 /*
 Py_ADDRESS_IN_RANGE(P, POOL)
 
@@ -803,6 +1123,11 @@ PyObject_Malloc(size_t nbytes)
 
 		/* Try to get a cached free pool. */
 		pool = usable_arenas->freepools;
+#ifdef PYMALLOC_RELEASE_POOLS
+		if (pool == NULL && usable_arenas->nreleased != 0)
+			pool = usable_arenas->freepools =
+				reuse_released_pool(usable_arenas);
+#endif
 		if (pool != NULL) {
 			/* Unlink from cached pools. */
 			usable_arenas->freepools = pool->nextpool;
@@ -837,7 +1162,8 @@ PyObject_Malloc(size_t nbytes)
 				assert(usable_arenas->freepools != NULL ||
 				       usable_arenas->pool_address <=
 				           (block*)usable_arenas->address +
-				               ARENA_SIZE - POOL_SIZE);
+				               ARENA_SIZE - POOL_SIZE ||
+				       ARENA_NRELEASED(usable_arenas) != 0);
 			}
 		init_pool:
 			/* Frontlink to used pools. */
@@ -1016,7 +1342,7 @@ PyObject_Free(void *p)
 				unused_arena_objects = ao;
 
 				/* Free the entire arena. */
-				free((void *)ao->address);
+				arena_park(ao->address);
 				ao->address = 0;	/* mark unassociated */
 				--narenas_currently_allocated;
 
@@ -1199,6 +1525,191 @@ PyObject_Realloc(void *p, size_t nbytes)
    	return bp ? bp : p;
 }
 
+/*==========================================================================*/
+/* Allocator statistics.  Nothing here is maintained on the allocation fast
+ * paths:  a census walks every arena on demand, so asking for statistics
+ * costs time proportional to the number of pools, and nothing otherwise.
+ */
+
+#if NB_SMALL_SIZE_CLASSES > PyMalloc_MAX_SIZE_CLASSES
+#error "PyMallocStats can't describe every size class"
+#endif
+
+#ifdef Py_DEBUG
+/* Is target in the list?  The list is traversed via the nextpool pointers.
+ * The list may be NULL-terminated, or circular.  Return 1 if target is in
+ * list, else 0.
+ */
+static int
+pool_is_in_list(const poolp target, poolp list)
+{
+	poolp origlist = list;
+	assert(target != NULL);
+	if (list == NULL)
+		return 0;
+	do {
+		if (target == list)
+			return 1;
+		list = list->nextpool;
+	} while (list != NULL && list != origlist);
+	return 0;
+}
+
+#else
+#define pool_is_in_list(X, Y) 1
+
+#endif	/* Py_DEBUG */
+
+struct malloc_census {
+	/* # of pools, allocated blocks, and free blocks per class index */
+	size_t numpools[NB_SMALL_SIZE_CLASSES];
+	size_t numblocks[NB_SMALL_SIZE_CLASSES];
+	size_t numfreeblocks[NB_SMALL_SIZE_CLASSES];
+	/* total # of allocated bytes in used and full pools */
+	size_t allocated_bytes;
+	/* total # of available bytes in used pools */
+	size_t available_bytes;
+	/* # of free pools + pools not yet carved out of current arena */
+	size_t numfreepools;
+	/* # of free pools whose memory was given back to the system */
+	size_t numreleasedpools;
+	/* # of bytes for arena alignment padding */
+	size_t arena_alignment;
+	/* # of bytes in used and full pools used for pool_headers */
+	size_t pool_header_bytes;
+	/* # of bytes in used and full pools wasted due to quantization,
+	 * i.e. the necessarily leftover space at the ends of used and
+	 * full pools.
+	 */
+	size_t quantization;
+	/* # of arenas actually allocated. */
+	size_t narenas;
+};
+
+static void
+take_census(struct malloc_census *c)
+{
+	uint i;
+
+	memset(c, 0, sizeof(*c));
+
+	/* Because full pools aren't linked to from anything, it's easiest
+	 * to march over all the arenas.  If we're lucky, most of the memory
+	 * will be living in full pools -- would be a shame to miss them.
+	 */
+	for (i = 0; i < maxarenas; ++i) {
+		uint j;
+		uptr base = arenas[i].address;
+
+		/* Skip arenas which are not allocated. */
+		if (arenas[i].address == (uptr)NULL)
+			continue;
+		c->narenas += 1;
+
+		c->numfreepools += arenas[i].nfreepools;
+		c->numreleasedpools += ARENA_NRELEASED(&arenas[i]);
+
+		/* round up to pool alignment */
+		if (base & (uptr)POOL_SIZE_MASK) {
+			c->arena_alignment += POOL_SIZE;
+			base &= ~(uptr)POOL_SIZE_MASK;
+			base += POOL_SIZE;
+		}
+
+		/* visit every pool in the arena */
+		assert(base <= (uptr) arenas[i].pool_address);
+		for (j = 0;
+			    base < (uptr) arenas[i].pool_address;
+			    ++j, base += POOL_SIZE) {
+			poolp p = (poolp)base;
+			uint sz;
+			uint freeblocks;
+
+#ifdef PYMALLOC_RELEASE_POOLS
+			/* Released pools aren't on any list:  skip them
+			 * without touching their memory.
+			 */
+			if (arenas[i].released[j >> 3] & (1 << (j & 7)))
+				continue;
+#endif
+			sz = p->szidx;
+			if (p->ref.count == 0) {
+				/* currently unused */
+				assert(pool_is_in_list(p, arenas[i].freepools));
+				continue;
+			}
+			++c->numpools[sz];
+			c->numblocks[sz] += p->ref.count;
+			freeblocks = NUMBLOCKS(sz) - p->ref.count;
+			c->numfreeblocks[sz] += freeblocks;
+#ifdef Py_DEBUG
+			if (freeblocks > 0)
+				assert(pool_is_in_list(p, usedpools[sz + sz]));
+#endif
+		}
+	}
+	assert(c->narenas == narenas_currently_allocated);
+
+	for (i = 0; i < NB_SMALL_SIZE_CLASSES; ++i) {
+		const size_t p = c->numpools[i];
+		const uint size = INDEX2SIZE(i);
+		if (p == 0) {
+			assert(c->numblocks[i] == 0 && c->numfreeblocks[i] == 0);
+			continue;
+		}
+		c->allocated_bytes += c->numblocks[i] * size;
+		c->available_bytes += c->numfreeblocks[i] * size;
+		c->pool_header_bytes += p * POOL_OVERHEAD;
+		c->quantization += p * ((POOL_SIZE - POOL_OVERHEAD) % size);
+	}
+}
+
+/* Fill *st with a snapshot of pymalloc's structures; this is the
+ * release-build counterpart of _PyObject_DebugMallocStats().  No Python
+ * objects are involved (pgen links this file too), so callers can build
+ * whatever report they like without perturbing the numbers.
+ */
+void
+_PyObject_GetMallocStats(PyMallocStats *st)
+{
+	struct malloc_census c;
+	uint i;
+
+	take_census(&c);
+
+	st->small_request_threshold = SMALL_REQUEST_THRESHOLD;
+	st->pool_size = POOL_SIZE;
+	st->arena_size = ARENA_SIZE;
+	st->arenas_allocated_total = ntimes_arena_allocated;
+	st->arenas_reclaimed = ntimes_arena_allocated - c.narenas;
+	st->arenas_highwater = narenas_highwater;
+	st->arenas_allocated_current = c.narenas;
+#ifdef ARENAS_USE_MMAP
+	st->parked_arenas = nparked_arenas;
+#else
+	st->parked_arenas = 0;
+#endif
+	st->free_pools = c.numfreepools;
+	st->released_pools = c.numreleasedpools;
+	st->allocated_bytes = c.allocated_bytes;
+	st->available_bytes = c.available_bytes;
+	st->pool_header_bytes = c.pool_header_bytes;
+	st->quantization_bytes = c.quantization;
+	st->arena_alignment_bytes = c.arena_alignment;
+
+	st->nsizeclasses = 0;
+	for (i = 0; i < NB_SMALL_SIZE_CLASSES; ++i) {
+		PyMallocSizeClassStats *sc;
+		if (c.numpools[i] == 0)
+			continue;
+		sc = &st->sizeclasses[st->nsizeclasses++];
+		sc->block_size = INDEX2SIZE(i);
+		sc->pools = c.numpools[i];
+		sc->blocks_in_use = c.numblocks[i];
+		sc->blocks_available = c.numfreeblocks[i];
+	}
+}
+
 #else	/* ! WITH_PYMALLOC */
 
 /*==========================================================================*/
@@ -1282,31 +1793,6 @@ write_size_t(void *p, size_t n)
 	}
 }
 
-#ifdef Py_DEBUG
-/* Is target in the list?  The list is traversed via the nextpool pointers.
- * The list may be NULL-terminated, or circular.  Return 1 if target is in
- * list, else 0.
- */
-static int
-pool_is_in_list(const poolp target, poolp list)
-{
-	poolp origlist = list;
-	assert(target != NULL);
-	if (list == NULL)
-		return 0;
-	do {
-		if (target == list)
-			return 1;
-		list = list->nextpool;
-	} while (list != NULL && list != origlist);
-	return 0;
-}
-
-#else
-#define pool_is_in_list(X, Y) 1
-
-#endif	/* Py_DEBUG */
-
 /* Let S = sizeof(size_t).  The debug malloc asks for 4*S extra bytes and
    fills them with useful stuff, here calling the underlying malloc's result p:
 
@@ -1616,27 +2102,7 @@ _PyObject_DebugMallocStats(void)
 {
 	uint i;
 	const uint numclasses = SMALL_REQUEST_THRESHOLD >> ALIGNMENT_SHIFT;
-	/* # of pools, allocated blocks, and free blocks per class index */
-	size_t numpools[SMALL_REQUEST_THRESHOLD >> ALIGNMENT_SHIFT];
-	size_t numblocks[SMALL_REQUEST_THRESHOLD >> ALIGNMENT_SHIFT];
-	size_t numfreeblocks[SMALL_REQUEST_THRESHOLD >> ALIGNMENT_SHIFT];
-	/* total # of allocated bytes in used and full pools */
-	size_t allocated_bytes = 0;
-	/* total # of available bytes in used pools */
-	size_t available_bytes = 0;
-	/* # of free pools + pools not yet carved out of current arena */
-	uint numfreepools = 0;
-	/* # of bytes for arena alignment padding */
-	size_t arena_alignment = 0;
-	/* # of bytes in used and full pools used for pool_headers */
-	size_t pool_header_bytes = 0;
-	/* # of bytes in used and full pools wasted due to quantization,
-	 * i.e. the necessarily leftover space at the ends of used and
-	 * full pools.
-	 */
-	size_t quantization = 0;
-	/* # of arenas actually allocated. */
-	size_t narenas = 0;
+	struct malloc_census c;
 	/* running total -- should equal narenas * ARENA_SIZE */
 	size_t total;
 	char buf[128];
@@ -1644,58 +2110,7 @@ _PyObject_DebugMallocStats(void)
 	fprintf(stderr, "Small block threshold = %d, in %u size classes.\n",
 		SMALL_REQUEST_THRESHOLD, numclasses);
 
-	for (i = 0; i < numclasses; ++i)
-		numpools[i] = numblocks[i] = numfreeblocks[i] = 0;
-
-	/* Because full pools aren't linked to from anything, it's easiest
-	 * to march over all the arenas.  If we're lucky, most of the memory
-	 * will be living in full pools -- would be a shame to miss them.
-	 */
-	for (i = 0; i < maxarenas; ++i) {
-		uint poolsinarena;
-		uint j;
-		uptr base = arenas[i].address;
-
-		/* Skip arenas which are not allocated. */
-		if (arenas[i].address == (uptr)NULL)
-			continue;
-		narenas += 1;
-
-		poolsinarena = arenas[i].ntotalpools;
-		numfreepools += arenas[i].nfreepools;
-
-		/* round up to pool alignment */
-		if (base & (uptr)POOL_SIZE_MASK) {
-			arena_alignment += POOL_SIZE;
-			base &= ~(uptr)POOL_SIZE_MASK;
-			base += POOL_SIZE;
-		}
-
-		/* visit every pool in the arena */
-		assert(base <= (uptr) arenas[i].pool_address);
-		for (j = 0;
-			    base < (uptr) arenas[i].pool_address;
-			    ++j, base += POOL_SIZE) {
-			poolp p = (poolp)base;
-			const uint sz = p->szidx;
-			uint freeblocks;
-
-			if (p->ref.count == 0) {
-				/* currently unused */
-				assert(pool_is_in_list(p, arenas[i].freepools));
-				continue;
-			}
-			++numpools[sz];
-			numblocks[sz] += p->ref.count;
-			freeblocks = NUMBLOCKS(sz) - p->ref.count;
-			numfreeblocks[sz] += freeblocks;
-#ifdef Py_DEBUG
-			if (freeblocks > 0)
-				assert(pool_is_in_list(p, usedpools[sz + sz]));
-#endif
-		}
-	}
-	assert(narenas == narenas_currently_allocated);
+	take_census(&c);
 
 	fputc('\n', stderr);
 	fputs("class   size   num pools   blocks in use  avail blocks\n"
@@ -1703,49 +2118,44 @@ _PyObject_DebugMallocStats(void)
 		stderr);
 
 	for (i = 0; i < numclasses; ++i) {
-		size_t p = numpools[i];
-		size_t b = numblocks[i];
-		size_t f = numfreeblocks[i];
+		size_t p = c.numpools[i];
+		size_t b = c.numblocks[i];
+		size_t f = c.numfreeblocks[i];
 		uint size = INDEX2SIZE(i);
-		if (p == 0) {
-			assert(b == 0 && f == 0);
+		if (p == 0)
 			continue;
-		}
 		fprintf(stderr, "%5u %6u "
 				"%11" PY_FORMAT_SIZE_T "u "
 				"%15" PY_FORMAT_SIZE_T "u "
 				"%13" PY_FORMAT_SIZE_T "u\n",
 			i, size, p, b, f);
-		allocated_bytes += b * size;
-		available_bytes += f * size;
-		pool_header_bytes += p * POOL_OVERHEAD;
-		quantization += p * ((POOL_SIZE - POOL_OVERHEAD) % size);
 	}
 	fputc('\n', stderr);
 	(void)printone("# times object malloc called", serialno);
 
 	(void)printone("# arenas allocated total", ntimes_arena_allocated);
-	(void)printone("# arenas reclaimed", ntimes_arena_allocated - narenas);
+	(void)printone("# arenas reclaimed", ntimes_arena_allocated - c.narenas);
 	(void)printone("# arenas highwater mark", narenas_highwater);
-	(void)printone("# arenas allocated current", narenas);
+	(void)printone("# arenas allocated current", c.narenas);
 
 	PyOS_snprintf(buf, sizeof(buf),
 		"%" PY_FORMAT_SIZE_T "u arenas * %d bytes/arena",
-		narenas, ARENA_SIZE);
-	(void)printone(buf, narenas * ARENA_SIZE);
+		c.narenas, ARENA_SIZE);
+	(void)printone(buf, c.narenas * ARENA_SIZE);
 
 	fputc('\n', stderr);
 
-	total = printone("# bytes in allocated blocks", allocated_bytes);
-	total += printone("# bytes in available blocks", available_bytes);
+	total = printone("# bytes in allocated blocks", c.allocated_bytes);
+	total += printone("# bytes in available blocks", c.available_bytes);
 
 	PyOS_snprintf(buf, sizeof(buf),
-		"%u unused pools * %d bytes", numfreepools, POOL_SIZE);
-	total += printone(buf, (size_t)numfreepools * POOL_SIZE);
+		"%" PY_FORMAT_SIZE_T "u unused pools * %d bytes",
+		c.numfreepools, POOL_SIZE);
+	total += printone(buf, c.numfreepools * POOL_SIZE);
 
-	total += printone("# bytes lost to pool headers", pool_header_bytes);
-	total += printone("# bytes lost to quantization", quantization);
-	total += printone("# bytes lost to arena alignment", arena_alignment);
+	total += printone("# bytes lost to pool headers", c.pool_header_bytes);
+	total += printone("# bytes lost to quantization", c.quantization);
+	total += printone("# bytes lost to arena alignment", c.arena_alignment);
 	(void)printone("Total", total);
 }
 
@@ -38,9 +38,112 @@ _PySet_Dummy(void)
 }
 #endif
 
+/* Control bytes.  An Active slot's is a tag made from the top 7 bits of
+   its hash times a large odd constant, so that it depends on all of the
+   hash (int keys' hashes differ mostly in their low bits, which also pick
+   the group).  Unused and Dummy slots' have the top bit set, so they
+   never equal a tag.
+*/
+#define CTRL_UNUSED	((unsigned char)0x80)
+#define CTRL_DUMMY	((unsigned char)0xFE)
+
+#if SIZEOF_LONG > 4
+#define TAG_MULTIPLIER 0x9E3779B97F4A7C15UL
+#else
+#define TAG_MULTIPLIER 0x9E3779B9UL
+#endif
+#define CTRL_TAG(hash) ((unsigned char)(((unsigned long)(hash) * \
+	TAG_MULTIPLIER) >> (8 * SIZEOF_LONG - 7)))
+
+#define SET_CTRL(so, entry, c) ((so)->ctrl[(entry) - (so)->table] = (c))
+
+/* Groups of slots.  The group holding slot (hash & mask) is probed first,
+   then others in the order dictobject.c probes slots, until one has an
+   Unused slot.  A small table is a single group, and its control bytes
+   past the end of the table always say Unused.
+*/
+#define GROUP_SHIFT 4
+#define GROUP_WIDTH (1 << GROUP_SHIFT)
+
+#if PySet_GROUPSIZE != GROUP_WIDTH || PySet_MINSIZE > GROUP_WIDTH
+#error "set groups don't fit the header"
+#endif
+
+/* Bit i set for each slot i of the group that's really in the table. */
+#define VALID_SLOTS(so) ((so)->mask < GROUP_WIDTH - 1 ? \
+	(1U << ((so)->mask + 1)) - 1 : (1U << GROUP_WIDTH) - 1)
+
+#ifdef Py_HAVE_SSE2
+#include <emmintrin.h>
+
+/* Bit i is set if control byte i of the group is c. */
+Py_LOCAL_INLINE(unsigned int)
+group_match(const unsigned char *group, unsigned char c)
+{
+	__m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	return (unsigned int)_mm_movemask_epi8(
+		_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)c)));
+}
+
+/* Bit i is set if slot i of the group is Unused or Dummy. */
+Py_LOCAL_INLINE(unsigned int)
+group_match_free(const unsigned char *group)
+{
+	return (unsigned int)_mm_movemask_epi8(
+		_mm_loadu_si128((const __m128i *)group));
+}
+
+#else
+
+Py_LOCAL_INLINE(unsigned int)
+group_match(const unsigned char *group, unsigned char c)
+{
+	unsigned int bits = 0;
+	int i;
+
+	for (i = 0; i < GROUP_WIDTH; i++)
+		if (group[i] == c)
+			bits |= 1U << i;
+	return bits;
+}
+
+Py_LOCAL_INLINE(unsigned int)
+group_match_free(const unsigned char *group)
+{
+	unsigned int bits = 0;
+	int i;
+
+	for (i = 0; i < GROUP_WIDTH; i++)
+		if (group[i] & 0x80)
+			bits |= 1U << i;
+	return bits;
+}
+
+#endif /* Py_HAVE_SSE2 */
+
+/* Index of the lowest set bit of a nonzero group_match() result. */
+#ifdef __GNUC__
+#define LOWEST_SLOT(bits) __builtin_ctz(bits)
+#else
+Py_LOCAL_INLINE(int)
+LOWEST_SLOT(unsigned int bits)
+{
+	int i = 0;
+
+	assert(bits != 0);
+	while (!(bits & 1)) {
+		bits >>= 1;
+		i++;
+	}
+	return i;
+}
+#endif
+
 #define INIT_NONZERO_SET_SLOTS(so) do {				\
 	(so)->table = (so)->smalltable;				\
 	(so)->mask = PySet_MINSIZE - 1;				\
+	(so)->ctrl = (so)->smallctrl;				\
+	memset((so)->smallctrl, CTRL_UNUSED, sizeof((so)->smallctrl));	\
 	(so)->hash = -1;					\
     } while(0)
 
@@ -63,11 +166,20 @@ This is based on Algorithm D from Knuth Vol. 3, Sec. 6.4.
 Open addressing is preferred over chaining since the link overhead for
 chaining would be substantial (100% with typical malloc overhead).
 
-The initial probe index is computed as hash mod the table size. Subsequent
-probe indices are computed as explained in Objects/dictobject.c.
+Slot (hash & mask) is looked at first, as in dictobject.c; usually it
+holds the key or is Unused, and that's the end of it.  Keys only go
+anywhere else when that slot is taken, so an Unused first slot means the
+key isn't there.  Otherwise the table is searched a group of slots at a
+time, comparing the key's tag with all of the group's control bytes at
+once (with SSE2, one instruction), so that other keys are only looked at
+when their tag matches:  about once in 128 times.  Groups are probed as
+explained above.
 
 All arithmetic on hash should ignore overflow.
 
+The search returns the key's entry if it's there, else the first Unused or
+Dummy slot it passed, for the key to go into.
+
 Unlike the dictionary implementation, the lookkey functions can return
 NULL if the rich comparison returns an error.
 */
@@ -75,16 +187,18 @@ NULL if the rich comparison returns an error.
 static setentry *
 set_lookkey(PySetObject *so, PyObject *key, register long hash)
 {
-	register Py_ssize_t i;
-	register size_t perturb;
-	register setentry *freeslot;
-	register size_t mask = so->mask;
+	register size_t i = (size_t)hash & so->mask;
+	size_t g = i >> GROUP_SHIFT;
+	size_t perturb = hash;
+	unsigned char *group;
+	unsigned char tag;
+	unsigned int bits;
 	setentry *table = so->table;
+	setentry *freeslot;
 	register setentry *entry;
 	register int cmp;
 	PyObject *startkey;
 
-	i = hash & mask;
 	entry = &table[i];
 	if (entry->key == NULL || entry->key == key)
 		return entry;
@@ -106,47 +220,52 @@ set_lookkey(PySetObject *so, PyObject *key, register long hash)
 			else {
 				/* The compare did major nasty stuff to the
 				 * set:  start over.
- 				 */
- 				return set_lookkey(so, key, hash);
- 			}
+				 */
+				return set_lookkey(so, key, hash);
+			}
 		}
 		freeslot = NULL;
 	}
 
-	/* In the loop, key == dummy is by far (factor of 100s) the
-	   least likely outcome, so test for that last. */
-	for (perturb = hash; ; perturb >>= PERTURB_SHIFT) {
-		i = (i << 2) + i + perturb + 1;
-		entry = &table[i & mask];
-		if (entry->key == NULL) {
-			if (freeslot != NULL)
-				entry = freeslot;
-			break;
-		}
-		if (entry->key == key)
-			break;
-		if (entry->hash == hash && entry->key != dummy) {
+	/* The first slot has been dealt with. */
+	tag = CTRL_TAG(hash);
+	group = so->ctrl + (g << GROUP_SHIFT);
+	bits = group_match(group, tag) & ~(1U << (i & (GROUP_WIDTH - 1)));
+	for (;;) {
+		for (; bits; bits &= bits - 1) {
+			entry = &table[(g << GROUP_SHIFT) + LOWEST_SLOT(bits)];
+			if (entry->key == key)
+				return entry;
+			if (entry->hash != hash)
+				continue;
 			startkey = entry->key;
 			Py_INCREF(startkey);
 			cmp = PyObject_RichCompareBool(startkey, key, Py_EQ);
 			Py_DECREF(startkey);
 			if (cmp < 0)
 				return NULL;
-			if (table == so->table && entry->key == startkey) {
-				if (cmp > 0)
-					break;
-			}
-			else {
+			if (table != so->table || entry->key != startkey) {
 				/* The compare did major nasty stuff to the
 				 * set:  start over.
- 				 */
- 				return set_lookkey(so, key, hash);
- 			}
+				 */
+				return set_lookkey(so, key, hash);
+			}
+			if (cmp > 0)
+				return entry;
+		}
+		if (freeslot == NULL) {
+			bits = group_match_free(group) & VALID_SLOTS(so);
+			if (bits)
+				freeslot = &table[(g << GROUP_SHIFT) +
+						  LOWEST_SLOT(bits)];
 		}
-		else if (entry->key == dummy && freeslot == NULL)
-			freeslot = entry;
+		if (group_match(group, CTRL_UNUSED))
+			return freeslot;
+		perturb >>= PERTURB_SHIFT;
+		g = (5 * g + 1 + perturb) & ((size_t)so->mask >> GROUP_SHIFT);
+		group = so->ctrl + (g << GROUP_SHIFT);
+		bits = group_match(group, tag);
 	}
-	return entry;
 }
 
 /*
@@ -157,11 +276,14 @@ set_lookkey(PySetObject *so, PyObject *key, register long hash)
 static setentry *
 set_lookkey_string(PySetObject *so, PyObject *key, register long hash)
 {
-	register Py_ssize_t i;
-	register size_t perturb;
-	register setentry *freeslot;
-	register size_t mask = so->mask;
+	register size_t i = (size_t)hash & so->mask;
+	size_t g = i >> GROUP_SHIFT;
+	size_t perturb = hash;
+	unsigned char *group;
+	unsigned char tag;
+	unsigned int bits;
 	setentry *table = so->table;
+	setentry *freeslot;
 	register setentry *entry;
 
 	/* Make sure this function doesn't have to handle non-string keys,
@@ -172,7 +294,6 @@ set_lookkey_string(PySetObject *so, PyObject *key, register long hash)
 		so->lookup = set_lookkey;
 		return set_lookkey(so, key, hash);
 	}
-	i = hash & mask;
 	entry = &table[i];
 	if (entry->key == NULL || entry->key == key)
 		return entry;
@@ -184,23 +305,30 @@ set_lookkey_string(PySetObject *so, PyObject *key, register long hash)
 		freeslot = NULL;
 	}
 
-	/* In the loop, key == dummy is by far (factor of 100s) the
-	   least likely outcome, so test for that last. */
-	for (perturb = hash; ; perturb >>= PERTURB_SHIFT) {
-		i = (i << 2) + i + perturb + 1;
-		entry = &table[i & mask];
-		if (entry->key == NULL)
-			return freeslot == NULL ? entry : freeslot;
-		if (entry->key == key
-		    || (entry->hash == hash
-			&& entry->key != dummy
-			&& _PyString_Eq(entry->key, key)))
-			return entry;
-		if (entry->key == dummy && freeslot == NULL)
-			freeslot = entry;
+	tag = CTRL_TAG(hash);
+	group = so->ctrl + (g << GROUP_SHIFT);
+	bits = group_match(group, tag) & ~(1U << (i & (GROUP_WIDTH - 1)));
+	for (;;) {
+		for (; bits; bits &= bits - 1) {
+			entry = &table[(g << GROUP_SHIFT) + LOWEST_SLOT(bits)];
+			if (entry->key == key
+			    || (entry->hash == hash
+				&& _PyString_Eq(entry->key, key)))
+				return entry;
+		}
+		if (freeslot == NULL) {
+			bits = group_match_free(group) & VALID_SLOTS(so);
+			if (bits)
+				freeslot = &table[(g << GROUP_SHIFT) +
+						  LOWEST_SLOT(bits)];
+		}
+		if (group_match(group, CTRL_UNUSED))
+			return freeslot;
+		perturb >>= PERTURB_SHIFT;
+		g = (5 * g + 1 + perturb) & ((size_t)so->mask >> GROUP_SHIFT);
+		group = so->ctrl + (g << GROUP_SHIFT);
+		bits = group_match(group, tag);
 	}
-	assert(0);	/* NOT REACHED */
-	return 0;
 }
 
 /*
@@ -223,11 +351,13 @@ set_insert_key(register PySetObject *so, PyObject *key, long hash)
 		so->fill++; 
 		entry->key = key;
 		entry->hash = hash;
+		SET_CTRL(so, entry, CTRL_TAG(hash));
 		so->used++;
 	} else if (entry->key == dummy) {
 		/* DUMMY */
 		entry->key = key;
 		entry->hash = hash;
+		SET_CTRL(so, entry, CTRL_TAG(hash));
 		so->used++;
 		Py_DECREF(dummy);
 	} else {
@@ -248,18 +378,26 @@ is responsible for incref'ing `key`.
 static void
 set_insert_clean(register PySetObject *so, PyObject *key, long hash)
 {
-	register size_t i;
-	register size_t perturb;
-	register size_t mask = (size_t)so->mask;
-	setentry *table = so->table;
+	size_t i = (size_t)hash & so->mask;
+	size_t g = i >> GROUP_SHIFT;
+	size_t perturb = hash;
+	unsigned int bits;
 	register setentry *entry;
 
-	i = hash & mask;
-	entry = &table[i];
-	for (perturb = hash; entry->key != NULL; perturb >>= PERTURB_SHIFT) {
-		i = (i << 2) + i + perturb + 1;
-		entry = &table[i & mask];
+	if (so->table[i].key != NULL) {
+		for (;;) {
+			bits = group_match_free(so->ctrl + (g << GROUP_SHIFT)) &
+			       VALID_SLOTS(so);
+			if (bits)
+				break;
+			perturb >>= PERTURB_SHIFT;
+			g = (5 * g + 1 + perturb) & (so->mask >> GROUP_SHIFT);
+		}
+		i = (g << GROUP_SHIFT) + LOWEST_SLOT(bits);
 	}
+	so->ctrl[i] = CTRL_TAG(hash);
+	entry = &so->table[i];
+	assert(entry->key == NULL);
 	so->fill++;
 	entry->key = key;
 	entry->hash = hash;
@@ -277,6 +415,7 @@ set_table_resize(PySetObject *so, Py_ssize_t minused)
 	Py_ssize_t newsize;
 	setentry *oldtable, *newtable, *entry;
 	Py_ssize_t i;
+	size_t nbytes;
 	int is_oldtable_malloced;
 	setentry small_copy[PySet_MINSIZE];
 
@@ -317,7 +456,13 @@ set_table_resize(PySetObject *so, Py_ssize_t minused)
 		}
 	}
 	else {
-		newtable = PyMem_NEW(setentry, newsize);
+		/* The control bytes go just past the end of the table. */
+		if ((size_t)newsize > PY_SSIZE_T_MAX / (sizeof(setentry) + 1)) {
+			PyErr_NoMemory();
+			return -1;
+		}
+		nbytes = (size_t)newsize * (sizeof(setentry) + 1);
+		newtable = (setentry *)PyMem_MALLOC(nbytes);
 		if (newtable == NULL) {
 			PyErr_NoMemory();
 			return -1;
@@ -329,6 +474,14 @@ set_table_resize(PySetObject *so, Py_ssize_t minused)
 	so->table = newtable;
 	so->mask = newsize - 1;
 	memset(newtable, 0, sizeof(setentry) * newsize);
+	if (newtable == so->smalltable) {
+		so->ctrl = so->smallctrl;
+		memset(so->smallctrl, CTRL_UNUSED, sizeof(so->smallctrl));
+	}
+	else {
+		so->ctrl = (unsigned char *)(newtable + newsize);
+		memset(so->ctrl, CTRL_UNUSED, newsize);
+	}
 	so->used = 0;
 	i = so->fill;
 	so->fill = 0;
@@ -415,6 +568,7 @@ set_discard_entry(PySetObject *so, setentry *oldentry)
 	old_key = entry->key;
 	Py_INCREF(dummy);
 	entry->key = dummy;
+	SET_CTRL(so, entry, CTRL_DUMMY);
 	so->used--;
 	Py_DECREF(old_key);
 	return DISCARD_FOUND;
@@ -442,6 +596,7 @@ set_discard_key(PySetObject *so, PyObject *key)
 	old_key = entry->key;
 	Py_INCREF(dummy);
 	entry->key = dummy;
+	SET_CTRL(so, entry, CTRL_DUMMY);
 	so->used--;
 	Py_DECREF(old_key);
 	return DISCARD_FOUND;
@@ -665,6 +820,23 @@ set_merge(PySetObject *so, PyObject *otherset)
 	   if (set_table_resize(so, (so->used + other->used)*2) != 0)
 		   return -1;
 	}
+	/* If our table is empty, the keys can't collide with anything
+	 * already in it or with each other, so they go straight in without
+	 * being compared.
+	 */
+	if (so->fill == 0) {
+		if (other->lookup == set_lookkey)
+			so->lookup = set_lookkey;
+		for (i = 0; i <= other->mask; i++) {
+			entry = &other->table[i];
+			if (entry->key != NULL &&
+			    entry->key != dummy) {
+				Py_INCREF(entry->key);
+				set_insert_clean(so, entry->key, entry->hash);
+			}
+		}
+		return 0;
+	}
 	for (i = 0; i <= other->mask; i++) {
 		entry = &other->table[i];
 		if (entry->key != NULL && 
@@ -749,6 +921,7 @@ set_pop(PySetObject *so)
 	key = entry->key;
 	Py_INCREF(dummy);
 	entry->key = dummy;
+	SET_CTRL(so, entry, CTRL_DUMMY);
 	so->used--;
 	so->table[0].hash = i + 1;  /* next place to start */
 	return key;
@@ -938,6 +1111,18 @@ set_update_internal(PySetObject *so, PyObject *other)
 			if (set_table_resize(so, (so->used + dictsize)*2) != 0)
 				return -1;
 		}
+		/* Dict keys are distinct, so if our table is empty they go
+		 * straight in, with their cached hashes.
+		 */
+		if (so->fill == 0) {
+			while (_PyDict_Next(other, &pos, &key, &value, &hash)) {
+				if (!PyString_CheckExact(key))
+					so->lookup = set_lookkey;
+				Py_INCREF(key);
+				set_insert_clean(so, key, hash);
+			}
+			return 0;
+		}
 		while (_PyDict_Next(other, &pos, &key, &value, &hash)) {
 			setentry an_entry;
 
@@ -949,6 +1134,26 @@ set_update_internal(PySetObject *so, PyObject *other)
 		return 0;
 	}
 
+	if (PyList_CheckExact(other) || PyTuple_CheckExact(other)) {
+		Py_ssize_t i;
+
+		/* Walk the items without an iterator.  Hashing or comparing
+		 * a key can run code that shrinks a list, so its size is
+		 * checked every time round.  The table isn't presized: the
+		 * sequence may be mostly duplicates.
+		 */
+		for (i = 0; i < PySequence_Fast_GET_SIZE(other); i++) {
+			key = PySequence_Fast_GET_ITEM(other, i);
+			Py_INCREF(key);
+			if (set_add_key(so, key) == -1) {
+				Py_DECREF(key);
+				return -1;
+			}
+			Py_DECREF(key);
+		}
+		return 0;
+	}
+
 	it = PyObject_GetIter(other);
 	if (it == NULL)
 		return -1;
@@ -1103,6 +1308,8 @@ set_swap_bodies(PySetObject *a, PySetObject *b)
 	setentry *u;
 	setentry *(*f)(PySetObject *so, PyObject *key, long hash);
 	setentry tab[PySet_MINSIZE];
+	unsigned char *c;
+	unsigned char ctrl[PySet_GROUPSIZE];
 	long h;
 
 	t = a->fill;     a->fill   = b->fill;        b->fill  = t;
@@ -1117,12 +1324,23 @@ set_swap_bodies(PySetObject *a, PySetObject *b)
 		a->table = a->smalltable;
 	b->table = u;
 
+	c = a->ctrl;
+	if (a->ctrl == a->smallctrl)
+		c = b->smallctrl;
+	a->ctrl = b->ctrl;
+	if (b->ctrl == b->smallctrl)
+		a->ctrl = a->smallctrl;
+	b->ctrl = c;
+
 	f = a->lookup;   a->lookup = b->lookup;      b->lookup = f;
 
 	if (a->table == a->smalltable || b->table == b->smalltable) {
 		memcpy(tab, a->smalltable, sizeof(tab));
 		memcpy(a->smalltable, b->smalltable, sizeof(tab));
 		memcpy(b->smalltable, tab, sizeof(tab));
+		memcpy(ctrl, a->smallctrl, sizeof(ctrl));
+		memcpy(a->smallctrl, b->smallctrl, sizeof(ctrl));
+		memcpy(b->smallctrl, ctrl, sizeof(ctrl));
 	}
 
 	if (PyType_IsSubtype(Py_TYPE(a), &PyFrozenSet_Type)  &&
@@ -1263,6 +1481,29 @@ set_intersection(PySetObject *so, PyObject *other)
 		return (PyObject *)result;
 	}
 
+	if (PyDict_CheckExact(other)) {
+		PyObject *value;
+		Py_ssize_t pos = 0;
+		setentry entry;
+
+		/* Use the hashes the dict has kept. */
+		while (_PyDict_Next(other, &pos, &entry.key, &value,
+				    &entry.hash)) {
+			int rv;
+
+			Py_INCREF(entry.key);
+			rv = set_contains_entry(so, &entry);
+			if (rv > 0)
+				rv = set_add_entry(result, &entry);
+			Py_DECREF(entry.key);
+			if (rv == -1) {
+				Py_DECREF(result);
+				return NULL;
+			}
+		}
+		return (PyObject *)result;
+	}
+
 	it = PyObject_GetIter(other);
 	if (it == NULL) {
 		Py_DECREF(result);
@@ -1422,6 +1663,26 @@ set_isdisjoint(PySetObject *so, PyObject *other)
 		Py_RETURN_TRUE;
 	}
 
+	if (PyDict_CheckExact(other)) {
+		PyObject *value;
+		Py_ssize_t pos = 0;
+		setentry entry;
+
+		while (_PyDict_Next(other, &pos, &entry.key, &value,
+				    &entry.hash)) {
+			int rv;
+
+			Py_INCREF(entry.key);
+			rv = set_contains_entry(so, &entry);
+			Py_DECREF(entry.key);
+			if (rv == -1)
+				return NULL;
+			if (rv)
+				Py_RETURN_FALSE;
+		}
+		Py_RETURN_TRUE;
+	}
+
 	it = PyObject_GetIter(other);
 	if (it == NULL)
 		return NULL;
@@ -1471,6 +1732,20 @@ set_difference_update_internal(PySetObject *so, PyObject *other)
 		while (set_next((PySetObject *)other, &pos, &entry))
 			if (set_discard_entry(so, entry) == -1)
 				return -1;
+	} else if (PyDict_CheckExact(other)) {
+		PyObject *value;
+		Py_ssize_t pos = 0;
+		setentry entry;
+		int rv;
+
+		while (_PyDict_Next(other, &pos, &entry.key, &value,
+				    &entry.hash)) {
+			Py_INCREF(entry.key);
+			rv = set_discard_entry(so, &entry);
+			Py_DECREF(entry.key);
+			if (rv == -1)
+				return -1;
+		}
 	} else {
 		PyObject *key, *it;
 		it = PyObject_GetIter(other);
@@ -1967,7 +2242,7 @@ set_sizeof(PySetObject *so)
 
 	res = sizeof(PySetObject);
 	if (so->table != so->smalltable)
-		res = res + (so->mask + 1) * sizeof(setentry);
+		res = res + (so->mask + 1) * (sizeof(setentry) + 1);
 	return PyInt_FromSsize_t(res);
 }
 
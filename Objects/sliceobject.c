@@ -83,8 +83,7 @@ static PyTypeObject PyEllipsis_Type = {
 };
 
 PyObject _Py_EllipsisObject = {
-	_PyObject_EXTRA_INIT
-	1, &PyEllipsis_Type
+	PyObject_HEAD_INIT_IMMORTAL(&PyEllipsis_Type)
 };
 
 
@@ -17,6 +17,308 @@
 #define FAST_COUNT 0
 #define FAST_SEARCH 1
 
+/* single characters are found with memchr (for 8-bit strings) or with
+   SSE2, and counted with SSE2, or AVX2 where the CPU has it.  short
+   patterns are found by comparing the first and last pattern character
+   against a whole vector of positions at once, and only checking the
+   rest of the pattern where both match.  the vector kernels are shared
+   by all character sizes; the AVX2 ones are only built for 8-bit
+   strings (str and bytearray). */
+
+#if defined(STRINGLIB_IS_UNICODE) && STRINGLIB_IS_UNICODE
+#define STRINGLIB_BYTE_CHARS 0
+#else
+#define STRINGLIB_BYTE_CHARS 1
+#endif
+
+/* below this length, memchr's setup costs more than a simple loop */
+#define MEMCHR_CUT_OFF 15
+
+/* longer patterns are left to the horspool loop, whose skips win over
+   checking every position */
+#define PAIR_SEARCH_MAX 32
+
+#ifdef Py_HAVE_SSE2
+#include <emmintrin.h>
+
+#define VCHARS ((Py_ssize_t)(16 / sizeof(STRINGLIB_CHAR)))
+
+Py_LOCAL_INLINE(__m128i)
+vsplat(STRINGLIB_CHAR ch)
+{
+    if (sizeof(STRINGLIB_CHAR) == 1)
+        return _mm_set1_epi8((char)ch);
+    else if (sizeof(STRINGLIB_CHAR) == 2)
+        return _mm_set1_epi16((short)ch);
+    else
+        return _mm_set1_epi32((int)ch);
+}
+
+Py_LOCAL_INLINE(__m128i)
+vcmpeq(__m128i a, __m128i b)
+{
+    if (sizeof(STRINGLIB_CHAR) == 1)
+        return _mm_cmpeq_epi8(a, b);
+    else if (sizeof(STRINGLIB_CHAR) == 2)
+        return _mm_cmpeq_epi16(a, b);
+    else
+        return _mm_cmpeq_epi32(a, b);
+}
+
+#define VLOAD(p) _mm_loadu_si128((const __m128i *)(p))
+
+/* the movemask of a comparison has sizeof(STRINGLIB_CHAR) bits set for
+   every matching character; these turn a bit position into a character
+   offset and clear the lowest match */
+#define VMASK_INDEX(mask) (__builtin_ctz(mask) / (int)sizeof(STRINGLIB_CHAR))
+#define VMASK_NEXT(mask) \
+    ((mask) & ~(((1U << sizeof(STRINGLIB_CHAR)) - 1) << __builtin_ctz(mask)))
+#endif /* Py_HAVE_SSE2 */
+
+Py_LOCAL_INLINE(Py_ssize_t)
+find_char(const STRINGLIB_CHAR* s, Py_ssize_t n, STRINGLIB_CHAR ch)
+{
+    Py_ssize_t i = 0;
+
+    if (STRINGLIB_BYTE_CHARS && n > MEMCHR_CUT_OFF) {
+        const char *p = memchr(s, ch, n);
+        return p != NULL ? (p - (const char *)s) : -1;
+    }
+#ifdef Py_HAVE_SSE2
+    if (n >= VCHARS) {
+        __m128i v = vsplat(ch);
+        for (; i + VCHARS <= n; i += VCHARS) {
+            unsigned int mask = _mm_movemask_epi8(vcmpeq(VLOAD(s + i), v));
+            if (mask)
+                return i + VMASK_INDEX(mask);
+        }
+    }
+#endif
+    for (; i < n; i++)
+        if (s[i] == ch)
+            return i;
+    return -1;
+}
+
+#ifdef Py_HAVE_SSE2
+/* each comparison subtracts -1 from every byte of a matching character,
+   so the byte sums divided by the character size count the matches.  a
+   byte can take 255 rounds before it has to be summed up. */
+Py_LOCAL(Py_ssize_t)
+count_char_sse2(const STRINGLIB_CHAR* s, Py_ssize_t n, STRINGLIB_CHAR ch,
+                Py_ssize_t *pi)
+{
+    const __m128i v = vsplat(ch), zero = _mm_setzero_si128();
+    Py_ssize_t i = *pi, count = 0;
+    int k;
+
+    while (i + VCHARS <= n) {
+        __m128i acc = zero;
+        for (k = 0; k < 255 && i + VCHARS <= n; k++, i += VCHARS)
+            acc = _mm_sub_epi8(acc, vcmpeq(VLOAD(s + i), v));
+        acc = _mm_sad_epu8(acc, zero);
+        count += _mm_cvtsi128_si32(acc) +
+                 _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+    }
+    *pi = i;
+    return count / sizeof(STRINGLIB_CHAR);
+}
+#endif
+
+#if defined(Py_HAVE_AVX2_TARGET) && STRINGLIB_BYTE_CHARS
+#include <immintrin.h>
+
+Py_TARGET_AVX2 Py_LOCAL(Py_ssize_t)
+count_char_avx2(const char* s, Py_ssize_t n, char ch, Py_ssize_t *pi)
+{
+    const __m256i v = _mm256_set1_epi8(ch), zero = _mm256_setzero_si256();
+    Py_ssize_t i = *pi, count = 0;
+    int k;
+
+    while (i + 32 <= n) {
+        __m256i acc = zero;
+        for (k = 0; k < 255 && i + 32 <= n; k++, i += 32)
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(
+                _mm256_loadu_si256((const __m256i *)(s + i)), v));
+        acc = _mm256_sad_epu8(acc, zero);
+        count += _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+                 _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+    }
+    *pi = i;
+    return count;
+}
+
+/* first/last character filter over 32 positions at a time; returns the
+   index of the first match in FAST_SEARCH mode, and otherwise leaves the
+   next position to look at in *pi and the matches found so far added to
+   *pcount.  *pnext is the first position a counted match may start at. */
+Py_TARGET_AVX2 Py_LOCAL(Py_ssize_t)
+pair_search_avx2(const char* s, Py_ssize_t w, const char* p, Py_ssize_t m,
+                 int mode, Py_ssize_t *pi, Py_ssize_t *pnext,
+                 Py_ssize_t *pcount)
+{
+    const __m256i first = _mm256_set1_epi8(p[0]);
+    const __m256i last = _mm256_set1_epi8(p[m - 1]);
+    Py_ssize_t i = *pi, next = *pnext, count = *pcount, j, k;
+
+    for (; i + 31 <= w; i += 32) {
+        unsigned int mask = _mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(
+                _mm256_loadu_si256((const __m256i *)(s + i)), first),
+            _mm256_cmpeq_epi8(
+                _mm256_loadu_si256((const __m256i *)(s + i + m - 1)), last)));
+        for (; mask; mask &= mask - 1) {
+            j = i + __builtin_ctz(mask);
+            if (j < next)
+                continue;
+            for (k = 1; k < m - 1; k++)
+                if (s[j+k] != p[k])
+                    break;
+            if (k >= m - 1) {
+                if (mode != FAST_COUNT)
+                    return j;
+                count++;
+                next = j + m;
+            }
+        }
+    }
+    *pi = i;
+    *pnext = next;
+    *pcount = count;
+    return -1;
+}
+#endif
+
+Py_LOCAL_INLINE(Py_ssize_t)
+count_char(const STRINGLIB_CHAR* s, Py_ssize_t n, STRINGLIB_CHAR ch)
+{
+    Py_ssize_t i = 0, count = 0;
+
+#if defined(Py_HAVE_AVX2_TARGET) && STRINGLIB_BYTE_CHARS
+    if (n >= 64 && Py_CPU_HAS_AVX2())
+        count = count_char_avx2(s, n, ch, &i);
+#endif
+#ifdef Py_HAVE_SSE2
+    count += count_char_sse2(s, n, ch, &i);
+#endif
+    for (; i < n; i++)
+        if (s[i] == ch)
+            count++;
+    return count;
+}
+
+#ifdef Py_HAVE_SSE2
+Py_LOCAL(Py_ssize_t)
+pair_search(const STRINGLIB_CHAR* s, Py_ssize_t n,
+            const STRINGLIB_CHAR* p, Py_ssize_t m,
+            int mode)
+{
+    const Py_ssize_t w = n - m, mlast = m - 1;
+    Py_ssize_t i = 0, next = 0, count = 0, j, k;
+    __m128i first, last;
+
+#if defined(Py_HAVE_AVX2_TARGET) && STRINGLIB_BYTE_CHARS
+    if (w >= 64 && Py_CPU_HAS_AVX2()) {
+        j = pair_search_avx2(s, w, p, m, mode, &i, &next, &count);
+        if (j >= 0)
+            return j;
+    }
+#endif
+    first = vsplat(p[0]);
+    last = vsplat(p[mlast]);
+    for (; i + VCHARS - 1 <= w; i += VCHARS) {
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(
+            vcmpeq(VLOAD(s + i), first),
+            vcmpeq(VLOAD(s + i + mlast), last)));
+        for (; mask; mask = VMASK_NEXT(mask)) {
+            j = i + VMASK_INDEX(mask);
+            if (j < next)
+                continue;
+            for (k = 1; k < mlast; k++)
+                if (s[j+k] != p[k])
+                    break;
+            if (k >= mlast) {
+                if (mode != FAST_COUNT)
+                    return j;
+                count++;
+                next = j + m;
+            }
+        }
+    }
+    if (i < next)
+        i = next;
+    for (; i <= w; i++) {
+        if (s[i] != p[0] || s[i+mlast] != p[mlast])
+            continue;
+        for (k = 1; k < mlast; k++)
+            if (s[i+k] != p[k])
+                break;
+        if (k >= mlast) {
+            if (mode != FAST_COUNT)
+                return i;
+            count++;
+            i = i + mlast;
+        }
+    }
+    if (mode != FAST_COUNT)
+        return -1;
+    return count;
+}
+#endif
+
+Py_LOCAL_INLINE(int)
+is_ascii(const STRINGLIB_CHAR* p, Py_ssize_t m)
+{
+    Py_ssize_t i;
+
+    for (i = 0; i < m; i++)
+        if ((unsigned long)p[i] >= 128)
+            return 0;
+    return 1;
+}
+
+/* most patterns are ASCII.  for those, the character just past the
+   window can be looked up in an exact shift table (sunday's variant of
+   horspool) instead of the 32-bit bloom mask, which lets non-ASCII and
+   unrelated ASCII characters alias pattern characters.  anything outside
+   ASCII moves the window past itself. */
+Py_LOCAL(Py_ssize_t)
+ascii_search(const STRINGLIB_CHAR* s, Py_ssize_t n,
+             const STRINGLIB_CHAR* p, Py_ssize_t m,
+             int mode)
+{
+    const Py_ssize_t w = n - m, mlast = m - 1;
+    const unsigned char past = m < 255 ? (unsigned char)(m + 1) : 255;
+    unsigned char shift[128];
+    unsigned long c;
+    Py_ssize_t i, j, count = 0;
+
+    memset(shift, past, sizeof(shift));
+    for (j = m < 255 ? 0 : m - 254; j < m; j++)
+        shift[(unsigned long)p[j]] = (unsigned char)(m - j);
+
+    for (i = 0; i <= w; ) {
+        if (s[i+mlast] == p[mlast]) {
+            for (j = 0; j < mlast; j++)
+                if (s[i+j] != p[j])
+                    break;
+            if (j == mlast) {
+                if (mode != FAST_COUNT)
+                    return i;
+                count++;
+                i += m;
+                continue;
+            }
+        }
+        /* note: s[n] may be read here, as in fastsearch() */
+        c = (unsigned long)s[i+m];
+        i += c < 128 ? shift[c] : m + 1;
+    }
+    if (mode != FAST_COUNT)
+        return -1;
+    return count;
+}
+
 Py_LOCAL_INLINE(Py_ssize_t)
 fastsearch(const STRINGLIB_CHAR* s, Py_ssize_t n,
            const STRINGLIB_CHAR* p, Py_ssize_t m,
@@ -36,21 +338,21 @@ fastsearch(const STRINGLIB_CHAR* s, Py_ssize_t n,
         if (m <= 0)
             return -1;
         /* use special case for 1-character strings */
-        if (mode == FAST_COUNT) {
-            for (i = 0; i < n; i++)
-                if (s[i] == p[0])
-                    count++;
-            return count;
-        } else {
-            for (i = 0; i < n; i++)
-                if (s[i] == p[0])
-                    return i;
-        }
-        return -1;
+        if (mode == FAST_COUNT)
+            return count_char(s, n, p[0]);
+        return find_char(s, n, p[0]);
     }
 
+#ifdef Py_HAVE_SSE2
+    if (m <= PAIR_SEARCH_MAX && w >= VCHARS)
+        return pair_search(s, n, p, m, mode);
+#endif
+
     mlast = m - 1;
 
+    if (is_ascii(p, m))
+        return ascii_search(s, n, p, m, mode);
+
     /* create compressed boyer-moore delta 1 table */
     skip = mlast - 1;
     /* process pattern[:-1] */
@@ -94,6 +396,52 @@ fastsearch(const STRINGLIB_CHAR* s, Py_ssize_t n,
     return count;
 }
 
+/* return the index of the first character at or after i in s[:n] that is
+   not printable ASCII (0x21-0x7e), or n.  printable ASCII characters are
+   never whitespace, so split() uses this to jump over the inside of a word
+   and only tests the characters it stops at. */
+Py_LOCAL_INLINE(Py_ssize_t)
+skip_ascii_graph(const STRINGLIB_CHAR* s, Py_ssize_t i, Py_ssize_t n)
+{
+#ifdef Py_HAVE_SSE2
+    /* bias each character so that 0x21-0x7e become the most negative
+       values for a signed compare */
+    __m128i sign, lo, hi;
+    if (sizeof(STRINGLIB_CHAR) == 1) {
+        sign = _mm_set1_epi8((char)0x80);
+        lo = _mm_set1_epi8(0x21);
+        hi = _mm_set1_epi8((char)(0x80 + 0x7e - 0x21 + 1));
+    }
+    else if (sizeof(STRINGLIB_CHAR) == 2) {
+        sign = _mm_set1_epi16((short)0x8000);
+        lo = _mm_set1_epi16(0x21);
+        hi = _mm_set1_epi16((short)(0x8000 + 0x7e - 0x21 + 1));
+    }
+    else {
+        sign = _mm_set1_epi32((int)0x80000000);
+        lo = _mm_set1_epi32(0x21);
+        hi = _mm_set1_epi32((int)(0x80000000 + 0x7e - 0x21 + 1));
+    }
+    for (; i + VCHARS <= n; i += VCHARS) {
+        __m128i v = VLOAD(s + i);
+        unsigned int mask;
+        if (sizeof(STRINGLIB_CHAR) == 1)
+            v = _mm_cmplt_epi8(_mm_xor_si128(_mm_sub_epi8(v, lo), sign), hi);
+        else if (sizeof(STRINGLIB_CHAR) == 2)
+            v = _mm_cmplt_epi16(_mm_xor_si128(_mm_sub_epi16(v, lo), sign), hi);
+        else
+            v = _mm_cmplt_epi32(_mm_xor_si128(_mm_sub_epi32(v, lo), sign), hi);
+        mask = _mm_movemask_epi8(v) ^ 0xFFFF;
+        if (mask)
+            return i + VMASK_INDEX(mask);
+    }
+#endif
+    for (; i < n; i++)
+        if ((unsigned long)s[i] - 0x21 > 0x7e - 0x21)
+            break;
+    return i;
+}
+
 #endif
 
 /*
@@ -96,12 +96,14 @@ PyString_FromStringAndSize(const char *str, Py_ssize_t size)
 		op = (PyStringObject *)t;
 		nullstring = op;
 		Py_INCREF(op);
+		_Py_SetImmortal(op);
 	} else if (size == 1 && str != NULL) {
 		PyObject *t = (PyObject *)op;
 		PyString_InternInPlace(&t);
 		op = (PyStringObject *)t;
 		characters[*str & UCHAR_MAX] = op;
 		Py_INCREF(op);
+		_Py_SetImmortal(op);
 	}
 	return (PyObject *) op;
 }
@@ -149,12 +151,14 @@ PyString_FromString(const char *str)
 		op = (PyStringObject *)t;
 		nullstring = op;
 		Py_INCREF(op);
+		_Py_SetImmortal(op);
 	} else if (size == 1) {
 		PyObject *t = (PyObject *)op;
 		PyString_InternInPlace(&t);
 		op = (PyStringObject *)t;
 		characters[*str & UCHAR_MAX] = op;
 		Py_INCREF(op);
+		_Py_SetImmortal(op);
 	}
 	return (PyObject *) op;
 }
@@ -1424,7 +1428,8 @@ static const char *stripformat[] = {"|O:lstrip", "|O:rstrip", "|O:strip"};
 #define FIX_PREALLOC_SIZE(list) Py_SIZE(list) = count
 
 #define SKIP_SPACE(s, i, len)    { while (i<len &&  isspace(Py_CHARMASK(s[i]))) i++; }
-#define SKIP_NONSPACE(s, i, len) { while (i<len && !isspace(Py_CHARMASK(s[i]))) i++; }
+#define SKIP_NONSPACE(s, i, len) { while ((i = skip_ascii_graph(s, i, len)) < len && \
+					  !isspace(Py_CHARMASK(s[i]))) i++; }
 #define RSKIP_SPACE(s, i)        { while (i>=0  &&  isspace(Py_CHARMASK(s[i]))) i--; }
 #define RSKIP_NONSPACE(s, i)     { while (i>=0  && !isspace(Py_CHARMASK(s[i]))) i--; }
 
@@ -1811,6 +1816,160 @@ PyDoc_STRVAR(join__doc__,
 Return a string which is the concatenation of the strings in the\n\
 sequence.  The separator between elements is S.");
 
+/* Smallest buffer string_join_iter() allocates. */
+#define JOIN_MIN_SIZE 256
+
+/* string_join() for an iterable that isn't a list or tuple.  Rather than
+ * collecting the items into a list and then sizing the result, copy each
+ * into a growing buffer as soon as the iterator produces it, so that it
+ * can be freed straight away.  The first time the buffer is outgrown, it
+ * is made big enough for the items the iterator's length hint says are
+ * left, if they are as long as those so far.  Short joins never ask.
+ */
+static PyObject *
+string_join_iter(PyStringObject *self, PyObject *orig)
+{
+	char *sep = PyString_AS_STRING(self);
+	const Py_ssize_t seplen = PyString_GET_SIZE(self);
+	PyObject *it, *item, *first = NULL, *res = NULL;
+	Py_ssize_t i, n, need, rest, per, used = 0, size = 0;
+	int hinted = 0;
+
+	it = PyObject_GetIter(orig);
+	if (it == NULL)
+		return NULL;
+
+	for (i = 0; (item = PyIter_Next(it)) != NULL; i++) {
+		if (!PyString_Check(item)) {
+#ifdef Py_USING_UNICODE
+			if (PyUnicode_Check(item)) {
+				/* Defer to Unicode join, with what has been
+				 * joined so far standing in for the items
+				 * already consumed.
+				 */
+				PyObject *seq, *r;
+
+				if (i > 1 && _PyString_Resize(&res, used) < 0)
+					goto error;
+				seq = PyList_New(0);
+				if (seq == NULL)
+					goto error;
+				if ((i > 0 && PyList_Append(seq,
+						i == 1 ? first : res) < 0) ||
+				    PyList_Append(seq, item) < 0 ||
+				    (r = _PyList_Extend((PyListObject *)seq,
+							it)) == NULL) {
+					Py_DECREF(seq);
+					goto error;
+				}
+				Py_DECREF(r);
+				Py_DECREF(item);
+				Py_DECREF(it);
+				Py_XDECREF(first);
+				Py_XDECREF(res);
+				r = PyUnicode_Join((PyObject *)self, seq);
+				Py_DECREF(seq);
+				return r;
+			}
+#endif
+			PyErr_Format(PyExc_TypeError,
+				     "sequence item %zd: expected string,"
+				     " %.80s found",
+				     i, Py_TYPE(item)->tp_name);
+			goto error;
+		}
+		if (i == 0) {
+			/* Keep it:  it may be the only item. */
+			first = item;
+			continue;
+		}
+		n = PyString_GET_SIZE(item);
+		if (i == 1)
+			used = PyString_GET_SIZE(first);
+		if (n > PY_SSIZE_T_MAX - seplen - used) {
+			PyErr_SetString(PyExc_OverflowError,
+				"join() result is too long for a Python string");
+			goto error;
+		}
+		need = used + seplen + n;
+		if (res == NULL || need > size) {
+			/* Grow by half again, for amortised linear time. */
+			size = need <= PY_SSIZE_T_MAX - (need >> 1) ?
+			       need + (need >> 1) : need;
+			if (res == NULL) {
+				if (size < JOIN_MIN_SIZE)
+					size = JOIN_MIN_SIZE;
+				res = PyString_FromStringAndSize(NULL, size);
+				if (res == NULL)
+					goto error;
+				Py_MEMCPY(PyString_AS_STRING(res),
+					  PyString_AS_STRING(first), used);
+				Py_CLEAR(first);
+			}
+			else {
+				PyObject *r = NULL;
+
+				if (!hinted) {
+					/* The hint may be wrong, so don't
+					 * fail if that much can't be had. */
+					hinted = 1;
+					rest = _PyObject_LengthHint(it, -1);
+					per = need / (i + 1);
+					if (rest > 0 && per > 0 &&
+					    rest <= (PY_SSIZE_T_MAX - need) / per &&
+					    need + rest * per > size) {
+						r = PyString_FromStringAndSize(
+							NULL, need + rest * per);
+						if (r == NULL)
+							PyErr_Clear();
+					}
+				}
+				if (r != NULL) {
+					Py_MEMCPY(PyString_AS_STRING(r),
+						  PyString_AS_STRING(res), used);
+					Py_DECREF(res);
+					res = r;
+					size = PyString_GET_SIZE(r);
+				}
+				else if (_PyString_Resize(&res, size) < 0)
+					goto error;
+			}
+		}
+		Py_MEMCPY(PyString_AS_STRING(res) + used, sep, seplen);
+		Py_MEMCPY(PyString_AS_STRING(res) + used + seplen,
+			  PyString_AS_STRING(item), n);
+		used = need;
+		Py_DECREF(item);
+	}
+	Py_DECREF(it);
+	if (PyErr_Occurred()) {
+		Py_XDECREF(first);
+		Py_XDECREF(res);
+		return NULL;
+	}
+
+	if (i == 0)
+		return PyString_FromString("");
+	if (i == 1) {
+		if (PyString_CheckExact(first))
+			return first;
+		res = PyString_FromStringAndSize(PyString_AS_STRING(first),
+						 PyString_GET_SIZE(first));
+		Py_DECREF(first);
+		return res;
+	}
+	if (_PyString_Resize(&res, used) < 0)
+		return NULL;
+	return res;
+
+ error:
+	Py_DECREF(item);
+	Py_DECREF(it);
+	Py_XDECREF(first);
+	Py_XDECREF(res);
+	return NULL;
+}
+
 static PyObject *
 string_join(PyStringObject *self, PyObject *orig)
 {
@@ -1823,10 +1982,10 @@ string_join(PyStringObject *self, PyObject *orig)
 	Py_ssize_t i;
 	PyObject *seq, *item;
 
-	seq = PySequence_Fast(orig, "");
-	if (seq == NULL) {
-		return NULL;
-	}
+	if (!PyList_Check(orig) && !PyTuple_Check(orig))
+		return string_join_iter(self, orig);
+	seq = orig;
+	Py_INCREF(seq);
 
 	seqlen = PySequence_Size(seq);
 	if (seqlen == 0) {
@@ -2218,6 +2377,26 @@ Return a copy of the string S converted to lowercase.");
 #define _tolower tolower
 #endif
 
+/* Whether the ctype functions agree with ASCII; in the "C" locale, which
+   Python starts in, they do. */
+static int ctype_is_ascii = 1;
+
+void
+_PyString_CheckCtype(void)
+{
+	int c;
+
+	for (c = 0; c < 256; c++) {
+		int upper = c >= 'A' && c <= 'Z';
+		int lower = c >= 'a' && c <= 'z';
+		if ((isupper(c) != 0) != upper || (islower(c) != 0) != lower ||
+		    (upper && tolower(c) != c + 0x20) ||
+		    (lower && toupper(c) != c - 0x20))
+			break;
+	}
+	ctype_is_ascii = c == 256;
+}
+
 static PyObject *
 string_lower(PyStringObject *self)
 {
@@ -2231,6 +2410,11 @@ string_lower(PyStringObject *self)
 
 	s = PyString_AS_STRING(newobj);
 
+	if (ctype_is_ascii) {
+		_Py_bytes_lower(s, PyString_AS_STRING(self), n);
+		return newobj;
+	}
+
 	Py_MEMCPY(s, PyString_AS_STRING(self), n);
 
 	for (i = 0; i < n; i++) {
@@ -2264,6 +2448,11 @@ string_upper(PyStringObject *self)
 
 	s = PyString_AS_STRING(newobj);
 
+	if (ctype_is_ascii) {
+		_Py_bytes_upper(s, PyString_AS_STRING(self), n);
+		return newobj;
+	}
+
 	Py_MEMCPY(s, PyString_AS_STRING(self), n);
 
 	for (i = 0; i < n; i++) {
@@ -2407,6 +2596,10 @@ string_swapcase(PyStringObject *self)
 	if (newobj == NULL)
 		return NULL;
 	s_new = PyString_AsString(newobj);
+	if (ctype_is_ascii) {
+		_Py_bytes_swapcase(s_new, s, n);
+		return newobj;
+	}
 	for (i = 0; i < n; i++) {
 		int c = Py_CHARMASK(*s++);
 		if (islower(c)) {
@@ -2507,11 +2700,7 @@ string_translate(PyStringObject *self, PyObject *args)
 
 	if (dellen == 0 && table != NULL) {
 		/* If no deletions are required, use faster code */
-		for (i = inlen; --i >= 0; ) {
-			c = Py_CHARMASK(*input++);
-			if (Py_CHARMASK((*output++ = table[c])) != c)
-				changed = 1;
-		}
+		changed = _Py_bytes_translate(output, input, inlen, table);
 		if (changed || !PyString_CheckExact(input_obj))
 			return result;
 		Py_DECREF(result);
@@ -5163,6 +5352,7 @@ PyString_InternImmortal(PyObject **p)
 	if (PyString_CHECK_INTERNED(*p) != SSTATE_INTERNED_IMMORTAL) {
 		PyString_CHECK_INTERNED(*p) = SSTATE_INTERNED_IMMORTAL;
 		Py_INCREF(*p);
+		_Py_SetImmortal(*p);
 	}
 }
 
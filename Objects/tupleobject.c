@@ -66,12 +66,17 @@ PyTuple_New(register Py_ssize_t size)
 		}
 		nbytes += sizeof(PyTupleObject) - sizeof(PyObject *);
 
-		op = PyObject_GC_NewVar(PyTupleObject, &PyTuple_Type, size);
+		/* Leave room for the cached hash after the items */
+		op = PyObject_GC_NewVar(PyTupleObject, &PyTuple_Type,
+					size >= 2 ? size + 1 : size);
 		if (op == NULL)
 			return NULL;
+		Py_SIZE(op) = size;
 	}
 	for (i=0; i < size; i++)
 		op->ob_item[i] = NULL;
+	if (size >= 2)
+		_PyTuple_HASH_SLOT(op) = -1;
 #if PyTuple_MAXSAVESIZE > 0
 	if (size == 0) {
 		free_list[0] = op;
@@ -127,6 +132,7 @@ PyTuple_SetItem(register PyObject *op, register Py_ssize_t i, PyObject *newitem)
 	p = ((PyTupleObject *)op) -> ob_item + i;
 	olditem = *p;
 	*p = newitem;
+	_PyTuple_RESET_HASH(op);
 	Py_XDECREF(olditem);
 	return 0;
 }
@@ -337,14 +343,29 @@ tuplehash(PyTupleObject *v)
 {
 	register long x, y;
 	register Py_ssize_t len = Py_SIZE(v);
-	register PyObject **p;
+	register PyObject **p, *o;
 	long mult = 1000003L;
+	int cached = _PyTuple_HASH_CACHED(v);
+
+	if (cached && (x = _PyTuple_HASH_SLOT(v)) != -1)
+		return x;
 	x = 0x345678L;
 	p = v->ob_item;
 	while (--len >= 0) {
-		y = PyObject_Hash(*p++);
-		if (y == -1)
-			return -1;
+		o = *p++;
+		/* Save the call through tp_hash for the usual key parts; this
+		   must give what int_hash() and string_hash() would. */
+		if (PyInt_CheckExact(o)) {
+			y = PyInt_AS_LONG(o);
+			if (y == -1)
+				y = -2;
+		}
+		else if (!PyString_CheckExact(o) ||
+			 (y = ((PyStringObject *)o)->ob_shash) == -1) {
+			y = PyObject_Hash(o);
+			if (y == -1)
+				return -1;
+		}
 		x = (x ^ y) * mult;
 		/* the cast might truncate len; that doesn't change hash stability */
 		mult += (long)(82520L + len + len);
@@ -352,6 +373,8 @@ tuplehash(PyTupleObject *v)
 	x += 97531L;
 	if (x == -1)
 		x = -2;
+	if (cached)
+		_PyTuple_HASH_SLOT(v) = x;
 	return x;
 }
 
@@ -761,6 +784,8 @@ tuple_sizeof(PyTupleObject *self)
 	Py_ssize_t res;
 
 	res = PyTuple_Type.tp_basicsize + Py_SIZE(self) * sizeof(PyObject *);
+	if (_PyTuple_CACHES_HASH(self))
+		res += sizeof(PyObject *);
 	return PyInt_FromSsize_t(res);
 }
 
@@ -939,22 +964,45 @@ _PyTuple_Resize(PyObject **pv, Py_ssize_t newsize)
 		Py_XDECREF(v->ob_item[i]);
 		v->ob_item[i] = NULL;
 	}
-	sv = PyObject_GC_Resize(PyTupleObject, v, newsize);
+	sv = PyObject_GC_Resize(PyTupleObject, v,
+				newsize >= 2 ? newsize + 1 : newsize);
 	if (sv == NULL) {
 		*pv = NULL;
 		PyObject_GC_Del(v);
 		return -1;
 	}
+	Py_SIZE(sv) = newsize;
 	_Py_NewReference((PyObject *) sv);
 	/* Zero out items added by growing */
 	if (newsize > oldsize)
 		memset(&sv->ob_item[oldsize], 0,
 		       sizeof(*sv->ob_item) * (newsize - oldsize));
+	if (newsize >= 2)
+		_PyTuple_HASH_SLOT(sv) = -1;
 	*pv = (PyObject *) sv;
 	_PyObject_GC_TRACK(sv);
 	return 0;
 }
 
+/* Report the size of the free lists, GC headers included.  The empty tuple
+   singleton isn't counted, since it is never released. */
+void
+_PyTuple_FreeListStats(Py_ssize_t *count, Py_ssize_t *nbytes)
+{
+	Py_ssize_t n = 0, size = 0;
+#if PyTuple_MAXSAVESIZE > 0
+	int i;
+	for (i = 1; i < PyTuple_MAXSAVESIZE; i++) {
+		n += numfree[i];
+		size += numfree[i] * (sizeof(PyGC_Head) +
+				      sizeof(PyTupleObject) +
+				      (i >= 2 ? i : i-1) * sizeof(PyObject *));
+	}
+#endif
+	*count = n;
+	*nbytes = size;
+}
+
 int
 PyTuple_ClearFreeList(void)
 {
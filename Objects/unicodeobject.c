@@ -386,6 +386,55 @@ void unicode_dealloc(register PyUnicodeObject *unicode)
     }
 }
 
+/* Which range all the characters of a string fall in.  The range
+   bounds are powers of two, so the bitwise or of the characters tells. */
+#define URANGE_ASCII 1		/* all characters < 0x80 */
+#define URANGE_LATIN1 2		/* all characters < 0x100 */
+#define URANGE_WIDE 3		/* some characters >= 0x100 */
+
+/* Return the character range of unicode.  This costs a scan, which stops
+   at the first character above Latin-1, so it is only worth it where the
+   answer saves a slower pass over the string. */
+static int
+unicode_charrange(PyUnicodeObject *unicode)
+{
+    register const Py_UNICODE *p = unicode->str;
+    register const Py_UNICODE *e = p + unicode->length;
+    register Py_UNICODE ored = 0;
+
+    while (p < e && ored < 0x100)
+	ored |= *p++;
+    return ored < 0x80 ? URANGE_ASCII :
+	   ored < 0x100 ? URANGE_LATIN1 : URANGE_WIDE;
+}
+
+/* Return the string holding the ordinals of the characters of unicode,
+   all of which must be below 256.  This is what encoding to ASCII,
+   Latin-1 and, for ASCII text, UTF-8 comes down to, without any of the
+   error handling. */
+static PyObject *
+unicode_encode_narrow(PyUnicodeObject *unicode)
+{
+    PyObject *v;
+    register const Py_UNICODE *p = unicode->str;
+    register char *s;
+    Py_ssize_t i, size = unicode->length;
+
+    assert(unicode_charrange(unicode) != URANGE_WIDE);
+    if (size == 1) {
+	/* Use the string character cache */
+	char c = (char)p[0];
+	return PyString_FromStringAndSize(&c, 1);
+    }
+    v = PyString_FromStringAndSize(NULL, size);
+    if (v == NULL)
+	return NULL;
+    s = PyString_AS_STRING(v);
+    for (i = 0; i < size; i++)
+	s[i] = (char)p[i];
+    return v;
+}
+
 int PyUnicode_Resize(PyObject **unicode, Py_ssize_t length)
 {
     register PyUnicodeObject *v;
@@ -2069,6 +2118,8 @@ PyObject *PyUnicode_AsUTF8String(PyObject *unicode)
         PyErr_BadArgument();
         return NULL;
     }
+    if (unicode_charrange((PyUnicodeObject *)unicode) == URANGE_ASCII)
+	return unicode_encode_narrow((PyUnicodeObject *)unicode);
     return PyUnicode_EncodeUTF8(PyUnicode_AS_UNICODE(unicode),
 				PyUnicode_GET_SIZE(unicode),
 				NULL);
@@ -3647,6 +3698,8 @@ PyObject *PyUnicode_AsLatin1String(PyObject *unicode)
 	PyErr_BadArgument();
 	return NULL;
     }
+    if (unicode_charrange((PyUnicodeObject *)unicode) != URANGE_WIDE)
+	return unicode_encode_narrow((PyUnicodeObject *)unicode);
     return PyUnicode_EncodeLatin1(PyUnicode_AS_UNICODE(unicode),
 				  PyUnicode_GET_SIZE(unicode),
 				  NULL);
@@ -3726,6 +3779,8 @@ PyObject *PyUnicode_AsASCIIString(PyObject *unicode)
 	PyErr_BadArgument();
 	return NULL;
     }
+    if (unicode_charrange((PyUnicodeObject *)unicode) == URANGE_ASCII)
+	return unicode_encode_narrow((PyUnicodeObject *)unicode);
     return PyUnicode_EncodeASCII(PyUnicode_AS_UNICODE(unicode),
 				 PyUnicode_GET_SIZE(unicode),
 				 NULL);
@@ -5648,7 +5703,8 @@ PyObject *split_whitespace(PyUnicodeObject *self,
 	while (i < len && Py_UNICODE_ISSPACE(buf[i]))
 	    i++;
 	j = i;
-	while (i < len && !Py_UNICODE_ISSPACE(buf[i]))
+	while ((i = skip_ascii_graph(buf, i, len)) < len &&
+	       !Py_UNICODE_ISSPACE(buf[i]))
 	    i++;
 	if (j < i) {
 	    if (maxcount-- <= 0)
@@ -6323,6 +6379,24 @@ PyObject *PyUnicode_RichCompare(PyObject *left,
 {
     int result;
 
+    if ((op == Py_EQ || op == Py_NE) &&
+	PyUnicode_Check(left) && PyUnicode_Check(right)) {
+	/* Equality needs neither coercion nor code point ordering:
+	   strings of different lengths can't be equal, and the others
+	   are compared memory-wise. */
+	PyUnicodeObject *u = (PyUnicodeObject *)left;
+	PyUnicodeObject *v = (PyUnicodeObject *)right;
+
+	if (u == v)
+	    result = 1;
+	else if (u->length != v->length)
+	    result = 0;
+	else
+	    result = memcmp(u->str, v->str,
+			    u->length * sizeof(Py_UNICODE)) == 0;
+	return PyBool_FromLong(op == Py_EQ ? result : !result);
+    }
+
     result = PyUnicode_Compare(left, right);
     if (result == -1 && PyErr_Occurred())
         goto onError;
@@ -55,6 +55,7 @@ extern void initdatetime(void);
 extern void init_fileio(void);
 extern void init_bytesio(void);
 extern void init_functools(void);
+extern void init_stringbuilder(void);
 extern void init_json(void);
 extern void initzlib(void);
 
@@ -135,6 +136,7 @@ struct _inittab _PyImport_Inittab[] = {
 	{"_fileio", init_fileio},
 	{"_bytesio", init_bytesio},
 	{"_functools", init_functools},
+	{"_stringbuilder", init_stringbuilder},
 	{"_json", init_json},
 
 	{"xxsubtype", initxxsubtype},
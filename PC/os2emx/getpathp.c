@@ -416,3 +416,11 @@ Py_GetProgramFullPath(void)
 		calculate_path();
 	return progpath;
 }
+
+/* Only the Unix build freezes standard library modules into the
+   interpreter, and needs to know where they came from. */
+char *
+_Py_GetStdlibDir(void)
+{
+	return NULL;
+}
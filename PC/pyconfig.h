@@ -530,6 +530,9 @@ Py_NO_ENABLE_SHARED to find out.  Also support MS_NO_COREDLL for b/w compat */
 /* Use Python's own small-block memory-allocator. */
 #define WITH_PYMALLOC 1
 
+/* Don't touch the reference counts of immortal objects. */
+#define WITH_IMMORTAL_OBJECTS 1
+
 /* Define if you have clock.  */
 /* #define HAVE_CLOCK */
 
@@ -105,6 +105,8 @@ tok_new(void)
 	tok->buf = tok->cur = tok->end = tok->inp = tok->start = NULL;
 	tok->done = E_OK;
 	tok->fp = NULL;
+	tok->block = NULL;
+	tok->badchar = NULL;
 	tok->tabsize = TABSIZE;
 	tok->indent = 0;
 	tok->indstack[0] = 0;
@@ -156,12 +158,33 @@ static char *
 error_ret(struct tok_state *tok) /* XXX */
 {
 	tok->decoding_erred = 1;
-	if (tok->fp != NULL && tok->buf != NULL) /* see PyTokenizer_Free */
+	if (tok->block != NULL) {
+		PyMem_FREE(tok->block);
+		tok->block = NULL;
+	}
+	else if (tok->fp != NULL && tok->buf != NULL) /* see PyTokenizer_Free */
 		PyMem_FREE(tok->buf);
 	tok->buf = NULL;
 	return NULL;		/* as if it were EOF */
 }
 
+/* Report the non-ASCII byte C in a file with no encoding declared, on the
+   line after tok->lineno. */
+
+static char *
+nonascii_error(struct tok_state *tok, int c)
+{
+	char buf[500];
+	sprintf(buf,
+		"Non-ASCII character '\\x%.2x' "
+		"in file %.200s on line %i, "
+		"but no encoding declared; "
+		"see http://www.python.org/peps/pep-0263.html for details",
+		c, tok->filename, tok->lineno + 1);
+	PyErr_SetString(PyExc_SyntaxError, buf);
+	return error_ret(tok);
+}
+
 static char *
 new_string(const char *s, Py_ssize_t len)
 {
@@ -492,19 +515,8 @@ decoding_fgets(char *s, int size, struct tok_state *tok)
 				break;
 			}
 	}
-	if (badchar) {
-		char buf[500];
-		/* Need to add 1 to the line number, since this line
-		   has not been counted, yet.  */
-		sprintf(buf,
-			"Non-ASCII character '\\x%.2x' "
-			"in file %.200s on line %i, "
-			"but no encoding declared; "
-			"see http://www.python.org/peps/pep-0263.html for details",
-			badchar, tok->filename, tok->lineno + 1);
-		PyErr_SetString(PyExc_SyntaxError, buf);
-		return error_ret(tok);
-	}
+	if (badchar)
+		return nonascii_error(tok, badchar);
 #endif
 	return line;
 }
@@ -529,6 +541,108 @@ decoding_feof(struct tok_state *tok)
 	}
 }
 
+/* Return the first byte with the high bit set in the N bytes at S, or
+   NULL.  Most sources are ASCII, so this goes a word at a time. */
+
+static const char *
+find_nonascii(const char *s, Py_ssize_t n)
+{
+	const char *end = s + n;
+	const size_t high_bits = (size_t)-1 / 0xFF * 0x80;
+
+	for (; s < end && ((size_t)s & (sizeof(size_t) - 1)) != 0; s++)
+		if (*s & 0x80)
+			return s;
+	while (end - s >= (Py_ssize_t)sizeof(size_t) &&
+	       (*(const size_t *)s & high_bits) == 0)
+		s += sizeof(size_t);
+	for (; s < end; s++)
+		if (*s & 0x80)
+			return s;
+	return NULL;
+}
+
+#define BLOCKSIZE 65536
+
+/* Read the rest of the file into tok->block in a few large reads, so
+   that tok_nextc() takes the lines from it in place, as from a string,
+   instead of copying them one at a time through decoding_fgets().  The
+   text of a token being read is kept in front.  The new text is changed
+   as the line by line reads would: "\r\n" and "\r" become "\n", a NUL
+   byte drops the rest of its line and the newline ending it, and the
+   last line gets a newline if it has none.  Then tok->end is one past the
+   text's '\0' if the reads would have given a token running to the end
+   of the file an empty last line: see tok_nextc().  Only for files read
+   raw, once past the lines that may declare the encoding.
+   Return 0 if out of memory. */
+
+static int
+tok_readblock(struct tok_state *tok)
+{
+	Py_ssize_t keep = tok->start == NULL ? 0 : tok->inp - tok->buf;
+	Py_ssize_t size = keep + BLOCKSIZE, len = keep;
+	int at_eof = feof(tok->fp), faked = 0;
+	char *block, *s, *d, *end;
+
+	/* Room for a newline and the '\0' after the text */
+	block = (char *)PyMem_MALLOC(size + 2);
+	if (block == NULL)
+		return 0;
+	memcpy(block, tok->buf, keep);
+	for (;;) {
+		len += fread(block + len, 1, size - len, tok->fp);
+		if (len < size)
+			break;
+		size *= 2;
+		s = (char *)PyMem_REALLOC(block, size + 2);
+		if (s == NULL) {
+			PyMem_FREE(block);
+			return 0;
+		}
+		block = s;
+	}
+
+	end = block + len;
+	for (s = block + keep; s < end && *s != '\r' && *s != '\0'; s++)
+		;
+	for (d = s; s < end; ) {
+		char c = *s++;
+		if (c == '\r') {
+			if (s < end && *s == '\n')
+				s++;
+			c = '\n';
+		}
+		else if (c == '\0') {
+			while (s < end && *s != '\n' && *s != '\r')
+				s++;
+			if (s < end && *s++ == '\r' && s < end && *s == '\n')
+				s++;
+			continue;
+		}
+		*d++ = c;
+	}
+	len = d - block;
+	if (len > keep && block[len - 1] != '\n') {
+		block[len++] = '\n';
+		faked = 1;
+	}
+	block[len] = '\0';
+
+	/* Without an encoding declared, the lines are checked for non-ASCII
+	   bytes as they are reached */
+	if (tok->encoding == NULL)
+		tok->badchar = find_nonascii(block + keep, len - keep);
+	if (tok->start != NULL)
+		tok->start = block + (tok->start - tok->buf);
+	if (keep > 0)
+		tok->line_start = block + (tok->line_start - tok->buf);
+	PyMem_FREE(tok->buf);
+	tok->block = tok->buf = block;
+	tok->cur = tok->inp = block + keep;
+	tok->end = block + len + (at_eof || faked ? 0 : 1);
+	return 1;
+}
+
 /* Fetch a byte from TOK, using the string buffer. */
 
 static int
@@ -686,7 +800,9 @@ PyTokenizer_Free(struct tok_state *tok)
 	Py_XDECREF(tok->decoding_readline);
 	Py_XDECREF(tok->decoding_buffer);
 #endif
-	if (tok->fp != NULL && tok->buf != NULL)
+	if (tok->block != NULL)
+		PyMem_FREE(tok->block);
+	else if (tok->fp != NULL && tok->buf != NULL)
 		PyMem_FREE(tok->buf);
 	PyMem_FREE(tok);
 }
@@ -762,17 +878,46 @@ tok_nextc(register struct tok_state *tok)
 		}
 		if (tok->done != E_OK)
 			return EOF;
-		if (tok->fp == NULL) {
+		if (tok->fp == NULL || tok->block != NULL) {
 			char *end = strchr(tok->inp, '\n');
 			if (end != NULL)
 				end++;
 			else {
 				end = strchr(tok->inp, '\0');
-				if (end == tok->inp) {
+				if (end == tok->inp && tok->block != NULL &&
+				    tok->start != NULL && end < tok->end) {
+					/* The empty line decoding_fgets()
+					   would give; see tok_readblock() */
+					end[0] = '\n';
+					end[1] = '\0';
+					tok->end = ++end;
+				}
+				else if (end == tok->inp) {
+					/* The end of a file counts as a line,
+					   and empties the last one */
+					if (tok->block != NULL) {
+						if (tok->start == NULL)
+							*tok->buf = '\0';
+						tok->lineno++;
+					}
 					tok->done = E_EOF;
 					return EOF;
 				}
 			}
+#ifndef PGEN
+			if (tok->badchar != NULL && tok->badchar < end) {
+				/* Fail as decoding_fgets() would, counting
+				   the line first if it continues a token */
+				if (tok->start != NULL)
+					tok->lineno++;
+				nonascii_error(tok, Py_CHARMASK(*tok->badchar));
+				if (tok->start == NULL)
+					tok->lineno++;
+				tok->done = E_EOF;
+				tok->cur = tok->inp;
+				return EOF;
+			}
+#endif
 			if (tok->start == NULL)
 				tok->buf = tok->cur;
 			tok->line_start = tok->cur;
@@ -780,6 +925,17 @@ tok_nextc(register struct tok_state *tok)
 			tok->inp = end;
 			return Py_CHARMASK(*tok->cur++);
 		}
+#ifndef PGEN
+		if (tok->prompt == NULL && tok->decoding_state > 0 &&
+		    tok->lineno >= 2) {
+			if (!tok_readblock(tok)) {
+				tok->done = E_NOMEM;
+				tok->cur = tok->inp;
+				return EOF;
+			}
+			continue;
+		}
+#endif
 		if (tok->prompt != NULL) {
 			char *newtok = PyOS_Readline(stdin, stdout, tok->prompt);
 			if (tok->nextprompt != NULL)
@@ -1109,6 +1265,51 @@ indenterror(struct tok_state *tok)
 }
 
 
+/* Character classes for tok_get(), so that each test is one lookup; the
+   bytes from 128 up are in none.  EOF indexes the last entry. */
+
+#define CC_NAME		0x01	/* Letters and '_' */
+#define CC_DIGIT	0x02
+#define CC_HEX		0x04	/* Hexadecimal digits */
+#define CC_STRING	0x08	/* '\n' and '\\', which need care in strings */
+
+#define N	CC_NAME
+#define D	CC_DIGIT
+#define H	CC_HEX
+#define S	CC_STRING
+
+static const unsigned char char_class[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0,	/*   0-  7 */
+	0, 0, S, 0, 0, 0, 0, 0,	/*   8- 15 */
+	0, 0, 0, 0, 0, 0, 0, 0,	/*  16- 23 */
+	0, 0, 0, 0, 0, 0, 0, 0,	/*  24- 31 */
+	0, 0, 0, 0, 0, 0, 0, 0,	/*  32- 39 */
+	0, 0, 0, 0, 0, 0, 0, 0,	/*  40- 47 */
+	D|H, D|H, D|H, D|H, D|H, D|H, D|H, D|H,	/*  48- 55 */
+	D|H, D|H, 0, 0, 0, 0, 0, 0,	/*  56- 63 */
+	0, N|H, N|H, N|H, N|H, N|H, N|H, N,	/*  64- 71 */
+	N, N, N, N, N, N, N, N,	/*  72- 79 */
+	N, N, N, N, N, N, N, N,	/*  80- 87 */
+	N, N, N, 0, S, 0, 0, N,	/*  88- 95 */
+	0, N|H, N|H, N|H, N|H, N|H, N|H, N,	/*  96-103 */
+	N, N, N, N, N, N, N, N,	/* 104-111 */
+	N, N, N, N, N, N, N, N,	/* 112-119 */
+	N, N, N, 0, 0, 0, 0, 0,	/* 120-127 */
+	/* The rest is 0 */
+};
+
+#undef N
+#undef D
+#undef H
+#undef S
+
+#define CHAR_CLASS(c)		(char_class[(c) & 0xff])
+#define IS_NAME_START(c)	(CHAR_CLASS(c) & CC_NAME)
+#define IS_NAME_CHAR(c)		(CHAR_CLASS(c) & (CC_NAME | CC_DIGIT))
+#define IS_DIGIT(c)		(CHAR_CLASS(c) & CC_DIGIT)
+#define IS_XDIGIT(c)		(CHAR_CLASS(c) & CC_HEX)
+
+
 /* Get next token, after space stripping etc. */
 
 static int
@@ -1239,6 +1440,12 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 		} while (c != EOF && c != '\n' &&
 			 (size_t)(tp - cbuf + 1) < sizeof(cbuf));
 		*tp = '\0';
+		/* The rest of the line can be passed over at once */
+		if (c != EOF && c != '\n') {
+			tp = (char *)memchr(tok->cur, '\n',
+					    tok->inp - tok->cur);
+			tok->cur = tp != NULL ? tp : tok->inp;
+		}
 		for (cp = tabforms;
 		     cp < tabforms + sizeof(tabforms)/sizeof(tabforms[0]);
 		     cp++) {
@@ -1264,7 +1471,7 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 	}
 
 	/* Identifier (most frequent token!) */
-	if (isalpha(c) || c == '_') {
+	if (IS_NAME_START(c)) {
 		/* Process r"", u"" and ur"" */
 		switch (c) {
 		case 'b':
@@ -1290,7 +1497,10 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 				goto letter_quote;
 			break;
 		}
-		while (isalnum(c) || c == '_') {
+		if (IS_NAME_CHAR(c)) {
+			/* The line ends in '\n' or '\0', so this stays in it */
+			while (IS_NAME_CHAR(*tok->cur))
+				tok->cur++;
 			c = tok_nextc(tok);
 		}
 		tok_backup(tok, c);
@@ -1313,7 +1523,7 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 	/* Period or number starting with period? */
 	if (c == '.') {
 		c = tok_nextc(tok);
-		if (isdigit(c)) {
+		if (IS_DIGIT(c)) {
 			goto fraction;
 		}
 		else {
@@ -1325,7 +1535,7 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 	}
 
 	/* Number */
-	if (isdigit(c)) {
+	if (IS_DIGIT(c)) {
 		if (c == '0') {
 			/* Hex, octal or binary -- maybe. */
 			c = tok_nextc(tok);
@@ -1339,14 +1549,14 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 
 				/* Hex */
 				c = tok_nextc(tok);
-				if (!isxdigit(c)) {
+				if (!IS_XDIGIT(c)) {
 					tok->done = E_TOKEN;
 					tok_backup(tok, c);
 					return ERRORTOKEN;
 				}
 				do {
 					c = tok_nextc(tok);
-				} while (isxdigit(c));
+				} while (IS_XDIGIT(c));
 			}
                         else if (c == 'o' || c == 'O') {
 				/* Octal */
@@ -1379,11 +1589,11 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 				while ('0' <= c && c < '8') {
 					c = tok_nextc(tok);
 				}
-				if (isdigit(c)) {
+				if (IS_DIGIT(c)) {
 					found_decimal = 1;
 					do {
 						c = tok_nextc(tok);
-					} while (isdigit(c));
+					} while (IS_DIGIT(c));
 				}
 				if (c == '.')
 					goto fraction;
@@ -1406,7 +1616,7 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 			/* Decimal */
 			do {
 				c = tok_nextc(tok);
-			} while (isdigit(c));
+			} while (IS_DIGIT(c));
 			if (c == 'l' || c == 'L')
 				c = tok_nextc(tok);
 			else {
@@ -1416,7 +1626,7 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 					/* Fraction */
 					do {
 						c = tok_nextc(tok);
-					} while (isdigit(c));
+					} while (IS_DIGIT(c));
 				}
 				if (c == 'e' || c == 'E') {
 		exponent:
@@ -1424,14 +1634,14 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 					c = tok_nextc(tok);
 					if (c == '+' || c == '-')
 						c = tok_nextc(tok);
-					if (!isdigit(c)) {
+					if (!IS_DIGIT(c)) {
 						tok->done = E_TOKEN;
 						tok_backup(tok, c);
 						return ERRORTOKEN;
 					}
 					do {
 						c = tok_nextc(tok);
-					} while (isdigit(c));
+					} while (IS_DIGIT(c));
 				}
 #ifndef WITHOUT_COMPLEX
 				if (c == 'j' || c == 'J')
@@ -1455,6 +1665,17 @@ tok_get(register struct tok_state *tok, char **p_start, char **p_end)
 		int triple = 0;
 		int tripcount = 0;
 		for (;;) {
+			if (tok->cur < tok->inp &&
+			    !(CHAR_CLASS(*tok->cur) & CC_STRING) &&
+			    *tok->cur != quote) {
+				/* Pass over the plain characters at once */
+				do {
+					tok->cur++;
+				} while (tok->cur < tok->inp &&
+					 !(CHAR_CLASS(*tok->cur) & CC_STRING) &&
+					 *tok->cur != quote);
+				tripcount = 0;
+			}
 			c = tok_nextc(tok);
 			if (c == '\n') {
 				if (!triple) {
@@ -16,7 +16,8 @@ extern "C" {
 struct tok_state {
 	/* Input state; buf <= cur <= inp <= end */
 	/* NB an entire line is held in the buffer */
-	char *buf;	/* Input buffer, or NULL; malloc'ed if fp != NULL */
+	char *buf;	/* Input buffer, or NULL; malloc'ed if fp != NULL,
+			   unless it's in block */
 	char *cur;	/* Next character in buffer */
 	char *inp;	/* End of data in buffer */
 	char *end;	/* End of input buffer if buf != NULL */
@@ -24,6 +25,9 @@ struct tok_state {
 	int done;	/* E_OK normally, E_EOF at EOF, otherwise error code */
 	/* NB If done != E_OK, cur must be == inp!!! */
 	FILE *fp;	/* Rest of input; NULL if tokenizing a string */
+	char *block;	/* Rest of fp read at once, or NULL; see tok_readblock */
+	const char *badchar;	/* First non-ASCII byte in block, if that's an
+				   error, or NULL */
 	int tabsize;	/* Tab spacing */
 	int indent;	/* Current indentation index */
 	int indstack[MAXINDENT];	/* Stack of indents */
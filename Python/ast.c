@@ -1,6 +1,8 @@
 /*
  * This file includes functions to transform a concrete syntax tree (CST) to
  * an abstract syntax tree (AST).  The main function is PyAST_FromNode().
+ * _PyAST_FromString() and _PyAST_FromFile() at the end build the AST from
+ * the tokens instead, without a CST.
  *
  */
 #include "Python.h"
@@ -12,6 +14,8 @@
 #include "token.h"
 #include "parsetok.h"
 #include "graminit.h"
+#include "errcode.h"
+#include "../Parser/tokenizer.h"
 
 #include <assert.h>
 
@@ -26,8 +30,7 @@ struct compiling {
     const char *c_filename; /* filename */
 };
 
-static asdl_seq *seq_for_testlist(struct compiling *, const node *,
-								  enum _expr_const *constant);
+static asdl_seq *seq_for_testlist(struct compiling *, const node *);
 static expr_ty ast_for_expr(struct compiling *, const node *);
 static stmt_ty ast_for_stmt(struct compiling *, const node *);
 static asdl_seq *ast_for_suite(struct compiling *, const node *);
@@ -67,9 +70,9 @@ new_identifier(const char* n, PyArena *arena) {
 */
 
 static int
-ast_error(const node *n, const char *errstr)
+ast_error_at(int lineno, const char *errstr)
 {
-    PyObject *u = Py_BuildValue("zi", errstr, LINENO(n));
+    PyObject *u = Py_BuildValue("zi", errstr, lineno);
     if (!u)
         return 0;
     PyErr_SetObject(PyExc_SyntaxError, u);
@@ -77,6 +80,8 @@ ast_error(const node *n, const char *errstr)
     return 0;
 }
 
+#define ast_error(n, errstr) ast_error_at(LINENO(n), (errstr))
+
 static void
 ast_error_finish(const char *filename)
 {
@@ -119,33 +124,33 @@ ast_error_finish(const char *filename)
 }
 
 static int
-ast_warn(struct compiling *c, const node *n, char *msg)
+ast_warn(struct compiling *c, int lineno, char *msg)
 {
-    if (PyErr_WarnExplicit(PyExc_SyntaxWarning, msg, c->c_filename, LINENO(n),
+    if (PyErr_WarnExplicit(PyExc_SyntaxWarning, msg, c->c_filename, lineno,
                            NULL, NULL) < 0) {
         /* if -Werr, change it to a SyntaxError */
         if (PyErr_Occurred() && PyErr_ExceptionMatches(PyExc_SyntaxWarning))
-            ast_error(n, msg);
+            ast_error_at(lineno, msg);
         return 0;
     }
     return 1;
 }
 
 static void*
-ast_check_error(struct compiling *c, const node *n, char *msg)
+ast_check_error(struct compiling *c, int lineno, char *msg)
 {
 	if (PyErr_Occurred())
-		ast_error(n, msg);
+		ast_error_at(lineno, msg);
     return NULL;
 }
 
 static int
-forbidden_check(struct compiling *c, const node *n, const char *x)
+forbidden_check(struct compiling *c, int lineno, const char *x)
 {
     if (!strcmp(x, "None"))
-        return ast_error(n, "assignment to None");
+        return ast_error_at(lineno, "assignment to None");
     if (Py_Py3kWarningFlag && !(strcmp(x, "True") && strcmp(x, "False")) &&
-        !ast_warn(c, n, "assignment to True or False is forbidden in 3.x"))
+        !ast_warn(c, lineno, "assignment to True or False is forbidden in 3.x"))
         return 0;
     return 1;
 }
@@ -350,9 +355,9 @@ Const(object c, enum _expr_const constant, int lineno, int col_offset, PyArena *
 */
 
 static operator_ty
-get_operator(const node *n)
+get_operator(int type)
 {
-    switch (TYPE(n)) {
+    switch (type) {
         case VBAR:
             return BitOr;
         case CIRCUMFLEX:
@@ -388,7 +393,7 @@ get_operator(const node *n)
 */
 
 static int
-set_context(struct compiling *c, expr_ty e, expr_context_ty ctx, const node *n)
+set_context(struct compiling *c, expr_ty e, expr_context_ty ctx, int lineno)
 {
     asdl_seq *s = NULL;
     /* If a particular expression type can't be used for assign / delete,
@@ -407,7 +412,7 @@ set_context(struct compiling *c, expr_ty e, expr_context_ty ctx, const node *n)
 
     switch (e->kind) {
         case Attribute_kind:
-            if (ctx == Store && !forbidden_check(c, n,
+            if (ctx == Store && !forbidden_check(c, lineno,
                                 PyBytes_AS_STRING(e->v.Attribute.attr)))
                     return 0;
             e->v.Attribute.ctx = ctx;
@@ -416,7 +421,7 @@ set_context(struct compiling *c, expr_ty e, expr_context_ty ctx, const node *n)
             e->v.Subscript.ctx = ctx;
             break;
         case Name_kind:
-            if (ctx == Store && !forbidden_check(c, n,
+            if (ctx == Store && !forbidden_check(c, lineno,
                                 PyBytes_AS_STRING(e->v.Name.id)))
                     return 0;
             e->v.Name.ctx = ctx;
@@ -427,7 +432,7 @@ set_context(struct compiling *c, expr_ty e, expr_context_ty ctx, const node *n)
             break;
         case Tuple_kind:
             if (asdl_seq_LEN(e->v.Tuple.elts) == 0) 
-                return ast_error(n, "can't assign to ()");
+                return ast_error_at(lineno, "can't assign to ()");
             e->v.Tuple.ctx = ctx;
             s = e->v.Tuple.elts;
             break;
@@ -479,7 +484,7 @@ set_context(struct compiling *c, expr_ty e, expr_context_ty ctx, const node *n)
                       "can't %s %s",
                       ctx == Store ? "assign to" : "delete",
                       expr_name);
-        return ast_error(n, buf);
+        return ast_error_at(lineno, buf);
     }
 
     /* If the LHS is a list or tuple, we need to set the assignment
@@ -489,7 +494,7 @@ set_context(struct compiling *c, expr_ty e, expr_context_ty ctx, const node *n)
         int i;
 
         for (i = 0; i < asdl_seq_LEN(s); i++) {
-            if (!set_context(c, (expr_ty)asdl_seq_GET(s, i), ctx, n))
+            if (!set_context(c, (expr_ty)asdl_seq_GET(s, i), ctx, lineno))
                 return 0;
         }
     }
@@ -587,8 +592,7 @@ ast_for_comp_op(struct compiling *c, const node *n)
 }
 
 static asdl_seq *
-seq_for_testlist(struct compiling *c, const node *n,
-				 enum _expr_const *constant)
+seq_for_testlist(struct compiling *c, const node *n)
 {
     /* testlist: test (',' test)* [','] */
     asdl_seq *seq;
@@ -604,19 +608,12 @@ seq_for_testlist(struct compiling *c, const node *n,
     if (!seq)
         return NULL;
 
-	/* Defaults to constant value, but if at least one expression wasn't
-	   a constant, reverts to no_const. */
-	*constant = pure_const;
     for (i = 0; i < NCH(n); i += 2) {
         assert(TYPE(CHILD(n, i)) == test || TYPE(CHILD(n, i)) == old_test);
 
         expression = ast_for_expr(c, CHILD(n, i));
         if (!expression)
             return NULL;
-		/* Updates the constant flag. */
-		*constant &= expression->kind == Const_kind ?
-			expression->v.Const.constant : no_const;
-
         assert(i / 2 < seq->size);
         asdl_seq_SET(seq, i / 2, expression);
     }
@@ -645,7 +642,7 @@ set_name:
         /* fpdef_node is either a NAME or an fplist */
         child = CHILD(fpdef_node, 0);
         if (TYPE(child) == NAME) {
-            if (!forbidden_check(c, n, STR(child)))
+            if (!forbidden_check(c, LINENO(n), STR(child)))
                 return NULL;
             arg_id = NEW_IDENTIFIER(child);
             if (!arg_id)
@@ -670,7 +667,7 @@ set_name:
     }
 
     result = Tuple(args, Store, LINENO(n), n->n_col_offset, c->c_arena);
-    if (!set_context(c, result, Store, n))
+    if (!set_context(c, result, Store, LINENO(n)))
         return NULL;
     return result;
 }
@@ -745,7 +742,7 @@ ast_for_arguments(struct compiling *c, const node *n)
                     /* def foo((x)): is not complex, special case. */
                     if (NCH(ch) != 1) {
                         /* We have complex arguments, setup for unpacking. */
-                        if (Py_Py3kWarningFlag && !ast_warn(c, ch,
+                        if (Py_Py3kWarningFlag && !ast_warn(c, LINENO(ch),
                             "tuple parameter unpacking has been removed in 3.x"))
                             goto error;
                         asdl_seq_SET(args, k++, compiler_complex_args(c, ch));
@@ -763,7 +760,7 @@ ast_for_arguments(struct compiling *c, const node *n)
                 if (TYPE(CHILD(ch, 0)) == NAME) {
                     PyObject *id;
                     expr_ty name;
-                    if (!forbidden_check(c, n, STR(CHILD(ch, 0))))
+                    if (!forbidden_check(c, LINENO(n), STR(CHILD(ch, 0))))
                         goto error;
                     id = NEW_IDENTIFIER(CHILD(ch, 0));
                     if (!id)
@@ -778,7 +775,7 @@ ast_for_arguments(struct compiling *c, const node *n)
                 i += 2; /* the name and the comma */
                 break;
             case STAR:
-                if (!forbidden_check(c, CHILD(n, i+1), STR(CHILD(n, i+1))))
+                if (!forbidden_check(c, LINENO(CHILD(n, i+1)), STR(CHILD(n, i+1))))
                     goto error;
                 vararg = NEW_IDENTIFIER(CHILD(n, i+1));
                 if (!vararg)
@@ -786,7 +783,7 @@ ast_for_arguments(struct compiling *c, const node *n)
                 i += 3;
                 break;
             case DOUBLESTAR:
-                if (!forbidden_check(c, CHILD(n, i+1), STR(CHILD(n, i+1))))
+                if (!forbidden_check(c, LINENO(CHILD(n, i+1)), STR(CHILD(n, i+1))))
                     goto error;
                 kwarg = NEW_IDENTIFIER(CHILD(n, i+1));
                 if (!kwarg)
@@ -912,7 +909,8 @@ ast_for_funcdef(struct compiling *c, const node *n, asdl_seq *decorator_seq)
     name = NEW_IDENTIFIER(CHILD(n, name_i));
     if (!name)
         return NULL;
-    else if (!forbidden_check(c, CHILD(n, name_i), STR(CHILD(n, name_i))))
+    else if (!forbidden_check(c, LINENO(CHILD(n, name_i)),
+                             STR(CHILD(n, name_i))))
         return NULL;
     args = ast_for_arguments(c, CHILD(n, name_i + 1));
     if (!args)
@@ -1318,7 +1316,8 @@ ast_for_genexp(struct compiling *c, const node *n)
 }
 
 static expr_ty
-pyobj_to_expr(PyObject* o, enum _expr_const constant, const node *n, PyArena *arena)
+pyobj_to_expr(PyObject* o, enum _expr_const constant, int lineno, int col_offset,
+              PyArena *arena)
 {
 	if (constant == no_const)
 		if (PyString_CheckExact(o) || PyUnicode_CheckExact(o) ||
@@ -1331,7 +1330,7 @@ pyobj_to_expr(PyObject* o, enum _expr_const constant, const node *n, PyArena *ar
 			constant = Py_SIZE(o) ? mutable_const : pure_const;
 	assert(constant);
 	PyArena_AddPyObject(arena, o);
-	return Const(o, constant, LINENO(n), n->n_col_offset, arena);
+	return Const(o, constant, lineno, col_offset, arena);
 }
 
 static PyObject *
@@ -1339,11 +1338,11 @@ constant_seq_to_pytuple(asdl_seq *elts)
 {
 	int i;
 	PyObject *t, *o, **dest;
-	t = PyTuple_New(elts->size);
+	t = PyTuple_New(asdl_seq_LEN(elts));
 	if (!t)
 		return NULL;
 	dest = ((PyTupleObject *) t)->ob_item;
-	for(i = 0; i < elts->size; i++) {
+	for(i = 0; i < asdl_seq_LEN(elts); i++) {
 		o = ((expr_ty) (elts->elements[i]))->v.Const.c;
 		Py_INCREF(o);
 		dest[i] = o;
@@ -1356,11 +1355,11 @@ constant_seq_to_pylist(asdl_seq *elts)
 {
 	int i;
 	PyObject *t, *o, **dest;
-	t = PyList_New(elts->size);
+	t = PyList_New(asdl_seq_LEN(elts));
 	if (!t)
 		return NULL;
 	dest = ((PyListObject *) t)->ob_item;
-	for(i = 0; i < elts->size; i++) {
+	for(i = 0; i < asdl_seq_LEN(elts); i++) {
 		o = ((expr_ty) (elts->elements[i]))->v.Const.c;
 		Py_INCREF(o);
 		dest[i] = o;
@@ -1380,8 +1379,7 @@ constant_seqs_to_pydict(asdl_seq *keys, asdl_seq *values)
 		k = ((expr_ty) (keys->elements[i]))->v.Const.c;
 		v = ((expr_ty) (values->elements[i]))->v.Const.c;
 		if (PyDict_SetItem(dict, k, v) < 0) {
-			Py_DECREF(k);
-			Py_DECREF(v);
+			/* k and v are borrowed from the Const nodes. */
 			Py_DECREF(dict);
 			return NULL;
 		}
@@ -1389,6 +1387,151 @@ constant_seqs_to_pydict(asdl_seq *keys, asdl_seq *values)
 	return dict;
 }
 
+/* The kind of constant the expression e is, or no_const. */
+#define CONSTANT(e) ((e)->kind == Const_kind ? (e)->v.Const.constant : \
+					 no_const)
+
+static enum _expr_const
+seq_constant(asdl_seq *elts)
+{
+	int i;
+	/* Defaults to constant value, but if at least one expression wasn't
+	   a constant, reverts to no_const. */
+	enum _expr_const constant = pure_const;
+	for (i = 0; i < asdl_seq_LEN(elts); i++)
+		constant &= CONSTANT((expr_ty)asdl_seq_GET(elts, i));
+	return constant;
+}
+
+/* The functions below build the nodes for displays and literals out of
+   their parts, folding them into constants where possible.  Both the
+   CST front end and the token parser (see _PyAST_FromString()) use them.
+*/
+
+static expr_ty
+fold_tuple(struct compiling *c, asdl_seq *elts, int lineno, int col_offset)
+{
+	enum _expr_const constant = seq_constant(elts);
+	if (!c->c_no_folding && constant) {
+		PyObject *np = constant_seq_to_pytuple(elts);
+		if (np == NULL)
+			return NULL;
+		return pyobj_to_expr(np, constant == content_const ?
+							 mutable_const : constant,
+							 lineno, col_offset, c->c_arena);
+	}
+	return Tuple(elts, Load, lineno, col_offset, c->c_arena);
+}
+
+static expr_ty
+fold_list(struct compiling *c, asdl_seq *elts, int lineno, int col_offset)
+{
+	enum _expr_const constant = seq_constant(elts);
+	if (!c->c_no_folding && constant) {
+		PyObject *np = constant_seq_to_pylist(elts);
+		if (np == NULL)
+			return NULL;
+		return pyobj_to_expr(np, constant == pure_const ?
+							 content_const : mutable_const,
+							 lineno, col_offset, c->c_arena);
+	}
+	return List(elts, Load, lineno, col_offset, c->c_arena);
+}
+
+static expr_ty
+fold_dict(struct compiling *c, asdl_seq *keys, asdl_seq *values,
+		  int lineno, int col_offset)
+{
+	int i;
+	/* Defaults to constant value, but if at least one expression wasn't
+	   a constant, reverts to no_const. */
+	enum _expr_const constant = pure_const;
+	for (i = 0; i < asdl_seq_LEN(keys); i++) {
+		expr_ty e = (expr_ty)asdl_seq_GET(keys, i);
+		if (e->kind == Const_kind) {
+			if ((e->v.Const.constant == mutable_const ||
+				e->v.Const.constant == content_const) &&
+				c->c_strict_folding) {
+				char buf[128];
+				PyOS_snprintf(buf, sizeof(buf),
+							  "unhashable type %s for dictionary key",
+							  e->v.Const.c->ob_type->tp_name);
+				ast_error_at(e->lineno, buf);
+				return NULL;
+			}
+		}
+		else
+			constant = no_const;
+		/* Updates the constant flag. */
+		constant &= CONSTANT((expr_ty)asdl_seq_GET(values, i));
+	}
+	if (!c->c_no_folding && constant) {
+		PyObject *np = constant_seqs_to_pydict(keys, values);
+		if (np == NULL)
+			return NULL;
+		return pyobj_to_expr(np, constant == pure_const ?
+							 content_const : mutable_const,
+							 lineno, col_offset, c->c_arena);
+	}
+	return Dict(keys, values, lineno, col_offset, c->c_arena);
+}
+
+static expr_ty
+fold_repr(struct compiling *c, expr_ty e, int lineno, int col_offset)
+{
+	if (!c->c_no_folding && e->kind == Const_kind) {
+		PyObject *result = PyObject_Repr(e->v.Const.c);
+		if (!result)
+			if (c->c_strict_folding)
+				return ast_check_error(c, lineno,
+									   "invalid backquote operation");
+			else {
+				PyErr_Clear();
+				return Repr(e, lineno, col_offset, c->c_arena);
+			}
+		return pyobj_to_expr(result, pure_const, lineno, col_offset,
+							 c->c_arena);
+	}
+	return Repr(e, lineno, col_offset, c->c_arena);
+}
+
+/* None, either as a name or as a constant */
+static expr_ty
+none_to_expr(struct compiling *c, int lineno, int col_offset)
+{
+	PyObject *name;
+
+	if (!c->c_no_folding) {
+		Py_INCREF(Py_None);
+		return pyobj_to_expr(Py_None, pure_const, lineno, col_offset,
+							 c->c_arena);
+	}
+	name = new_identifier("None", c->c_arena);
+	if (!name)
+		return NULL;
+	return Name(name, Load, lineno, col_offset, c->c_arena);
+}
+
+static expr_ty
+str_to_expr(struct compiling *c, PyObject *str, int lineno, int col_offset)
+{
+	if (c->c_no_folding) {
+		PyArena_AddPyObject(c->c_arena, str);
+		return Str(str, lineno, col_offset, c->c_arena);
+	}
+	return pyobj_to_expr(str, pure_const, lineno, col_offset, c->c_arena);
+}
+
+static expr_ty
+num_to_expr(struct compiling *c, PyObject *pynum, int lineno, int col_offset)
+{
+	if (c->c_no_folding) {
+		PyArena_AddPyObject(c->c_arena, pynum);
+		return Num(pynum, lineno, col_offset, c->c_arena);
+	}
+	return pyobj_to_expr(pynum, pure_const, lineno, col_offset, c->c_arena);
+}
+
 static expr_ty
 ast_for_atom(struct compiling *c, const node *n)
 {
@@ -1402,19 +1545,8 @@ ast_for_atom(struct compiling *c, const node *n)
 		PyObject *name;
 
         /* "None" identifier will be converted to the None constant */
-		if (!c->c_no_folding)
-			if (!strcmp(STR(ch), "None")) {
-				Py_INCREF(Py_None);
-				return pyobj_to_expr(Py_None, pure_const, n, c->c_arena);
-			}
-			/*else if (!strcmp(STR(ch), "False")) {
-				Py_INCREF(Py_False);
-				return pyobj_to_expr(Py_False, pure_const, n, c->c_arena);
-			}
-			else if (!strcmp(STR(ch), "True")) {
-				Py_INCREF(Py_True);
-				return pyobj_to_expr(Py_True, pure_const, n, c->c_arena);
-			}*/
+		if (!c->c_no_folding && !strcmp(STR(ch), "None"))
+			return none_to_expr(c, LINENO(n), n->n_col_offset);
 
         /* All names start in Load context, but may later be
            changed. */
@@ -1448,36 +1580,19 @@ ast_for_atom(struct compiling *c, const node *n)
 #endif
             return NULL;
         }
-        if (c->c_no_folding) {
-			PyArena_AddPyObject(c->c_arena, str);
-			return Str(str, LINENO(n), n->n_col_offset, c->c_arena);
-        }
-        else
-			return pyobj_to_expr(str, pure_const, n, c->c_arena);
+        return str_to_expr(c, str, LINENO(n), n->n_col_offset);
     }
     case NUMBER: {
         PyObject *pynum = parsenumber(c, STR(ch));
 		if (!pynum)
 			return NULL;
-        if (c->c_no_folding) {
-			PyArena_AddPyObject(c->c_arena, pynum);
-			return Num(pynum, LINENO(n), n->n_col_offset, c->c_arena);
-        }
-        else
-			return pyobj_to_expr(pynum, pure_const, n, c->c_arena);
+        return num_to_expr(c, pynum, LINENO(n), n->n_col_offset);
     }
     case LPAR: /* some parenthesized expressions */
         ch = CHILD(n, 1);
-        
+
         if (TYPE(ch) == RPAR)
-	        if (c->c_no_folding)
-	            return Tuple(NULL, Load, LINENO(n), n->n_col_offset, c->c_arena);
-	        else {
-				PyObject *pyemptytuple = PyTuple_New(0);
-				if (!pyemptytuple)
-					return NULL;
-				return pyobj_to_expr(pyemptytuple, pure_const, n, c->c_arena);
-			}
+            return fold_tuple(c, NULL, LINENO(n), n->n_col_offset);
 		if (TYPE(ch) == yield_expr)
 			return ast_for_expr(c, ch);
 		if ((NCH(ch) > 1) && (TYPE(CHILD(ch, 1)) == gen_for))
@@ -1485,115 +1600,60 @@ ast_for_atom(struct compiling *c, const node *n)
 		return ast_for_testlist_gexp(c, ch);
     case LSQB: /* list (or list comprehension) */
         ch = CHILD(n, 1);
-        
+
 		if (TYPE(ch) == RSQB)
-	        if (c->c_no_folding)
-	            return List(NULL, Load, LINENO(n), n->n_col_offset, c->c_arena);
-	        else {
-				PyObject *pyemptylist = PyList_New(0);
-				if (!pyemptylist)
-					return NULL;
-				return pyobj_to_expr(pyemptylist, content_const, n, c->c_arena);
-			}
-        
+            return fold_list(c, NULL, LINENO(n), n->n_col_offset);
+
         REQ(ch, listmaker);
         if (NCH(ch) == 1 || TYPE(CHILD(ch, 1)) == COMMA) {
-			enum _expr_const constant;
-            asdl_seq *elts = seq_for_testlist(c, ch, &constant);
+            asdl_seq *elts = seq_for_testlist(c, ch);
             if (!elts)
                 return NULL;
-			if (!c->c_no_folding && constant) {
-				PyObject *np = constant_seq_to_pylist(elts);
-				if (np == NULL)
-					return NULL;
-				return pyobj_to_expr(np, constant == pure_const ?
-									 content_const : mutable_const,
-									 n, c->c_arena);
-			}
-			else
-				return List(elts, Load, LINENO(n), n->n_col_offset, c->c_arena);
+            return fold_list(c, elts, LINENO(n), n->n_col_offset);
         }
         return ast_for_listcomp(c, ch);
     case LBRACE: {
         /* dictmaker: test ':' test (',' test ':' test)* [','] */
         int i, size;
         asdl_seq *keys, *values;
-		enum _expr_const constant;
-        
+
         ch = CHILD(n, 1);
         size = (NCH(ch) + 1) / 4; /* +1 in case no trailing comma */
         keys = asdl_seq_new(size, c->c_arena);
         if (!keys)
             return NULL;
-        
+
         values = asdl_seq_new(size, c->c_arena);
         if (!values)
             return NULL;
-        
-		/* Defaults to constant value, but if at least one expression wasn't
-		   a constant, reverts to no_const. */
-		constant = pure_const;
+
         for (i = 0; i < NCH(ch); i += 4) {
             expr_ty e;
-            
+
             e = ast_for_expr(c, CHILD(ch, i));
             if (!e)
                 return NULL;
-			if (e->kind == Const_kind) {
-				if ((e->v.Const.constant == mutable_const ||
-					e->v.Const.constant == content_const) &&
-					c->c_strict_folding) {
-					char buf[128];
-					PyOS_snprintf(buf, sizeof(buf),
-								  "unhashable type %s for dictionary key",
-								  e->v.Const.c->ob_type->tp_name);
-					ast_error(CHILD(ch, i), buf);
-					return NULL;
-				}
-			}
-			else
-				constant = no_const;
 
             asdl_seq_SET(keys, i / 4, e);
 
             e = ast_for_expr(c, CHILD(ch, i + 2));
             if (!e)
                 return NULL;
-			/* Updates the constant flag. */
-			constant &= e->kind == Const_kind ? e->v.Const.constant : no_const;
 
             asdl_seq_SET(values, i / 4, e);
         }
-		if (!c->c_no_folding && constant) {
-			PyObject *np = constant_seqs_to_pydict(keys, values);
-			if (np == NULL)
-				return NULL;
-			return pyobj_to_expr(np, constant == pure_const ?
-								 content_const : mutable_const, n, c->c_arena);
-		}
-		return Dict(keys, values, LINENO(n), n->n_col_offset, c->c_arena);
+        return fold_dict(c, keys, values, LINENO(n), n->n_col_offset);
     }
     case BACKQUOTE: { /* repr */
         expr_ty e;
         if (Py_Py3kWarningFlag &&
-            !ast_warn(c, n, "backquote not supported in 3.x; use repr()"))
+            !ast_warn(c, LINENO(n),
+                      "backquote not supported in 3.x; use repr()"))
             return NULL;
         e = ast_for_testlist(c, CHILD(n, 1));
         if (!e)
             return NULL;
-		if (!c->c_no_folding && e->kind == Const_kind) {
-			PyObject *result = PyObject_Repr(e->v.Const.c);
-			if (!result)
-				if (c->c_strict_folding)
-					return ast_check_error(c, n,
-										   "invalid backquote operation");
-				else {
-					PyErr_Clear();
-					return Repr(e, LINENO(n), n->n_col_offset, c->c_arena);
-				}
-			return pyobj_to_expr(result, pure_const, n, c->c_arena);
-		}
-		return Repr(e, LINENO(n), n->n_col_offset, c->c_arena);
+        return fold_repr(c, e, LINENO(n), n->n_col_offset);
     }
     default:
         PyErr_Format(PyExc_SystemError, "unhandled atom %d", TYPE(ch));
@@ -1659,14 +1719,7 @@ ast_for_slice(struct compiling *c, const node *n)
         if (NCH(ch) == 1) {
             /* No expression, so step is None */
             ch = CHILD(ch, 0);
-			if (c->c_no_folding)
-				step = Name(new_identifier("None", c->c_arena), Load,
-							LINENO(ch), ch->n_col_offset, c->c_arena);
-			else {
-	            /* None is a constant */
-				Py_INCREF(Py_None);
-				step = pyobj_to_expr(Py_None, pure_const, ch, c->c_arena);
-			}
+            step = none_to_expr(c, LINENO(ch), ch->n_col_offset);
             if (!step)
                 return NULL;
         } else {
@@ -1684,16 +1737,15 @@ ast_for_slice(struct compiling *c, const node *n)
 
 static expr_ty
 unfolded_binop(expr_ty expr1, operator_ty newoperator, expr_ty expr2,
-		   const node *n, struct compiling *c)
+		   int lineno, int col_offset, struct compiling *c)
 {
-	return BinOp(expr1, newoperator, expr2, LINENO(n), n->n_col_offset,
-				 c->c_arena);
+	return BinOp(expr1, newoperator, expr2, lineno, col_offset, c->c_arena);
 }
 
 /* Fold binary ops on constants: BINARY_OP(CONST1, CONST2) */
 static expr_ty
 fold_binop(expr_ty expr1, operator_ty newoperator, expr_ty expr2,
-		   const node *n, struct compiling *c)
+		   int lineno, int col_offset, struct compiling *c)
 {
 	Py_ssize_t size;
 	if (!c->c_no_folding && expr1->kind == Const_kind &&
@@ -1716,7 +1768,8 @@ fold_binop(expr_ty expr1, operator_ty newoperator, expr_ty expr2,
 				/* Cannot fold this operation statically since
 							   the result can depend on the run-time presence
 							   of the -Qnew flag */
-				return unfolded_binop(expr1, newoperator, expr2, n, c);
+				return unfolded_binop(expr1, newoperator, expr2, lineno,
+									  col_offset, c);
 			case Mod:
 				result = PyNumber_Remainder(obj1, obj2);
 				break;
@@ -1748,27 +1801,30 @@ fold_binop(expr_ty expr1, operator_ty newoperator, expr_ty expr2,
 		}
 		if (!result)
 			if (c->c_strict_folding)
-				return ast_check_error(c, n, "invalid binary operation");
+				return ast_check_error(c, lineno, "invalid binary operation");
 			else {
 				PyErr_Clear();
-				return unfolded_binop(expr1, newoperator, expr2, n, c);
+				return unfolded_binop(expr1, newoperator, expr2, lineno,
+									  col_offset, c);
 			}
 		size = PyObject_Size(result);
 		if (size == -1)
 			PyErr_Clear();
 		else if (size > 32) {
 			Py_DECREF(result);
-			return unfolded_binop(expr1, newoperator, expr2, n, c);
+			return unfolded_binop(expr1, newoperator, expr2, lineno,
+								  col_offset, c);
 		}
 		if (newoperator == Mod && (PyString_CheckExact(obj1) ||
 			PyUnicode_CheckExact(obj1)))
 			constant = pure_const;
 		else
 			constant = expr1->v.Const.constant & expr2->v.Const.constant;
-		return pyobj_to_expr(result, constant, n, c->c_arena);
+		return pyobj_to_expr(result, constant, lineno, col_offset, c->c_arena);
 	}
 	else
-		return unfolded_binop(expr1, newoperator, expr2, n, c);
+		return unfolded_binop(expr1, newoperator, expr2, lineno, col_offset,
+							  c);
 }
 
 static expr_ty
@@ -1791,11 +1847,12 @@ ast_for_binop(struct compiling *c, const node *n)
         if (!expr2)
             return NULL;
 
-        newoperator = get_operator(CHILD(n, 1));
+        newoperator = get_operator(TYPE(CHILD(n, 1)));
         if (!newoperator)
             return NULL;
 
-        expr1 = fold_binop(expr1, newoperator, expr2, n, c);
+        expr1 = fold_binop(expr1, newoperator, expr2, LINENO(n),
+                           n->n_col_offset, c);
         if (!expr1)
             return NULL;
 
@@ -1803,7 +1860,7 @@ ast_for_binop(struct compiling *c, const node *n)
         for (i = 1; i < nops; i++) {
             const node* next_oper = CHILD(n, i * 2 + 1);
 
-            newoperator = get_operator(next_oper);
+            newoperator = get_operator(TYPE(next_oper));
             if (!newoperator)
                 return NULL;
 
@@ -1811,7 +1868,8 @@ ast_for_binop(struct compiling *c, const node *n)
             if (!expr2)
                 return NULL;
 
-			expr1 = fold_binop(expr1, newoperator, expr2, next_oper, c);
+			expr1 = fold_binop(expr1, newoperator, expr2, LINENO(next_oper),
+							   next_oper->n_col_offset, c);
 			if (!expr1)
 				return NULL;
         }
@@ -1819,24 +1877,103 @@ ast_for_binop(struct compiling *c, const node *n)
 }
 
 static expr_ty
-ast_subscript_folding(struct compiling *c, const node *n, expr_ty left_expr,
-					  PyObject *right_obj)
+ast_subscript_folding(struct compiling *c, int lineno, int col_offset,
+					  expr_ty left_expr, PyObject *right_obj)
 {
 	PyObject *e;
 	e = PyObject_GetItem(left_expr->v.Const.c, right_obj);
 	if (!e)
-		return ast_check_error(c, n, "invalid subscription operation");
-	return pyobj_to_expr(e, no_const, n, c->c_arena);
+		return ast_check_error(c, lineno, "invalid subscription operation");
+	return pyobj_to_expr(e, no_const, lineno, col_offset, c->c_arena);
+}
+
+/* Subscription of left_expr by a single slice */
+static expr_ty
+fold_subscript(struct compiling *c, expr_ty left_expr, slice_ty slc,
+			   int lineno, int col_offset)
+{
+	if (!c->c_no_folding && slc->kind == Index_kind &&
+		slc->v.Index.value->kind == Const_kind &&
+		left_expr->kind == Const_kind) {
+		expr_ty e = ast_subscript_folding(c, lineno, col_offset, left_expr,
+										  slc->v.Index.value->v.Const.c);
+		if (e || c->c_strict_folding)
+			return e;
+		PyErr_Clear();
+	}
+	return Subscript(left_expr, slc, Load, lineno, col_offset, c->c_arena);
+}
+
+/* Subscription of left_expr by a list of slices (x[a, b] or x[a,]) */
+static expr_ty
+fold_subscripts(struct compiling *c, expr_ty left_expr, asdl_seq *slices,
+				int lineno, int col_offset)
+{
+	/* The grammar is ambiguous here. The ambiguity is resolved
+	   by treating the sequence as a tuple literal if there are
+	   no slice features.
+	*/
+	int j;
+	slice_ty slc;
+	bool simple = true;
+	enum _expr_const constant;
+	asdl_seq *elts;
+	expr_ty e;
+
+	/* Defaults to constant value, but if at least one expression
+	   wasn't a constant, reverts to no_const. */
+	constant = pure_const;
+	for (j = 0; j < asdl_seq_LEN(slices); j++) {
+		slc = (slice_ty)asdl_seq_GET(slices, j);
+		if (slc->kind == Index_kind)
+			/* Updates the constant flag. */
+			constant &= CONSTANT(slc->v.Index.value);
+		else
+			simple = false;
+	}
+	if (!simple)
+		return Subscript(left_expr, ExtSlice(slices, c->c_arena),
+						 Load, lineno, col_offset, c->c_arena);
+	/* extract Index values and put them in a Tuple */
+	elts = asdl_seq_new(asdl_seq_LEN(slices), c->c_arena);
+	if (!elts)
+		return NULL;
+	for (j = 0; j < asdl_seq_LEN(slices); ++j) {
+		slc = (slice_ty)asdl_seq_GET(slices, j);
+		assert(slc->kind == Index_kind  && slc->v.Index.value);
+		asdl_seq_SET(elts, j, slc->v.Index.value);
+	}
+	if (!c->c_no_folding && constant) {
+		PyObject *np = constant_seq_to_pytuple(elts);
+		if (np == NULL)
+			return NULL;
+		if (left_expr->kind == Const_kind) {
+			e = ast_subscript_folding(c, lineno, col_offset, left_expr, np);
+			if (e || c->c_strict_folding)
+				return e;
+			PyErr_Clear();
+			e = Tuple(elts, Load, lineno, col_offset, c->c_arena);
+		}
+		else
+			e = pyobj_to_expr(np, constant == content_const ?
+							  mutable_const : constant, lineno, col_offset,
+							  c->c_arena);
+	}
+	else
+		e = Tuple(elts, Load, lineno, col_offset, c->c_arena);
+	if (!e)
+		return NULL;
+	return Subscript(left_expr, Index(e, c->c_arena),
+					 Load, lineno, col_offset, c->c_arena);
 }
 
 static expr_ty
 ast_for_trailer(struct compiling *c, const node *n, expr_ty left_expr)
 {
-    /* trailer: '(' [arglist] ')' | '[' subscriptlist ']' | '.' NAME 
+    /* trailer: '(' [arglist] ')' | '[' subscriptlist ']' | '.' NAME
        subscriptlist: subscript (',' subscript)* [',']
        subscript: '.' '.' '.' | test | [test] ':' [test] [sliceop]
      */
-    expr_ty e;
     REQ(n, trailer);
     if (TYPE(CHILD(n, 0)) == LPAR)
         if (NCH(n) == 2)
@@ -1859,96 +1996,39 @@ ast_for_trailer(struct compiling *c, const node *n, expr_ty left_expr)
             slice_ty slc = ast_for_slice(c, CHILD(n, 0));
             if (!slc)
                 return NULL;
-			if (!c->c_no_folding && slc->kind == Index_kind &&
-				slc->v.Index.value->kind == Const_kind &&
-				left_expr->kind == Const_kind) {
-				e = ast_subscript_folding(c, n, left_expr,
-												slc->v.Index.value->v.Const.c);
-				if (e || c->c_strict_folding)
-					return e;
-				PyErr_Clear();
-			}
-            return Subscript(left_expr, slc, Load, LINENO(n), n->n_col_offset,
-							 c->c_arena);
+            return fold_subscript(c, left_expr, slc, LINENO(n),
+                                  n->n_col_offset);
         }
         else {
-            /* The grammar is ambiguous here. The ambiguity is resolved 
-               by treating the sequence as a tuple literal if there are
-               no slice features.
-            */
             int j;
             slice_ty slc;
-            bool simple = true;
-			enum _expr_const constant;
-            asdl_seq *slices, *elts;
+            asdl_seq *slices;
             slices = asdl_seq_new((NCH(n) + 1) / 2, c->c_arena);
             if (!slices)
                 return NULL;
-			/* Defaults to constant value, but if at least one expression
-			   wasn't a constant, reverts to no_const. */
-			constant = pure_const;
             for (j = 0; j < NCH(n); j += 2) {
                 slc = ast_for_slice(c, CHILD(n, j));
                 if (!slc)
                     return NULL;
-                if (slc->kind == Index_kind)
-					/* Updates the constant flag. */
-					constant &= slc->v.Index.value->kind == Const_kind ?
-						slc->v.Index.value->v.Const.constant : no_const;
-				else
-                    simple = false;
                 asdl_seq_SET(slices, j / 2, slc);
             }
-            if (!simple)
-                return Subscript(left_expr, ExtSlice(slices, c->c_arena),
-							  Load, LINENO(n), n->n_col_offset, c->c_arena);
-			/* extract Index values and put them in a Tuple */
-			elts = asdl_seq_new(asdl_seq_LEN(slices), c->c_arena);
-			if (!elts)
-				return NULL;
-			for (j = 0; j < asdl_seq_LEN(slices); ++j) {
-				slc = (slice_ty)asdl_seq_GET(slices, j);
-				assert(slc->kind == Index_kind  && slc->v.Index.value);
-				asdl_seq_SET(elts, j, slc->v.Index.value);
-			}
-			if (!c->c_no_folding && constant) {
-				PyObject *np = constant_seq_to_pytuple(elts);
-				if (np == NULL)
-					return NULL;
-				if (left_expr->kind == Const_kind) {
-					e = ast_subscript_folding(c, n, left_expr, np);
-					if (e || c->c_strict_folding)
-						return e;
-					PyErr_Clear();
-					e = Tuple(elts, Load, LINENO(n), n->n_col_offset,
-							  c->c_arena);
-				}
-				else
-					e = pyobj_to_expr(np, constant == content_const ?
-									  mutable_const : constant, n, c->c_arena);
-			}
-			else
-				e = Tuple(elts, Load, LINENO(n), n->n_col_offset, c->c_arena);
-			if (!e)
-				return NULL;
-			return Subscript(left_expr, Index(e, c->c_arena),
-						  Load, LINENO(n), n->n_col_offset, c->c_arena);
+            return fold_subscripts(c, left_expr, slices, LINENO(n),
+                                   n->n_col_offset);
         }
     }
 }
 
 static expr_ty
 unfolded_unop(unaryop_ty newoperator, expr_ty expression,
-			  const node *n, struct compiling *c)
+			  int lineno, int col_offset, struct compiling *c)
 {
-	return UnaryOp(newoperator, expression, LINENO(n), n->n_col_offset,
-				   c->c_arena);
+	return UnaryOp(newoperator, expression, lineno, col_offset, c->c_arena);
 }
 
 /* Fold unary ops on constants: UNARY_OP(CONST) */
 static expr_ty
 fold_unop(unaryop_ty newoperator, expr_ty expression,
-		   const node *n, struct compiling *c)
+		  int lineno, int col_offset, struct compiling *c)
 {
 	if (!c->c_no_folding && expression->kind == Const_kind) {
 		PyObject *obj, *result = NULL;
@@ -1960,7 +2040,7 @@ fold_unop(unaryop_ty newoperator, expr_ty expression,
 			case Not: {
 				int value = PyObject_Not(obj);
 				if (value < 0)
-					return ast_check_error(c, n, "invalid not operation");
+					return ast_check_error(c, lineno, "invalid not operation");
 				result = value ? Py_True : Py_False;
 				Py_INCREF(result);
 				break;
@@ -1978,20 +2058,67 @@ fold_unop(unaryop_ty newoperator, expr_ty expression,
 				}
 				else
 					/* Preserve the sign of -0.0 */
-					return unfolded_unop(USub, expression, n, c);
+					return unfolded_unop(USub, expression, lineno,
+										 col_offset, c);
 			}
 		}
 		if (!result)
 			if (c->c_strict_folding)
-				return ast_check_error(c, n, "invalid unary operation");
+				return ast_check_error(c, lineno, "invalid unary operation");
 			else {
 				PyErr_Clear();
-				return unfolded_unop(newoperator, expression, n, c);
+				return unfolded_unop(newoperator, expression, lineno,
+									 col_offset, c);
 			}
-		return pyobj_to_expr(result, no_const, n, c->c_arena);
+		return pyobj_to_expr(result, no_const, lineno, col_offset, c->c_arena);
+	}
+	else
+		return unfolded_unop(newoperator, expression, lineno, col_offset, c);
+}
+
+static expr_ty
+fold_not(struct compiling *c, expr_ty expression, int lineno, int col_offset)
+{
+	/* not (a is b) -->  a is not b
+	   not (a in b) -->  a not in b
+	   not (a is not b) -->  a is b
+	   not (a not in b) -->  a in b
+	*/
+	if (expression->kind == Compare_kind &&
+		expression->v.Compare.ops->size == 1 &&
+		expression->v.Compare.ops->elements[0] >= Is &&
+		expression->v.Compare.ops->elements[0] <= NotIn) {
+		expression->v.Compare.ops->elements[0] =
+			(expression->v.Compare.ops->elements[0] - 1 ^ 1) + 1;
+		return expression;
 	}
 	else
-		return unfolded_unop(newoperator, expression, n, c);
+		return fold_unop(Not, expression, lineno, col_offset, c);
+}
+
+/* A constant right operand of in / not in is only searched, so a list
+   can become a tuple. */
+static int
+fold_compare_operand(struct compiling *c, cmpop_ty op, expr_ty expression)
+{
+	if ((expression->kind == Const_kind) && (op == In || op == NotIn)) {
+		PyObject *v, *w;
+		expression->v.Const.constant = pure_const;
+		v = w = expression->v.Const.c;
+		if (PyList_CheckExact(v))
+			w = PyList_AsTuple(v);
+		else if (PyDict_CheckExact(v))
+			;
+			//w = PyFrozenSet_New(v);
+		if (!w)
+			return 0;
+		if (v != w) {
+			v = w;
+			PyArena_AddPyObject(c->c_arena, v);
+		}
+		expression->v.Const.c = v;
+	}
+	return 1;
 }
 
 static expr_ty
@@ -2045,7 +2172,7 @@ ast_for_factor(struct compiling *c, const node *n)
 						 TYPE(CHILD(n, 0)));
 			return NULL;
     }
-	return fold_unop(newoperator, expression, n, c);
+	return fold_unop(newoperator, expression, LINENO(n), n->n_col_offset, c);
 }
 
 static expr_ty
@@ -2076,7 +2203,7 @@ ast_for_power(struct compiling *c, const node *n)
         expr_ty f = ast_for_expr(c, CHILD(n, NCH(n) - 1));
         if (!f)
             return NULL;
-		tmp = fold_binop(e, Pow, f, n, c);
+		tmp = fold_binop(e, Pow, f, LINENO(n), n->n_col_offset, c);
         if (!tmp)
             return NULL;
         e = tmp;
@@ -2157,21 +2284,7 @@ ast_for_expr(struct compiling *c, const node *n)
                 expr_ty expression = ast_for_expr(c, CHILD(n, 1));
                 if (!expression)
                     return NULL;
-				/* not (a is b) -->  a is not b
-				   not (a in b) -->  a not in b
-				   not (a is not b) -->  a is b
-				   not (a not in b) -->  a in b
-				*/
-				if (expression->kind == Compare_kind &&
-					expression->v.Compare.ops->size == 1 &&
-					expression->v.Compare.ops->elements[0] >= Is &&
-					expression->v.Compare.ops->elements[0] <= NotIn) {
-					expression->v.Compare.ops->elements[0] =
-						(expression->v.Compare.ops->elements[0] - 1 ^ 1) + 1;
-					return expression;
-				}
-				else
-					return fold_unop(Not, expression, n, c);
+                return fold_not(c, expression, LINENO(n), n->n_col_offset);
             }
         case comparison:
             if (NCH(n) == 1) {
@@ -2200,25 +2313,9 @@ ast_for_expr(struct compiling *c, const node *n)
                     if (!expression)
                         return NULL;
 
-					if ((expression->kind == Const_kind) &&
-						(newoperator == In || newoperator == NotIn)) {
-						PyObject *v, *w;
-						expression->v.Const.constant = pure_const;
-						v = w = expression->v.Const.c;
-						if (PyList_CheckExact(v))
-							w = PyList_AsTuple(v);
-						else if (PyDict_CheckExact(v))
-							;
-							//w = PyFrozenSet_New(v);
-						if (!w)
-							return NULL;
-						if (v != w) {
-							v = w;
-							PyArena_AddPyObject(c->c_arena, v);
-						}
-						expression->v.Const.c = v;
-					}
-                        
+                    if (!fold_compare_operand(c, newoperator, expression))
+                        return NULL;
+
                     asdl_seq_SET(ops, i / 2, newoperator);
                     asdl_seq_SET(cmps, i / 2, expression);
                 }
@@ -2369,7 +2466,8 @@ ast_for_call(struct compiling *c, const node *n, expr_ty func)
                     return NULL;
                 }
                 key = e->v.Name.id;
-                if (!forbidden_check(c, CHILD(ch, 0), PyBytes_AS_STRING(key)))
+                if (!forbidden_check(c, LINENO(CHILD(ch, 0)),
+                                     PyBytes_AS_STRING(key)))
                     return NULL;
                 for (k = 0; k < nkeywords; k++) {
                     tmp = PyString_AS_STRING(
@@ -2426,20 +2524,10 @@ ast_for_testlist(struct compiling *c, const node* n)
     if (NCH(n) == 1)
         return ast_for_expr(c, CHILD(n, 0));
     else {
-		enum _expr_const constant;
-        asdl_seq *tmp = seq_for_testlist(c, n, &constant);
+        asdl_seq *tmp = seq_for_testlist(c, n);
         if (!tmp)
             return NULL;
-		if (!c->c_no_folding && constant) {
-			PyObject *np = constant_seq_to_pytuple(tmp);
-			if (np == NULL)
-				return NULL;
-			return pyobj_to_expr(np, constant == content_const ?
-								 constant = mutable_const : constant,
-								 n, c->c_arena);
-		}
-        else
-			return Tuple(tmp, Load, LINENO(n), n->n_col_offset, c->c_arena);
+        return fold_tuple(c, tmp, LINENO(n), n->n_col_offset);
     }
 }
 
@@ -2459,7 +2547,6 @@ static asdl_seq*
 ast_for_class_bases(struct compiling *c, const node* n)
 {
     /* testlist: test (',' test)* [','] */
-	enum _expr_const constant;
     assert(NCH(n) > 0);
     REQ(n, testlist);
     if (NCH(n) == 1) {
@@ -2474,7 +2561,7 @@ ast_for_class_bases(struct compiling *c, const node* n)
         return bases;
     }
 
-    return seq_for_testlist(c, n, &constant);
+    return seq_for_testlist(c, n);
 }
 
 static stmt_ty
@@ -2517,7 +2604,7 @@ ast_for_expr_stmt(struct compiling *c, const node *n)
             case Name_kind: {
                 const char *var_name = PyBytes_AS_STRING(expr1->v.Name.id);
                 if ((var_name[0] == 'N' || var_name[0] == 'T' || var_name[0] == 'F') &&
-                    !forbidden_check(c, ch, var_name))
+                    !forbidden_check(c, LINENO(ch), var_name))
                     return NULL;
                 break;
             }
@@ -2529,7 +2616,7 @@ ast_for_expr_stmt(struct compiling *c, const node *n)
                           "assignment");
                 return NULL;
         }
-        if(!set_context(c, expr1, Store, ch))
+        if(!set_context(c, expr1, Store, LINENO(ch)))
             return NULL;
 
         ch = CHILD(n, 2);
@@ -2571,7 +2658,7 @@ ast_for_expr_stmt(struct compiling *c, const node *n)
             if (!e) 
                 return NULL;
 
-            if (!set_context(c, e, Store, CHILD(n, i)))
+            if (!set_context(c, e, Store, LINENO(CHILD(n, i))))
                 return NULL;
 
             asdl_seq_SET(targets, i / 2, e);
@@ -2636,7 +2723,7 @@ ast_for_exprlist(struct compiling *c, const node *n, expr_context_ty context)
         if (!e)
             return NULL;
         asdl_seq_SET(seq, i / 2, e);
-        if (context && !set_context(c, e, context, CHILD(n, i)))
+        if (context && !set_context(c, e, context, LINENO(CHILD(n, i))))
             return NULL;
     }
     return seq;
@@ -3328,7 +3415,7 @@ ast_for_except_clause(struct compiling *c, const node *exc, node *body)
         expr_ty e = ast_for_expr(c, CHILD(exc, 3));
         if (!e)
             return NULL;
-        if (!set_context(c, e, Store, CHILD(exc, 3)))
+        if (!set_context(c, e, Store, LINENO(CHILD(exc, 3))))
             return NULL;
         expression = ast_for_expr(c, CHILD(exc, 1));
         if (!expression)
@@ -3450,7 +3537,7 @@ ast_for_with_stmt(struct compiling *c, const node *n)
         if (!optional_vars) {
             return NULL;
         }
-        if (!set_context(c, optional_vars, Store, n)) {
+        if (!set_context(c, optional_vars, Store, LINENO(n))) {
             return NULL;
         }
         suite_index = 4;
@@ -3473,7 +3560,7 @@ ast_for_classdef(struct compiling *c, const node *n, asdl_seq *decorator_seq)
     
     REQ(n, classdef);
 
-    if (!forbidden_check(c, n, STR(CHILD(n, 1))))
+    if (!forbidden_check(c, LINENO(n), STR(CHILD(n, 1))))
             return NULL;
 
     if (NCH(n) == 4) {
@@ -3843,3 +3930,2391 @@ parsestrplus(struct compiling *c, const node *n)
         Py_XDECREF(v);
         return NULL;
 }
+
+/* Token parser
+
+   _PyAST_FromString() and _PyAST_FromFile() build the AST straight from
+   the tokens, without the concrete syntax tree that pgen makes and
+   PyAST_FromNode() walks.  They follow Grammar/Grammar by recursive
+   descent, deciding on one token of lookahead as pgen does, and make the
+   same nodes at the same positions through the builders above.
+
+   Only sources that compile are handled.  On a syntax error, found by
+   the tokenizer, the parser or a builder, or on one of the rare cases
+   noted below, they return NULL without an exception set, and the caller
+   parses the source again through the CST, which reports the error as
+   before: pgen finds errors in a different order than the builders do.
+   Any other error, such as a MemoryError, is passed on as it is.
+
+   The parser is kept by hand.  GRAMMAR_MD5 is the MD5 of the rules of
+   the Grammar/Grammar it follows, without the comments and blank lines;
+   test_compile fails when they differ, until the parser and this digest
+   are brought up to date.
+*/
+#define GRAMMAR_MD5 "ceff1bac51a2d3be6a6eafe954f34f4b"
+
+
+/* Keywords, as token types after the tokenizer's own */
+enum {
+	KW_AND = N_TOKENS, KW_AS, KW_ASSERT, KW_BREAK, KW_CLASS, KW_CONTINUE,
+	KW_DEF, KW_DEL, KW_ELIF, KW_ELSE, KW_EXCEPT, KW_EXEC, KW_FINALLY,
+	KW_FOR, KW_FROM, KW_GLOBAL, KW_IF, KW_IMPORT, KW_IN, KW_IS,
+	KW_LAMBDA, KW_NOT, KW_OR, KW_PASS, KW_PRINT, KW_RAISE, KW_RETURN,
+	KW_TRY, KW_WHILE, KW_WITH, KW_YIELD
+};
+
+/* In the order of the enum above, which is alphabetical */
+static const char * const keywords[] = {
+	"and", "as", "assert", "break", "class", "continue", "def", "del",
+	"elif", "else", "except", "exec", "finally", "for", "from", "global",
+	"if", "import", "in", "is", "lambda", "not", "or", "pass", "print",
+	"raise", "return", "try", "while", "with", "yield", NULL
+};
+
+#define STARTS_EXPR(t) ((t) == NAME || (t) == NUMBER || (t) == STRING || \
+						(t) == LPAR || (t) == LSQB || (t) == LBRACE || \
+						(t) == BACKQUOTE || (t) == PLUS || (t) == MINUS || \
+						(t) == TILDE)
+#define STARTS_TEST(t) (STARTS_EXPR(t) || (t) == KW_NOT || (t) == KW_LAMBDA)
+
+/* Pgen keeps the nodes being built on a stack of MAXSTACK (1500) entries
+   and fails past it.  The depth counts below are upper bounds of the
+   entries a test, a statement, and the nested constructs that don't go
+   through a test take there, so the token parser gives up first on
+   sources that deep. */
+#define DEPTH_LIMIT 1400
+#define TEST_DEPTH 18
+#define STMT_DEPTH 8
+
+struct parsing {
+	struct compiling c;
+	struct tok_state *tok;
+	int type;				/* current token, or -1 if not read yet */
+	char *a, *b;			/* its text */
+	int lineno;				/* and position */
+	int col_offset;
+	int started;			/* as in parsetok() */
+	int dont_imply_dedent;
+	int future;				/* CO_FUTURE_* flags, as pgen's p_flags */
+	int depth;				/* bound of the depth of pgen's stack */
+	int utf8;				/* source is UTF-8 (PyCF_SOURCE_IS_UTF8) */
+	int strings;			/* string literals decoded so far */
+	void **stack;			/* items of the sequences being built */
+	int nstack;
+	int stack_size;
+	char *text;				/* buffer for the text of tokens */
+	size_t text_size;
+};
+
+/* PEEK() reads the current token if needed and returns its type; NEXT()
+   consumes it.  EXPECT() consumes a token of type t or gives up. */
+#define PEEK(p) ((p)->type >= 0 ? (p)->type : fetch(p))
+#define NEXT(p) ((p)->type = -1)
+#define EXPECT(p, t) do { \
+		if (PEEK(p) != (t)) \
+			return 0; \
+		NEXT(p); \
+	} while (0)
+
+#define ENTER(p, n) do { \
+		if (((p)->depth += (n)) > DEPTH_LIMIT) \
+			return 0; \
+	} while (0)
+#define LEAVE(p, n) ((p)->depth -= (n))
+
+static int
+classify(struct parsing *p)
+{
+	const char * const *kw;
+	const char *s = p->a;
+	size_t len = p->b - p->a;
+
+	for (kw = keywords; *kw && (*kw)[0] <= s[0]; kw++)
+		if ((*kw)[0] == s[0] && !strncmp(*kw, s, len) &&
+			(*kw)[len] == '\0') {
+			if (kw - keywords + KW_AND == KW_PRINT &&
+				p->future & CO_FUTURE_PRINT_FUNCTION)
+				break; /* no longer a keyword */
+			return (int)(kw - keywords) + KW_AND;
+		}
+	return NAME;
+}
+
+/* Read the next token, feeding them the way parsetok() does to pgen */
+static int
+fetch(struct parsing *p)
+{
+	struct tok_state *tok = p->tok;
+	int type = PyTokenizer_Get(tok, &p->a, &p->b);
+
+	if (type == ENDMARKER && p->started) {
+		type = NEWLINE; /* Add an extra newline */
+		p->started = 0;
+		if (tok->indent && !p->dont_imply_dedent) {
+			tok->pendin = -tok->indent;
+			tok->indent = 0;
+		}
+	}
+	else
+		p->started = 1;
+	if (type == NAME)
+		type = classify(p);
+	p->lineno = tok->lineno;
+	if (p->a >= tok->line_start)
+		p->col_offset = (int)(p->a - tok->line_start);
+	else
+		p->col_offset = -1;
+	return p->type = type;
+}
+
+static char *
+text_buffer(struct parsing *p, size_t size)
+{
+	if (size > p->text_size) {
+		char *text = PyMem_Realloc(p->text, size);
+		if (!text)
+			return (char *)PyErr_NoMemory();
+		p->text = text;
+		p->text_size = size;
+	}
+	return p->text;
+}
+
+/* The text of the current token, after a '-' if minus is true.  Like
+   parsetok() it stops at a NUL byte. */
+static char *
+token_text(struct parsing *p, int minus)
+{
+	size_t len = p->b - p->a;
+	const char *nul = memchr(p->a, '\0', len);
+	char *text;
+
+	if (nul)
+		len = nul - p->a;
+	text = text_buffer(p, len + 2);
+	if (!text)
+		return NULL;
+	if (minus)
+		*text++ = '-';
+	memcpy(text, p->a, len);
+	text[len] = '\0';
+	return p->text;
+}
+
+static identifier
+parse_name(struct parsing *p)
+{
+	PyObject *id;
+
+	if (PEEK(p) != NAME)
+		return NULL;
+	id = PyString_FromStringAndSize(p->a, p->b - p->a);
+	if (!id)
+		return NULL;
+	PyString_InternInPlace(&id);
+	PyArena_AddPyObject(p->c.c_arena, id);
+	NEXT(p);
+	return id;
+}
+
+/* A NAME that gets bound, as a parameter or definition */
+static identifier
+parse_bound_name(struct parsing *p)
+{
+	identifier id;
+	int lineno;
+
+	PEEK(p);
+	lineno = p->lineno;
+	id = parse_name(p);
+	if (!id || !forbidden_check(&p->c, lineno, PyString_AS_STRING(id)))
+		return NULL;
+	return id;
+}
+
+static int
+push_item(struct parsing *p, void *item)
+{
+	if (p->nstack == p->stack_size) {
+		int size = p->stack_size ? 2 * p->stack_size : 64;
+		void **stack = PyMem_Realloc(p->stack, size * sizeof(void *));
+		if (!stack) {
+			PyErr_NoMemory();
+			return 0;
+		}
+		p->stack = stack;
+		p->stack_size = size;
+	}
+	p->stack[p->nstack++] = item;
+	return 1;
+}
+
+/* push() takes the result of a parsing function, failing on NULL */
+#define push(p, item) push_nonnull((p), (void *)(item))
+#define push_int(p, i) push_item((p), (void *)(Py_intptr_t)(i))
+#define STACK_INT(p, i) ((int)(Py_intptr_t)(p)->stack[i])
+
+static int
+push_nonnull(struct parsing *p, void *item)
+{
+	return item != NULL && push_item(p, item);
+}
+
+/* The items pushed since the stack had base items, as a sequence */
+static asdl_seq *
+pop_seq(struct parsing *p, int base)
+{
+	int i, n = p->nstack - base;
+	asdl_seq *seq = asdl_seq_new(n, p->c.c_arena);
+
+	if (!seq)
+		return NULL;
+	for (i = 0; i < n; i++)
+		asdl_seq_SET(seq, i, p->stack[base + i]);
+	p->nstack = base;
+	return seq;
+}
+
+static expr_ty parse_test(struct parsing *);
+static expr_ty parse_old_test(struct parsing *);
+static expr_ty parse_or_test(struct parsing *);
+static expr_ty parse_expr(struct parsing *, int);
+static expr_ty parse_factor(struct parsing *);
+static expr_ty parse_testlist(struct parsing *);
+static expr_ty parse_call(struct parsing *, expr_ty);
+static arguments_ty parse_varargslist(struct parsing *);
+static asdl_seq *parse_suite(struct parsing *);
+static int parse_stmt(struct parsing *);
+
+/* The rest of a list of tests after its first one; a trailing comma is
+   allowed */
+static asdl_seq *
+parse_more_tests(struct parsing *p, expr_ty first)
+{
+	int base = p->nstack;
+
+	if (!push(p, first))
+		return NULL;
+	while (PEEK(p) == COMMA) {
+		NEXT(p);
+		if (!STARTS_TEST(PEEK(p)))
+			break;
+		if (!push(p, parse_test(p)))
+			return NULL;
+	}
+	return pop_seq(p, base);
+}
+
+static expr_ty
+parse_testlist(struct parsing *p)
+{
+	/* testlist: test (',' test)* [','] */
+	asdl_seq *elts;
+	expr_ty e;
+	int lineno, col_offset;
+
+	PEEK(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	e = parse_test(p);
+	if (!e || PEEK(p) != COMMA)
+		return e;
+	elts = parse_more_tests(p, e);
+	if (!elts)
+		return NULL;
+	return fold_tuple(&p->c, elts, lineno, col_offset);
+}
+
+static expr_ty
+parse_yield_expr(struct parsing *p)
+{
+	/* yield_expr: 'yield' [testlist] */
+	expr_ty e = NULL;
+	int lineno = p->lineno, col_offset = p->col_offset;
+
+	NEXT(p);
+	if (STARTS_TEST(PEEK(p))) {
+		e = parse_testlist(p);
+		if (!e)
+			return NULL;
+	}
+	return Yield(e, lineno, col_offset, p->c.c_arena);
+}
+
+/* The expressions of an exprlist, put in context ctx.  *single is set
+   when there is one and no comma. */
+static asdl_seq *
+parse_exprlist(struct parsing *p, expr_context_ty ctx, int *single)
+{
+	/* exprlist: expr (',' expr)* [','] */
+	int base = p->nstack, lineno;
+	expr_ty e;
+	asdl_seq *seq;
+
+	ENTER(p, TEST_DEPTH);
+	*single = 1;
+	for (;;) {
+		PEEK(p);
+		lineno = p->lineno;
+		e = parse_expr(p, 0);
+		if (!e || !set_context(&p->c, e, ctx, lineno) || !push(p, e))
+			return NULL;
+		if (PEEK(p) != COMMA)
+			break;
+		NEXT(p);
+		*single = 0;
+		if (!STARTS_EXPR(PEEK(p)))
+			break;
+	}
+	seq = pop_seq(p, base);
+	LEAVE(p, TEST_DEPTH);
+	return seq;
+}
+
+/* The target of a for loop or comprehension started at lineno */
+static expr_ty
+parse_target(struct parsing *p, int lineno, int col_offset)
+{
+	asdl_seq *targets;
+	int single;
+
+	targets = parse_exprlist(p, Store, &single);
+	if (!targets)
+		return NULL;
+	if (single)
+		return (expr_ty)asdl_seq_GET(targets, 0);
+	return Tuple(targets, Store, lineno, col_offset, p->c.c_arena);
+}
+
+/* The clauses of a list comprehension if list is true, or else of a
+   generator expression, from the first 'for' */
+static asdl_seq *
+parse_comprehension(struct parsing *p, int list)
+{
+	/* list_for: 'for' exprlist 'in' testlist_safe [list_iter]
+	   list_iter: list_for | list_if
+	   list_if: 'if' old_test [list_iter]
+	   testlist_safe: old_test [(',' old_test)+ [',']]
+	   gen_for: 'for' exprlist 'in' or_test [gen_iter]
+	   gen_iter: gen_for | gen_if
+	   gen_if: 'if' old_test [gen_iter]
+	*/
+	int base = p->nstack, depth = p->depth, ifs_base, elts_base;
+	int lineno, col_offset;
+	expr_ty target, iter;
+	asdl_seq *ifs, *elts;
+
+	while (PEEK(p) == KW_FOR) {
+		/* pgen nests each clause in the one before */
+		ENTER(p, 2);
+		lineno = p->lineno;
+		col_offset = p->col_offset;
+		NEXT(p);
+		target = parse_target(p, lineno, col_offset);
+		if (!target)
+			return NULL;
+		EXPECT(p, KW_IN);
+		if (list) {
+			PEEK(p);
+			lineno = p->lineno;
+			col_offset = p->col_offset;
+			iter = parse_old_test(p);
+			if (iter && PEEK(p) == COMMA) {
+				elts_base = p->nstack;
+				if (!push(p, iter))
+					return NULL;
+				NEXT(p);
+				do {
+					if (!push(p, parse_old_test(p)))
+						return NULL;
+					if (PEEK(p) != COMMA)
+						break;
+					NEXT(p);
+				} while (STARTS_TEST(PEEK(p)));
+				elts = pop_seq(p, elts_base);
+				if (!elts)
+					return NULL;
+				iter = fold_tuple(&p->c, elts, lineno, col_offset);
+			}
+		}
+		else
+			iter = parse_or_test(p);
+		if (!iter)
+			return NULL;
+		ifs = NULL;
+		if (PEEK(p) == KW_IF || p->type == KW_FOR) {
+			ifs_base = p->nstack;
+			while (PEEK(p) == KW_IF) {
+				ENTER(p, 2);
+				NEXT(p);
+				if (!push(p, parse_old_test(p)))
+					return NULL;
+			}
+			ifs = pop_seq(p, ifs_base);
+			if (!ifs)
+				return NULL;
+		}
+		if (!push(p, comprehension(target, iter, ifs, p->c.c_arena)))
+			return NULL;
+	}
+	p->depth = depth;
+	return pop_seq(p, base);
+}
+
+static expr_ty
+parse_strings(struct parsing *p)
+{
+	/* STRING+, concatenated as by parsestrplus() */
+	PyObject *v = NULL, *s;
+	int lineno = p->lineno, col_offset = p->col_offset;
+	char *text;
+
+	do {
+		text = token_text(p, 0);
+		if (!text)
+			goto error;
+		if (!p->utf8) {
+			/* The literals are decoded as they come, while the
+			   CST decodes them all with the encoding declared
+			   in the end; give up if it changes in between. */
+			if (p->strings && p->c.c_encoding != p->tok->encoding)
+				goto error;
+			p->c.c_encoding = p->tok->encoding;
+		}
+		p->strings++;
+		NEXT(p);
+		s = parsestr(&p->c, text);
+		if (!s)
+			goto error;
+		if (!v)
+			v = s;
+		else if (PyString_Check(v) && PyString_Check(s)) {
+			PyString_ConcatAndDel(&v, s);
+			if (!v)
+				goto error;
+		}
+#ifdef Py_USING_UNICODE
+		else {
+			PyObject *temp = PyUnicode_Concat(v, s);
+			Py_DECREF(s);
+			Py_DECREF(v);
+			v = temp;
+			if (!v)
+				goto error;
+		}
+#endif
+	} while (PEEK(p) == STRING);
+	return str_to_expr(&p->c, v, lineno, col_offset);
+
+ error:
+	Py_XDECREF(v);
+	return NULL;
+}
+
+static expr_ty
+parse_number(struct parsing *p, const char *s, int lineno, int col_offset)
+{
+	PyObject *pynum = parsenumber(&p->c, s);
+
+	if (!pynum)
+		return NULL;
+	return num_to_expr(&p->c, pynum, lineno, col_offset);
+}
+
+static expr_ty
+parse_atom(struct parsing *p)
+{
+	/* atom: ('(' [yield_expr|testlist_gexp] ')' |
+	          '[' [listmaker] ']' |
+	          '{' [dictmaker] '}' |
+	          '`' testlist1 '`' |
+	          NAME | NUMBER | STRING+)
+	   testlist_gexp: test ( gen_for | (',' test)* [','] )
+	   listmaker: test ( list_for | (',' test)* [','] )
+	   dictmaker: test ':' test (',' test ':' test)* [',']
+	   testlist1: test (',' test)*
+	*/
+	int i, n, base, lineno, col_offset, elt_lineno, elt_col_offset;
+	expr_ty e;
+	identifier name;
+	asdl_seq *elts, *keys, *values;
+	char *text;
+
+	PEEK(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	switch (p->type) {
+	case NAME:
+		/* "None" identifier will be converted to the None constant */
+		if (!p->c.c_no_folding && p->b - p->a == 4 &&
+			!strncmp(p->a, "None", 4)) {
+			NEXT(p);
+			return none_to_expr(&p->c, lineno, col_offset);
+		}
+		name = parse_name(p);
+		if (!name)
+			return NULL;
+		return Name(name, Load, lineno, col_offset, p->c.c_arena);
+	case NUMBER:
+		text = token_text(p, 0);
+		if (!text)
+			return NULL;
+		NEXT(p);
+		return parse_number(p, text, lineno, col_offset);
+	case STRING:
+		return parse_strings(p);
+	case LPAR:
+		NEXT(p);
+		if (PEEK(p) == RPAR) {
+			NEXT(p);
+			return fold_tuple(&p->c, NULL, lineno, col_offset);
+		}
+		if (p->type == KW_YIELD)
+			e = parse_yield_expr(p);
+		else {
+			elt_lineno = p->lineno;
+			elt_col_offset = p->col_offset;
+			e = parse_test(p);
+			if (e && PEEK(p) == KW_FOR) {
+				elts = parse_comprehension(p, 0);
+				e = elts ? GeneratorExp(e, elts, elt_lineno, elt_col_offset,
+										p->c.c_arena) : NULL;
+			}
+			else if (e && p->type == COMMA) {
+				elts = parse_more_tests(p, e);
+				e = elts ? fold_tuple(&p->c, elts, elt_lineno,
+									  elt_col_offset) : NULL;
+			}
+		}
+		if (!e)
+			return NULL;
+		EXPECT(p, RPAR);
+		return e;
+	case LSQB:
+		NEXT(p);
+		if (PEEK(p) == RSQB) {
+			NEXT(p);
+			return fold_list(&p->c, NULL, lineno, col_offset);
+		}
+		elt_lineno = p->lineno;
+		elt_col_offset = p->col_offset;
+		e = parse_test(p);
+		if (!e)
+			return NULL;
+		if (PEEK(p) == KW_FOR) {
+			elts = parse_comprehension(p, 1);
+			e = elts ? ListComp(e, elts, elt_lineno, elt_col_offset,
+								p->c.c_arena) : NULL;
+		}
+		else {
+			elts = parse_more_tests(p, e);
+			e = elts ? fold_list(&p->c, elts, lineno, col_offset) : NULL;
+		}
+		if (!e)
+			return NULL;
+		EXPECT(p, RSQB);
+		return e;
+	case LBRACE:
+		NEXT(p);
+		base = p->nstack;
+		while (STARTS_TEST(PEEK(p))) {
+			if (!push(p, parse_test(p)))
+				return NULL;
+			EXPECT(p, COLON);
+			if (!push(p, parse_test(p)))
+				return NULL;
+			if (PEEK(p) != COMMA)
+				break;
+			NEXT(p);
+		}
+		EXPECT(p, RBRACE);
+		n = (p->nstack - base) / 2;
+		keys = asdl_seq_new(n, p->c.c_arena);
+		values = asdl_seq_new(n, p->c.c_arena);
+		if (!keys || !values)
+			return NULL;
+		for (i = 0; i < n; i++) {
+			asdl_seq_SET(keys, i, p->stack[base + 2 * i]);
+			asdl_seq_SET(values, i, p->stack[base + 2 * i + 1]);
+		}
+		p->nstack = base;
+		return fold_dict(&p->c, keys, values, lineno, col_offset);
+	case BACKQUOTE:
+		NEXT(p);
+		PEEK(p);
+		elt_lineno = p->lineno;
+		elt_col_offset = p->col_offset;
+		e = parse_test(p);
+		if (e && PEEK(p) == COMMA) {
+			base = p->nstack;
+			if (!push(p, e))
+				return NULL;
+			while (PEEK(p) == COMMA) {
+				NEXT(p);
+				if (!push(p, parse_test(p)))
+					return NULL;
+			}
+			elts = pop_seq(p, base);
+			e = elts ? fold_tuple(&p->c, elts, elt_lineno,
+								  elt_col_offset) : NULL;
+		}
+		if (!e)
+			return NULL;
+		EXPECT(p, BACKQUOTE);
+		return fold_repr(&p->c, e, lineno, col_offset);
+	default:
+		return NULL;
+	}
+}
+
+static slice_ty
+parse_subscript(struct parsing *p)
+{
+	/* subscript: '.' '.' '.' | test | [test] ':' [test] [sliceop]
+	   sliceop: ':' [test]
+	*/
+	expr_ty lower = NULL, upper = NULL, step = NULL;
+	int lineno, col_offset;
+
+	if (PEEK(p) == DOT) {
+		NEXT(p);
+		EXPECT(p, DOT);
+		EXPECT(p, DOT);
+		return Ellipsis(p->c.c_arena);
+	}
+	if (p->type != COLON) {
+		lower = parse_test(p);
+		if (!lower)
+			return NULL;
+		if (PEEK(p) != COLON)
+			return Index(lower, p->c.c_arena);
+	}
+	NEXT(p);
+	if (STARTS_TEST(PEEK(p))) {
+		upper = parse_test(p);
+		if (!upper)
+			return NULL;
+	}
+	if (PEEK(p) == COLON) {
+		lineno = p->lineno;
+		col_offset = p->col_offset;
+		NEXT(p);
+		if (STARTS_TEST(PEEK(p)))
+			step = parse_test(p);
+		else
+			step = none_to_expr(&p->c, lineno, col_offset);
+		if (!step)
+			return NULL;
+	}
+	return Slice(lower, upper, step, p->c.c_arena);
+}
+
+static expr_ty
+parse_trailer(struct parsing *p, expr_ty left_expr)
+{
+	/* trailer: '(' [arglist] ')' | '[' subscriptlist ']' | '.' NAME
+	   subscriptlist: subscript (',' subscript)* [',']
+	*/
+	int base, lineno = p->lineno, col_offset = p->col_offset;
+	identifier attr_id;
+	slice_ty slc;
+	asdl_seq *slices;
+	expr_ty e;
+
+	switch (p->type) {
+	case LPAR:
+		NEXT(p);
+		if (PEEK(p) == RPAR)
+			e = Call(left_expr, NULL, NULL, NULL, NULL, lineno,
+					 col_offset, p->c.c_arena);
+		else
+			e = parse_call(p, left_expr);
+		if (!e)
+			return NULL;
+		EXPECT(p, RPAR);
+		return e;
+	case DOT:
+		NEXT(p);
+		attr_id = parse_name(p);
+		if (!attr_id)
+			return NULL;
+		return Attribute(left_expr, attr_id, Load, lineno, col_offset,
+						 p->c.c_arena);
+	default:
+		NEXT(p);
+		PEEK(p);
+		lineno = p->lineno;
+		col_offset = p->col_offset;
+		slc = parse_subscript(p);
+		if (!slc)
+			return NULL;
+		if (PEEK(p) != COMMA)
+			e = fold_subscript(&p->c, left_expr, slc, lineno, col_offset);
+		else {
+			base = p->nstack;
+			if (!push(p, slc))
+				return NULL;
+			while (PEEK(p) == COMMA) {
+				NEXT(p);
+				if (!STARTS_TEST(PEEK(p)) && p->type != DOT &&
+					p->type != COLON)
+					break;
+				if (!push(p, parse_subscript(p)))
+					return NULL;
+			}
+			slices = pop_seq(p, base);
+			if (!slices)
+				return NULL;
+			e = fold_subscripts(&p->c, left_expr, slices, lineno,
+								col_offset);
+		}
+		if (!e)
+			return NULL;
+		EXPECT(p, RSQB);
+		return e;
+	}
+}
+
+/* The trailers and power of the atom e, the power starting at lineno */
+static expr_ty
+parse_power_rest(struct parsing *p, expr_ty e, int lineno, int col_offset)
+{
+	/* power: atom trailer* ['**' factor] */
+	expr_ty tmp;
+
+	for (;;) {
+		switch (PEEK(p)) {
+		case LPAR:
+		case LSQB:
+		case DOT:
+			tmp = parse_trailer(p, e);
+			if (!tmp)
+				return NULL;
+			tmp->lineno = e->lineno;
+			tmp->col_offset = e->col_offset;
+			e = tmp;
+			break;
+		case DOUBLESTAR:
+			NEXT(p);
+			ENTER(p, 2);
+			tmp = parse_factor(p);
+			LEAVE(p, 2);
+			if (!tmp)
+				return NULL;
+			return fold_binop(e, Pow, tmp, lineno, col_offset, &p->c);
+		default:
+			return e;
+		}
+	}
+}
+
+static expr_ty
+parse_factor(struct parsing *p)
+{
+	/* factor: ('+'|'-'|'~') factor | power */
+	int lineno, col_offset, num_lineno, num_col_offset;
+	unaryop_ty op;
+	expr_ty e;
+	char *text;
+
+	PEEK(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	switch (p->type) {
+	case PLUS:
+		op = UAdd;
+		break;
+	case MINUS:
+		op = USub;
+		break;
+	case TILDE:
+		op = Invert;
+		break;
+	default:
+		e = parse_atom(p);
+		if (!e)
+			return NULL;
+		return parse_power_rest(p, e, lineno, col_offset);
+	}
+	NEXT(p);
+	if (op == USub && PEEK(p) == NUMBER) {
+		/* As in ast_for_factor(), a negated number without trailers
+		   is a constant of its own */
+		num_lineno = p->lineno;
+		num_col_offset = p->col_offset;
+		text = token_text(p, 1);
+		if (!text)
+			return NULL;
+		NEXT(p);
+		switch (PEEK(p)) {
+		case LPAR:
+		case LSQB:
+		case DOT:
+		case DOUBLESTAR:
+			e = parse_number(p, text + 1, num_lineno, num_col_offset);
+			if (!e)
+				return NULL;
+			e = parse_power_rest(p, e, num_lineno, num_col_offset);
+			break;
+		default:
+			return parse_number(p, text, num_lineno, num_col_offset);
+		}
+	}
+	else {
+		ENTER(p, 1);
+		e = parse_factor(p);
+		LEAVE(p, 1);
+	}
+	if (!e)
+		return NULL;
+	return fold_unop(op, e, lineno, col_offset, &p->c);
+}
+
+/* The level of a binary operator, from '|' at 0 to term's at 5, or -1 */
+static int
+binop_level(int type)
+{
+	switch (type) {
+	case VBAR:
+		return 0;
+	case CIRCUMFLEX:
+		return 1;
+	case AMPER:
+		return 2;
+	case LEFTSHIFT:
+	case RIGHTSHIFT:
+		return 3;
+	case PLUS:
+	case MINUS:
+		return 4;
+	case STAR:
+	case SLASH:
+	case PERCENT:
+	case DOUBLESLASH:
+		return 5;
+	default:
+		return -1;
+	}
+}
+
+static expr_ty
+parse_expr(struct parsing *p, int level)
+{
+	/* expr: xor_expr ('|' xor_expr)*
+	   xor_expr: and_expr ('^' and_expr)*
+	   and_expr: shift_expr ('&' shift_expr)*
+	   shift_expr: arith_expr (('<<'|'>>') arith_expr)*
+	   arith_expr: term (('+'|'-') term)*
+	   term: factor (('*'|'/'|'%'|'//') factor)*
+
+	   As in ast_for_binop(), the first operation of a chain is at its
+	   start and the others at their operators.
+	*/
+	int lineno, col_offset;
+	operator_ty op;
+	expr_ty e1, e2;
+
+	PEEK(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	e1 = level < 5 ? parse_expr(p, level + 1) : parse_factor(p);
+	if (!e1 || binop_level(PEEK(p)) != level)
+		return e1;
+	for (;;) {
+		op = get_operator(p->type);
+		NEXT(p);
+		e2 = level < 5 ? parse_expr(p, level + 1) : parse_factor(p);
+		if (!e2)
+			return NULL;
+		e1 = fold_binop(e1, op, e2, lineno, col_offset, &p->c);
+		if (!e1 || binop_level(PEEK(p)) != level)
+			return e1;
+		lineno = p->lineno;
+		col_offset = p->col_offset;
+	}
+}
+
+/* The comparison operator at the current token, 0 if there is none or
+   -1 if it is wrong */
+static int
+parse_comp_op(struct parsing *p)
+{
+	/* comp_op: '<'|'>'|'=='|'>='|'<='|'<>'|'!='|'in'|'not' 'in'|'is'
+	            |'is' 'not' */
+	int op;
+
+	switch (PEEK(p)) {
+	case LESS:
+		op = Lt;
+		break;
+	case GREATER:
+		op = Gt;
+		break;
+	case EQEQUAL:
+		op = Eq;
+		break;
+	case LESSEQUAL:
+		op = LtE;
+		break;
+	case GREATEREQUAL:
+		op = GtE;
+		break;
+	case NOTEQUAL:
+		op = NotEq;
+		break;
+	case KW_IN:
+		op = In;
+		break;
+	case KW_NOT:
+		NEXT(p);
+		if (PEEK(p) != KW_IN)
+			return -1;
+		op = NotIn;
+		break;
+	case KW_IS:
+		NEXT(p);
+		if (PEEK(p) != KW_NOT)
+			return Is;
+		op = IsNot;
+		break;
+	default:
+		return 0;
+	}
+	NEXT(p);
+	return op;
+}
+
+static expr_ty
+parse_comparison(struct parsing *p)
+{
+	/* comparison: expr (comp_op expr)* */
+	int i, n, op, base, lineno, col_offset;
+	expr_ty e, comparator;
+	asdl_int_seq *ops;
+	asdl_seq *cmps;
+
+	PEEK(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	e = parse_expr(p, 0);
+	if (!e)
+		return NULL;
+	base = p->nstack;
+	while ((op = parse_comp_op(p)) != 0) {
+		if (op < 0)
+			return NULL;
+		comparator = parse_expr(p, 0);
+		if (!comparator ||
+			!fold_compare_operand(&p->c, (cmpop_ty)op, comparator) ||
+			!push_int(p, op) || !push(p, comparator))
+			return NULL;
+	}
+	n = (p->nstack - base) / 2;
+	if (!n)
+		return e;
+	ops = asdl_int_seq_new(n, p->c.c_arena);
+	cmps = asdl_seq_new(n, p->c.c_arena);
+	if (!ops || !cmps)
+		return NULL;
+	for (i = 0; i < n; i++) {
+		asdl_seq_SET(ops, i, (cmpop_ty)STACK_INT(p, base + 2 * i));
+		asdl_seq_SET(cmps, i, p->stack[base + 2 * i + 1]);
+	}
+	p->nstack = base;
+	return Compare(e, ops, cmps, lineno, col_offset, p->c.c_arena);
+}
+
+static expr_ty
+parse_not_test(struct parsing *p)
+{
+	/* not_test: 'not' not_test | comparison */
+	int lineno, col_offset;
+	expr_ty e;
+
+	if (PEEK(p) != KW_NOT)
+		return parse_comparison(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	NEXT(p);
+	ENTER(p, 1);
+	e = parse_not_test(p);
+	LEAVE(p, 1);
+	if (!e)
+		return NULL;
+	return fold_not(&p->c, e, lineno, col_offset);
+}
+
+/* An or_test if keyword is 'or', or else an and_test */
+static expr_ty
+parse_boolop(struct parsing *p, int keyword)
+{
+	/* or_test: and_test ('or' and_test)*
+	   and_test: not_test ('and' not_test)* */
+	int base, lineno, col_offset;
+	expr_ty e;
+	asdl_seq *values;
+
+	PEEK(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	e = keyword == KW_OR ? parse_boolop(p, KW_AND) : parse_not_test(p);
+	if (!e || PEEK(p) != keyword)
+		return e;
+	base = p->nstack;
+	if (!push(p, e))
+		return NULL;
+	while (PEEK(p) == keyword) {
+		NEXT(p);
+		e = keyword == KW_OR ? parse_boolop(p, KW_AND) : parse_not_test(p);
+		if (!push(p, e))
+			return NULL;
+	}
+	values = pop_seq(p, base);
+	if (!values)
+		return NULL;
+	return BoolOp(keyword == KW_OR ? Or : And, values, lineno, col_offset,
+				  p->c.c_arena);
+}
+
+static expr_ty
+parse_or_test(struct parsing *p)
+{
+	expr_ty e;
+
+	ENTER(p, TEST_DEPTH);
+	e = parse_boolop(p, KW_OR);
+	LEAVE(p, TEST_DEPTH);
+	return e;
+}
+
+/* A lambdef, or an old_lambdef if old is true */
+static expr_ty
+parse_lambdef(struct parsing *p, int old)
+{
+	/* lambdef: 'lambda' [varargslist] ':' test
+	   old_lambdef: 'lambda' [varargslist] ':' old_test */
+	int lineno = p->lineno, col_offset = p->col_offset;
+	arguments_ty args;
+	expr_ty body;
+
+	NEXT(p);
+	if (PEEK(p) == COLON)
+		args = arguments(NULL, NULL, NULL, NULL, p->c.c_arena);
+	else
+		args = parse_varargslist(p);
+	if (!args)
+		return NULL;
+	EXPECT(p, COLON);
+	body = old ? parse_old_test(p) : parse_test(p);
+	if (!body)
+		return NULL;
+	return Lambda(args, body, lineno, col_offset, p->c.c_arena);
+}
+
+/* A test, or an old_test if old is true */
+static expr_ty
+parse_ifexp(struct parsing *p, int old)
+{
+	/* test: or_test ['if' or_test 'else' test] | lambdef
+	   old_test: or_test | old_lambdef */
+	int lineno, col_offset;
+	expr_ty body, expression, orelse;
+
+	if (PEEK(p) == KW_LAMBDA)
+		return parse_lambdef(p, old);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	body = parse_boolop(p, KW_OR);
+	if (!body || old || PEEK(p) != KW_IF)
+		return body;
+	NEXT(p);
+	expression = parse_or_test(p);
+	if (!expression)
+		return NULL;
+	EXPECT(p, KW_ELSE);
+	orelse = parse_test(p);
+	if (!orelse)
+		return NULL;
+	return IfExp(expression, body, orelse, lineno, col_offset, p->c.c_arena);
+}
+
+static expr_ty
+parse_test(struct parsing *p)
+{
+	expr_ty e;
+
+	ENTER(p, TEST_DEPTH);
+	e = parse_ifexp(p, 0);
+	LEAVE(p, TEST_DEPTH);
+	return e;
+}
+
+static expr_ty
+parse_old_test(struct parsing *p)
+{
+	expr_ty e;
+
+	ENTER(p, TEST_DEPTH);
+	e = parse_ifexp(p, 1);
+	LEAVE(p, TEST_DEPTH);
+	return e;
+}
+
+/* Tags of the items parse_call() and parse_varargslist() push */
+enum { TAG_ARG = 1, TAG_KEYWORD, TAG_DEFAULT };
+
+/* One argument of a call, pushed with its tag */
+static int
+parse_argument(struct parsing *p, int base, int *nargs, int *nkeywords,
+			   int *ngens, expr_ty vararg)
+{
+	/* argument: test [gen_for] | test '=' test  # Really [keyword '='] test */
+	int i, lineno, col_offset;
+	identifier key;
+	expr_ty e;
+	asdl_seq *generators;
+	keyword_ty kw;
+
+	PEEK(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	e = parse_test(p);
+	if (!e)
+		return 0;
+	if (PEEK(p) == KW_FOR) {
+		generators = parse_comprehension(p, 0);
+		if (!generators)
+			return 0;
+		(*ngens)++;
+		return push_int(p, TAG_ARG) &&
+			push(p, GeneratorExp(e, generators, lineno, col_offset,
+								 p->c.c_arena));
+	}
+	if (p->type != EQUAL) {
+		if (*nkeywords || vararg)
+			return 0;
+		(*nargs)++;
+		return push_int(p, TAG_ARG) && push(p, e);
+	}
+	NEXT(p);
+	if (e->kind != Name_kind)
+		return 0;
+	key = e->v.Name.id;
+	if (!forbidden_check(&p->c, lineno, PyString_AS_STRING(key)))
+		return 0;
+	for (i = base; i < p->nstack; i += 2)
+		if (STACK_INT(p, i) == TAG_KEYWORD &&
+			!strcmp(PyString_AS_STRING(((keyword_ty)p->stack[i + 1])->arg),
+					PyString_AS_STRING(key)))
+			return 0;
+	e = parse_test(p);
+	if (!e)
+		return 0;
+	kw = keyword(key, e, p->c.c_arena);
+	(*nkeywords)++;
+	return push_int(p, TAG_KEYWORD) && push(p, kw);
+}
+
+/* A call of func, from the first token of its arglist */
+static expr_ty
+parse_call(struct parsing *p, expr_ty func)
+{
+	/* arglist: (argument ',')* (argument [',']| '*' test (',' argument)*
+	            [',' '**' test] | '**' test) */
+	int i, nargs = 0, nkeywords = 0, ngens = 0, base = p->nstack;
+	asdl_seq *args, *keywords;
+	expr_ty vararg = NULL, kwarg = NULL;
+
+	while (PEEK(p) != STAR && p->type != DOUBLESTAR) {
+		if (!parse_argument(p, base, &nargs, &nkeywords, &ngens, NULL))
+			return NULL;
+		if (PEEK(p) != COMMA)
+			goto done;
+		NEXT(p);
+		if (!STARTS_TEST(PEEK(p)) && p->type != STAR &&
+			p->type != DOUBLESTAR)
+			goto done;
+	}
+	if (p->type == STAR) {
+		NEXT(p);
+		vararg = parse_test(p);
+		if (!vararg)
+			return NULL;
+		while (PEEK(p) == COMMA) {
+			NEXT(p);
+			if (PEEK(p) == DOUBLESTAR)
+				break;
+			if (!parse_argument(p, base, &nargs, &nkeywords, &ngens,
+								vararg))
+				return NULL;
+		}
+	}
+	if (p->type == DOUBLESTAR) {
+		NEXT(p);
+		kwarg = parse_test(p);
+		if (!kwarg)
+			return NULL;
+	}
+ done:
+	if (ngens > 1 || (ngens && (nargs || nkeywords)) ||
+		nargs + nkeywords + ngens > 255)
+		return NULL;
+	args = asdl_seq_new(nargs + ngens, p->c.c_arena);
+	keywords = asdl_seq_new(nkeywords, p->c.c_arena);
+	if (!args || !keywords)
+		return NULL;
+	nargs = nkeywords = 0;
+	for (i = base; i < p->nstack; i += 2) {
+		if (STACK_INT(p, i) == TAG_ARG) {
+			asdl_seq_SET(args, nargs++, p->stack[i + 1]);
+		}
+		else {
+			asdl_seq_SET(keywords, nkeywords++, p->stack[i + 1]);
+		}
+	}
+	p->nstack = base;
+	return Call(func, args, keywords, vararg, kwarg, func->lineno,
+				func->col_offset, p->c.c_arena);
+}
+
+/* A parameter; *wrapped is set when it is a single one in parentheses,
+   which ast_for_arguments() doesn't take with a default */
+static expr_ty
+parse_fpdef(struct parsing *p, int *wrapped)
+{
+	/* fpdef: NAME | '(' fplist ')'
+	   fplist: fpdef (',' fpdef)* [','] */
+	int base, inner, lineno, col_offset;
+	identifier name;
+	asdl_seq *elts;
+	expr_ty e;
+
+	*wrapped = 0;
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	if (p->type == NAME) {
+		name = parse_bound_name(p);
+		if (!name)
+			return NULL;
+		return Name(name, Param, lineno, col_offset, p->c.c_arena);
+	}
+	EXPECT(p, LPAR);
+	ENTER(p, 2);
+	PEEK(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	if (p->type != NAME && p->type != LPAR)
+		return NULL;
+	e = parse_fpdef(p, &inner);
+	if (!e)
+		return NULL;
+	if (PEEK(p) != COMMA)
+		*wrapped = 1;
+	else {
+		base = p->nstack;
+		if (!push(p, e))
+			return NULL;
+		while (PEEK(p) == COMMA) {
+			NEXT(p);
+			if (PEEK(p) != NAME && p->type != LPAR)
+				break;
+			if (!push(p, parse_fpdef(p, &inner)))
+				return NULL;
+		}
+		elts = pop_seq(p, base);
+		if (!elts)
+			return NULL;
+		e = Tuple(elts, Store, lineno, col_offset, p->c.c_arena);
+		if (!e || !set_context(&p->c, e, Store, lineno))
+			return NULL;
+	}
+	EXPECT(p, RPAR);
+	LEAVE(p, 2);
+	return e;
+}
+
+static arguments_ty
+parse_varargslist(struct parsing *p)
+{
+	/* varargslist: ((fpdef ['=' test] ',')*
+	                 ('*' NAME [',' '**' NAME] | '**' NAME) |
+	                 fpdef ['=' test] (',' fpdef ['=' test])* [','])
+	*/
+	int i, n_args = 0, n_defaults = 0, base = p->nstack, wrapped;
+	identifier vararg = NULL, kwarg = NULL;
+	asdl_seq *args = NULL, *defaults = NULL;
+	expr_ty e;
+
+	while (PEEK(p) == NAME || p->type == LPAR) {
+		e = parse_fpdef(p, &wrapped);
+		if (!push_int(p, TAG_ARG) || !push(p, e))
+			return NULL;
+		n_args++;
+		if (PEEK(p) == EQUAL) {
+			if (wrapped)
+				return NULL;
+			NEXT(p);
+			if (!push_int(p, TAG_DEFAULT) || !push(p, parse_test(p)))
+				return NULL;
+			n_defaults++;
+		}
+		else if (n_defaults)
+			return NULL; /* non-default argument follows default */
+		if (PEEK(p) != COMMA)
+			goto done;
+		NEXT(p);
+	}
+	if (PEEK(p) == STAR) {
+		NEXT(p);
+		vararg = parse_bound_name(p);
+		if (!vararg)
+			return NULL;
+		if (PEEK(p) != COMMA)
+			goto done;
+		NEXT(p);
+		if (PEEK(p) != DOUBLESTAR)
+			return NULL;
+	}
+	if (p->type == DOUBLESTAR) {
+		NEXT(p);
+		kwarg = parse_bound_name(p);
+		if (!kwarg)
+			return NULL;
+	}
+	else if (!n_args)
+		return NULL;
+ done:
+	if (n_args) {
+		args = asdl_seq_new(n_args, p->c.c_arena);
+		if (!args)
+			return NULL;
+	}
+	if (n_defaults) {
+		defaults = asdl_seq_new(n_defaults, p->c.c_arena);
+		if (!defaults)
+			return NULL;
+	}
+	n_args = n_defaults = 0;
+	for (i = base; i < p->nstack; i += 2) {
+		if (STACK_INT(p, i) == TAG_ARG) {
+			asdl_seq_SET(args, n_args++, p->stack[i + 1]);
+		}
+		else {
+			asdl_seq_SET(defaults, n_defaults++, p->stack[i + 1]);
+		}
+	}
+	p->nstack = base;
+	return arguments(args, vararg, kwarg, defaults, p->c.c_arena);
+}
+
+static operator_ty
+augassign_operator(int type)
+{
+	switch (type) {
+	case PLUSEQUAL:
+		return Add;
+	case MINEQUAL:
+		return Sub;
+	case STAREQUAL:
+		return Mult;
+	case SLASHEQUAL:
+		return Div;
+	case PERCENTEQUAL:
+		return Mod;
+	case AMPEREQUAL:
+		return BitAnd;
+	case VBAREQUAL:
+		return BitOr;
+	case CIRCUMFLEXEQUAL:
+		return BitXor;
+	case LEFTSHIFTEQUAL:
+		return LShift;
+	case RIGHTSHIFTEQUAL:
+		return RShift;
+	case DOUBLESTAREQUAL:
+		return Pow;
+	case DOUBLESLASHEQUAL:
+		return FloorDiv;
+	default:
+		return (operator_ty)0;
+	}
+}
+
+static stmt_ty
+parse_expr_stmt(struct parsing *p)
+{
+	/* expr_stmt: testlist (augassign (yield_expr|testlist) |
+	                        ('=' (yield_expr|testlist))*) */
+	int base, yield = 0, lineno = p->lineno, col_offset = p->col_offset;
+	const char *var_name;
+	operator_ty op;
+	asdl_seq *targets;
+	expr_ty e, value;
+
+	e = parse_testlist(p);
+	if (!e)
+		return NULL;
+	op = augassign_operator(PEEK(p));
+	if (op) {
+		switch (e->kind) {
+		case Name_kind:
+			var_name = PyString_AS_STRING(e->v.Name.id);
+			if ((var_name[0] == 'N' || var_name[0] == 'T' ||
+				 var_name[0] == 'F') &&
+				!forbidden_check(&p->c, lineno, var_name))
+				return NULL;
+			break;
+		case Attribute_kind:
+		case Subscript_kind:
+			break;
+		default:
+			return NULL;
+		}
+		if (!set_context(&p->c, e, Store, lineno))
+			return NULL;
+		NEXT(p);
+		value = PEEK(p) == KW_YIELD ? parse_yield_expr(p) :
+			parse_testlist(p);
+		if (!value)
+			return NULL;
+		return AugAssign(e, op, value, lineno, col_offset, p->c.c_arena);
+	}
+	if (p->type != EQUAL)
+		return Expr(e, lineno, col_offset, p->c.c_arena);
+	base = p->nstack;
+	while (PEEK(p) == EQUAL) {
+		if (yield || !set_context(&p->c, e, Store, e->lineno) ||
+			!push(p, e))
+			return NULL;
+		NEXT(p);
+		yield = PEEK(p) == KW_YIELD;
+		e = yield ? parse_yield_expr(p) : parse_testlist(p);
+		if (!e)
+			return NULL;
+	}
+	targets = pop_seq(p, base);
+	if (!targets)
+		return NULL;
+	return Assign(targets, e, lineno, col_offset, p->c.c_arena);
+}
+
+static stmt_ty
+parse_print_stmt(struct parsing *p)
+{
+	/* print_stmt: 'print' ( [ test (',' test)* [','] ] |
+	                         '>>' test [ (',' test)+ [','] ] ) */
+	int base = p->nstack, lineno = p->lineno, col_offset = p->col_offset;
+	expr_ty dest = NULL;
+	asdl_seq *seq;
+	bool nl = true;
+
+	NEXT(p);
+	if (PEEK(p) == RIGHTSHIFT) {
+		NEXT(p);
+		dest = parse_test(p);
+		if (!dest)
+			return NULL;
+		if (PEEK(p) == COMMA) {
+			NEXT(p);
+			if (!push(p, parse_test(p)))
+				return NULL;
+		}
+	}
+	else if (STARTS_TEST(p->type)) {
+		if (!push(p, parse_test(p)))
+			return NULL;
+	}
+	if (p->nstack > base)
+		while (PEEK(p) == COMMA) {
+			NEXT(p);
+			nl = false;
+			if (!STARTS_TEST(PEEK(p)))
+				break;
+			if (!push(p, parse_test(p)))
+				return NULL;
+			nl = true;
+		}
+	seq = pop_seq(p, base);
+	if (!seq)
+		return NULL;
+	return Print(dest, seq, nl, lineno, col_offset, p->c.c_arena);
+}
+
+/* A dotted_name as a single identifier "a.b.c"; *nparts is set to the
+   number of names in it */
+static identifier
+parse_dotted_name(struct parsing *p, int *nparts)
+{
+	/* dotted_name: NAME ('.' NAME)* */
+	size_t len = 0, size;
+	PyObject *str;
+	char *text;
+
+	*nparts = 0;
+	for (;;) {
+		if (PEEK(p) != NAME)
+			return NULL;
+		size = p->b - p->a;
+		text = text_buffer(p, len + size + 1);
+		if (!text)
+			return NULL;
+		memcpy(text + len, p->a, size);
+		len += size;
+		(*nparts)++;
+		NEXT(p);
+		if (PEEK(p) != DOT)
+			break;
+		NEXT(p);
+		text[len++] = '.';
+	}
+	str = PyString_FromStringAndSize(p->text, len);
+	if (!str)
+		return NULL;
+	PyString_InternInPlace(&str);
+	PyArena_AddPyObject(p->c.c_arena, str);
+	return str;
+}
+
+static stmt_ty
+parse_import_name(struct parsing *p)
+{
+	/* import_name: 'import' dotted_as_names
+	   dotted_as_names: dotted_as_name (',' dotted_as_name)*
+	   dotted_as_name: dotted_name ['as' NAME] */
+	int nparts, base = p->nstack;
+	int lineno = p->lineno, col_offset = p->col_offset;
+	identifier name, asname;
+	asdl_seq *aliases;
+
+	NEXT(p);
+	for (;;) {
+		name = parse_dotted_name(p, &nparts);
+		if (!name)
+			return NULL;
+		asname = NULL;
+		if (PEEK(p) == KW_AS) {
+			NEXT(p);
+			asname = parse_name(p);
+			if (!asname)
+				return NULL;
+		}
+		if (!push(p, alias(name, asname, p->c.c_arena)))
+			return NULL;
+		if (PEEK(p) != COMMA)
+			break;
+		NEXT(p);
+	}
+	aliases = pop_seq(p, base);
+	if (!aliases)
+		return NULL;
+	return Import(aliases, lineno, col_offset, p->c.c_arena);
+}
+
+/* The flag of a feature that changes how the source is parsed */
+static int
+future_feature(const char *name)
+{
+	if (!strcmp(name, FUTURE_WITH_STATEMENT))
+		return CO_FUTURE_WITH_STATEMENT;
+	if (!strcmp(name, FUTURE_PRINT_FUNCTION))
+		return CO_FUTURE_PRINT_FUNCTION;
+	if (!strcmp(name, FUTURE_UNICODE_LITERALS))
+		return CO_FUTURE_UNICODE_LITERALS;
+	return 0;
+}
+
+static stmt_ty
+parse_import_from(struct parsing *p)
+{
+	/* import_from: ('from' ('.'* dotted_name | '.'+)
+	                 'import' ('*' | '(' import_as_names ')' |
+	                           import_as_names))
+	   import_as_names: import_as_name (',' import_as_name)* [',']
+	   import_as_name: NAME ['as' NAME] */
+	int ndots = 0, nparts = 0, parens = 0, future, found = 0;
+	int base = p->nstack, lineno = p->lineno, col_offset = p->col_offset;
+	identifier modname = NULL, name, asname;
+	asdl_seq *aliases;
+
+	NEXT(p);
+	while (PEEK(p) == DOT) {
+		NEXT(p);
+		ndots++;
+	}
+	if (p->type == NAME) {
+		modname = parse_dotted_name(p, &nparts);
+		if (!modname)
+			return NULL;
+	}
+	else if (!ndots)
+		return NULL;
+	EXPECT(p, KW_IMPORT);
+	/* The statements pgen's future_hack() takes for future ones */
+	if (ndots == 0)
+		future = nparts > 1 ||
+			!strcmp(PyString_AS_STRING(modname), "__future__");
+	else
+		future = ndots == 1 && !modname;
+	if (PEEK(p) == STAR) {
+		NEXT(p);
+		name = new_identifier("*", p->c.c_arena);
+		if (!name || !push(p, alias(name, NULL, p->c.c_arena)))
+			return NULL;
+	}
+	else {
+		if (p->type == LPAR) {
+			NEXT(p);
+			parens = 1;
+		}
+		for (;;) {
+			name = parse_name(p);
+			if (!name)
+				return NULL;
+			asname = NULL;
+			if (PEEK(p) == KW_AS) {
+				NEXT(p);
+				asname = parse_name(p);
+				if (!asname)
+					return NULL;
+			}
+			if (!push(p, alias(name, asname, p->c.c_arena)))
+				return NULL;
+			if (future)
+				found |= future_feature(PyString_AS_STRING(name));
+			if (PEEK(p) != COMMA)
+				break;
+			NEXT(p);
+			if (PEEK(p) != NAME) {
+				/* trailing comma not allowed without
+				   surrounding parentheses */
+				if (!parens)
+					return NULL;
+				break;
+			}
+		}
+		if (parens)
+			EXPECT(p, RPAR);
+	}
+	/* Like pgen, take the features from the next token on: the one
+	   after the names is read already unless they are in parentheses */
+	if (found & CO_FUTURE_UNICODE_LITERALS) {
+		/* parsestr() has to know before any string literal */
+		if (p->strings)
+			return NULL;
+		p->c.c_future_unicode = 1;
+	}
+	p->future |= found;
+	aliases = pop_seq(p, base);
+	if (!aliases)
+		return NULL;
+	if (!modname) {
+		modname = new_identifier("", p->c.c_arena);
+		if (!modname)
+			return NULL;
+	}
+	return ImportFrom(modname, aliases, ndots, lineno, col_offset,
+					  p->c.c_arena);
+}
+
+static stmt_ty
+parse_small_stmt(struct parsing *p)
+{
+	/* small_stmt: (expr_stmt | print_stmt  | del_stmt | pass_stmt |
+	                flow_stmt | import_stmt | global_stmt | exec_stmt |
+	                assert_stmt) */
+	int base, single, lineno, col_offset;
+	expr_ty e1 = NULL, e2 = NULL, e3 = NULL;
+	asdl_seq *seq;
+	stmt_ty s;
+
+	ENTER(p, STMT_DEPTH);
+	PEEK(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	switch (p->type) {
+	case KW_PRINT:
+		s = parse_print_stmt(p);
+		break;
+	case KW_DEL:
+		/* del_stmt: 'del' exprlist */
+		NEXT(p);
+		seq = parse_exprlist(p, Del, &single);
+		s = seq ? Delete(seq, lineno, col_offset, p->c.c_arena) : NULL;
+		break;
+	case KW_PASS:
+		NEXT(p);
+		s = Pass(lineno, col_offset, p->c.c_arena);
+		break;
+	case KW_BREAK:
+		NEXT(p);
+		s = Break(lineno, col_offset, p->c.c_arena);
+		break;
+	case KW_CONTINUE:
+		NEXT(p);
+		s = Continue(lineno, col_offset, p->c.c_arena);
+		break;
+	case KW_RETURN:
+		/* return_stmt: 'return' [testlist] */
+		NEXT(p);
+		if (STARTS_TEST(PEEK(p)) && !(e1 = parse_testlist(p)))
+			return NULL;
+		s = Return(e1, lineno, col_offset, p->c.c_arena);
+		break;
+	case KW_RAISE:
+		/* raise_stmt: 'raise' [test [',' test [',' test]]] */
+		NEXT(p);
+		if (STARTS_TEST(PEEK(p))) {
+			if (!(e1 = parse_test(p)))
+				return NULL;
+			if (PEEK(p) == COMMA) {
+				NEXT(p);
+				if (!(e2 = parse_test(p)))
+					return NULL;
+				if (PEEK(p) == COMMA) {
+					NEXT(p);
+					if (!(e3 = parse_test(p)))
+						return NULL;
+				}
+			}
+		}
+		s = Raise(e1, e2, e3, lineno, col_offset, p->c.c_arena);
+		break;
+	case KW_YIELD:
+		/* yield_stmt: yield_expr */
+		e1 = parse_yield_expr(p);
+		s = e1 ? Expr(e1, lineno, col_offset, p->c.c_arena) : NULL;
+		break;
+	case KW_IMPORT:
+		s = parse_import_name(p);
+		break;
+	case KW_FROM:
+		s = parse_import_from(p);
+		break;
+	case KW_GLOBAL:
+		/* global_stmt: 'global' NAME (',' NAME)* */
+		base = p->nstack;
+		do {
+			NEXT(p);
+			if (!push(p, parse_name(p)))
+				return NULL;
+		} while (PEEK(p) == COMMA);
+		seq = pop_seq(p, base);
+		s = seq ? Global(seq, lineno, col_offset, p->c.c_arena) : NULL;
+		break;
+	case KW_EXEC:
+		/* exec_stmt: 'exec' expr ['in' test [',' test]] */
+		NEXT(p);
+		ENTER(p, TEST_DEPTH);
+		e1 = parse_expr(p, 0);
+		LEAVE(p, TEST_DEPTH);
+		if (!e1)
+			return NULL;
+		if (PEEK(p) == KW_IN) {
+			NEXT(p);
+			if (!(e2 = parse_test(p)))
+				return NULL;
+			if (PEEK(p) == COMMA) {
+				NEXT(p);
+				if (!(e3 = parse_test(p)))
+					return NULL;
+			}
+		}
+		s = Exec(e1, e2, e3, lineno, col_offset, p->c.c_arena);
+		break;
+	case KW_ASSERT:
+		/* assert_stmt: 'assert' test [',' test] */
+		NEXT(p);
+		if (!(e1 = parse_test(p)))
+			return NULL;
+		if (PEEK(p) == COMMA) {
+			NEXT(p);
+			if (!(e2 = parse_test(p)))
+				return NULL;
+		}
+		s = Assert(e1, e2, lineno, col_offset, p->c.c_arena);
+		break;
+	default:
+		s = parse_expr_stmt(p);
+		break;
+	}
+	LEAVE(p, STMT_DEPTH);
+	return s;
+}
+
+static int
+parse_simple_stmt(struct parsing *p)
+{
+	/* simple_stmt: small_stmt (';' small_stmt)* [';'] NEWLINE */
+	for (;;) {
+		if (!push(p, parse_small_stmt(p)))
+			return 0;
+		if (PEEK(p) != SEMI)
+			break;
+		NEXT(p);
+		if (PEEK(p) == NEWLINE)
+			break;
+	}
+	EXPECT(p, NEWLINE);
+	return 1;
+}
+
+static asdl_seq *
+parse_suite(struct parsing *p)
+{
+	/* suite: simple_stmt | NEWLINE INDENT stmt+ DEDENT */
+	int base = p->nstack;
+
+	if (PEEK(p) != NEWLINE) {
+		if (!parse_simple_stmt(p))
+			return NULL;
+	}
+	else {
+		NEXT(p);
+		EXPECT(p, INDENT);
+		do {
+			if (!parse_stmt(p))
+				return NULL;
+		} while (PEEK(p) != DEDENT);
+		NEXT(p);
+	}
+	return pop_seq(p, base);
+}
+
+/* The suite after a ':' */
+static asdl_seq *
+parse_block(struct parsing *p)
+{
+	EXPECT(p, COLON);
+	return parse_suite(p);
+}
+
+/* The suite of an 'else' clause if there is one, or else NULL; *error is
+   set when there is one that is wrong */
+static asdl_seq *
+parse_else(struct parsing *p, int keyword, int *error)
+{
+	asdl_seq *seq;
+
+	*error = 0;
+	if (PEEK(p) != keyword)
+		return NULL;
+	NEXT(p);
+	seq = parse_block(p);
+	*error = seq == NULL;
+	return seq;
+}
+
+static stmt_ty
+parse_if_stmt(struct parsing *p)
+{
+	/* if_stmt: 'if' test ':' suite ('elif' test ':' suite)*
+	            ['else' ':' suite] */
+	int error, base = p->nstack, lineno = p->lineno, col_offset = p->col_offset;
+	asdl_seq *orelse;
+	stmt_ty s;
+
+	/* Each clause is pushed as the position and test, and the suite;
+	   the If statements are made from the last */
+	do {
+		NEXT(p);
+		PEEK(p);
+		if (!push_int(p, p->lineno) || !push_int(p, p->col_offset) ||
+			!push(p, parse_test(p)) || !push(p, parse_block(p)))
+			return NULL;
+	} while (PEEK(p) == KW_ELIF);
+	orelse = parse_else(p, KW_ELSE, &error);
+	if (error)
+		return NULL;
+	for (;;) {
+		p->nstack -= 4;
+		if (p->nstack == base)
+			break;
+		s = If(p->stack[p->nstack + 2], p->stack[p->nstack + 3], orelse,
+			   STACK_INT(p, p->nstack), STACK_INT(p, p->nstack + 1),
+			   p->c.c_arena);
+		orelse = asdl_seq_new(1, p->c.c_arena);
+		if (!s || !orelse)
+			return NULL;
+		asdl_seq_SET(orelse, 0, s);
+	}
+	return If(p->stack[base + 2], p->stack[base + 3], orelse, lineno,
+			  col_offset, p->c.c_arena);
+}
+
+static stmt_ty
+parse_while_stmt(struct parsing *p)
+{
+	/* while_stmt: 'while' test ':' suite ['else' ':' suite] */
+	int error, lineno = p->lineno, col_offset = p->col_offset;
+	asdl_seq *body, *orelse;
+	expr_ty expression;
+
+	NEXT(p);
+	expression = parse_test(p);
+	if (!expression || !(body = parse_block(p)))
+		return NULL;
+	orelse = parse_else(p, KW_ELSE, &error);
+	if (error)
+		return NULL;
+	return While(expression, body, orelse, lineno, col_offset, p->c.c_arena);
+}
+
+static stmt_ty
+parse_for_stmt(struct parsing *p)
+{
+	/* for_stmt: 'for' exprlist 'in' testlist ':' suite ['else' ':' suite] */
+	int error, lineno = p->lineno, col_offset = p->col_offset;
+	asdl_seq *body, *orelse;
+	expr_ty target, iter;
+
+	NEXT(p);
+	target = parse_target(p, lineno, col_offset);
+	if (!target)
+		return NULL;
+	EXPECT(p, KW_IN);
+	iter = parse_testlist(p);
+	if (!iter || !(body = parse_block(p)))
+		return NULL;
+	orelse = parse_else(p, KW_ELSE, &error);
+	if (error)
+		return NULL;
+	return For(target, iter, body, orelse, lineno, col_offset, p->c.c_arena);
+}
+
+static stmt_ty
+parse_try_stmt(struct parsing *p)
+{
+	/* try_stmt: ('try' ':' suite
+	              ((except_clause ':' suite)+
+	               ['else' ':' suite]
+	               ['finally' ':' suite] |
+	               'finally' ':' suite))
+	   except_clause: 'except' [test [('as' | ',') test]] */
+	int error, base = p->nstack, lineno = p->lineno, col_offset = p->col_offset;
+	int clause_lineno, clause_col_offset;
+	asdl_seq *body, *handler_body, *handlers, *orelse = NULL, *finalbody;
+	expr_ty type, name;
+	stmt_ty s;
+
+	NEXT(p);
+	body = parse_block(p);
+	if (!body)
+		return NULL;
+	while (PEEK(p) == KW_EXCEPT) {
+		clause_lineno = p->lineno;
+		clause_col_offset = p->col_offset;
+		NEXT(p);
+		type = name = NULL;
+		if (STARTS_TEST(PEEK(p))) {
+			if (!(type = parse_test(p)))
+				return NULL;
+			if (PEEK(p) == KW_AS || p->type == COMMA) {
+				NEXT(p);
+				name = parse_test(p);
+				if (!name || !set_context(&p->c, name, Store, name->lineno))
+					return NULL;
+			}
+		}
+		handler_body = parse_block(p);
+		if (!handler_body)
+			return NULL;
+		if (!push(p, ExceptHandler(type, name, handler_body, clause_lineno,
+								   clause_col_offset, p->c.c_arena)))
+			return NULL;
+	}
+	if (p->nstack > base) {
+		handlers = pop_seq(p, base);
+		if (!handlers)
+			return NULL;
+		orelse = parse_else(p, KW_ELSE, &error);
+		if (error)
+			return NULL;
+		finalbody = parse_else(p, KW_FINALLY, &error);
+		if (error)
+			return NULL;
+		s = TryExcept(body, handlers, orelse, lineno, col_offset,
+					  p->c.c_arena);
+		if (!finalbody)
+			return s;
+		/* if a 'finally' is present too, we nest the TryExcept within
+		   a TryFinally to emulate try ... except ... finally */
+		body = asdl_seq_new(1, p->c.c_arena);
+		if (!s || !body)
+			return NULL;
+		asdl_seq_SET(body, 0, s);
+	}
+	else {
+		EXPECT(p, KW_FINALLY);
+		finalbody = parse_block(p);
+		if (!finalbody)
+			return NULL;
+	}
+	return TryFinally(body, finalbody, lineno, col_offset, p->c.c_arena);
+}
+
+static stmt_ty
+parse_with_stmt(struct parsing *p)
+{
+	/* with_stmt: 'with' test [ with_var ] ':' suite
+	   with_var: 'as' expr */
+	int lineno = p->lineno, col_offset = p->col_offset;
+	expr_ty context_expr, optional_vars = NULL;
+	asdl_seq *body;
+
+	NEXT(p);
+	context_expr = parse_test(p);
+	if (!context_expr)
+		return NULL;
+	if (PEEK(p) == KW_AS) {
+		NEXT(p);
+		ENTER(p, TEST_DEPTH);
+		optional_vars = parse_expr(p, 0);
+		LEAVE(p, TEST_DEPTH);
+		if (!optional_vars ||
+			!set_context(&p->c, optional_vars, Store, lineno))
+			return NULL;
+	}
+	body = parse_block(p);
+	if (!body)
+		return NULL;
+	return With(context_expr, optional_vars, body, lineno, col_offset,
+				p->c.c_arena);
+}
+
+static stmt_ty
+parse_funcdef(struct parsing *p, asdl_seq *decorator_seq, int lineno,
+			  int col_offset)
+{
+	/* funcdef: 'def' NAME parameters ':' suite
+	   parameters: '(' [varargslist] ')' */
+	identifier name;
+	arguments_ty args;
+	asdl_seq *body;
+
+	NEXT(p);
+	name = parse_bound_name(p);
+	if (!name)
+		return NULL;
+	EXPECT(p, LPAR);
+	if (PEEK(p) == RPAR)
+		args = arguments(NULL, NULL, NULL, NULL, p->c.c_arena);
+	else
+		args = parse_varargslist(p);
+	if (!args)
+		return NULL;
+	EXPECT(p, RPAR);
+	body = parse_block(p);
+	if (!body)
+		return NULL;
+	return FunctionDef(name, args, body, decorator_seq, lineno, col_offset,
+					   p->c.c_arena);
+}
+
+static stmt_ty
+parse_classdef(struct parsing *p, asdl_seq *decorator_seq, int lineno,
+			   int col_offset)
+{
+	/* classdef: 'class' NAME ['(' [testlist] ')'] ':' suite */
+	identifier name;
+	asdl_seq *bases = NULL, *body;
+
+	NEXT(p);
+	name = parse_bound_name(p);
+	if (!name)
+		return NULL;
+	if (PEEK(p) == LPAR) {
+		NEXT(p);
+		if (PEEK(p) != RPAR) {
+			bases = parse_more_tests(p, parse_test(p));
+			if (!bases)
+				return NULL;
+		}
+		EXPECT(p, RPAR);
+	}
+	body = parse_block(p);
+	if (!body)
+		return NULL;
+	return ClassDef(name, bases, body, decorator_seq, lineno, col_offset,
+					p->c.c_arena);
+}
+
+static expr_ty
+parse_decorator(struct parsing *p)
+{
+	/* decorator: '@' dotted_name [ '(' [arglist] ')' ] NEWLINE */
+	int lineno = p->lineno, col_offset = p->col_offset;
+	int name_lineno, name_col_offset;
+	identifier id;
+	expr_ty e;
+
+	NEXT(p);
+	PEEK(p);
+	name_lineno = p->lineno;
+	name_col_offset = p->col_offset;
+	id = parse_name(p);
+	if (!id)
+		return NULL;
+	e = Name(id, Load, name_lineno, name_col_offset, p->c.c_arena);
+	while (e && PEEK(p) == DOT) {
+		NEXT(p);
+		id = parse_name(p);
+		if (!id)
+			return NULL;
+		e = Attribute(e, id, Load, name_lineno, name_col_offset,
+					  p->c.c_arena);
+	}
+	if (!e)
+		return NULL;
+	if (PEEK(p) == LPAR) {
+		NEXT(p);
+		if (PEEK(p) == RPAR)
+			e = Call(e, NULL, NULL, NULL, NULL, lineno, col_offset,
+					 p->c.c_arena);
+		else
+			e = parse_call(p, e);
+		if (!e)
+			return NULL;
+		EXPECT(p, RPAR);
+	}
+	EXPECT(p, NEWLINE);
+	return e;
+}
+
+static stmt_ty
+parse_compound_stmt(struct parsing *p)
+{
+	/* compound_stmt: if_stmt | while_stmt | for_stmt | try_stmt |
+	                  with_stmt | funcdef | classdef | decorated
+	   decorated: decorator_seq (classdef | funcdef)
+	   decorators: decorator+ */
+	int base, lineno, col_offset;
+	asdl_seq *decorator_seq = NULL;
+	stmt_ty s;
+
+	ENTER(p, STMT_DEPTH);
+	PEEK(p);
+	lineno = p->lineno;
+	col_offset = p->col_offset;
+	switch (p->type) {
+	case KW_IF:
+		s = parse_if_stmt(p);
+		break;
+	case KW_WHILE:
+		s = parse_while_stmt(p);
+		break;
+	case KW_FOR:
+		s = parse_for_stmt(p);
+		break;
+	case KW_TRY:
+		s = parse_try_stmt(p);
+		break;
+	case KW_WITH:
+		s = parse_with_stmt(p);
+		break;
+	default:
+		if (p->type == AT) {
+			base = p->nstack;
+			while (PEEK(p) == AT)
+				if (!push(p, parse_decorator(p)))
+					return NULL;
+			decorator_seq = pop_seq(p, base);
+			if (!decorator_seq)
+				return NULL;
+		}
+		if (p->type == KW_DEF)
+			s = parse_funcdef(p, decorator_seq, lineno, col_offset);
+		else if (p->type == KW_CLASS)
+			s = parse_classdef(p, decorator_seq, lineno, col_offset);
+		else
+			return NULL;
+		break;
+	}
+	LEAVE(p, STMT_DEPTH);
+	return s;
+}
+
+static int
+is_compound_stmt(int type)
+{
+	switch (type) {
+	case KW_IF:
+	case KW_WHILE:
+	case KW_FOR:
+	case KW_TRY:
+	case KW_WITH:
+	case KW_DEF:
+	case KW_CLASS:
+	case AT:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* A statement, pushed on the stack; a simple_stmt pushes all of its own */
+static int
+parse_stmt(struct parsing *p)
+{
+	/* stmt: simple_stmt | compound_stmt */
+	if (is_compound_stmt(PEEK(p)))
+		return push(p, parse_compound_stmt(p));
+	return parse_simple_stmt(p);
+}
+
+static mod_ty
+parse_input(struct parsing *p, int start)
+{
+	asdl_seq *stmts;
+	expr_ty e;
+
+	switch (start) {
+	case Py_file_input:
+		/* file_input: (NEWLINE | stmt)* ENDMARKER */
+		while (PEEK(p) != ENDMARKER)
+			if (p->type == NEWLINE)
+				NEXT(p);
+			else if (!parse_stmt(p))
+				return NULL;
+		stmts = pop_seq(p, 0);
+		if (!stmts)
+			return NULL;
+		return Module(stmts, p->c.c_arena);
+	case Py_eval_input:
+		/* eval_input: testlist NEWLINE* ENDMARKER */
+		e = parse_testlist(p);
+		if (!e)
+			return NULL;
+		while (PEEK(p) == NEWLINE)
+			NEXT(p);
+		if (p->type != ENDMARKER)
+			return NULL;
+		return Expression(e, p->c.c_arena);
+	case Py_single_input:
+		/* single_input: NEWLINE | simple_stmt | compound_stmt NEWLINE
+		   Nothing after it is read, as pgen stops there too. */
+		if (PEEK(p) == NEWLINE) {
+			if (!push(p, Pass(0, 0, p->c.c_arena)))
+				return NULL;
+		}
+		else if (!is_compound_stmt(p->type)) {
+			if (!parse_simple_stmt(p))
+				return NULL;
+		}
+		else {
+			if (!push(p, parse_compound_stmt(p)))
+				return NULL;
+			EXPECT(p, NEWLINE);
+		}
+		stmts = pop_seq(p, 0);
+		if (!stmts)
+			return NULL;
+		return Interactive(stmts, p->c.c_arena);
+	default:
+		return NULL;
+	}
+}
+
+static mod_ty
+parse_tokens(struct tok_state *tok, const char *filename, int start,
+			 PyCompilerFlags *flags, PyArena *arena)
+{
+	struct parsing p;
+	mod_ty mod;
+
+	if (Py_TabcheckFlag) {
+		tok->altwarning = (tok->filename != NULL);
+		if (Py_TabcheckFlag >= 2)
+			tok->alterror++;
+	}
+	p.utf8 = (flags->cf_flags & PyCF_SOURCE_IS_UTF8) != 0;
+	p.c.c_encoding = p.utf8 ? "utf-8" : NULL;
+	p.c.c_future_unicode = flags->cf_flags & CO_FUTURE_UNICODE_LITERALS;
+	p.c.c_no_folding = (flags->cf_flags & PyCF_ONLY_AST) != 0;
+	p.c.c_strict_folding = 0;
+	p.c.c_arena = arena;
+	p.c.c_filename = filename;
+	p.tok = tok;
+	p.type = -1;
+	p.started = 0;
+	p.dont_imply_dedent = flags->cf_flags & PyCF_DONT_IMPLY_DEDENT;
+	p.future = flags->cf_flags &
+		(CO_FUTURE_PRINT_FUNCTION | CO_FUTURE_UNICODE_LITERALS);
+	p.depth = 0;
+	p.strings = 0;
+	p.stack = NULL;
+	p.nstack = p.stack_size = 0;
+	p.text = NULL;
+	p.text_size = 0;
+
+	mod = parse_input(&p, start);
+	/* The CST decodes the string literals with the encoding declared,
+	   and has none for Unicode sources */
+	if (p.utf8 ? tok->encoding != NULL :
+		p.strings && p.c.c_encoding != tok->encoding)
+		mod = NULL;
+	if (mod)
+		flags->cf_flags |= p.future & PyCF_MASK;
+	else if (tok->done == E_NOMEM)
+		PyErr_NoMemory();
+	else if ((tok->done != E_OK && tok->done != E_EOF) ||
+			 PyErr_ExceptionMatches(PyExc_SyntaxError) ||
+			 PyErr_ExceptionMatches(PyExc_UnicodeError))
+		/* An error in the source, which the CST reports */
+		PyErr_Clear();
+	PyMem_Free(p.stack);
+	PyMem_Free(p.text);
+	PyTokenizer_Free(tok);
+	return mod;
+}
+
+/* The token parser can't stand in for the CST when the source could get
+   warnings: they would come twice for one it gives up on */
+#define TOKEN_PARSER_USABLE() \
+	(!Py_Py3kWarningFlag && !Py_VerboseFlag && Py_TabcheckFlag != 1)
+
+mod_ty
+_PyAST_FromString(const char *s, const char *filename, int start,
+				  PyCompilerFlags *flags, PyArena *arena)
+{
+	struct tok_state *tok;
+
+	if (!TOKEN_PARSER_USABLE())
+		return NULL;
+	tok = PyTokenizer_FromString(s);
+	if (!tok) {
+		/* The CST reports a bad encoding declaration */
+		if (PyErr_Occurred())
+			PyErr_Clear();
+		else
+			PyErr_NoMemory();
+		return NULL;
+	}
+	tok->filename = filename ? filename : "<string>";
+	return parse_tokens(tok, filename, start, flags, arena);
+}
+
+mod_ty
+_PyAST_FromFile(FILE *fp, const char *filename, int start,
+				PyCompilerFlags *flags, PyArena *arena)
+{
+	struct tok_state *tok;
+	mod_ty mod;
+	long pos;
+
+	if (!TOKEN_PARSER_USABLE())
+		return NULL;
+	/* The CST parses the file again from here */
+	pos = ftell(fp);
+	if (pos == -1L)
+		return NULL;
+	tok = PyTokenizer_FromFile(fp, NULL, NULL);
+	if (!tok) {
+		PyErr_NoMemory();
+		return NULL;
+	}
+	tok->filename = filename;
+	mod = parse_tokens(tok, filename, start, flags, arena);
+	if (!mod && !PyErr_Occurred() && fseek(fp, pos, SEEK_SET) != 0)
+		PyErr_SetFromErrno(PyExc_IOError);
+	return mod;
+}
@@ -1410,6 +1410,7 @@ compiler_flush_constants(struct compiler *c, PyObject *constants)
 			if (!tmp)
 				return 0;
 			ADDOP_O(c, LOAD_CONSTS, tmp, consts);
+			Py_DECREF(tmp);
 		}
 		_PyList_Clear(constants);
 	}
@@ -2277,6 +2278,7 @@ compiler_import(struct compiler *c, stmt_ty s)
 		if (t == NULL)
 			return -1;
 		ADDOP_O(c, LOAD_CONSTS, t, consts);
+		Py_DECREF(t);
 		ADDOP_NAME(c, IMPORT_NAME, alias->name, names);
 
 		if (alias->asname) {
@@ -2349,6 +2351,7 @@ compiler_from_import(struct compiler *c, stmt_ty s)
 	if (t == NULL)
 		return -1;
 	ADDOP_O(c, LOAD_CONSTS, t, consts);
+	Py_DECREF(t);
 	ADDOP_NAME(c, IMPORT_NAME, s->v.ImportFrom.module, names);
 	for (i = 0; i < n; i++) {
 		alias_ty alias = (alias_ty)asdl_seq_GET(s->v.ImportFrom.names, i);
@@ -2365,10 +2368,8 @@ compiler_from_import(struct compiler *c, stmt_ty s)
 		if (alias->asname)
 			store_name = alias->asname;
 
-		if (!compiler_nameop(c, store_name, Store)) {
-			Py_DECREF(names);
+		if (!compiler_nameop(c, store_name, Store))
 			return 0;
-		}
 	}
 	/* remove imported module */
 	ADDOP(c, POP_TOP);
@@ -3094,6 +3095,10 @@ compiler_genexp(struct compiler *c, expr_ty e)
 	compiler_exit_scope(c);
 	if (co == NULL)
 		return 0;
+	if (asdl_seq_LEN(e->v.GeneratorExp.generators) == 1 &&
+	    asdl_seq_LEN(((comprehension_ty)asdl_seq_GET(
+			e->v.GeneratorExp.generators, 0))->ifs) == 0)
+		co->co_flags |= CO_GENEXP_MAP;
 
 	compiler_make_closure(c, co, 0, NULL);
 	Py_DECREF(co);
@@ -3301,6 +3306,7 @@ compiler_visit_expr(struct compiler *c, expr_ty e)
 				if (t == NULL)
 					return 0;
 				ADDOP_O(c, LOAD_CONSTS, t, consts);
+				Py_DECREF(t);
 			}
 			else {
 				VISIT(c, expr, value);
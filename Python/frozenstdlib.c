@@ -0,0 +1,12 @@
+
+/* Standard library modules frozen into the interpreter.
+
+   "make frozenstdlib" replaces this file with one holding the modules
+   named by FROZEN_STDLIB in the Makefile; see Tools/freeze/freezestdlib.py.
+   This one holds none. */
+
+#include "Python.h"
+
+struct _frozen _PyImport_FrozenStdlib[] = {
+	{0, 0, 0} /* sentinel */
+};
@@ -74,9 +74,12 @@ extern time_t PyOS_GetLastModificationTime(char *, FILE *);
        Python 2.6a0: 62151 (peephole optimizations and STORE_MAP opcode)
        Python 2.6a1: 62161 (WITH_CLEANUP optimization)
        Python 2.6.1: 62162 (wordcodes)
+       Python 2.6.1: 62172 (marshal version 3: nested code objects are
+                            loaded lazily)
+       Python 2.6.1: 62182 (marshal version 4: references to any object)
 .
 */
-#define MAGIC (62162 | ((long)'\r'<<16) | ((long)'\n'<<24))
+#define MAGIC (62182 | ((long)'\r'<<16) | ((long)'\n'<<24))
 
 /* Magic word as global; note that _PyImport_Init() can change the
    value of this global to accommodate for alterations of how the
@@ -240,6 +243,9 @@ _PyImport_Fini(void)
 {
 	Py_XDECREF(extensions);
 	extensions = NULL;
+#ifdef USE_DIR_LISTINGS
+	Py_CLEAR(dir_listings);
+#endif
 	PyMem_DEL(_PyImport_Filetab);
 	_PyImport_Filetab = NULL;
 }
@@ -981,6 +987,7 @@ static PyObject *load_module(char *, FILE *, char *, int, PyObject *);
 static struct filedescr *find_module(char *, char *, PyObject *,
 				     char *, size_t, FILE **, PyObject **);
 static struct _frozen *find_frozen(char *name);
+static struct _frozen *find_frozen_stdlib(char *name);
 
 /* Load a package and return its module object WITH INCREMENTED
    REFERENCE COUNT */
@@ -1135,6 +1142,160 @@ PyImport_GetImporter(PyObject *path) {
 	return importer;
 }
 
+/* Directory listings for find_module().
+
+   Looking for a module in a directory tries a file name for every suffix
+   in _PyImport_Filetab, and nearly all of those tries fail.  Instead, the
+   names in each directory are read once into a set, which is kept along
+   with the directory's modification time, and only the files the listing
+   has are opened.  The directory is listed again when its mtime changes.
+   Listings are kept by the device and inode numbers of the directory,
+   not by its path, which for "." depends on the current directory.
+
+   Reading a listing costs as much as trying a few dozen names, so a
+   directory is only listed once it has been searched LISTING_SEARCHES
+   times.  Short-lived processes try the names, and never read the listing
+   of the directory they were started in, however large.
+
+   A name added in the same clock tick that the listing was read in would
+   go unnoticed, so a directory is only listed once it has been left alone
+   for LISTING_SETTLE seconds.  imp.invalidate_caches() drops all the
+   listings, for file systems whose mtimes can't be relied on. */
+
+#if defined(HAVE_DIRENT_H) && defined(HAVE_STAT) && !defined(PYOS_OS2)
+#define USE_DIR_LISTINGS
+#include <dirent.h>
+
+#define LISTING_SEARCHES 32
+#define LISTING_SETTLE 2
+
+/* (st_dev, st_ino) -> number of searches so far, or (mtime, nsec, names) */
+static PyObject *dir_listings = NULL;
+
+/* Return a new reference to the set of names in the directory path, or
+   Py_None if path isn't a directory.  NULL (with no exception set) means
+   the directory hasn't been listed, and its files have to be tried one
+   by one. */
+static PyObject *
+get_dir_listing(const char *path)
+{
+	struct stat st;
+	long nsec = 0;
+	PyObject *key, *entry, *names = NULL;
+	DIR *dirp;
+	struct dirent *ep;
+
+	if (stat(path, &st) != 0) {
+		if (errno != ENOENT && errno != ENOTDIR)
+			return NULL;
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+	if (!S_ISDIR(st.st_mode)) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+#ifdef HAVE_STAT_TV_NSEC
+	nsec = st.st_mtim.tv_nsec;
+#endif
+	if (dir_listings == NULL && (dir_listings = PyDict_New()) == NULL)
+		goto error;
+#ifdef HAVE_LONG_LONG
+	key = Py_BuildValue("LL", (PY_LONG_LONG)st.st_dev,
+			    (PY_LONG_LONG)st.st_ino);
+#else
+	key = Py_BuildValue("ll", (long)st.st_dev, (long)st.st_ino);
+#endif
+	if (key == NULL)
+		goto error;
+	entry = PyDict_GetItem(dir_listings, key);
+	if (entry != NULL && PyTuple_Check(entry)) {
+		if (PyInt_AS_LONG(PyTuple_GET_ITEM(entry, 0)) ==
+		    (long)st.st_mtime &&
+		    PyInt_AS_LONG(PyTuple_GET_ITEM(entry, 1)) == nsec) {
+			Py_DECREF(key);
+			names = PyTuple_GET_ITEM(entry, 2);
+			Py_INCREF(names);
+			return names;
+		}
+	}
+	else {
+		long searches = entry == NULL ? 1 : PyInt_AS_LONG(entry) + 1;
+		if (searches < LISTING_SEARCHES) {
+			entry = PyInt_FromLong(searches);
+			if (entry == NULL ||
+			    PyDict_SetItem(dir_listings, key, entry) < 0)
+				PyErr_Clear();
+			Py_XDECREF(entry);
+			Py_DECREF(key);
+			return NULL;
+		}
+	}
+	if (time(NULL) - st.st_mtime < LISTING_SETTLE) {
+		Py_DECREF(key);
+		return NULL;
+	}
+
+	dirp = opendir(path);
+	if (dirp == NULL || (names = PySet_New(NULL)) == NULL)
+		goto done;
+	while ((ep = readdir(dirp)) != NULL) {
+		PyObject *name = PyString_FromString(ep->d_name);
+		if (name == NULL || PySet_Add(names, name) < 0) {
+			Py_XDECREF(name);
+			Py_CLEAR(names);
+			goto done;
+		}
+		Py_DECREF(name);
+	}
+	entry = Py_BuildValue("llO", (long)st.st_mtime, nsec, names);
+	if (entry == NULL || PyDict_SetItem(dir_listings, key, entry) < 0)
+		PyErr_Clear();
+	Py_XDECREF(entry);
+  done:
+	if (dirp != NULL)
+		closedir(dirp);
+	Py_DECREF(key);
+  error:
+	/* Running out of memory only costs the speedup */
+	PyErr_Clear();
+	return names;
+}
+#endif /* USE_DIR_LISTINGS */
+
+static PyObject *
+imp_invalidate_caches(PyObject *self, PyObject *noargs)
+{
+#ifdef USE_DIR_LISTINGS
+	Py_CLEAR(dir_listings);
+#endif
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* Return whether the listing names (if any) has the file name */
+static int
+in_listing(PyObject *names, char *name)
+{
+	PyObject *v;
+	int found;
+
+	if (names == NULL)
+		return 1;
+	v = PyString_FromString(name);
+	if (v == NULL) {
+		PyErr_Clear();
+		return 1;
+	}
+	found = PySet_Contains(names, v);
+	Py_DECREF(v);
+	if (found < 0) {
+		PyErr_Clear();
+		return 1;
+	}
+	return found;
+}
+
 /* Search the path (default sys.path) for a module.  Return the
    corresponding filedescr struct, and (via return arguments) the
    pathname and an open file.  Return NULL if the module is not found. */
@@ -1158,6 +1319,7 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
 	char *filemode;
 	FILE *fp = NULL;
 	PyObject *path_hooks, *path_importer_cache;
+	PyObject *names = NULL;
 #ifndef RISCOS
 	struct stat statbuf;
 #endif
@@ -1235,6 +1397,13 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
 			     "No frozen submodule named %.200s", name);
 		return NULL;
 	}
+	if (path != NULL && fullname != NULL &&
+	    strchr(fullname, '.') != NULL &&
+	    find_frozen_stdlib(fullname) != NULL) {
+		/* A module of a frozen standard library package */
+		strcpy(buf, fullname);
+		return &fd_frozen;
+	}
 	if (path == NULL) {
 		if (is_builtin(name)) {
 			strcpy(buf, name);
@@ -1335,6 +1504,18 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
 		}
 		/* no hook was found, use builtin import */
 
+#ifdef USE_DIR_LISTINGS
+		/* A listing can't answer case-insensitive questions */
+		if (getenv("PYTHONCASEOK") == NULL)
+			names = get_dir_listing(len > 0 ? buf : ".");
+		if (names == Py_None) {
+			/* Nothing to find in something that isn't a directory */
+			Py_CLEAR(names);
+			Py_XDECREF(copy);
+			continue;
+		}
+#endif
+
 		if (len > 0 && buf[len-1] != SEP
 #ifdef ALTSEP
 		    && buf[len-1] != ALTSEP
@@ -1347,10 +1528,12 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
 		/* Check for package import (buf holds a directory name,
 		   and there's an __init__ module in that directory */
 #ifdef HAVE_STAT
-		if (stat(buf, &statbuf) == 0 &&         /* it exists */
+		if (in_listing(names, buf + len - namelen) &&
+		    stat(buf, &statbuf) == 0 &&         /* it exists */
 		    S_ISDIR(statbuf.st_mode) &&         /* it's a directory */
 		    case_ok(buf, len, namelen, name)) { /* case matches */
 			if (find_init_module(buf)) { /* and has __init__.py */
+				Py_XDECREF(names);
 				Py_XDECREF(copy);
 				return &fd_package;
 			}
@@ -1361,6 +1544,7 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
 					MAXPATHLEN, buf);
 				if (PyErr_Warn(PyExc_ImportWarning,
 					       warnstr)) {
+					Py_XDECREF(names);
 					Py_XDECREF(copy);
 					return NULL;
 				}
@@ -1423,6 +1607,8 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
 			}
 #endif /* PYOS_OS2 */
 			strcpy(buf+len, fdp->suffix);
+			if (!in_listing(names, buf + len - namelen))
+				continue;
 			if (Py_VerboseFlag > 1)
 				PySys_WriteStderr("# trying %s\n", buf);
 			filemode = fdp->mode;
@@ -1452,6 +1638,7 @@ find_module(char *fullname, char *subname, PyObject *path, char *buf,
 			saved_buf = NULL;
 		}
 #endif
+		Py_CLEAR(names);
 		Py_XDECREF(copy);
 		if (fp != NULL)
 			break;
@@ -1887,13 +2074,74 @@ find_frozen(char *name)
 
 	for (p = PyImport_FrozenModules; ; p++) {
 		if (p->name == NULL)
-			return NULL;
+			return find_frozen_stdlib(name);
 		if (strcmp(p->name, name) == 0)
 			break;
 	}
 	return p;
 }
 
+/* Frozen standard library modules stand in for the files they were made
+   from, so they are only used when it's known which directory that is. */
+
+static struct _frozen *
+find_frozen_stdlib(char *name)
+{
+	static Py_ssize_t n = -1;
+	Py_ssize_t lo, hi, mid;
+	int cmp;
+
+	if (n < 0) {
+		for (n = 0; _PyImport_FrozenStdlib[n].name != NULL; n++)
+			;
+		if (_Py_GetStdlibDir() == NULL)
+			n = 0;
+	}
+	lo = 0;
+	hi = n;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		cmp = strcmp(name, _PyImport_FrozenStdlib[mid].name);
+		if (cmp == 0)
+			return &_PyImport_FrozenStdlib[mid];
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return NULL;
+}
+
+/* Store the name of the source file of the frozen standard library module
+   name in buf: <stdlib>/name.py, or <stdlib>/name/__init__.py for a
+   package.  Return -1 if it doesn't fit. */
+
+static int
+frozen_stdlib_file(char *name, int ispackage, char *buf, size_t buflen)
+{
+	char *dir = _Py_GetStdlibDir();
+	size_t len = strlen(dir);
+	char *p;
+
+	if (len + 1 + strlen(name) + 12 >= buflen)
+		return -1;
+	strcpy(buf, dir);
+	if (len > 0 && buf[len - 1] != SEP)
+		buf[len++] = SEP;
+	strcpy(buf + len, name);
+	for (p = buf + len; *p != '\0'; p++) {
+		if (*p == '.')
+			*p = SEP;
+	}
+	if (ispackage) {
+		*p++ = SEP;
+		strcpy(p, "__init__.py");
+	}
+	else
+		strcpy(p, ".py");
+	return 0;
+}
+
 static PyObject *
 get_frozen_object(char *name)
 {
@@ -1931,6 +2179,8 @@ PyImport_ImportFrozenModule(char *name)
 	PyObject *m;
 	int ispackage;
 	int size;
+	char *pathname = "<frozen>";
+	char file[MAXPATHLEN+1];
 
 	if (p == NULL)
 		return 0;
@@ -1956,15 +2206,39 @@ PyImport_ImportFrozenModule(char *name)
 			     name);
 		goto err_return;
 	}
+	if (p == find_frozen_stdlib(name)) {
+		if (frozen_stdlib_file(name, ispackage, file,
+				       sizeof(file)) < 0) {
+			PyErr_Format(PyExc_ImportError,
+				     "standard library path too long for %.200s",
+				     name);
+			goto err_return;
+		}
+		pathname = file;
+	}
 	if (ispackage) {
-		/* Set __path__ to the package name */
+		/* Set __path__ to the package name, or for a standard library
+		   package to its directory */
 		PyObject *d, *s;
 		int err;
 		m = PyImport_AddModule(name);
 		if (m == NULL)
 			goto err_return;
 		d = PyModule_GetDict(m);
-		s = PyString_InternFromString(name);
+		if (pathname != file)
+			s = PyString_InternFromString(name);
+		else {
+			s = PyString_FromStringAndSize(file,
+				strrchr(file, SEP) - file);
+			if (s != NULL) {
+				PyObject *dir = s;
+				s = PyList_New(1);
+				if (s == NULL)
+					Py_DECREF(dir);
+				else
+					PyList_SET_ITEM(s, 0, dir);
+			}
+		}
 		if (s == NULL)
 			goto err_return;
 		err = PyDict_SetItemString(d, "__path__", s);
@@ -1972,7 +2246,7 @@ PyImport_ImportFrozenModule(char *name)
 		if (err != 0)
 			goto err_return;
 	}
-	m = PyImport_ExecCodeModuleEx(name, co, "<frozen>");
+	m = PyImport_ExecCodeModuleEx(name, co, pathname);
 	if (m == NULL)
 		goto err_return;
 	Py_DECREF(co);
@@ -3090,6 +3364,12 @@ This lock should be used by import hooks to ensure thread-safety\n\
 when importing modules.\n\
 On platforms without threads, this function does nothing.");
 
+PyDoc_STRVAR(doc_invalidate_caches,
+"invalidate_caches() -> None\n\
+Forget the directory listings kept to speed up finding modules.\n\
+Call this after adding modules on a file system whose directory\n\
+modification times aren't kept up to date.");
+
 PyDoc_STRVAR(doc_release_lock,
 "release_lock() -> None\n\
 Release the interpreter's import lock.\n\
@@ -3105,6 +3385,8 @@ static PyMethodDef imp_methods[] = {
 	{"lock_held",	 imp_lock_held,	   METH_NOARGS,  doc_lock_held},
 	{"acquire_lock", imp_acquire_lock, METH_NOARGS,  doc_acquire_lock},
 	{"release_lock", imp_release_lock, METH_NOARGS,  doc_release_lock},
+	{"invalidate_caches", imp_invalidate_caches, METH_NOARGS,
+	 doc_invalidate_caches},
 	/* The rest are obsolete */
 	{"get_frozen_object",	imp_get_frozen_object,	METH_VARARGS},
 	{"init_builtin",	imp_init_builtin,	METH_VARARGS},
@@ -37,10 +37,18 @@
 #define TYPE_LIST		'['
 #define TYPE_DICT		'{'
 #define TYPE_CODE		'c'
+#define TYPE_LAZYCODE		'C'
 #define TYPE_UNICODE		'u'
 #define TYPE_UNKNOWN		'?'
 #define TYPE_SET		'<'
 #define TYPE_FROZENSET  	'>'
+#define TYPE_REF		'r'
+#define TYPE_SHORT_STRING	'z'
+#define TYPE_SHORT_INTERNED	'Z'
+#define TYPE_SMALL_TUPLE	')'
+
+/* Added to the type of an object that TYPE_REF can refer back to */
+#define FLAG_REF		0x80
 
 typedef struct {
 	FILE *fp;
@@ -50,8 +58,19 @@ typedef struct {
 	PyObject *str;
 	char *ptr;
 	char *end;
-	PyObject *strings; /* dict on marshal, list on unmarshal */
+	/* Objects that can be referred back to: on marshal, a dict mapping
+	   them (interned strings up to version 3) to their index; on
+	   unmarshal, the list of them.  When base isn't NULL, it is the
+	   lazily loaded code object being read, and its data can also refer
+	   to the first nbase objects of the data it was part of. */
+	PyObject *refs;
 	int version;
+	int nested;	/* marshal: depth of the constants of the function
+			   being written, or 0 */
+	PyObject *added; /* marshal: list of the keys added to refs, or NULL */
+	int trusted;	/* unmarshal: skip the restricted mode check */
+	PyObject *base;
+	Py_ssize_t nbase;
 } WFILE;
 
 #define w_byte(c, p) if (((p)->fp)) putc((c), (p)->fp); \
@@ -119,10 +138,157 @@ w_long64(long x, WFILE *p)
 }
 #endif
 
+static void w_object(PyObject *, WFILE *);
+
+/* Give key the next index in p->refs.  Return -1 on error. */
+static int
+w_add_ref(PyObject *key, WFILE *p)
+{
+	PyObject *idx;
+	int ok;
+
+	idx = PyInt_FromSsize_t(PyDict_Size(p->refs));
+	ok = idx != NULL && PyDict_SetItem(p->refs, key, idx) == 0 &&
+		(p->added == NULL || PyList_Append(p->added, key) == 0);
+	Py_XDECREF(idx);
+	return ok ? 0 : -1;
+}
+
+/* Whether v is a tuple of interned strings, like the names of a code
+   object.  Equal ones can be written once however many copies there
+   are. */
+static int
+is_names_tuple(PyObject *v)
+{
+	Py_ssize_t i;
+
+	if (!PyTuple_CheckExact(v) || PyTuple_GET_SIZE(v) == 0)
+		return 0;
+	for (i = 0; i < PyTuple_GET_SIZE(v); i++) {
+		PyObject *item = PyTuple_GET_ITEM(v, i);
+		if (!PyString_CheckExact(item) ||
+		    !PyString_CHECK_INTERNED(item))
+			return 0;
+	}
+	return 1;
+}
+
+/* Version 4 writes an object that has been written before as TYPE_REF and
+   its index among the objects written with FLAG_REF.  Objects are known by
+   their address, except for tuples of names, which are known by value.  An
+   object only one reference leads to can't come up again, so it isn't
+   numbered, except for a TYPE_INTERNED string: the reader numbers those
+   anyway, as versions up to 3 need.  Return 1 if v has been dealt with
+   (written as a reference, or an error occurred); otherwise set *flag if
+   it has been numbered.
+*/
+static int
+w_ref(PyObject *v, int *flag, WFILE *p)
+{
+	PyObject *key, *idx;
+
+	if (is_names_tuple(v)) {
+		Py_INCREF(v);
+		key = v;
+	}
+	else if ((Py_REFCNT(v) == 1 &&
+		  !(PyString_CheckExact(v) && PyString_CHECK_INTERNED(v) &&
+		    PyString_GET_SIZE(v) >= 256)) ||
+		 (PyTuple_CheckExact(v) && PyTuple_GET_SIZE(v) == 0))
+		return 0;
+	else {
+		key = PyLong_FromVoidPtr(v);
+		if (key == NULL) {
+			p->error = 1;
+			return 1;
+		}
+	}
+	idx = PyDict_GetItem(p->refs, key);
+	if (idx != NULL) {
+		w_byte(TYPE_REF, p);
+		w_long(PyInt_AS_LONG(idx), p);
+	}
+	else if (w_add_ref(key, p) < 0)
+		p->error = 1;
+	else
+		*flag = FLAG_REF;
+	Py_DECREF(key);
+	return idx != NULL || p->error;
+}
+
+/* Version 3 writes the code objects found among the constants of a
+   function's code object as TYPE_LAZYCODE: the length of the code
+   object's data, then the data, which only refers back to the objects
+   written before it.  The reader can skip it, and decode it when the code
+   object is first needed (see _PyLazyCode_Load() below).  The code of
+   functions and classes defined in a module or class body is needed as
+   soon as the module is run, so that is written as it is.
+*/
+static void
+w_lazy_code(PyObject *co, WFILE *p)
+{
+	WFILE wf;
+	Py_ssize_t n;
+
+	wf.fp = NULL;
+	wf.str = PyString_FromStringAndSize((char *)NULL, 256);
+	if (wf.str == NULL) {
+		p->error = 1;
+		return;
+	}
+	wf.ptr = PyString_AS_STRING(wf.str);
+	wf.end = wf.ptr + PyString_GET_SIZE(wf.str);
+	wf.error = 0;
+	wf.depth = p->depth - 1;
+	wf.version = p->version;
+	wf.nested = 0;
+	/* What the code object adds to refs is forgotten afterwards */
+	wf.refs = p->refs;
+	wf.added = PyList_New(0);
+	if (wf.added == NULL) {
+		Py_DECREF(wf.str);
+		p->error = 1;
+		return;
+	}
+	w_object(co, &wf);
+	for (n = 0; n < PyList_GET_SIZE(wf.added); n++) {
+		if (PyDict_DelItem(p->refs,
+				   PyList_GET_ITEM(wf.added, n)) < 0)
+			wf.error = 1;
+	}
+	Py_DECREF(wf.added);
+	if (wf.str == NULL || wf.error) {
+		Py_XDECREF(wf.str);
+		p->error = wf.error ? wf.error : 1;
+		return;
+	}
+	n = wf.ptr - PyString_AS_STRING(wf.str);
+	if (n > INT_MAX) {
+		Py_DECREF(wf.str);
+		p->error = 1;
+		return;
+	}
+	w_byte(TYPE_LAZYCODE, p);
+	w_long((long)n, p);
+	w_string(PyString_AS_STRING(wf.str), (int)n, p);
+	Py_DECREF(wf.str);
+}
+
+#define W_TYPE(t, p) w_byte((char)((t) | flag), (p))
+
 static void
 w_object(PyObject *v, WFILE *p)
 {
 	Py_ssize_t i, n;
+	int flag = 0;
+
+	if (v != NULL && _PyLazyCode_Check(v)) {
+		v = _PyLazyCode_Load(v);
+		if (v == NULL) {
+			p->error = 1;
+			return;
+		}
+	}
 
 	p->depth++;
 
@@ -147,6 +313,13 @@ w_object(PyObject *v, WFILE *p)
 	else if (v == Py_True) {
 	        w_byte(TYPE_TRUE, p);
 	}
+	else if (PyCode_Check(v) && p->depth == p->nested && p->version > 2) {
+		w_lazy_code(v, p);
+	}
+	else if (p->version > 3 && p->refs != NULL &&
+		 !PyInt_CheckExact(v) && w_ref(v, &flag, p)) {
+		/* Written as a reference */
+	}
 	else if (PyInt_CheckExact(v)) {
 		long x = PyInt_AS_LONG((PyIntObject *)v);
 #if SIZEOF_LONG > 4
@@ -164,7 +337,7 @@ w_object(PyObject *v, WFILE *p)
 	}
 	else if (PyLong_CheckExact(v)) {
 		PyLongObject *ob = (PyLongObject *)v;
-		w_byte(TYPE_LONG, p);
+		W_TYPE(TYPE_LONG, p);
 		n = ob->ob_size;
 		w_long((long)n, p);
 		if (n < 0)
@@ -180,14 +353,14 @@ w_object(PyObject *v, WFILE *p)
 				p->error = 1;
 				return;
 			}
-			w_byte(TYPE_BINARY_FLOAT, p);
+			W_TYPE(TYPE_BINARY_FLOAT, p);
 			w_string((char*)buf, 8, p);
 		}
 		else {
 			char buf[256]; /* Plenty to format any double */
 			PyFloat_AsReprString(buf, (PyFloatObject *)v);
 			n = strlen(buf);
-			w_byte(TYPE_FLOAT, p);
+			W_TYPE(TYPE_FLOAT, p);
 			w_byte((int)n, p);
 			w_string(buf, (int)n, p);
 		}
@@ -201,7 +374,7 @@ w_object(PyObject *v, WFILE *p)
 				p->error = 1;
 				return;
 			}
-			w_byte(TYPE_BINARY_COMPLEX, p);
+			W_TYPE(TYPE_BINARY_COMPLEX, p);
 			w_string((char*)buf, 8, p);
 			if (_PyFloat_Pack8(PyComplex_ImagAsDouble(v), 
 					   buf, 1) < 0) {
@@ -213,7 +386,7 @@ w_object(PyObject *v, WFILE *p)
 		else {
 			char buf[256]; /* Plenty to format any double */
 			PyFloatObject *temp;
-			w_byte(TYPE_COMPLEX, p);
+			W_TYPE(TYPE_COMPLEX, p);
 			temp = (PyFloatObject*)PyFloat_FromDouble(
 				PyComplex_RealAsDouble(v));
 			if (!temp) {
@@ -240,8 +413,20 @@ w_object(PyObject *v, WFILE *p)
 	}
 #endif
 	else if (PyString_CheckExact(v)) {
-		if (p->strings && PyString_CHECK_INTERNED(v)) {
-			PyObject *o = PyDict_GetItem(p->strings, v);
+		int interned = PyString_CHECK_INTERNED(v);
+		n = PyString_GET_SIZE(v);
+		if (p->version > 3 && n < 256) {
+			W_TYPE(interned ? TYPE_SHORT_INTERNED :
+			       TYPE_SHORT_STRING, p);
+			w_byte((char)n, p);
+			w_string(PyString_AS_STRING(v), (int)n, p);
+			goto exit;
+		}
+		if (p->version > 3) {
+			W_TYPE(interned ? TYPE_INTERNED : TYPE_STRING, p);
+		}
+		else if (p->refs && interned) {
+			PyObject *o = PyDict_GetItem(p->refs, v);
 			if (o) {
 				long w = PyInt_AsLong(o);
 				w_byte(TYPE_STRINGREF, p);
@@ -249,12 +434,7 @@ w_object(PyObject *v, WFILE *p)
 				goto exit;
 			}
 			else {
-				int ok;
-				o = PyInt_FromSsize_t(PyDict_Size(p->strings));
-				ok = o &&
-				     PyDict_SetItem(p->strings, v, o) >= 0;
-				Py_XDECREF(o);
-				if (!ok) {
+				if (w_add_ref(v, p) < 0) {
 					p->depth--;
 					p->error = 1;
 					return;
@@ -265,7 +445,6 @@ w_object(PyObject *v, WFILE *p)
 		else {
 			w_byte(TYPE_STRING, p);
 		}
-		n = PyString_GET_SIZE(v);
 		if (n > INT_MAX) {
 			/* huge strings are not supported */
 			p->depth--;
@@ -284,7 +463,7 @@ w_object(PyObject *v, WFILE *p)
 			p->error = 1;
 			return;
 		}
-		w_byte(TYPE_UNICODE, p);
+		W_TYPE(TYPE_UNICODE, p);
 		n = PyString_GET_SIZE(utf8);
 		if (n > INT_MAX) {
 			p->depth--;
@@ -297,15 +476,21 @@ w_object(PyObject *v, WFILE *p)
 	}
 #endif
 	else if (PyTuple_CheckExact(v)) {
-		w_byte(TYPE_TUPLE, p);
-		n = PyTuple_Size(v);
-		w_long((long)n, p);
+		n = PyTuple_GET_SIZE(v);
+		if (p->version > 3 && n < 256) {
+			W_TYPE(TYPE_SMALL_TUPLE, p);
+			w_byte((char)n, p);
+		}
+		else {
+			W_TYPE(TYPE_TUPLE, p);
+			w_long((long)n, p);
+		}
 		for (i = 0; i < n; i++) {
 			w_object(PyTuple_GET_ITEM(v, i), p);
 		}
 	}
 	else if (PyList_CheckExact(v)) {
-		w_byte(TYPE_LIST, p);
+		W_TYPE(TYPE_LIST, p);
 		n = PyList_GET_SIZE(v);
 		w_long((long)n, p);
 		for (i = 0; i < n; i++) {
@@ -315,7 +500,7 @@ w_object(PyObject *v, WFILE *p)
 	else if (PyDict_CheckExact(v)) {
 		Py_ssize_t pos;
 		PyObject *key, *value;
-		w_byte(TYPE_DICT, p);
+		W_TYPE(TYPE_DICT, p);
 		/* This one is NULL object terminated! */
 		pos = 0;
 		while (PyDict_Next(v, &pos, &key, &value)) {
@@ -328,9 +513,9 @@ w_object(PyObject *v, WFILE *p)
 		PyObject *value, *it;
 
 		if (PyObject_TypeCheck(v, &PySet_Type))
-			w_byte(TYPE_SET, p);
+			W_TYPE(TYPE_SET, p);
 		else
-			w_byte(TYPE_FROZENSET, p);
+			W_TYPE(TYPE_FROZENSET, p);
 		n = PyObject_Size(v);
 		if (n == -1) {
 			p->depth--;
@@ -357,13 +542,19 @@ w_object(PyObject *v, WFILE *p)
 	}
 	else if (PyCode_Check(v)) {
 		PyCodeObject *co = (PyCodeObject *)v;
-		w_byte(TYPE_CODE, p);
+		int nested = p->nested;
+		W_TYPE(TYPE_CODE, p);
 		w_long(co->co_argcount, p);
 		w_long(co->co_nlocals, p);
 		w_long(co->co_stacksize, p);
 		w_long(co->co_flags, p);
 		w_object(co->co_code, p);
+		/* Only the code objects that are themselves constants of a
+		   function are written lazily, so that loading them is
+		   only a matter of replacing items of co_consts. */
+		p->nested = (co->co_flags & CO_OPTIMIZED) ? p->depth + 2 : 0;
 		w_object(co->co_consts, p);
+		p->nested = nested;
 		w_object(co->co_names, p);
 		w_object(co->co_varnames, p);
 		w_object(co->co_freevars, p);
@@ -377,7 +568,7 @@ w_object(PyObject *v, WFILE *p)
 		/* Write unknown buffer-style objects as a string */
 		char *s;
 		PyBufferProcs *pb = v->ob_type->tp_as_buffer;
-		w_byte(TYPE_STRING, p);
+		W_TYPE(TYPE_STRING, p);
 		n = (*pb->bf_getreadbuffer)(v, 0, (void **)&s);
 		if (n > INT_MAX) {
 			p->depth--;
@@ -395,6 +586,8 @@ w_object(PyObject *v, WFILE *p)
 	p->depth--;
 }
 
+#undef W_TYPE
+
 /* version currently has no effect for writing longs. */
 void
 PyMarshal_WriteLongToFile(long x, FILE *fp, int version)
@@ -403,8 +596,10 @@ PyMarshal_WriteLongToFile(long x, FILE *fp, int version)
 	wf.fp = fp;
 	wf.error = 0;
 	wf.depth = 0;
-	wf.strings = NULL;
+	wf.refs = NULL;
 	wf.version = version;
+	wf.nested = 0;
+	wf.added = NULL;
 	w_long(x, &wf);
 }
 
@@ -415,10 +610,12 @@ PyMarshal_WriteObjectToFile(PyObject *x, FILE *fp, int version)
 	wf.fp = fp;
 	wf.error = 0;
 	wf.depth = 0;
-	wf.strings = (version > 0) ? PyDict_New() : NULL;
+	wf.refs = (version > 0) ? PyDict_New() : NULL;
 	wf.version = version;
+	wf.nested = 0;
+	wf.added = NULL;
 	w_object(x, &wf);
-	Py_XDECREF(wf.strings);
+	Py_XDECREF(wf.refs);
 }
 
 typedef WFILE RFILE; /* Same struct with different invariants */
@@ -462,6 +659,12 @@ r_long(RFILE *p)
 		x |= (long)getc(fp) << 16;
 		x |= (long)getc(fp) << 24;
 	}
+	else if (p->end - p->ptr >= 4) {
+		const unsigned char *s = (const unsigned char *)p->ptr;
+		x = s[0] | ((long)s[1] << 8) | ((long)s[2] << 16) |
+			((long)s[3] << 24);
+		p->ptr += 4;
+	}
 	else {
 		x = rs_byte(p);
 		x |= (long)rs_byte(p) << 8;
@@ -506,6 +709,226 @@ r_long64(RFILE *p)
 #endif
 }
 
+/* A code object that hasn't been unmarshalled yet.  These only appear
+   as items of the co_consts of a function's code object, and are
+   replaced by the code objects they stand for when a frame for that
+   function is first created (see _PyCode_LoadConsts()); most functions
+   of most modules are never called, so this saves the time and memory
+   it takes to build them.  Each keeps a copy of its own record only.
+*/
+typedef struct {
+	PyObject_HEAD
+	PyObject *data;		/* str holding the marshal data */
+	PyObject *parent;	/* lazy code object whose data held this */
+	PyObject *refs;		/* objects the data refers back to, after */
+	Py_ssize_t nrefs;	/* those of parent; nrefs of them in all */
+	PyObject *code;		/* the code object once it has been loaded */
+} lazycodeobject;
+
+/* Read a str of length n, and intern it if interned is set */
+static PyObject *
+r_str(RFILE *p, Py_ssize_t n, int interned)
+{
+	PyObject *v;
+
+	if (p->fp == NULL) {
+		if (p->end - p->ptr < n)
+			goto eof;
+		v = PyString_FromStringAndSize(p->ptr, n);
+		if (v == NULL)
+			return NULL;
+		p->ptr += n;
+	}
+	else {
+		v = PyString_FromStringAndSize((char *)NULL, n);
+		if (v == NULL)
+			return NULL;
+		if (r_string(PyString_AS_STRING(v), (int)n, p) != n) {
+			Py_DECREF(v);
+			goto eof;
+		}
+	}
+	if (interned)
+		PyString_InternInPlace(&v);
+	return v;
+
+  eof:
+	PyErr_SetString(PyExc_EOFError, "EOF read where object expected");
+	return NULL;
+}
+
+/* Number of objects that can be referred back to so far */
+#define R_NREFS(p) ((p)->nbase + PyList_GET_SIZE((p)->refs))
+
+#define LAZY_PARENT(lc) ((lazycodeobject *)(lc)->parent)
+
+/* Return a borrowed reference to object number n, or NULL */
+static PyObject *
+r_ref(RFILE *p, long n)
+{
+	lazycodeobject *lc;
+
+	if (n < 0 || n >= R_NREFS(p))
+		return NULL;
+	if (n >= p->nbase)
+		return PyList_GET_ITEM(p->refs, n - p->nbase);
+	/* Find the data it was read from */
+	lc = (lazycodeobject *)p->base;
+	while (lc->parent != NULL && n < LAZY_PARENT(lc)->nrefs)
+		lc = LAZY_PARENT(lc);
+	if (lc->parent != NULL)
+		n -= LAZY_PARENT(lc)->nrefs;
+	return PyList_GET_ITEM(lc->refs, n);
+}
+
+static PyObject *
+r_lazy_code(RFILE *p, Py_ssize_t n)
+{
+	lazycodeobject *lc;
+
+	lc = PyObject_GC_New(lazycodeobject, &_PyLazyCode_Type);
+	if (lc == NULL)
+		return NULL;
+	lc->parent = NULL;
+	lc->refs = NULL;
+	lc->code = NULL;
+	_PyObject_GC_TRACK(lc);
+	/* A copy of its own part of the data, so that a code object which is
+	   never loaded doesn't keep all of it alive */
+	lc->data = r_str(p, n, 0);
+	if (lc->data == NULL) {
+		Py_DECREF(lc);
+		return NULL;
+	}
+	Py_XINCREF(p->base);
+	lc->parent = p->base;
+	Py_INCREF(p->refs);
+	lc->refs = p->refs;
+	lc->nrefs = R_NREFS(p);
+	return (PyObject *)lc;
+}
+
+static PyObject *read_object(RFILE *);
+
+/* Return a borrowed reference to the code object op stands for. */
+PyObject *
+_PyLazyCode_Load(PyObject *op)
+{
+	lazycodeobject *lc = (lazycodeobject *)op;
+	RFILE rf;
+	PyObject *v;
+
+	assert(_PyLazyCode_Check(op));
+	if (lc->code != NULL)
+		return lc->code;
+	rf.fp = NULL;
+	rf.ptr = PyString_AS_STRING(lc->data);
+	rf.end = rf.ptr + PyString_GET_SIZE(lc->data);
+	rf.depth = 0;
+	rf.trusted = 1;
+	rf.base = op;
+	rf.nbase = lc->nrefs;
+	rf.refs = PyList_New(0);
+	if (rf.refs == NULL)
+		return NULL;
+	v = read_object(&rf);
+	Py_DECREF(rf.refs);
+	if (v == NULL)
+		return NULL;
+	if (!PyCode_Check(v) || rf.ptr != rf.end) {
+		Py_DECREF(v);
+		PyErr_SetString(PyExc_ValueError, "bad marshal data");
+		return NULL;
+	}
+	if (lc->code != NULL) {
+		/* Loaded meanwhile by a destructor run from read_object() */
+		Py_DECREF(v);
+		return lc->code;
+	}
+	lc->code = v;
+	/* refs stays: the code objects in v that are still to be loaded can
+	   refer to them */
+	Py_CLEAR(lc->data);
+	return v;
+}
+
+/* Once loaded, a lazy code object is part of a cycle if the code holds
+   lazy code objects of its own: they keep it as their parent. */
+static int
+lazycode_traverse(lazycodeobject *lc, visitproc visit, void *arg)
+{
+	Py_VISIT(lc->parent);
+	Py_VISIT(lc->refs);
+	Py_VISIT(lc->code);
+	return 0;
+}
+
+static int
+lazycode_clear(lazycodeobject *lc)
+{
+	Py_CLEAR(lc->parent);
+	Py_CLEAR(lc->refs);
+	Py_CLEAR(lc->code);
+	return 0;
+}
+
+static void
+lazycode_dealloc(lazycodeobject *lc)
+{
+	PyObject_GC_UnTrack(lc);
+	Py_XDECREF(lc->data);
+	Py_XDECREF(lc->parent);
+	Py_XDECREF(lc->refs);
+	Py_XDECREF(lc->code);
+	PyObject_GC_Del(lc);
+}
+
+PyTypeObject _PyLazyCode_Type = {
+	PyVarObject_HEAD_INIT(&PyType_Type, 0)
+	"lazy_code",
+	sizeof(lazycodeobject),
+	0,
+	(destructor)lazycode_dealloc,	/* tp_dealloc */
+	0,				/* tp_print */
+	0,				/* tp_getattr */
+	0,				/* tp_setattr */
+	0,				/* tp_compare */
+	0,				/* tp_repr */
+	0,				/* tp_as_number */
+	0,				/* tp_as_sequence */
+	0,				/* tp_as_mapping */
+	0,				/* tp_hash */
+	0,				/* tp_call */
+	0,				/* tp_str */
+	0,				/* tp_getattro */
+	0,				/* tp_setattro */
+	0,				/* tp_as_buffer */
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,	/* tp_flags */
+	0,				/* tp_doc */
+	(traverseproc)lazycode_traverse,	/* tp_traverse */
+	(inquiry)lazycode_clear,	/* tp_clear */
+};
+
+/* Make v the object numbered idx, in place of the None that stood for it */
+static void
+r_set_ref(RFILE *p, Py_ssize_t idx, PyObject *v)
+{
+	PyObject *old = PyList_GET_ITEM(p->refs, idx - p->nbase);
+
+	Py_INCREF(v);
+	PyList_SET_ITEM(p->refs, idx - p->nbase, v);
+	Py_DECREF(old);
+}
+
+/* Number a tuple, list or dict as soon as it exists, so that the objects
+   in it can refer back to it */
+#define R_REF(v) do { \
+		if (flag) { \
+			r_set_ref(p, idx, (v)); \
+			flag = 0; \
+		} \
+	} while (0)
+
 static PyObject *
 r_object(RFILE *p)
 {
@@ -514,6 +937,8 @@ r_object(RFILE *p)
 	PyObject *v, *v2;
 	long i, n;
 	int type = r_byte(p);
+	int flag = 0;
+	Py_ssize_t idx = 0;
 	PyObject *retval;
 
 	p->depth++;
@@ -524,6 +949,18 @@ r_object(RFILE *p)
 		return NULL;
 	}
 
+	if (type != EOF && (type & FLAG_REF)) {
+		/* Number it before the objects it contains; None stands for
+		   it until it has been read, or R_REF() has been used */
+		type &= ~FLAG_REF;
+		flag = 1;
+		idx = R_NREFS(p);
+		if (PyList_Append(p->refs, Py_None) < 0) {
+			p->depth--;
+			return NULL;
+		}
+	}
+
 	switch (type) {
 
 	case EOF:
@@ -713,36 +1150,46 @@ r_object(RFILE *p)
 			retval = NULL;
 			break;
 		}
-		v = PyString_FromStringAndSize((char *)NULL, n);
-		if (v == NULL) {
-			retval = NULL;
-			break;
-		}
-		if (r_string(PyString_AS_STRING(v), (int)n, p) != n) {
-			Py_DECREF(v);
+		v = r_str(p, n, type == TYPE_INTERNED);
+		/* Up to version 3 TYPE_STRINGREF can refer to any interned
+		   string */
+		if (v != NULL && type == TYPE_INTERNED && !flag &&
+		    PyList_Append(p->refs, v) < 0)
+			Py_CLEAR(v);
+		retval = v;
+		break;
+
+	case TYPE_SHORT_INTERNED:
+	case TYPE_SHORT_STRING:
+		n = r_byte(p);
+		if (n == EOF) {
 			PyErr_SetString(PyExc_EOFError,
 					"EOF read where object expected");
 			retval = NULL;
 			break;
 		}
-		if (type == TYPE_INTERNED) {
-			PyString_InternInPlace(&v);
-			if (PyList_Append(p->strings, v) < 0) {
-				retval = NULL;
-				break;
-			}
+		retval = r_str(p, n, type == TYPE_SHORT_INTERNED);
+		break;
+
+	case TYPE_STRINGREF:
+		v = r_ref(p, r_long(p));
+		if (v == NULL) {
+			PyErr_SetString(PyExc_ValueError, "bad marshal data");
+			retval = NULL;
+			break;
 		}
+		Py_INCREF(v);
 		retval = v;
 		break;
 
-	case TYPE_STRINGREF:
-		n = r_long(p);
-		if (n < 0 || n >= PyList_GET_SIZE(p->strings)) {
+	case TYPE_REF:
+		v = r_ref(p, r_long(p));
+		/* None stands for an object that is still being read */
+		if (v == NULL || v == Py_None) {
 			PyErr_SetString(PyExc_ValueError, "bad marshal data");
 			retval = NULL;
 			break;
 		}
-		v = PyList_GET_ITEM(p->strings, n);
 		Py_INCREF(v);
 		retval = v;
 		break;
@@ -777,8 +1224,9 @@ r_object(RFILE *p)
 	    }
 #endif
 
+	case TYPE_SMALL_TUPLE:
 	case TYPE_TUPLE:
-		n = r_long(p);
+		n = type == TYPE_TUPLE ? r_long(p) : r_byte(p);
 		if (n < 0 || n > INT_MAX) {
 			PyErr_SetString(PyExc_ValueError, "bad marshal data");
 			retval = NULL;
@@ -789,6 +1237,7 @@ r_object(RFILE *p)
 			retval = NULL;
 			break;
 		}
+		R_REF(v);
 		for (i = 0; i < n; i++) {
 			v2 = r_object(p);
 			if ( v2 == NULL ) {
@@ -816,6 +1265,7 @@ r_object(RFILE *p)
 			retval = NULL;
 			break;
 		}
+		R_REF(v);
 		for (i = 0; i < n; i++) {
 			v2 = r_object(p);
 			if ( v2 == NULL ) {
@@ -837,6 +1287,7 @@ r_object(RFILE *p)
 			retval = NULL;
 			break;
 		}
+		R_REF(v);
 		for (;;) {
 			PyObject *key, *val;
 			key = r_object(p);
@@ -889,7 +1340,7 @@ r_object(RFILE *p)
 		retval = v;
 		break;
 
-	case TYPE_CODE:
+	case TYPE_LAZYCODE:
 		if (PyEval_GetRestricted()) {
 			PyErr_SetString(PyExc_RuntimeError,
 				"cannot unmarshal code objects in "
@@ -897,6 +1348,23 @@ r_object(RFILE *p)
 			retval = NULL;
 			break;
 		}
+		n = r_long(p);
+		if (n < 0 || n > INT_MAX) {
+			PyErr_SetString(PyExc_ValueError, "bad marshal data");
+			retval = NULL;
+			break;
+		}
+		retval = r_lazy_code(p, n);
+		break;
+
+	case TYPE_CODE:
+		if (!p->trusted && PyEval_GetRestricted()) {
+			PyErr_SetString(PyExc_RuntimeError,
+				"cannot unmarshal code objects in "
+				"restricted execution mode");
+			retval = NULL;
+			break;
+		}
 		else {
 			int argcount;
 			int nlocals;
@@ -954,6 +1422,10 @@ r_object(RFILE *p)
 					code, consts, names, varnames,
 					freevars, cellvars, filename, name,
 					firstlineno, lnotab);
+			/* Lazy code objects read after it can refer back to
+			   it, or be held by it (see Include/code.h) */
+			if (v != NULL)
+				_PyObject_GC_TRACK(v);
 
 		  code_error:
 			Py_XDECREF(code);
@@ -978,6 +1450,8 @@ r_object(RFILE *p)
 		break;
 
 	}
+	if (flag && retval != NULL)
+		r_set_ref(p, idx, retval);
 	p->depth--;
 	return retval;
 }
@@ -1002,7 +1476,7 @@ PyMarshal_ReadShortFromFile(FILE *fp)
 	RFILE rf;
 	assert(fp);
 	rf.fp = fp;
-	rf.strings = NULL;
+	rf.refs = NULL;
 	rf.end = rf.ptr = NULL;
 	return r_short(&rf);
 }
@@ -1012,7 +1486,7 @@ PyMarshal_ReadLongFromFile(FILE *fp)
 {
 	RFILE rf;
 	rf.fp = fp;
-	rf.strings = NULL;
+	rf.refs = NULL;
 	rf.ptr = rf.end = NULL;
 	return r_long(&rf);
 }
@@ -1085,11 +1559,14 @@ PyMarshal_ReadObjectFromFile(FILE *fp)
 	RFILE rf;
 	PyObject *result;
 	rf.fp = fp;
-	rf.strings = PyList_New(0);
+	rf.refs = PyList_New(0);
 	rf.depth = 0;
 	rf.ptr = rf.end = NULL;
+	rf.trusted = 0;
+	rf.base = NULL;
+	rf.nbase = 0;
 	result = r_object(&rf);
-	Py_DECREF(rf.strings);
+	Py_DECREF(rf.refs);
 	return result;
 }
 
@@ -1101,10 +1578,13 @@ PyMarshal_ReadObjectFromString(char *str, Py_ssize_t len)
 	rf.fp = NULL;
 	rf.ptr = str;
 	rf.end = str + len;
-	rf.strings = PyList_New(0);
+	rf.refs = PyList_New(0);
 	rf.depth = 0;
+	rf.trusted = 0;
+	rf.base = NULL;
+	rf.nbase = 0;
 	result = r_object(&rf);
-	Py_DECREF(rf.strings);
+	Py_DECREF(rf.refs);
 	return result;
 }
 
@@ -1121,9 +1601,11 @@ PyMarshal_WriteObjectToString(PyObject *x, int version)
 	wf.error = 0;
 	wf.depth = 0;
 	wf.version = version;
-	wf.strings = (version > 0) ? PyDict_New() : NULL;
+	wf.nested = 0;
+	wf.added = NULL;
+	wf.refs = (version > 0) ? PyDict_New() : NULL;
 	w_object(x, &wf);
-	Py_XDECREF(wf.strings);
+	Py_XDECREF(wf.refs);
 	if (wf.str != NULL) {
 		char *base = PyString_AS_STRING((PyStringObject *)wf.str);
 		if (wf.ptr - base > PY_SSIZE_T_MAX) {
@@ -1165,10 +1647,12 @@ marshal_dump(PyObject *self, PyObject *args)
 	wf.ptr = wf.end = NULL;
 	wf.error = 0;
 	wf.depth = 0;
-	wf.strings = (version > 0) ? PyDict_New() : 0;
+	wf.refs = (version > 0) ? PyDict_New() : 0;
 	wf.version = version;
+	wf.nested = 0;
+	wf.added = NULL;
 	w_object(x, &wf);
-	Py_XDECREF(wf.strings);
+	Py_XDECREF(wf.refs);
 	if (wf.error) {
 		PyErr_SetString(PyExc_ValueError,
 				(wf.error==1)?"unmarshallable object"
@@ -1190,10 +1674,13 @@ marshal_load(PyObject *self, PyObject *f)
 		return NULL;
 	}
 	rf.fp = PyFile_AsFile(f);
-	rf.strings = PyList_New(0);
+	rf.refs = PyList_New(0);
 	rf.depth = 0;
+	rf.trusted = 0;
+	rf.base = NULL;
+	rf.nbase = 0;
 	result = read_object(&rf);
-	Py_DECREF(rf.strings);
+	Py_DECREF(rf.refs);
 	return result;
 }
 
@@ -1219,10 +1706,13 @@ marshal_loads(PyObject *self, PyObject *args)
 	rf.fp = NULL;
 	rf.ptr = s;
 	rf.end = s + n;
-	rf.strings = PyList_New(0);
+	rf.refs = PyList_New(0);
 	rf.depth = 0;
+	rf.trusted = 0;
+	rf.base = NULL;
+	rf.nbase = 0;
 	result = read_object(&rf);
-	Py_DECREF(rf.strings);
+	Py_DECREF(rf.refs);
 	return result;
 }
 
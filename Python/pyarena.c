@@ -7,11 +7,20 @@
    allocation is about 20 bytes and that most compiles use a single
    block.
 
+   When a block fills up, the next one is twice as big, up to
+   MAX_BLOCK_SIZE, so that large sources don't need a long chain of small
+   blocks.  Freed arenas are kept on a short free list and reset instead of
+   released, and the first block of a reset arena is grown to hold what the
+   last compile used: compiling many small snippets doesn't go through
+   malloc() at all after the first one.
+
    TODO(jhylton): Think about a realloc API, maybe just for the last
    allocation?
 */
 
 #define DEFAULT_BLOCK_SIZE 8192
+#define MAX_BLOCK_SIZE		(256 * 1024)
+#define MAXFREEARENAS		4
 #define ALIGNMENT		8
 #define ALIGNMENT_MASK		(ALIGNMENT - 1)
 #define ROUNDUP(x)		(((x) + ALIGNMENT_MASK) & ~ALIGNMENT_MASK)
@@ -75,6 +84,14 @@ struct _arena {
 #endif
 };
 
+/* Make the whole of block b available again. */
+static void
+block_rewind(block *b)
+{
+	b->ab_offset = ROUNDUP((Py_uintptr_t)(b->ab_mem)) - 
+	  (Py_uintptr_t)(b->ab_mem);
+}
+
 static block *
 block_new(size_t size)
 {
@@ -86,8 +103,7 @@ block_new(size_t size)
 	b->ab_size = size;
 	b->ab_mem = (void *)(b + 1);
 	b->ab_next = NULL;
-	b->ab_offset = ROUNDUP((Py_uintptr_t)(b->ab_mem)) - 
-	  (Py_uintptr_t)(b->ab_mem);
+	block_rewind(b);
 	return b;
 }
 
@@ -107,13 +123,18 @@ block_alloc(block *b, size_t size)
 	assert(b);
 	size = ROUNDUP(size);
 	if (b->ab_offset + size > b->ab_size) {
-		/* If we need to allocate more memory than will fit in
-		   the default block, allocate a one-off block that is
-		   exactly the right size. */
+		/* Each new block is twice the size of the last one, up to
+		   MAX_BLOCK_SIZE.  If we need to allocate more memory than
+		   that, allocate a one-off block that is exactly the right
+		   size. */
 		/* TODO(jhylton): Think about space waste at end of block */
-		block *newbl = block_new(
-				size < DEFAULT_BLOCK_SIZE ?
-				DEFAULT_BLOCK_SIZE : size);
+		size_t newsize = b->ab_size * 2;
+		block *newbl;
+		if (newsize > MAX_BLOCK_SIZE)
+			newsize = MAX_BLOCK_SIZE;
+		if (newsize < size)
+			newsize = size;
+		newbl = block_new(newsize);
 		if (!newbl)
 			return NULL;
 		assert(!b->ab_next);
@@ -127,10 +148,68 @@ block_alloc(block *b, size_t size)
 	return p;
 }
 
+/* Arenas released by PyArena_Free(), handed out again by PyArena_New() */
+static PyArena *free_arenas[MAXFREEARENAS];
+static int numfree = 0;
+
+static void
+arena_clear_objects(PyArena *arena)
+{
+        int r;
+
+	/* This property normally holds, except when the code being compiled
+	   is sys.getobjects(0), in which case there will be two references.
+        assert(arena->a_objects->ob_refcnt == 1);
+	*/
+
+        /* Clear all the elements from the list.  This is necessary
+           to guarantee that they will be DECREFed. */
+        r = PyList_SetSlice(arena->a_objects,
+                            0, PyList_GET_SIZE(arena->a_objects), NULL);
+        assert(r == 0);
+        assert(PyList_GET_SIZE(arena->a_objects) == 0);
+}
+
+/* Get a freed arena ready for reuse.  If it needed more than one block,
+   all the blocks are replaced by a single one big enough for the same
+   allocations (up to MAX_BLOCK_SIZE).
+*/
+static void
+arena_reset(PyArena *arena)
+{
+	block *b;
+	size_t used = 0;
+
+	arena_clear_objects(arena);
+	if (arena->a_head->ab_next) {
+		for (b = arena->a_head; b; b = b->ab_next)
+			used += b->ab_offset;
+		if (used > MAX_BLOCK_SIZE)
+			used = MAX_BLOCK_SIZE;
+		if (used > arena->a_head->ab_size &&
+		    (b = block_new(used)) != NULL) {
+			block_free(arena->a_head);
+			arena->a_head = b;
+		}
+		else {
+			block_free(arena->a_head->ab_next);
+			arena->a_head->ab_next = NULL;
+		}
+	}
+	block_rewind(arena->a_head);
+	arena->a_cur = arena->a_head;
+}
+
 PyArena *
 PyArena_New()
 {
-	PyArena* arena = (PyArena *)malloc(sizeof(PyArena));
+	PyArena* arena;
+
+	if (numfree) {
+		arena = free_arenas[--numfree];
+		goto done;
+	}
+	arena = (PyArena *)malloc(sizeof(PyArena));
 	if (!arena)
 		return (PyArena*)PyErr_NoMemory();
 
@@ -146,11 +225,12 @@ PyArena_New()
                 free((void *)arena);
                 return (PyArena*)PyErr_NoMemory();
         }
+  done:
 #if defined(Py_DEBUG)
         arena->total_allocs = 0;
         arena->total_size = 0;
         arena->total_blocks = 1;
-        arena->total_block_size = DEFAULT_BLOCK_SIZE;
+        arena->total_block_size = arena->a_head->ab_size;
         arena->total_big_blocks = 0;
 #endif
 	return arena;
@@ -159,7 +239,6 @@ PyArena_New()
 void
 PyArena_Free(PyArena *arena)
 {
-        int r;
 	assert(arena);
 #if defined(Py_DEBUG)
         /*
@@ -170,22 +249,30 @@ PyArena_Free(PyArena *arena)
                 PyList_Size(arena->a_objects));
         */
 #endif
+	if (numfree < MAXFREEARENAS) {
+		arena_reset(arena);
+		free_arenas[numfree++] = arena;
+		return;
+	}
 	block_free(arena->a_head);
-	/* This property normally holds, except when the code being compiled
-	   is sys.getobjects(0), in which case there will be two references.
-        assert(arena->a_objects->ob_refcnt == 1);
-	*/
-
-        /* Clear all the elements from the list.  This is necessary
-           to guarantee that they will be DECREFed. */
-        r = PyList_SetSlice(arena->a_objects,
-                            0, PyList_GET_SIZE(arena->a_objects), NULL);
-        assert(r == 0);
-        assert(PyList_GET_SIZE(arena->a_objects) == 0);
+	arena_clear_objects(arena);
         Py_DECREF(arena->a_objects);
 	free(arena);
 }
 
+void
+PyArena_Fini(void)
+{
+	PyArena *arena;
+
+	while (numfree) {
+		arena = free_arenas[--numfree];
+		block_free(arena->a_head);
+		Py_DECREF(arena->a_objects);
+		free(arena);
+	}
+}
+
 void *
 PyArena_Malloc(PyArena *arena, size_t size)
 {
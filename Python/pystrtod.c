@@ -2,6 +2,7 @@
 
 #include <Python.h>
 #include <locale.h>
+#include <float.h>
 
 /* ascii character tests (as opposed to locale tests) */
 #define ISSPACE(c)  ((c) == ' ' || (c) == '\f' || (c) == '\n' || \
@@ -9,6 +10,106 @@
 #define ISDIGIT(c)  ((c) >= '0' && (c) <= '9')
 
 
+/* Clinger's fast path.  When the decimal digits of a number make an
+   integer that a double holds exactly, and it's scaled by a power of ten
+   that a double holds exactly too, one multiplication or division gives
+   the correctly rounded result, without the help of strtod().  That
+   covers most numbers written by people and by programs.
+
+   It needs the arithmetic done in double precision, or double rounding
+   can get the last bit wrong (x87 FPUs work in extended precision). */
+#if DBL_MANT_DIG == 53 && \
+    ((defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0) || defined(_M_X64))
+#define HAVE_FAST_STRTOD
+#endif
+
+#ifdef HAVE_FAST_STRTOD
+
+/* Any 15-digit integer is below 2**53. */
+#define FAST_STRTOD_MAX_DIGITS 15
+
+static const double exact_powers_of_ten[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define MAX_EXACT_POWER_OF_TEN 22
+
+/* Convert the unsigned decimal number at s if the fast path applies.
+   Return 1 and set *result and *endptr if it did, and 0 if strtod() has
+   to do it. */
+static int
+fast_strtod(const char *s, const char **endptr, double *result)
+{
+	const char *p = s;
+	double m = 0.0;
+	int ndigits = 0;	/* significant digits so far */
+	int nfrac = 0;		/* digits after the decimal point */
+	int any = 0;		/* seen any digit at all? */
+	int exponent = 0;
+
+	for (; ISDIGIT(*p); p++) {
+		any = 1;
+		if (ndigits == 0 && *p == '0')
+			continue;
+		if (++ndigits > FAST_STRTOD_MAX_DIGITS)
+			return 0;
+		m = 10.0 * m + (*p - '0');
+	}
+	if (*p == '.') {
+		for (p++; ISDIGIT(*p); p++) {
+			any = 1;
+			if (++nfrac > 2 * MAX_EXACT_POWER_OF_TEN)
+				return 0;
+			if (ndigits == 0 && *p == '0')
+				continue;
+			if (++ndigits > FAST_STRTOD_MAX_DIGITS)
+				return 0;
+			m = 10.0 * m + (*p - '0');
+		}
+	}
+	if (!any)
+		return 0;
+
+	/* As with strtod(), an 'e' without digits after it isn't part of
+	   the number. */
+	if (*p == 'e' || *p == 'E') {
+		const char *q = p + 1;
+		int negative = 0;
+
+		if (*q == '-') {
+			negative = 1;
+			q++;
+		}
+		else if (*q == '+')
+			q++;
+		if (ISDIGIT(*q)) {
+			for (; ISDIGIT(*q); q++) {
+				if (exponent > 2 * MAX_EXACT_POWER_OF_TEN)
+					return 0;
+				exponent = 10 * exponent + (*q - '0');
+			}
+			if (negative)
+				exponent = -exponent;
+			p = q;
+		}
+	}
+	exponent -= nfrac;
+
+	if (m == 0.0 || exponent == 0)
+		*result = m;
+	else if (exponent > 0 && exponent <= MAX_EXACT_POWER_OF_TEN)
+		*result = m * exact_powers_of_ten[exponent];
+	else if (exponent < 0 && -exponent <= MAX_EXACT_POWER_OF_TEN)
+		*result = m / exact_powers_of_ten[-exponent];
+	else
+		return 0;
+	*endptr = p;
+	return 1;
+}
+
+#endif /* HAVE_FAST_STRTOD */
+
 /**
  * PyOS_ascii_strtod:
  * @nptr:    the string to convert to a numeric value.
@@ -93,6 +194,22 @@ PyOS_ascii_strtod(const char *nptr, char **endptr)
 	}
 	digits_pos = p;
 
+#ifdef HAVE_FAST_STRTOD
+	/* The fast path reads '.' as the decimal point, so it's only right
+	   if the number doesn't go on in the locale's decimal point. */
+	if (fast_strtod(digits_pos, &end, &val) &&
+	    (*end == '.' ||
+	     strncmp(end, decimal_point, decimal_point_len) != 0)) {
+		errno = 0;
+		if (negate)
+			val = -val;
+		if (endptr)
+			*endptr = (char *)end;
+		return val;
+	}
+	val = -1.0;
+#endif
+
 	if (decimal_point[0] != '.' || 
 	    decimal_point[1] != 0)
 	{
@@ -483,6 +600,454 @@ PyOS_ascii_formatd(char       *buffer,
 	return buffer;
 }
 
+/* Shortest round-trip formatting.
+
+   repr() of a float should read back as the same float.  17 significant
+   digits always do, but most floats need fewer, and the rest are noise:
+   "%.17g" % 0.1 is "0.10000000000000001".  Grisu3 [Florian Loitsch,
+   "Printing Floating-Point Numbers Quickly and Accurately with Integers",
+   PLDI 2010] finds the shortest digits that read back exactly (and of
+   those, the closest) with 64-bit integer arithmetic only.  For about
+   0.5% of doubles it can't be sure it has, and says so; those go to the C
+   library for 15, 16 and then 17 digits, until they read back. */
+
+#if DBL_MANT_DIG == 53 && defined(HAVE_LONG_LONG)
+#define HAVE_GRISU
+#endif
+
+/* Most digits that ever need generating, and then some. */
+#define SHORTEST_MAX_DIGITS 20
+
+#ifdef HAVE_GRISU
+
+typedef unsigned PY_LONG_LONG grisu_uint64;
+
+#define U64(hi, lo) (((grisu_uint64)(hi) << 32) | (grisu_uint64)(lo))
+#define LOW32(x) ((x) & U64(0, 0xFFFFFFFF))
+
+/* A "do it yourself" floating point number, f * 2**e. */
+typedef struct {
+	grisu_uint64 f;
+	int e;
+} diy_fp;
+
+/* 10**k ~= f * 2**e, rounded, with the top bit of f set, for k from
+   CACHED_POWERS_MIN_K upwards in steps of CACHED_POWERS_STEP. */
+static const struct {
+	grisu_uint64 f;
+	short e;
+	short k;
+} cached_powers[] = {
+	{U64(0xfa8fd5a0, 0x081c0288), -1220, -348},
+	{U64(0xbaaee17f, 0xa23ebf76), -1193, -340},
+	{U64(0x8b16fb20, 0x3055ac76), -1166, -332},
+	{U64(0xcf42894a, 0x5dce35ea), -1140, -324},
+	{U64(0x9a6bb0aa, 0x55653b2d), -1113, -316},
+	{U64(0xe61acf03, 0x3d1a45df), -1087, -308},
+	{U64(0xab70fe17, 0xc79ac6ca), -1060, -300},
+	{U64(0xff77b1fc, 0xbebcdc4f), -1034, -292},
+	{U64(0xbe5691ef, 0x416bd60c), -1007, -284},
+	{U64(0x8dd01fad, 0x907ffc3c), -980, -276},
+	{U64(0xd3515c28, 0x31559a83), -954, -268},
+	{U64(0x9d71ac8f, 0xada6c9b5), -927, -260},
+	{U64(0xea9c2277, 0x23ee8bcb), -901, -252},
+	{U64(0xaecc4991, 0x4078536d), -874, -244},
+	{U64(0x823c1279, 0x5db6ce57), -847, -236},
+	{U64(0xc2109436, 0x4dfb5637), -821, -228},
+	{U64(0x9096ea6f, 0x3848984f), -794, -220},
+	{U64(0xd77485cb, 0x25823ac7), -768, -212},
+	{U64(0xa086cfcd, 0x97bf97f4), -741, -204},
+	{U64(0xef340a98, 0x172aace5), -715, -196},
+	{U64(0xb23867fb, 0x2a35b28e), -688, -188},
+	{U64(0x84c8d4df, 0xd2c63f3b), -661, -180},
+	{U64(0xc5dd4427, 0x1ad3cdba), -635, -172},
+	{U64(0x936b9fce, 0xbb25c996), -608, -164},
+	{U64(0xdbac6c24, 0x7d62a584), -582, -156},
+	{U64(0xa3ab6658, 0x0d5fdaf6), -555, -148},
+	{U64(0xf3e2f893, 0xdec3f126), -529, -140},
+	{U64(0xb5b5ada8, 0xaaff80b8), -502, -132},
+	{U64(0x87625f05, 0x6c7c4a8b), -475, -124},
+	{U64(0xc9bcff60, 0x34c13053), -449, -116},
+	{U64(0x964e858c, 0x91ba2655), -422, -108},
+	{U64(0xdff97724, 0x70297ebd), -396, -100},
+	{U64(0xa6dfbd9f, 0xb8e5b88f), -369, -92},
+	{U64(0xf8a95fcf, 0x88747d94), -343, -84},
+	{U64(0xb9447093, 0x8fa89bcf), -316, -76},
+	{U64(0x8a08f0f8, 0xbf0f156b), -289, -68},
+	{U64(0xcdb02555, 0x653131b6), -263, -60},
+	{U64(0x993fe2c6, 0xd07b7fac), -236, -52},
+	{U64(0xe45c10c4, 0x2a2b3b06), -210, -44},
+	{U64(0xaa242499, 0x697392d3), -183, -36},
+	{U64(0xfd87b5f2, 0x8300ca0e), -157, -28},
+	{U64(0xbce50864, 0x92111aeb), -130, -20},
+	{U64(0x8cbccc09, 0x6f5088cc), -103, -12},
+	{U64(0xd1b71758, 0xe219652c), -77, -4},
+	{U64(0x9c400000, 0x00000000), -50, 4},
+	{U64(0xe8d4a510, 0x00000000), -24, 12},
+	{U64(0xad78ebc5, 0xac620000), 3, 20},
+	{U64(0x813f3978, 0xf8940984), 30, 28},
+	{U64(0xc097ce7b, 0xc90715b3), 56, 36},
+	{U64(0x8f7e32ce, 0x7bea5c70), 83, 44},
+	{U64(0xd5d238a4, 0xabe98068), 109, 52},
+	{U64(0x9f4f2726, 0x179a2245), 136, 60},
+	{U64(0xed63a231, 0xd4c4fb27), 162, 68},
+	{U64(0xb0de6538, 0x8cc8ada8), 189, 76},
+	{U64(0x83c7088e, 0x1aab65db), 216, 84},
+	{U64(0xc45d1df9, 0x42711d9a), 242, 92},
+	{U64(0x924d692c, 0xa61be758), 269, 100},
+	{U64(0xda01ee64, 0x1a708dea), 295, 108},
+	{U64(0xa26da399, 0x9aef774a), 322, 116},
+	{U64(0xf209787b, 0xb47d6b85), 348, 124},
+	{U64(0xb454e4a1, 0x79dd1877), 375, 132},
+	{U64(0x865b8692, 0x5b9bc5c2), 402, 140},
+	{U64(0xc83553c5, 0xc8965d3d), 428, 148},
+	{U64(0x952ab45c, 0xfa97a0b3), 455, 156},
+	{U64(0xde469fbd, 0x99a05fe3), 481, 164},
+	{U64(0xa59bc234, 0xdb398c25), 508, 172},
+	{U64(0xf6c69a72, 0xa3989f5c), 534, 180},
+	{U64(0xb7dcbf53, 0x54e9bece), 561, 188},
+	{U64(0x88fcf317, 0xf22241e2), 588, 196},
+	{U64(0xcc20ce9b, 0xd35c78a5), 614, 204},
+	{U64(0x98165af3, 0x7b2153df), 641, 212},
+	{U64(0xe2a0b5dc, 0x971f303a), 667, 220},
+	{U64(0xa8d9d153, 0x5ce3b396), 694, 228},
+	{U64(0xfb9b7cd9, 0xa4a7443c), 720, 236},
+	{U64(0xbb764c4c, 0xa7a44410), 747, 244},
+	{U64(0x8bab8eef, 0xb6409c1a), 774, 252},
+	{U64(0xd01fef10, 0xa657842c), 800, 260},
+	{U64(0x9b10a4e5, 0xe9913129), 827, 268},
+	{U64(0xe7109bfb, 0xa19c0c9d), 853, 276},
+	{U64(0xac2820d9, 0x623bf429), 880, 284},
+	{U64(0x80444b5e, 0x7aa7cf85), 907, 292},
+	{U64(0xbf21e440, 0x03acdd2d), 933, 300},
+	{U64(0x8e679c2f, 0x5e44ff8f), 960, 308},
+	{U64(0xd433179d, 0x9c8cb841), 986, 316},
+	{U64(0x9e19db92, 0xb4e31ba9), 1013, 324},
+	{U64(0xeb96bf6e, 0xbadf77d9), 1039, 332},
+	{U64(0xaf87023b, 0x9bf0ee6b), 1066, 340}
+};
+
+#define CACHED_POWERS_MIN_K -348
+#define CACHED_POWERS_STEP 8
+
+/* Digits are generated from v * 10**k, with the binary exponent of that
+   in this range, so that its integral part fits in 32 bits. */
+#define GRISU_ALPHA -60
+#define GRISU_GAMMA -32
+
+static const unsigned int small_powers_of_ten[] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+	1000000000
+};
+
+/* x * y, rounded to 64 bits. */
+static diy_fp
+diy_fp_multiply(diy_fp x, diy_fp y)
+{
+	grisu_uint64 a = x.f >> 32, b = LOW32(x.f);
+	grisu_uint64 c = y.f >> 32, d = LOW32(y.f);
+	grisu_uint64 ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	grisu_uint64 mid;
+	diy_fp r;
+
+	mid = (bd >> 32) + LOW32(ad) + LOW32(bc);
+	mid += (grisu_uint64)1 << 31;
+	r.f = ac + (ad >> 32) + (bc >> 32) + (mid >> 32);
+	r.e = x.e + y.e + 64;
+	return r;
+}
+
+static diy_fp
+diy_fp_normalize(diy_fp x)
+{
+	assert(x.f != 0);
+	while (!(x.f & U64(0xFFC00000, 0))) {
+		x.f <<= 10;
+		x.e -= 10;
+	}
+	while (!(x.f & U64(0x80000000, 0))) {
+		x.f <<= 1;
+		x.e--;
+	}
+	return x;
+}
+
+/* Nudge the last digit generated towards w, the scaled value, as far as
+   the interval allows; rest is what's left over.  All distances are in
+   units of ten_kappa's, and are only known to within unit.  Return 0 if
+   that leaves it unclear which of two candidates is closest, or whether
+   the candidate is inside the interval at all. */
+static int
+round_weed(char *digits, int length, grisu_uint64 distance_too_high_w,
+	   grisu_uint64 unsafe_interval, grisu_uint64 rest,
+	   grisu_uint64 ten_kappa, grisu_uint64 unit)
+{
+	grisu_uint64 small_distance = distance_too_high_w - unit;
+	grisu_uint64 big_distance = distance_too_high_w + unit;
+
+	while (rest < small_distance &&
+	       unsafe_interval - rest >= ten_kappa &&
+	       (rest + ten_kappa < small_distance ||
+		small_distance - rest >= rest + ten_kappa - small_distance)) {
+		digits[length - 1]--;
+		rest += ten_kappa;
+	}
+	if (rest < big_distance &&
+	    unsafe_interval - rest >= ten_kappa &&
+	    (rest + ten_kappa < big_distance ||
+	     big_distance - rest > rest + ten_kappa - big_distance))
+		return 0;
+	return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+/* Generate the digits of w until they're inside (low, high), allowing for
+   the error in those.  Return 0 if the result may not be the shortest. */
+static int
+digit_gen(diy_fp low, diy_fp w, diy_fp high, char *digits, int *length,
+	  int *kappa)
+{
+	grisu_uint64 unit = 1;
+	grisu_uint64 too_high = high.f + unit;
+	grisu_uint64 unsafe_interval = too_high - (low.f - unit);
+	grisu_uint64 one = (grisu_uint64)1 << -w.e;
+	unsigned int integrals = (unsigned int)(too_high >> -w.e);
+	grisu_uint64 fractionals = too_high & (one - 1);
+	unsigned int divisor;
+	int bits = 64 + w.e;
+
+	/* Find the biggest power of ten no greater than integrals; it's
+	   at least 2**(bits - 2), so a guess from bits is at most one too
+	   big. */
+	*kappa = ((bits + 1) * 1233 >> 12) + 1;
+	if (integrals < small_powers_of_ten[*kappa - 1])
+		--*kappa;
+	divisor = small_powers_of_ten[*kappa - 1];
+	*length = 0;
+
+	while (*kappa > 0) {
+		grisu_uint64 rest;
+
+		digits[(*length)++] = (char)('0' + integrals / divisor);
+		integrals %= divisor;
+		--*kappa;
+		rest = ((grisu_uint64)integrals << -w.e) + fractionals;
+		if (rest < unsafe_interval)
+			return round_weed(digits, *length, too_high - w.f,
+					  unsafe_interval, rest,
+					  (grisu_uint64)divisor << -w.e,
+					  unit);
+		divisor /= 10;
+	}
+	for (;;) {
+		fractionals *= 10;
+		unit *= 10;
+		unsafe_interval *= 10;
+		digits[(*length)++] = (char)('0' + (fractionals >> -w.e));
+		fractionals &= one - 1;
+		--*kappa;
+		if (fractionals < unsafe_interval)
+			return round_weed(digits, *length,
+					  (too_high - w.f) * unit,
+					  unsafe_interval, fractionals, one,
+					  unit);
+		if (*length == SHORTEST_MAX_DIGITS)
+			return 0;
+	}
+}
+
+/* Put the shortest digits of the positive finite double v into digits,
+   and return how many there are, with v ~= 0.<digits> * 10**decpt; or
+   return 0 if Grisu3 can't be sure it found them. */
+static int
+grisu3(double v, char *digits, int *decpt)
+{
+	diy_fp w, m_plus, m_minus, c;
+	int binexp, k, i, length, kappa;
+
+	/* v = w.f * 2**w.e, as in its IEEE representation. */
+	w.f = (grisu_uint64)ldexp(frexp(v, &binexp), DBL_MANT_DIG);
+	w.e = binexp - DBL_MANT_DIG;
+	if (w.e < DBL_MIN_EXP - DBL_MANT_DIG) {
+		/* A subnormal, with fewer significant bits. */
+		w.f >>= DBL_MIN_EXP - DBL_MANT_DIG - w.e;
+		w.e = DBL_MIN_EXP - DBL_MANT_DIG;
+	}
+
+	/* Anything between m_minus and m_plus, the midpoints between v and
+	   its neighbours, reads back as v.  The neighbour below a power of
+	   two is twice as close as the one above. */
+	m_plus.f = (w.f << 1) + 1;
+	m_plus.e = w.e - 1;
+	m_plus = diy_fp_normalize(m_plus);
+	if (w.f == (grisu_uint64)1 << (DBL_MANT_DIG - 1) &&
+	    w.e > DBL_MIN_EXP - DBL_MANT_DIG) {
+		m_minus.f = (w.f << 2) - 1;
+		m_minus.e = w.e - 2;
+	}
+	else {
+		m_minus.f = (w.f << 1) - 1;
+		m_minus.e = w.e - 1;
+	}
+	m_minus.f <<= m_minus.e - m_plus.e;
+	m_minus.e = m_plus.e;
+	w = diy_fp_normalize(w);
+	assert(w.e == m_plus.e);
+
+	/* Scale by the cached power of ten that brings the binary exponent
+	   into [GRISU_ALPHA, GRISU_GAMMA].  0.30103 is log10(2). */
+	k = (int)ceil((GRISU_ALPHA - w.e - 1) * 0.30102999566398114);
+	i = (k - CACHED_POWERS_MIN_K - 1) / CACHED_POWERS_STEP + 1;
+	c.f = cached_powers[i].f;
+	c.e = cached_powers[i].e;
+	w = diy_fp_multiply(w, c);
+	m_minus = diy_fp_multiply(m_minus, c);
+	m_plus = diy_fp_multiply(m_plus, c);
+	assert(GRISU_ALPHA <= w.e && w.e <= GRISU_GAMMA);
+
+	if (!digit_gen(m_minus, w, m_plus, digits, &length, &kappa))
+		return 0;
+	*decpt = length + kappa - cached_powers[i].k;
+	return length;
+}
+
+#endif /* HAVE_GRISU */
+
+/* Like grisu3(), but never fails.  This relies on the C library rounding
+   correctly: then if any string of 15 digits or fewer reads back as v,
+   the correctly rounded 15 digits do, less their trailing zeros.
+   Subnormals have fewer bits, so they start from fewer digits. */
+static int
+shortest_digits(double v, char *digits, int *decpt)
+{
+	char buf[40];
+	char *p;
+	int n, precision;
+
+#ifdef HAVE_GRISU
+	n = grisu3(v, digits, decpt);
+	if (n > 0)
+		goto done;
+#endif
+
+	for (precision = v < DBL_MIN ? 1 : 15; ; precision++) {
+		PyOS_snprintf(buf, sizeof(buf), "%.*e", precision - 1, v);
+		if (precision == 17 || strtod(buf, NULL) == v)
+			break;
+	}
+	/* buf is d.ddd...e+XX, with the locale's decimal point. */
+	n = 0;
+	for (p = buf; *p != 'e'; p++)
+		if (ISDIGIT(*p))
+			digits[n++] = *p;
+	*decpt = atoi(p + 1) + 1;
+
+#ifdef HAVE_GRISU
+  done:
+#endif
+	while (n > 1 && digits[n - 1] == '0')
+		n--;
+	return n;
+}
+
+/**
+ * _PyOS_ascii_formatd_shortest:
+ * @buffer: A buffer to place the resulting string in
+ * @buf_size: The length of the buffer.
+ * @d: The #gdouble to convert
+ * @precision: The most significant digits to use.
+ *
+ * Converts a #gdouble to a string the way "%.<precision>g" would, but
+ * with no more significant digits than it takes for the string to read
+ * back as d, and without regard to the locale.  For a precision of 15 or
+ * less that's exactly what "%.<precision>g" gives.
+ *
+ * Return value: The pointer to the buffer with the converted string, or
+ * %NULL if d is an infinity or a NaN, or (rarely) it isn't clear which
+ * way d rounds to precision digits.
+ **/
+char *
+_PyOS_ascii_formatd_shortest(char *buffer, size_t buf_size, double d,
+			     int precision)
+{
+	char digits[SHORTEST_MAX_DIGITS];
+	char *p = buffer;
+	int n, decpt, exponent, i;
+
+	/* Sign, 17 digits, a point, 4 zeros and "e-308" fit easily. */
+	if (buf_size < 32 || precision < 1 || !Py_IS_FINITE(d))
+		return NULL;
+	if (copysign(1.0, d) < 0.0) {
+		*p++ = '-';
+		d = -d;
+	}
+	if (d == 0.0) {
+		digits[0] = '0';
+		n = decpt = 1;
+	}
+	else
+		n = shortest_digits(d, digits, &decpt);
+	if (n > precision) {
+		/* The digits are within half an ulp of d, and no digit
+		   string closer to d is as short, so rounding them rounds d
+		   correctly, unless the only digit dropped is a 5: then d
+		   may be on either side of the halfway point. */
+		if (n == precision + 1 && digits[precision] == '5')
+			return NULL;
+		n = precision;
+		if (digits[n] >= '5') {
+			while (n > 0 && digits[n - 1] == '9')
+				n--;
+			if (n == 0) {
+				digits[n++] = '1';
+				decpt++;
+			}
+			else
+				digits[n - 1]++;
+		}
+		else {
+			while (n > 1 && digits[n - 1] == '0')
+				n--;
+		}
+	}
+
+	exponent = decpt - 1;
+	if (exponent < -4 || exponent >= precision) {
+		*p++ = digits[0];
+		if (n > 1) {
+			*p++ = '.';
+			memcpy(p, digits + 1, n - 1);
+			p += n - 1;
+		}
+		PyOS_snprintf(p, buf_size - (p - buffer), "e%c%02d",
+			      exponent < 0 ? '-' : '+',
+			      exponent < 0 ? -exponent : exponent);
+		return buffer;
+	}
+	if (decpt <= 0) {
+		*p++ = '0';
+		*p++ = '.';
+		for (i = decpt; i < 0; i++)
+			*p++ = '0';
+		memcpy(p, digits, n);
+		p += n;
+	}
+	else if (n <= decpt) {
+		memcpy(p, digits, n);
+		p += n;
+		for (i = n; i < decpt; i++)
+			*p++ = '0';
+	}
+	else {
+		memcpy(p, digits, decpt);
+		p += decpt;
+		*p++ = '.';
+		memcpy(p, digits + decpt, n - decpt);
+		p += n - decpt;
+	}
+	*p = '\0';
+	return buffer;
+}
+
 double
 PyOS_ascii_atof(const char *nptr)
 {
@@ -58,6 +58,8 @@ static PyObject *run_pyc_file(FILE *, const char *, PyObject *, PyObject *,
 static void err_input(perrdetail *);
 static void initsigs(void);
 static void call_sys_exitfunc(void);
+static PyCodeObject *compile_cached(const char *, const char *, int,
+				    PyCompilerFlags *);
 static void call_ll_exitfuncs(void);
 extern void _PyUnicode_Init(void);
 extern void _PyUnicode_Fini(void);
@@ -114,6 +116,30 @@ Py_IsInitialized(void)
 
 */
 
+#if defined(Py_USING_UNICODE) && defined(HAVE_LANGINFO_H) && defined(CODESET)
+/* Codesets that nl_langinfo() commonly returns and that name codecs every
+   installation has.  Looking them up in the codec registry would import
+   the encodings package at every start. */
+static char *standard_codesets[] = {
+	"ANSI_X3.4-1968", "ASCII", "US-ASCII",
+	"UTF-8", "UTF8",
+	"ISO-8859-1", "ISO8859-1", "LATIN1",
+	NULL
+};
+
+static int
+is_standard_codeset(const char *codeset)
+{
+	char **p;
+
+	for (p = standard_codesets; *p != NULL; p++) {
+		if (PyOS_stricmp(codeset, *p) == 0)
+			return 1;
+	}
+	return 0;
+}
+#endif
+
 static int
 add_flag(int flag, const char *envs)
 {
@@ -270,10 +296,11 @@ Py_InitializeEx(int install_sigs)
 		setlocale(LC_CTYPE, "");
 		loc_codeset = nl_langinfo(CODESET);
 		if (loc_codeset && *loc_codeset) {
-			PyObject *enc = PyCodec_Encoder(loc_codeset);
-			if (enc) {
+			PyObject *enc = NULL;
+			if (is_standard_codeset(loc_codeset) ||
+			    (enc = PyCodec_Encoder(loc_codeset)) != NULL) {
 				loc_codeset = strdup(loc_codeset);
-				Py_DECREF(enc);
+				Py_XDECREF(enc);
 			} else {
 				loc_codeset = NULL;
 				PyErr_Clear();
@@ -451,6 +478,12 @@ Py_Finalize(void)
 	/* Destroy the database used by _PyImport_{Fixup,Find}Extension */
 	_PyImport_Fini();
 
+	/* Drop the code objects kept by compile() */
+	_PyCompileCache_Fini();
+
+	/* Release the arenas kept for reuse by the compiler */
+	PyArena_Fini();
+
 	/* Debugging stuff */
 #ifdef COUNT_ALLOCS
 	dump_counts(stdout);
@@ -1284,7 +1317,18 @@ PyRun_StringFlags(const char *str, int start, PyObject *globals,
 {
 	PyObject *ret = NULL;
 	mod_ty mod;
-	PyArena *arena = PyArena_New();
+	PyArena *arena;
+
+	if (Py_CompileCacheSize > 0) {
+		PyCodeObject *co = compile_cached(str, "<string>", start,
+						  flags);
+		if (co == NULL)
+			return NULL;
+		ret = PyEval_EvalCode(co, globals, locals);
+		Py_DECREF(co);
+		return ret;
+	}
+	arena = PyArena_New();
 	if (arena == NULL)
 		return NULL;
 	
@@ -1364,13 +1408,274 @@ run_pyc_file(FILE *fp, const char *filename, PyObject *globals,
 	return v;
 }
 
+/* The compile() cache.
+
+   Programs that compile the same strings over and over (template and rule
+   engines, mostly) get back the code object compiled the first time.  The
+   entries are keyed by the source text, file name, start symbol and
+   compiler flags, and kept in a hash table and a list from the most to
+   the least recently used.  Each entry is charged the size of its source
+   and of its code objects, and the least recently used entries are
+   dropped once the total goes over Py_CompileCacheSize kilobytes.
+
+   A hit gives the very code object the first compile() returned; code
+   objects are immutable, so nobody can tell but by identity.  It does
+   skip the warnings that compiling the source would issue again. */
+
+Py_ssize_t Py_CompileCacheSize = 0;	/* Set by -X compile_cache=N */
+
+/* Py_CompileCacheSize in bytes; embedders may have set it to anything */
+#define CC_LIMIT (Py_CompileCacheSize > PY_SSIZE_T_MAX / 1024 ? \
+		  PY_SSIZE_T_MAX : Py_CompileCacheSize * 1024)
+
+typedef struct _cc_entry {
+	struct _cc_entry *chain;	/* Next in the hash bucket */
+	struct _cc_entry *newer, *older;	/* Neighbours in the LRU list */
+	long hash;
+	int start;
+	int flags;
+	Py_ssize_t len;		/* Of the source */
+	Py_ssize_t charge;	/* Bytes counted against the limit */
+	PyCodeObject *co;
+	char *filename;		/* Points into text */
+	char text[1];		/* The source, then the file name */
+} cc_entry;
+
+static cc_entry **cc_table = NULL;
+static size_t cc_mask = 0;		/* Number of buckets - 1 */
+static cc_entry *cc_newest = NULL, *cc_oldest = NULL;
+static Py_ssize_t cc_entries = 0, cc_bytes = 0;
+static Py_ssize_t cc_hits = 0, cc_misses = 0, cc_evictions = 0;
+
+static long
+cc_hash(const char *str, Py_ssize_t len, const char *filename,
+	int start, int flags)
+{
+	register const unsigned char *p = (const unsigned char *)str;
+	register long x = (long)len ^ (start << 20) ^ flags;
+
+	while (--len >= 0)
+		x = (1000003*x) ^ *p++;
+	for (p = (const unsigned char *)filename; *p; p++)
+		x = (1000003*x) ^ *p;
+	return x;
+}
+
+/* Bytes held by co and the code objects among its constants */
+static Py_ssize_t
+cc_code_size(PyCodeObject *co)
+{
+	Py_ssize_t i, size = Py_TYPE(co)->tp_basicsize;
+
+	size += PyString_GET_SIZE(co->co_code);
+	size += PyString_GET_SIZE(co->co_lnotab);
+	size += PyTuple_GET_SIZE(co->co_consts) * sizeof(PyObject *);
+	size += PyTuple_GET_SIZE(co->co_names) * sizeof(PyObject *);
+	for (i = 0; i < PyTuple_GET_SIZE(co->co_consts); i++) {
+		PyObject *v = PyTuple_GET_ITEM(co->co_consts, i);
+		if (PyCode_Check(v))
+			size += cc_code_size((PyCodeObject *)v);
+	}
+	return size;
+}
+
+static cc_entry *
+cc_lookup(const char *str, Py_ssize_t len, const char *filename,
+	  int start, int flags, long hash)
+{
+	cc_entry *e;
+
+	if (cc_table == NULL)
+		return NULL;
+	for (e = cc_table[hash & cc_mask]; e != NULL; e = e->chain)
+		if (e->hash == hash && e->len == len && e->start == start &&
+		    e->flags == flags && strcmp(e->filename, filename) == 0 &&
+		    memcmp(e->text, str, len) == 0)
+			return e;
+	return NULL;
+}
+
+static void
+cc_unlink(cc_entry *e)
+{
+	cc_entry **pe = &cc_table[e->hash & cc_mask];
+
+	while (*pe != e)
+		pe = &(*pe)->chain;
+	*pe = e->chain;
+	if (e->newer != NULL)
+		e->newer->older = e->older;
+	else
+		cc_newest = e->older;
+	if (e->older != NULL)
+		e->older->newer = e->newer;
+	else
+		cc_oldest = e->newer;
+	cc_entries--;
+	cc_bytes -= e->charge;
+}
+
+static void
+cc_push(cc_entry *e)
+{
+	e->newer = NULL;
+	e->older = cc_newest;
+	if (cc_newest != NULL)
+		cc_newest->newer = e;
+	else
+		cc_oldest = e;
+	cc_newest = e;
+}
+
+/* Drop entries, least recently used first, until extra more bytes fit */
+static void
+cc_evict(Py_ssize_t extra)
+{
+	while (cc_oldest != NULL &&
+	       extra > CC_LIMIT - cc_bytes) {
+		cc_entry *e = cc_oldest;
+		cc_unlink(e);
+		cc_evictions++;
+		Py_DECREF(e->co);
+		PyMem_FREE(e);
+	}
+}
+
+/* Keep co as what compiling str gives.  Failing to only costs the
+   speedup, so no error is reported. */
+static void
+cc_insert(const char *str, Py_ssize_t len, const char *filename,
+	  int start, int flags, long hash, PyCodeObject *co)
+{
+	size_t flen = strlen(filename);
+	Py_ssize_t charge;
+	cc_entry *e;
+
+	/* Compiling may have run code that compiled the same source */
+	if (cc_lookup(str, len, filename, start, flags, hash) != NULL)
+		return;
+	charge = sizeof(cc_entry) + len + flen + cc_code_size(co);
+	if (charge > CC_LIMIT)
+		return;
+	cc_evict(charge);
+	if (cc_entries >= (Py_ssize_t)cc_mask) {
+		/* Keep about one entry per bucket */
+		size_t i, mask = cc_mask ? cc_mask * 2 + 1 : 63;
+		cc_entry **table = PyMem_NEW(cc_entry *, mask + 1);
+		if (table == NULL)
+			return;
+		memset(table, 0, (mask + 1) * sizeof(cc_entry *));
+		for (i = 0; cc_table != NULL && i <= cc_mask; i++) {
+			while (cc_table[i] != NULL) {
+				e = cc_table[i];
+				cc_table[i] = e->chain;
+				e->chain = table[e->hash & mask];
+				table[e->hash & mask] = e;
+			}
+		}
+		PyMem_FREE(cc_table);
+		cc_table = table;
+		cc_mask = mask;
+	}
+	e = (cc_entry *)PyMem_MALLOC(sizeof(cc_entry) + len + flen + 1);
+	if (e == NULL)
+		return;
+	e->hash = hash;
+	e->start = start;
+	e->flags = flags;
+	e->len = len;
+	e->charge = charge;
+	memcpy(e->text, str, len);
+	e->filename = e->text + len;
+	memcpy(e->filename, filename, flen + 1);
+	Py_INCREF(co);
+	e->co = co;
+	e->chain = cc_table[hash & cc_mask];
+	cc_table[hash & cc_mask] = e;
+	cc_push(e);
+	cc_entries++;
+	cc_bytes += charge;
+}
+
+/* Compile str as Py_CompileStringFlags() does, through the cache.
+   Returns a new reference. */
+static PyCodeObject *
+compile_cached(const char *str, const char *filename, int start,
+	       PyCompilerFlags *flags)
+{
+	Py_ssize_t len = strlen(str);
+	int cf_flags = flags ? flags->cf_flags : 0;
+	long hash = cc_hash(str, len, filename, start, cf_flags);
+	cc_entry *e = cc_lookup(str, len, filename, start, cf_flags, hash);
+	PyCodeObject *co;
+	PyArena *arena;
+	mod_ty mod;
+
+	if (e != NULL) {
+		cc_hits++;
+		if (e != cc_newest) {
+			cc_unlink(e);
+			cc_entries++;
+			cc_bytes += e->charge;
+			e->chain = cc_table[hash & cc_mask];
+			cc_table[hash & cc_mask] = e;
+			cc_push(e);
+		}
+		/* As compiling would, pass on the source's future imports */
+		if (flags)
+			flags->cf_flags |= (e->co->co_flags & PyCF_MASK);
+		Py_INCREF(e->co);
+		return e->co;
+	}
+	cc_misses++;
+	arena = PyArena_New();
+	if (arena == NULL)
+		return NULL;
+	mod = PyParser_ASTFromString(str, filename, start, flags, arena);
+	co = mod == NULL ? NULL : PyAST_Compile(mod, filename, flags, arena);
+	PyArena_Free(arena);
+	if (co != NULL)
+		cc_insert(str, len, filename, start, cf_flags, hash, co);
+	return co;
+}
+
+PyObject *
+_PyCompileCache_GetStats(void)
+{
+	return Py_BuildValue("{sn,sn,sn,sn,sn,sn}",
+			     "size", Py_CompileCacheSize,
+			     "bytes", cc_bytes,
+			     "entries", cc_entries,
+			     "hits", cc_hits,
+			     "misses", cc_misses,
+			     "evictions", cc_evictions);
+}
+
+void
+_PyCompileCache_Fini(void)
+{
+	Py_ssize_t size = Py_CompileCacheSize;
+
+	Py_CompileCacheSize = 0;
+	cc_evict(0);
+	Py_CompileCacheSize = size;
+	PyMem_FREE(cc_table);
+	cc_table = NULL;
+	cc_mask = 0;
+}
+
 PyObject *
 Py_CompileStringFlags(const char *str, const char *filename, int start,
 		      PyCompilerFlags *flags)
 {
 	PyCodeObject *co;
 	mod_ty mod;
-	PyArena *arena = PyArena_New();
+	PyArena *arena;
+
+	if (Py_CompileCacheSize > 0 &&
+	    !(flags && (flags->cf_flags & PyCF_ONLY_AST)))
+		return (PyObject *)compile_cached(str, filename, start, flags);
+	arena = PyArena_New();
 	if (arena == NULL)
 		return NULL;
 
@@ -1419,15 +1724,21 @@ PyParser_ASTFromString(const char *s, const char *filename, int start,
 	mod_ty mod;
 	PyCompilerFlags localflags;
 	perrdetail err;
-	int iflags = PARSER_FLAGS(flags);
+	int iflags;
+	node *n;
 
-	node *n = PyParser_ParseStringFlagsFilenameEx(s, filename,
-					&_PyParser_Grammar, start, &err,
-					&iflags);
 	if (flags == NULL) {
 		localflags.cf_flags = 0;
 		flags = &localflags;
 	}
+	/* Without a CST if possible; errors are reported through one */
+	mod = _PyAST_FromString(s, filename, start, flags, arena);
+	if (mod || PyErr_Occurred())
+		return mod;
+	iflags = PARSER_FLAGS(flags);
+	n = PyParser_ParseStringFlagsFilenameEx(s, filename,
+					&_PyParser_Grammar, start, &err,
+					&iflags);
 	if (n) {
 		flags->cf_flags |= iflags & PyCF_MASK;
 		mod = PyAST_FromNode(n, flags, filename, arena);
@@ -1448,14 +1759,27 @@ PyParser_ASTFromFile(FILE *fp, const char *filename, int start, char *ps1,
 	mod_ty mod;
 	PyCompilerFlags localflags;
 	perrdetail err;
-	int iflags = PARSER_FLAGS(flags);
+	int iflags;
+	node *n;
 
-	node *n = PyParser_ParseFileFlagsEx(fp, filename, &_PyParser_Grammar,
-				start, ps1, ps2, &err, &iflags);
 	if (flags == NULL) {
 		localflags.cf_flags = 0;
 		flags = &localflags;
 	}
+	/* Without a CST if possible, but not when reading interactively */
+	if (ps1 == NULL && ps2 == NULL) {
+		mod = _PyAST_FromFile(fp, filename, start, flags, arena);
+		if (mod)
+			return mod;
+		if (PyErr_Occurred()) {
+			if (errcode)
+				*errcode = E_ERROR;
+			return NULL;
+		}
+	}
+	iflags = PARSER_FLAGS(flags);
+	n = PyParser_ParseFileFlagsEx(fp, filename, &_PyParser_Grammar,
+				start, ps1, ps2, &err, &iflags);
 	if (n) {
 		flags->cf_flags |= iflags & PyCF_MASK;
 		mod = PyAST_FromNode(n, flags, filename, arena);
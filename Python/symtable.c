@@ -344,31 +344,192 @@ PyST_GetScope(PySTEntryObject *ste, PyObject *name)
    frame.  Cell variables are removed from the free set before the analyze
    function returns to its parent.
    
-   The sets of bound and free variables are implemented as dictionaries
-   mapping strings to None.
+   The sets of bound and free variables are namesets, below, allocated
+   from an arena that lives as long as the analysis.  The scope of each
+   name of a block is kept in an array that follows the order in which
+   PyDict_Next() returns the block's symbols.
 */
 
-#define SET_SCOPE(DICT, NAME, I) { \
-	PyObject *o = PyInt_FromLong(I); \
-	if (!o) \
-		return 0; \
-	if (PyDict_SetItem((DICT), (NAME), o) < 0) { \
-		Py_DECREF(o); \
-		return 0; \
-	} \
-	Py_DECREF(o); \
+/* A nameset is an open-addressing hash table of borrowed references to
+   names.  The names are the keys of the symbol dicts, which outlive the
+   analysis.  They are compared by value, since mangled names aren't
+   interned.
+*/
+
+typedef struct _nameset {
+	Py_ssize_t ns_fill;	/* # of slots holding a name or a dummy */
+	Py_ssize_t ns_used;	/* # of slots holding a name */
+	Py_ssize_t ns_mask;	/* # of slots - 1 */
+	PyObject **ns_table;
+	PyArena *ns_arena;
+} nameset;
+
+#define NAMESET_MINSIZE 8
+
+/* Marks the slot of a removed name */
+static char dummy_name;
+#define DUMMY ((PyObject *)&dummy_name)
+
+static nameset *
+nameset_new(PyArena *arena)
+{
+	nameset *s = (nameset *)PyArena_Malloc(arena, sizeof(nameset));
+	if (!s)
+		return NULL;
+	s->ns_table = (PyObject **)PyArena_Malloc(arena,
+				NAMESET_MINSIZE * sizeof(PyObject *));
+	if (!s->ns_table)
+		return NULL;
+	memset(s->ns_table, 0, NAMESET_MINSIZE * sizeof(PyObject *));
+	s->ns_fill = s->ns_used = 0;
+	s->ns_mask = NAMESET_MINSIZE - 1;
+	s->ns_arena = arena;
+	return s;
+}
+
+/* Return the slot holding name, or the one where it would go. */
+static PyObject **
+nameset_slot(nameset *s, PyObject *name)
+{
+	PyObject **slot, **freeslot = NULL;
+	Py_ssize_t len;
+	long hash;
+	size_t i;
+
+	assert(PyString_Check(name));
+	len = PyString_GET_SIZE(name);
+	hash = PyObject_Hash(name);	/* cached; can't fail */
+	for (i = (size_t)hash & s->ns_mask; ; i = (i + 1) & s->ns_mask) {
+		slot = &s->ns_table[i];
+		if (*slot == NULL)
+			return freeslot ? freeslot : slot;
+		if (*slot == DUMMY) {
+			if (!freeslot)
+				freeslot = slot;
+		}
+		else if (*slot == name ||
+			 (((PyStringObject *)*slot)->ob_shash == hash &&
+			  PyString_GET_SIZE(*slot) == len &&
+			  memcmp(PyString_AS_STRING(*slot),
+				 PyString_AS_STRING(name), len) == 0))
+			return slot;
+	}
+}
+
+/* Accepts a NULL s, the empty set */
+static int
+nameset_contains(nameset *s, PyObject *name)
+{
+	PyObject *p;
+
+	if (!s)
+		return 0;
+	p = *nameset_slot(s, name);
+	return p != NULL && p != DUMMY;
+}
+
+static int
+nameset_resize(nameset *s)
+{
+	PyObject **oldtable = s->ns_table, **slot;
+	Py_ssize_t i, size = NAMESET_MINSIZE, oldsize = s->ns_mask + 1;
+
+	while (size <= s->ns_used * 4)
+		size <<= 1;
+	s->ns_table = (PyObject **)PyArena_Malloc(s->ns_arena,
+						  size * sizeof(PyObject *));
+	if (!s->ns_table) {
+		s->ns_table = oldtable;
+		return 0;
+	}
+	memset(s->ns_table, 0, size * sizeof(PyObject *));
+	s->ns_mask = size - 1;
+	s->ns_fill = s->ns_used;
+	for (i = 0; i < oldsize; i++) {
+		if (oldtable[i] == NULL || oldtable[i] == DUMMY)
+			continue;
+		slot = nameset_slot(s, oldtable[i]);
+		assert(*slot == NULL);
+		*slot = oldtable[i];
+	}
+	return 1;
+}
+
+static int
+nameset_add(nameset *s, PyObject *name)
+{
+	PyObject **slot = nameset_slot(s, name);
+
+	if (*slot != NULL && *slot != DUMMY)
+		return 1;
+	if (*slot == NULL) {
+		if ((s->ns_fill + 1) * 3 >= (s->ns_mask + 1) * 2) {
+			if (!nameset_resize(s))
+				return 0;
+			slot = nameset_slot(s, name);
+			assert(*slot == NULL);
+		}
+		s->ns_fill++;
+	}
+	*slot = name;
+	s->ns_used++;
+	return 1;
+}
+
+/* Accepts a NULL s, the empty set */
+static void
+nameset_discard(nameset *s, PyObject *name)
+{
+	PyObject **slot;
+
+	if (!s)
+		return;
+	slot = nameset_slot(s, name);
+	if (*slot != NULL && *slot != DUMMY) {
+		*slot = DUMMY;
+		s->ns_used--;
+	}
+}
+
+/* Iterate over the names of s, like PyDict_Next() */
+static int
+nameset_next(nameset *s, Py_ssize_t *ppos, PyObject **pname)
+{
+	Py_ssize_t i = *ppos;
+
+	for (; i <= s->ns_mask; i++) {
+		if (s->ns_table[i] != NULL && s->ns_table[i] != DUMMY) {
+			*pname = s->ns_table[i];
+			*ppos = i + 1;
+			return 1;
+		}
+	}
+	*ppos = i;
+	return 0;
+}
+
+static int
+nameset_update(nameset *s, nameset *other)
+{
+	PyObject *name;
+	Py_ssize_t pos = 0;
+
+	while (nameset_next(other, &pos, &name))
+		if (!nameset_add(s, name))
+			return 0;
+	return 1;
 }
 
 /* Decide on scope of name, given flags.
 
-   The dicts passed in as arguments are modified as necessary.
+   The sets passed in as arguments are modified as necessary.
    ste is passed so that flags can be updated.
 */
 
 static int 
-analyze_name(PySTEntryObject *ste, PyObject *dict, PyObject *name, long flags,
-	     PyObject *bound, PyObject *local, PyObject *free, 
-	     PyObject *global)
+analyze_name(PySTEntryObject *ste, int *scope, PyObject *name, long flags,
+	     nameset *bound, nameset *local, nameset *free, 
+	     nameset *global)
 {
 	if (flags & DEF_GLOBAL) {
 		if (flags & DEF_PARAM) {
@@ -380,23 +541,17 @@ analyze_name(PySTEntryObject *ste, PyObject *dict, PyObject *name, long flags,
 			
 			return 0;
 		}
-		SET_SCOPE(dict, name, GLOBAL_EXPLICIT);
-		if (PyDict_SetItem(global, name, Py_None) < 0)
+		*scope = GLOBAL_EXPLICIT;
+		if (!nameset_add(global, name))
 			return 0;
-		if (bound && PyDict_GetItem(bound, name)) {
-			if (PyDict_DelItem(bound, name) < 0)
-				return 0;
-		}
+		nameset_discard(bound, name);
 		return 1;
 	}
 	if (flags & DEF_BOUND) {
-		SET_SCOPE(dict, name, LOCAL);
-		if (PyDict_SetItem(local, name, Py_None) < 0)
+		*scope = LOCAL;
+		if (!nameset_add(local, name))
 			return 0;
-		if (PyDict_GetItem(global, name)) {
-			if (PyDict_DelItem(global, name) < 0)
-				return 0;
-		}
+		nameset_discard(global, name);
 		return 1;
 	}
 	/* If an enclosing block has a binding for this name, it
@@ -404,31 +559,27 @@ analyze_name(PySTEntryObject *ste, PyObject *dict, PyObject *name, long flags,
 	   Note that having a non-NULL bound implies that the block
 	   is nested.
 	*/
-	if (bound && PyDict_GetItem(bound, name)) {
-		SET_SCOPE(dict, name, FREE);
+	if (nameset_contains(bound, name)) {
+		*scope = FREE;
 		ste->ste_free = 1;
-		if (PyDict_SetItem(free, name, Py_None) < 0)
-			return 0;
-		return 1;
+		return nameset_add(free, name);
 	}
 	/* If a parent has a global statement, then call it global
 	   explicit?  It could also be global implicit.
 	 */
-	else if (global && PyDict_GetItem(global, name)) {
-		SET_SCOPE(dict, name, GLOBAL_EXPLICIT);
+	else if (nameset_contains(global, name)) {
+		*scope = GLOBAL_EXPLICIT;
 		return 1;
 	}
 	else {
 		if (ste->ste_nested)
 			ste->ste_free = 1;
-		SET_SCOPE(dict, name, GLOBAL_IMPLICIT);
+		*scope = GLOBAL_IMPLICIT;
 		return 1;
 	}
 	return 0; /* Can't get here */
 }
 
-#undef SET_SCOPE
-
 /* If a name is defined in free and also in locals, then this block
    provides the binding for the free variable.  The name should be
    marked CELL in this block and removed from the free list.
@@ -437,37 +588,23 @@ analyze_name(PySTEntryObject *ste, PyObject *dict, PyObject *name, long flags,
    That's safe because no name can be free and local in the same scope.
 */
 
-static int
-analyze_cells(PyObject *scope, PyObject *free)
+static void
+analyze_cells(PyObject *symbols, int *scopes, nameset *free)
 {
-        PyObject *name, *v, *w;
-	int success = 0;
+        PyObject *name, *v;
 	Py_ssize_t pos = 0;
+	int *scope;
 
-	w = PyInt_FromLong(CELL);
-	if (!w)
-		return 0;
-	while (PyDict_Next(scope, &pos, &name, &v)) {
-		long flags;
-		assert(PyInt_Check(v));
-		flags = PyInt_AS_LONG(v);
-		if (flags != LOCAL)
+	for (scope = scopes; PyDict_Next(symbols, &pos, &name, &v); scope++) {
+		if (*scope != LOCAL)
 			continue;
-		if (!PyDict_GetItem(free, name))
+		if (!nameset_contains(free, name))
 			continue;
 		/* Replace LOCAL with CELL for this name, and remove
-		   from free. It is safe to replace the value of name 
-		   in the dict, because it will not cause a resize.
-		 */
-		if (PyDict_SetItem(scope, name, w) < 0)
-			goto error;
-		if (!PyDict_DelItem(free, name) < 0)
-			goto error;
+		   from free. */
+		*scope = CELL;
+		nameset_discard(free, name);
 	}
-	success = 1;
- error:
-	Py_DECREF(w);
-	return success;
 }
 
 /* Check for illegal statements in unoptimized namespaces */
@@ -516,23 +653,22 @@ check_unoptimized(const PySTEntryObject* ste) {
 
 /* Enter the final scope information into the st_symbols dict. 
  * 
- * All arguments are dicts.  Modifies symbols, others are read-only.
+ * symbols is modified; scopes gives the scope of each of its names, and
+ * the sets are read-only.
 */
 static int
-update_symbols(PyObject *symbols, PyObject *scope, 
-               PyObject *bound, PyObject *free, int classflag)
+update_symbols(PyObject *symbols, int *scopes, 
+               nameset *bound, nameset *free, int classflag)
 {
-	PyObject *name, *v, *u, *w, *free_value = NULL;
+	PyObject *name, *v, *u, *free_value = NULL;
 	Py_ssize_t pos = 0;
+	int *scope;
 
-	while (PyDict_Next(symbols, &pos, &name, &v)) {
-		long i, flags;
+	for (scope = scopes; PyDict_Next(symbols, &pos, &name, &v); scope++) {
+		long flags;
 		assert(PyInt_Check(v));
 		flags = PyInt_AS_LONG(v);
-		w = PyDict_GetItem(scope, name);
-		assert(w && PyInt_Check(w));
-		i = PyInt_AS_LONG(w);
-		flags |= (i << SCOPE_OFF);
+		flags |= ((long)*scope << SCOPE_OFF);
 		u = PyInt_FromLong(flags);
 		if (!u)
 			return 0;
@@ -549,7 +685,7 @@ update_symbols(PyObject *symbols, PyObject *scope,
 
         /* add a free variable when it's only use is for creating a closure */
         pos = 0;
-	while (PyDict_Next(free, &pos, &name, &v)) {
+	while (nameset_next(free, &pos, &name)) {
 		PyObject *o = PyDict_GetItem(symbols, name);
 
 		if (o) {
@@ -575,7 +711,7 @@ update_symbols(PyObject *symbols, PyObject *scope,
 			/* else it's not free, probably a cell */
 			continue;
 		}
-		if (!PyDict_GetItem(bound, name))
+		if (!nameset_contains(bound, name))
 			continue;       /* it's a global */
 
 		if (PyDict_SetItem(symbols, name, free_value) < 0) {
@@ -589,6 +725,7 @@ update_symbols(PyObject *symbols, PyObject *scope,
 
 /* Make final symbol table decisions for block of ste.
    Arguments:
+   arena -- where the sets of the block are allocated
    ste -- current symtable entry (input/output)
    bound -- set of variables bound in enclosing scopes (input)
    free -- set of free variables in enclosed scopes (output)
@@ -596,62 +733,64 @@ update_symbols(PyObject *symbols, PyObject *scope,
 */
 
 static int
-analyze_block(PySTEntryObject *ste, PyObject *bound, PyObject *free, 
-	      PyObject *global)
+analyze_block(PyArena *arena, PySTEntryObject *ste, nameset *bound,
+	      nameset *free, nameset *global)
 {
-	PyObject *name, *v, *local = NULL, *scope = NULL, *newbound = NULL;
-	PyObject *newglobal = NULL, *newfree = NULL;
-	int i, success = 0;
+	PyObject *name, *v;
+	nameset *local, *newbound, *newglobal, *newfree;
+	int i, *scopes, *scope;
 	Py_ssize_t pos = 0;
 
-	local = PyDict_New();
+	assert(PySTEntry_Check(ste));
+	assert(PyDict_Check(ste->ste_symbols));
+	scopes = (int *)PyArena_Malloc(arena, 
+			PyDict_Size(ste->ste_symbols) * sizeof(int));
+	if (!scopes)
+		return 0;
+	local = nameset_new(arena);
 	if (!local)
-		goto error;
-	scope = PyDict_New();
-	if (!scope)
-		goto error;
-	newglobal = PyDict_New();
+		return 0;
+	newglobal = nameset_new(arena);
 	if (!newglobal)
-		goto error;
-	newfree = PyDict_New();
+		return 0;
+	newfree = nameset_new(arena);
 	if (!newfree)
-		goto error;
-	newbound = PyDict_New();
+		return 0;
+	newbound = nameset_new(arena);
 	if (!newbound)
-		goto error;
+		return 0;
 
 	if (ste->ste_type == ClassBlock) {
 		/* make a copy of globals before calling analyze_name(),
 		   because global statements in the class have no effect
 		   on nested functions.
 		*/
-		if (PyDict_Update(newglobal, global) < 0)
-			goto error;
+		if (!nameset_update(newglobal, global))
+			return 0;
 		if (bound)
-			if (PyDict_Update(newbound, bound) < 0)
-				goto error;
+			if (!nameset_update(newbound, bound))
+				return 0;
 	}
 
-	assert(PySTEntry_Check(ste));
-	assert(PyDict_Check(ste->ste_symbols));
-	while (PyDict_Next(ste->ste_symbols, &pos, &name, &v)) {
+	for (scope = scopes; PyDict_Next(ste->ste_symbols, &pos, &name, &v);
+	     scope++) {
 		long flags = PyInt_AS_LONG(v);
 		if (!analyze_name(ste, scope, name, flags, bound, local, free,
 				  global))
-			goto error;
+			return 0;
 	}
 
 	if (ste->ste_type != ClassBlock) {
 		if (ste->ste_type == FunctionBlock) {
-			if (PyDict_Update(newbound, local) < 0)
-				goto error;
+			if (!nameset_update(newbound, local))
+				return 0;
 		}
 		if (bound) {
-			if (PyDict_Update(newbound, bound) < 0)
-				goto error;
+			if (!nameset_update(newbound, bound))
+				return 0;
 		}
-		if (PyDict_Update(newglobal, global) < 0)
-			goto error;
+		if (!nameset_update(newglobal, global))
+			return 0;
 	}
 
 	/* Recursively call analyze_block() on each child block */
@@ -660,51 +799,39 @@ analyze_block(PySTEntryObject *ste, PyObject *bound, PyObject *free,
 		PySTEntryObject* entry;
 		assert(c && PySTEntry_Check(c));
 		entry = (PySTEntryObject*)c;
-		if (!analyze_block(entry, newbound, newfree, newglobal))
-			goto error;
+		if (!analyze_block(arena, entry, newbound, newfree, newglobal))
+			return 0;
 		if (entry->ste_free || entry->ste_child_free)
 			ste->ste_child_free = 1;
 	}
 
-	if (ste->ste_type == FunctionBlock && !analyze_cells(scope, newfree))
-		goto error;
-	if (!update_symbols(ste->ste_symbols, scope, bound, newfree,
+	if (ste->ste_type == FunctionBlock)
+		analyze_cells(ste->ste_symbols, scopes, newfree);
+	if (!update_symbols(ste->ste_symbols, scopes, bound, newfree,
 			    ste->ste_type == ClassBlock))
-		goto error;
+		return 0;
 	if (!check_unoptimized(ste))
-		goto error;
+		return 0;
 
-	if (PyDict_Update(free, newfree) < 0)
-		goto error;
-	success = 1;
- error:
-	Py_XDECREF(local);
-	Py_XDECREF(scope);
-	Py_XDECREF(newbound);
-	Py_XDECREF(newglobal);
-	Py_XDECREF(newfree);
-	if (!success)
-		assert(PyErr_Occurred());
-	return success;
+	return nameset_update(free, newfree);
 }
 
 static int
 symtable_analyze(struct symtable *st)
 {
-	PyObject *free, *global;
-	int r;
+	PyArena *arena;
+	nameset *free, *global;
+	int r = 0;
 
-	free = PyDict_New();
-	if (!free)
-	    return 0;
-	global = PyDict_New();
-	if (!global) {
-	    Py_DECREF(free);
+	arena = PyArena_New();
+	if (!arena)
 	    return 0;
-	}
-	r = analyze_block(st->st_top, NULL, free, global);
-	Py_DECREF(free);
-	Py_DECREF(global);
+	free = nameset_new(arena);
+	global = nameset_new(arena);
+	if (free && global)
+	    r = analyze_block(arena, st->st_top, NULL, free, global);
+	PyArena_Free(arena);
+	assert(r || PyErr_Occurred());
 	return r;
 }
 
@@ -860,12 +860,186 @@ PyDoc_STRVAR(sys_clear_type_cache__doc__,
 Clear the internal type lookup cache.");
 
 
+#ifdef WITH_PYMALLOC
+/* Add an integer entry to dict.  Return -1 on error. */
+static int
+add_size_stat(PyObject *dict, const char *name, size_t value)
+{
+	PyObject *v = PyLong_FromSize_t(value);
+	int err;
+
+	if (v == NULL)
+		return -1;
+	err = PyDict_SetItemString(dict, name, v);
+	Py_DECREF(v);
+	return err;
+}
+
+/* Return a new dict describing pymalloc's arenas and pools.  The snapshot
+   is taken before anything is allocated for the result. */
+static PyObject *
+pymalloc_stats(void)
+{
+	PyMallocStats st;
+	PyObject *dict, *classes = NULL, *v;
+	size_t arena_bytes;
+	unsigned int i;
+
+	_PyObject_GetMallocStats(&st);
+	arena_bytes = (st.arenas_allocated_current + st.parked_arenas) *
+		      st.arena_size;
+
+	dict = PyDict_New();
+	if (dict == NULL)
+		return NULL;
+	if (add_size_stat(dict, "small_request_threshold",
+			  st.small_request_threshold) < 0 ||
+	    add_size_stat(dict, "pool_size", st.pool_size) < 0 ||
+	    add_size_stat(dict, "arena_size", st.arena_size) < 0 ||
+	    add_size_stat(dict, "arenas_allocated_total",
+			  st.arenas_allocated_total) < 0 ||
+	    add_size_stat(dict, "arenas_reclaimed", st.arenas_reclaimed) < 0 ||
+	    add_size_stat(dict, "arenas_highwater", st.arenas_highwater) < 0 ||
+	    add_size_stat(dict, "arenas_allocated_current",
+			  st.arenas_allocated_current) < 0 ||
+	    add_size_stat(dict, "parked_arenas", st.parked_arenas) < 0 ||
+	    add_size_stat(dict, "arena_bytes", arena_bytes) < 0 ||
+	    add_size_stat(dict, "free_pools", st.free_pools) < 0 ||
+	    add_size_stat(dict, "released_pools", st.released_pools) < 0 ||
+	    add_size_stat(dict, "free_pool_bytes",
+			  st.free_pools * st.pool_size) < 0 ||
+	    add_size_stat(dict, "allocated_bytes", st.allocated_bytes) < 0 ||
+	    add_size_stat(dict, "available_bytes", st.available_bytes) < 0 ||
+	    add_size_stat(dict, "pool_header_bytes",
+			  st.pool_header_bytes) < 0 ||
+	    add_size_stat(dict, "quantization_bytes",
+			  st.quantization_bytes) < 0 ||
+	    add_size_stat(dict, "arena_alignment_bytes",
+			  st.arena_alignment_bytes) < 0)
+		goto error;
+
+	/* Fraction of the memory held in arenas which isn't handed out to
+	   anybody.  A high value with many arenas means the live blocks are
+	   scattered thinly, pinning arenas that can't go back to the system. */
+	v = PyFloat_FromDouble(arena_bytes == 0 ? 0.0 :
+			1.0 - (double)st.allocated_bytes / (double)arena_bytes);
+	if (v == NULL)
+		goto error;
+	i = PyDict_SetItemString(dict, "fragmentation", v);
+	Py_DECREF(v);
+	if (i != 0)
+		goto error;
+
+	classes = PyList_New(st.nsizeclasses);
+	if (classes == NULL)
+		goto error;
+	for (i = 0; i < st.nsizeclasses; i++) {
+		PyMallocSizeClassStats *sc = &st.sizeclasses[i];
+		v = Py_BuildValue("(nnnn)", (Py_ssize_t)sc->block_size,
+				  (Py_ssize_t)sc->pools,
+				  (Py_ssize_t)sc->blocks_in_use,
+				  (Py_ssize_t)sc->blocks_available);
+		if (v == NULL)
+			goto error;
+		PyList_SET_ITEM(classes, i, v);
+	}
+	if (PyDict_SetItemString(dict, "size_classes", classes) < 0)
+		goto error;
+	Py_DECREF(classes);
+	return dict;
+
+  error:
+	Py_XDECREF(classes);
+	Py_DECREF(dict);
+	return NULL;
+}
+#endif /* WITH_PYMALLOC */
+
+/* Add a (count, bytes) entry for one free list to dict.  Return -1 on
+   error. */
+static int
+add_freelist_stats(PyObject *dict, const char *name,
+		   void (*stats)(Py_ssize_t *, Py_ssize_t *))
+{
+	Py_ssize_t count, nbytes;
+	PyObject *v;
+	int err;
+
+	stats(&count, &nbytes);
+	v = Py_BuildValue("(nn)", count, nbytes);
+	if (v == NULL)
+		return -1;
+	err = PyDict_SetItemString(dict, name, v);
+	Py_DECREF(v);
+	return err;
+}
+
+static PyObject *
+sys_malloc_stats(PyObject *self)
+{
+	PyObject *stats, *freelists;
+
+#ifdef WITH_PYMALLOC
+	stats = pymalloc_stats();
+#else
+	stats = PyDict_New();
+#endif
+	if (stats == NULL)
+		return NULL;
+	freelists = PyDict_New();
+	if (freelists == NULL)
+		goto error;
+	if (add_freelist_stats(freelists, "int", _PyInt_FreeListStats) < 0 ||
+	    add_freelist_stats(freelists, "float",
+			       _PyFloat_FreeListStats) < 0 ||
+	    add_freelist_stats(freelists, "frame",
+			       _PyFrame_FreeListStats) < 0 ||
+	    add_freelist_stats(freelists, "tuple",
+			       _PyTuple_FreeListStats) < 0 ||
+	    PyDict_SetItemString(stats, "freelists", freelists) < 0)
+		goto error;
+	Py_DECREF(freelists);
+	return stats;
+
+  error:
+	Py_XDECREF(freelists);
+	Py_DECREF(stats);
+	return NULL;
+}
+
+PyDoc_STRVAR(malloc_stats_doc,
+"_malloc_stats() -> dict\n\
+\n\
+Return statistics about the small object allocator (pymalloc): arena\n\
+counts and high-water mark, per size class pool usage, byte totals and\n\
+a fragmentation ratio.  The 'freelists' entry maps the int, float, frame\n\
+and tuple free lists to (objects, bytes) pairs.  Only 'freelists' is\n\
+present if Python was built without pymalloc."
+);
+
+static PyObject *
+sys_compile_cache_stats(PyObject *self)
+{
+	return _PyCompileCache_GetStats();
+}
+
+PyDoc_STRVAR(compile_cache_stats_doc,
+"_compile_cache_stats() -> dict\n\
+\n\
+Return statistics about the cache of code objects kept by compile(),\n\
+eval() and exec of strings: its 'size' limit in kilobytes (0 if it is\n\
+off), the 'bytes' and 'entries' it holds, and its 'hits', 'misses' and\n\
+'evictions'."
+);
+
 static PyMethodDef sys_methods[] = {
 	/* Might as well keep this in alphabetic order */
 	{"callstats", (PyCFunction)PyEval_GetCallStats, METH_NOARGS,
 	 callstats_doc},
 	{"_clear_type_cache",	sys_clear_type_cache,	  METH_NOARGS,
 	 sys_clear_type_cache__doc__},
+	{"_compile_cache_stats", (PyCFunction)sys_compile_cache_stats,
+	 METH_NOARGS, compile_cache_stats_doc},
 	{"_current_frames", sys_current_frames, METH_NOARGS,
 	 current_frames_doc},
 	{"displayhook",	sys_displayhook, METH_O, displayhook_doc},
@@ -903,6 +1077,8 @@ static PyMethodDef sys_methods[] = {
 	{"getsizeof",   (PyCFunction)sys_getsizeof,
 	 METH_VARARGS | METH_KEYWORDS, getsizeof_doc},
 	{"_getframe", sys_getframe, METH_VARARGS, getframe_doc},
+	{"_malloc_stats", (PyCFunction)sys_malloc_stats, METH_NOARGS,
+	 malloc_stats_doc},
 #ifdef MS_WINDOWS
 	{"getwindowsversion", (PyCFunction)sys_getwindowsversion, METH_NOARGS,
 	 getwindowsversion_doc},
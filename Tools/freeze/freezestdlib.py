@@ -0,0 +1,115 @@
+#! /usr/bin/env python
+
+"""Freeze standard library modules into the interpreter.
+
+usage: freezestdlib.py libdir output module...
+
+Writes output, a replacement for Python/frozenstdlib.c, holding the code
+of the modules named, compiled from their sources in libdir.  A name of
+the form pkg.* stands for the package pkg and the modules directly in it.
+"make frozenstdlib" runs this for the modules in FROZEN_STDLIB.
+
+The code objects' file names are relative to libdir (os.py,
+encodings/utf_8.py), which the linecache module looks up along sys.path.
+"""
+
+import marshal
+import os
+import sys
+
+header = """\
+/* Standard library modules frozen into the interpreter.
+
+   Generated by Tools/freeze/freezestdlib.py; "make frozenstdlib" makes it
+   again. */
+
+#include "Python.h"
+"""
+
+def find(libdir, name):
+    """Return the source file of module name relative to libdir, and
+    whether it is a package."""
+    relname = os.path.join(*name.split('.'))
+    init = os.path.join(relname, '__init__.py')
+    if os.path.isfile(os.path.join(libdir, init)):
+        return init, True
+    if os.path.isfile(os.path.join(libdir, relname + '.py')):
+        return relname + '.py', False
+    raise ValueError("no source for module %s in %s" % (name, libdir))
+
+def expand(libdir, names):
+    """Return the sorted module names that names stand for."""
+    modules = set()
+    for name in names:
+        if not name.endswith('.*'):
+            modules.add(name)
+            continue
+        package = name[:-2]
+        init, ispackage = find(libdir, package)
+        if not ispackage:
+            raise ValueError("%s is not a package" % package)
+        modules.add(package)
+        for filename in os.listdir(os.path.join(libdir, os.path.dirname(init))):
+            base, ext = os.path.splitext(filename)
+            if ext == '.py' and base != '__init__':
+                modules.add(package + '.' + base)
+    return sorted(modules)
+
+def freeze(libdir, name):
+    """Return the marshalled code of module name, and whether it is a
+    package."""
+    relname, ispackage = find(libdir, name)
+    f = open(os.path.join(libdir, relname), 'U')
+    try:
+        source = f.read()
+    finally:
+        f.close()
+    if source and source[-1] != '\n':
+        source += '\n'
+    code = compile(source, relname.replace(os.sep, '/'), 'exec')
+    return marshal.dumps(code), ispackage
+
+def writecode(outfp, mangled, data):
+    outfp.write('static const unsigned char M_%s[] = {' % mangled)
+    for i in range(0, len(data), 16):
+        outfp.write('\n\t')
+        for c in data[i:i+16]:
+            outfp.write('%d,' % ord(c))
+    outfp.write('\n};\n')
+
+def main(args):
+    if len(args) < 2:
+        print >>sys.stderr, __doc__
+        return 2
+    libdir, output = args[:2]
+    try:
+        modules = expand(libdir, args[2:])
+        frozen = [(name,) + freeze(libdir, name) for name in modules]
+    except (ValueError, IOError, SyntaxError), msg:
+        print >>sys.stderr, "freezestdlib:", msg
+        return 1
+    tmpname = output + '.tmp'
+    outfp = open(tmpname, 'w')
+    try:
+        outfp.write(header)
+        for name, data, ispackage in frozen:
+            outfp.write('\n')
+            writecode(outfp, name.replace('.', '__'), data)
+        outfp.write('\nstruct _frozen _PyImport_FrozenStdlib[] = {\n')
+        for name, data, ispackage in frozen:
+            size = len(data)
+            if ispackage:
+                # Indicate package by negative size
+                size = -size
+            outfp.write('\t{"%s", (unsigned char *)M_%s, %d},\n'
+                        % (name, name.replace('.', '__'), size))
+        outfp.write('\t{0, 0, 0} /* sentinel */\n};\n')
+    finally:
+        outfp.close()
+    if os.path.exists(output):
+        os.remove(output)
+    os.rename(tmpname, output)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
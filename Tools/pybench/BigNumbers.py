@@ -0,0 +1,123 @@
+from pybench import Test
+
+# Operands sized to exercise each of the long multiplication tiers:
+# Karatsuba below 400 digits (of 15 bits), Toom-Cook 3-way from there to
+# 1500 digits, and the number-theoretic transform above that.
+
+class LongMultiplication(Test):
+
+    version = 2.0
+    operations = 10
+    rounds = 4000
+
+    def test(self):
+
+        a = 7L ** 2000
+        b = 11L ** 1700
+
+        for i in xrange(self.rounds):
+
+            a * b
+            b * a
+            a * b
+            b * a
+            a * b
+
+            a * a
+            b * b
+            a * a
+            b * b
+            a * a
+
+    def calibrate(self):
+
+        a = 7L ** 2000
+        b = 11L ** 1700
+
+        for i in xrange(self.rounds):
+            pass
+
+class ToomLongMultiplication(Test):
+
+    version = 2.0
+    operations = 10
+    rounds = 800
+
+    def test(self):
+
+        a = 7L ** 6000
+        b = 11L ** 5000
+
+        for i in xrange(self.rounds):
+
+            a * b
+            b * a
+            a * b
+            b * a
+            a * b
+
+            a * a
+            b * b
+            a * a
+            b * b
+            a * a
+
+    def calibrate(self):
+
+        a = 7L ** 6000
+        b = 11L ** 5000
+
+        for i in xrange(self.rounds):
+            pass
+
+class HugeLongMultiplication(Test):
+
+    version = 2.0
+    operations = 4
+    rounds = 60
+
+    def test(self):
+
+        a = 7L ** 100000
+        b = 11L ** 80000
+
+        for i in xrange(self.rounds):
+
+            a * b
+            b * a
+            a * a
+            b * b
+
+    def calibrate(self):
+
+        a = 7L ** 100000
+        b = 11L ** 80000
+
+        for i in xrange(self.rounds):
+            pass
+
+class LongModularPower(Test):
+
+    version = 2.0
+    operations = 2
+    rounds = 8
+
+    def test(self):
+
+        m = 13L ** 4000 + 6
+        a = 7L ** 3500
+        e = 3L ** 100
+
+        for i in xrange(self.rounds):
+
+            pow(a, e, m)
+            pow(a + 1, e, m)
+
+    def calibrate(self):
+
+        m = 13L ** 4000 + 6
+        a = 7L ** 3500
+        e = 3L ** 100
+
+        for i in xrange(self.rounds):
+            pass
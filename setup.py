@@ -455,6 +455,8 @@ class PyBuildExt(build_ext):
         exts.append( Extension("_bytesio", ["_bytesio.c"]) )
         # _functools
         exts.append( Extension("_functools", ["_functoolsmodule.c"]) )
+        # string builders
+        exts.append( Extension("_stringbuilder", ["_stringbuilder.c"]) )
         # _json speedups
         exts.append( Extension("_json", ["_json.c"]) )
         # Python C API test module